@@ -0,0 +1,67 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#ifndef ATOMIC_OPS_H
+#define ATOMIC_OPS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Helpers for data which is shared between threads using the same 
+ * security context. They are implemented with the GCC/Clang __atomic 
+ * builtins when OSCORE_THREAD_SAFE is defined and are plain operations 
+ * otherwise, so that single threaded builds on small MCUs need neither 
+ * 64 bit atomics nor locks.
+ */
+
+/**
+ * @brief   Adds v to *p and returns the previous value of *p
+ */
+static inline uint64_t fetch_add_u64(uint64_t *p, uint64_t v)
+{
+#ifdef OSCORE_THREAD_SAFE
+	return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#else
+	uint64_t old = *p;
+	*p = old + v;
+	return old;
+#endif
+}
+
+/**
+ * @brief   Acquires a spin lock. The lock must be held only for a few 
+ *          instructions.
+ * @param   lock the lock, false if it is free
+ */
+static inline void spin_lock(bool *lock)
+{
+#ifdef OSCORE_THREAD_SAFE
+	while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+	}
+#else
+	(void)lock;
+#endif
+}
+
+/**
+ * @brief   Releases a spin lock acquired with spin_lock()
+ */
+static inline void spin_unlock(bool *lock)
+{
+#ifdef OSCORE_THREAD_SAFE
+	__atomic_clear(lock, __ATOMIC_RELEASE);
+#else
+	(void)lock;
+#endif
+}
+
+#endif
@@ -22,6 +22,12 @@ struct byte_array {
 	uint8_t *ptr;
 };
 
+/* Read-only array with pointer and length, e.g., an input segment.*/
+struct const_byte_array {
+	uint32_t len;
+	const uint8_t *ptr;
+};
+
 /* Empty Array with len=0 but with a non-null pointer.*/
 extern struct byte_array EMPTY_ARRAY;
 
@@ -0,0 +1,96 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef CBOR_HEAD_H
+#define CBOR_HEAD_H
+
+#include <stdint.h>
+
+#include "oscore_edhoc_error.h"
+
+/*CBOR major types, see RFC8949 section 3.1*/
+#define CBOR_UINT 0
+#define CBOR_NINT 1
+#define CBOR_BSTR 2
+#define CBOR_TSTR 3
+#define CBOR_ARRAY 4
+
+/*the largest head needed for 32 bit arguments*/
+#define CBOR_HEAD_MAX_SIZE 5
+
+/**
+ * @brief Encodes the head of a CBOR data item, i.e., the initial byte and 
+ *        the argument in its shortest form. For byte and text strings the 
+ *        content which follows the head is not part of the encoding, which 
+ *        allows to hash or MAC long strings without copying them.
+ * 
+ * @param major_type the major type, e.g., CBOR_BSTR
+ * @param argument the value of an integer, the length of a string or the 
+ *        number of elements of an array
+ * @param out output buffer of at least CBOR_HEAD_MAX_SIZE bytes
+ * @param out_len in: the length of out, out: the length of the head
+ * @return enum err 
+ */
+enum err cbor_head_encode(uint8_t major_type, uint32_t argument, uint8_t *out,
+			  uint32_t *out_len);
+
+/**
+ * @brief Decodes the head of a CBOR data item, see cbor_head_encode(). 
+ *        Only arguments up to 32 bit are supported.
+ * 
+ * @param in the encoded data item
+ * @param in_len length of in
+ * @param major_type the major type (output)
+ * @param argument the argument (output)
+ * @param head_len the length of the head (output)
+ * @return enum err, cbor_decoding_error if in does not start with a 
+ *         supported head
+ */
+enum err cbor_head_decode(const uint8_t *in, uint32_t in_len,
+			  uint8_t *major_type, uint32_t *argument,
+			  uint32_t *head_len);
+
+/**
+ * @brief Encodes an integer as CBOR unsigned or negative integer.
+ * 
+ * @param value the integer
+ * @param out output buffer of at least CBOR_HEAD_MAX_SIZE bytes
+ * @param out_len in: the length of out, out: the length of the encoding
+ * @return enum err 
+ */
+enum err cbor_int_encode(int32_t value, uint8_t *out, uint32_t *out_len);
+
+/**
+ * @brief Appends the head of a CBOR data item to a buffer.
+ * 
+ * @param major_type the major type, e.g., CBOR_BSTR
+ * @param argument see cbor_head_encode()
+ * @param out the buffer
+ * @param out_size the size of out
+ * @param offset in: the current end of the data in out, out: the new end
+ * @return enum err 
+ */
+enum err cbor_head_append(uint8_t major_type, uint32_t argument, uint8_t *out,
+			  uint32_t out_size, uint32_t *offset);
+
+/**
+ * @brief Appends raw bytes, e.g., the content of a CBOR string, to a buffer.
+ * 
+ * @param in the bytes to be appended, may be NULL if in_len is 0
+ * @param in_len length of in
+ * @param out the buffer
+ * @param out_size the size of out
+ * @param offset in: the current end of the data in out, out: the new end
+ * @return enum err 
+ */
+enum err cbor_bytes_append(const uint8_t *in, uint32_t in_len, uint8_t *out,
+			   uint32_t out_size, uint32_t *offset);
+
+#endif
@@ -16,12 +16,144 @@
 
 #include "edhoc/suites.h"
 
+#ifdef TINYCRYPT
+#include <tinycrypt/aes.h>
+#include <tinycrypt/sha256.h>
+#endif
+
+#if defined(EDHOC_ECC_RESTARTABLE) && !defined(MBEDTLS)
+#error "EDHOC_ECC_RESTARTABLE requires MBEDTLS"
+#endif
+
+#ifdef MBEDTLS
+/*the PSA operation objects are embedded in the structs below*/
+#include <psa/crypto.h>
+#ifdef EDHOC_ECC_RESTARTABLE
+#include <mbedtls/ecp.h>
+#include <mbedtls/ecdsa.h>
+#endif
+#endif
+
+/*state of sliced P-256 operations, defined with EDHOC_ECC_RESTARTABLE*/
+struct ecc_restart;
+
+/*HMAC-SHA-256 block size*/
+#define HMAC_BLOCK_SIZE 64
+
 /*Indicates what kind of operation a symmetric cipher will execute*/
 enum aes_operation {
 	ENCRYPT,
 	DECRYPT,
 };
 
+/**
+ * @brief   A symmetric AEAD key prepared for the selected crypto backend. 
+ *          It is created once with aead_key_init() and can be used for 
+ *          any number of aead_prepared() calls until aead_key_destroy() is 
+ *          called.
+ */
+struct aead_key {
+	bool initialized;
+	uint32_t tag_len;
+#ifdef TINYCRYPT
+	/*expanded AES-128 key schedule*/
+	struct tc_aes_key_sched_struct sched;
+#endif
+#ifdef MBEDTLS
+	/*id of a volatile PSA key*/
+	psa_key_id_t key_id;
+#endif
+};
+
+/**
+ * @brief   State of an incremental hash computation, see hash_init(), 
+ *          hash_update() and hash_final().
+ */
+struct hash_ctx {
+	enum hash_alg alg;
+#if defined(TINYCRYPT)
+	struct tc_sha256_state_struct s;
+#elif defined(MBEDTLS)
+	psa_hash_operation_t op;
+#endif
+};
+
+/**
+ * @brief   An HMAC key prepared for repeated HMAC computations, e.g., for 
+ *          deriving several keys from the same PRK. The hash states after 
+ *          absorbing the inner (key XOR ipad) and the outer (key XOR opad) 
+ *          blocks are computed once in hmac_key_init(), so that every HMAC 
+ *          computed with the key saves the two compression function calls 
+ *          of the key setup.
+ */
+struct hmac_key {
+	enum hash_alg alg;
+	bool initialized;
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	struct hash_ctx inner;
+	struct hash_ctx outer;
+#else
+	/*no built in crypto back-end, keep the raw key for hkdf_expand()*/
+	uint8_t key[HMAC_BLOCK_SIZE];
+	uint32_t key_len;
+#endif
+};
+
+/**
+ * @brief   State of an incremental HMAC computation with a prepared key, 
+ *          see hmac_init(), hmac_update() and hmac_final(). The key must 
+ *          stay valid until hmac_final() is called.
+ */
+struct hmac_ctx {
+	struct hmac_key *key;
+	struct hash_ctx inner;
+};
+
+
+/**
+ * @brief   Imports a symmetric key into the crypto backend so that it can 
+ *          be reused for multiple AEAD operations
+ * @param   k the prepared key
+ * @param   key the raw symmetric key
+ * @param   key_len length of key
+ * @param   tag_len the length of the authentication tags produced and 
+ *          verified with this key
+ * @retval  an err code
+ */
+enum err aead_key_init(struct aead_key *k, const uint8_t *key,
+		       const uint32_t key_len, const uint32_t tag_len);
+
+/**
+ * @brief   Releases all backend resources held by a prepared key. Calling 
+ *          it on a key which is not initialized has no effect.
+ * @param   k the prepared key
+ * @retval  an err code
+ */
+enum err aead_key_destroy(struct aead_key *k);
+
+/**
+ * @brief   Calculates AEAD encryption decryption with a prepared key
+ * @param   op opeartion to be executed (ENCRYPT or DECRYPT)
+ * @param   in  input message
+ * @param   in_len length of in
+ * @param   k the prepared key, see aead_key_init()
+ * @param   nonce the nonce
+ * @param   nonce_len length of nonce
+ * @param   aad additional authenticated data
+ * @param   aad_len length of add
+ * @param   out the cipher text
+ * @param   out_len the length of out
+ * @param   tag the authentication tag
+ * @param   tag_len the length of tag
+ * @retval  an err code
+ */
+enum err aead_prepared(enum aes_operation op, const uint8_t *in,
+		       const uint32_t in_len, struct aead_key *k,
+		       uint8_t *nonce, const uint32_t nonce_len,
+		       const uint8_t *aad, const uint32_t aad_len, uint8_t *out,
+		       const uint32_t out_len, uint8_t *tag,
+		       const uint32_t tag_len);
+
 /**
  * @brief   Calculates AEAD encryption decryption
  * @param   op opeartion to be executed (ENCRYPT or DECRYPT)
@@ -50,7 +182,8 @@ enum err aead(enum aes_operation op, const uint8_t *in, const uint32_t in_len,
  * @param   alg the ECDH algorithm
  * @param   sk private key
  * @param   sk_len length of sk
- * @param   pk public key
+ * @param   pk public key, P-256 keys may be compressed or uncompressed, 
+ *          uncompressed keys need no decompression
  * @param   pk_len length of pk
  * @param   shared_secret the result
  * @retval  an err code
@@ -59,6 +192,22 @@ enum err shared_secret_derive(enum ecdh_alg alg, const uint8_t *sk,
 			      const uint32_t sk_len, const uint8_t *pk,
 			      const uint32_t pk_len, uint8_t *shared_secret);
 
+/**
+ * @brief   Generates an ephemeral DH key pair from EPHEMERAL_RANDOM_SIZE 
+ *          random bytes. X25519 keys use the bytes as the secret seed, 
+ *          other curves are generated with ephemeral_dh_key_gen().
+ * @param   alg the DH curve
+ * @param   random fresh random bytes of the caller
+ * @param   random_len length of random, must be EPHEMERAL_RANDOM_SIZE
+ * @param   sk the private key
+ * @param   pk the public key
+ * @param   pk_size size of pk as input, length of the public key as output
+ * @retval  an err code
+ */
+enum err ephemeral_dh_key_gen_random(enum ecdh_alg alg, const uint8_t *random,
+				     uint32_t random_len, uint8_t *sk,
+				     uint8_t *pk, uint32_t *pk_size);
+
 /**
  * @brief   HKDF extract function, see rfc5869
  * @param   alg hash algorithm to be used
@@ -87,6 +236,54 @@ enum err hkdf_expand(enum hash_alg alg, const uint8_t *prk,
 		     const uint32_t prk_len, const uint8_t *info,
 		     const uint32_t info_len, uint8_t *out, uint32_t out_len);
 
+/**
+ * @brief   Prepares an HMAC key, see struct hmac_key
+ * @param   alg hash algorithm to be used
+ * @param   k the prepared key
+ * @param   key the raw key, e.g., a PRK
+ * @param   key_len length of key
+ * @retval  an err code
+ */
+enum err hmac_key_init(enum hash_alg alg, struct hmac_key *k,
+		       const uint8_t *key, const uint32_t key_len);
+
+/**
+ * @brief   Releases and zeroizes a prepared HMAC key. Calling it on a key 
+ *          which is not initialized has no effect.
+ * @param   k the prepared key
+ * @retval  an err code
+ */
+enum err hmac_key_destroy(struct hmac_key *k);
+
+/**
+ * @brief   HKDF expand function, see rfc5869, using a prepared PRK
+ * @param   prk the prepared pseudo random key, see hmac_key_init()
+ * @param   info info input parameter
+ * @param   info_len length of info
+ * @param   out the result
+ * @param   out_len length of out
+ * @retval  an err code
+ */
+enum err hkdf_expand_prepared(struct hmac_key *prk, const uint8_t *info,
+			      const uint32_t info_len, uint8_t *out,
+			      uint32_t out_len);
+
+/**
+ * @brief   Same as hkdf_expand_prepared() but with an info parameter given 
+ *          as a sequence of segments which are concatenated by the HMAC, 
+ *          so that info does not need to be assembled in a buffer
+ * @param   prk the prepared pseudo random key, see hmac_key_init()
+ * @param   info the info segments
+ * @param   info_cnt number of elements in info
+ * @param   out the result
+ * @param   out_len length of out
+ * @retval  an err code
+ */
+enum err hkdf_expand_prepared_segments(struct hmac_key *prk,
+				       const struct const_byte_array *info,
+				       uint32_t info_cnt, uint8_t *out,
+				       uint32_t out_len);
+
 /**
  * @brief   calculates a hash
  * @param   alg the hash algorithm
@@ -98,6 +295,75 @@ enum err hkdf_expand(enum hash_alg alg, const uint8_t *prk,
 enum err hash(enum hash_alg alg, const uint8_t *in, const uint32_t in_len,
 	      uint8_t *out);
 
+/**
+ * @brief   Starts an incremental hash computation
+ * @param   alg the hash algorithm
+ * @param   ctx the hash state to be initialized
+ * @retval  an err code
+ */
+enum err hash_init(enum hash_alg alg, struct hash_ctx *ctx);
+
+/**
+ * @brief   Absorbs the next piece of the message into a hash state
+ * @param   ctx the hash state
+ * @param   in the next piece of the message, may be NULL if in_len is 0
+ * @param   in_len length of in
+ * @retval  an err code
+ */
+enum err hash_update(struct hash_ctx *ctx, const uint8_t *in,
+		     const uint32_t in_len);
+
+/**
+ * @brief   Finishes an incremental hash computation. The state can not be 
+ *          used afterwards unless it is initialized again.
+ * @param   ctx the hash state
+ * @param   out the hash 
+ * @retval  an err code
+ */
+enum err hash_final(struct hash_ctx *ctx, uint8_t *out);
+
+/**
+ * @brief   Copies a hash state, e.g., to hash several messages with a 
+ *          common prefix
+ * @param   src the hash state to be copied
+ * @param   dst the new hash state
+ * @retval  an err code
+ */
+enum err hash_clone(struct hash_ctx *src, struct hash_ctx *dst);
+
+/**
+ * @brief   Aborts an incremental hash computation and zeroizes its state
+ * @param   ctx the hash state
+ * @retval  an err code
+ */
+enum err hash_abort(struct hash_ctx *ctx);
+
+/**
+ * @brief   Starts an incremental HMAC computation
+ * @param   ctx the HMAC state to be initialized
+ * @param   k a prepared key, see hmac_key_init()
+ * @retval  an err code
+ */
+enum err hmac_init(struct hmac_ctx *ctx, struct hmac_key *k);
+
+/**
+ * @brief   Absorbs the next piece of the message into an HMAC state
+ * @param   ctx the HMAC state
+ * @param   in the next piece of the message, may be NULL if in_len is 0
+ * @param   in_len length of in
+ * @retval  an err code
+ */
+enum err hmac_update(struct hmac_ctx *ctx, const uint8_t *in,
+		     const uint32_t in_len);
+
+/**
+ * @brief   Finishes an incremental HMAC computation
+ * @param   ctx the HMAC state
+ * @param   out the MAC (SHA_DEFAULT_SIZE bytes)
+ * @retval  an err code
+ */
+enum err hmac_final(struct hmac_ctx *ctx, uint8_t *out);
+
 /**
  * @brief   Verifies an asymmetric signature
  * @param   alg signature algorithm to be used
@@ -129,6 +395,236 @@ enum err verify(enum sign_alg alg, const uint8_t *pk, const uint32_t pk_len,
 		const uint8_t *msg, const uint32_t msg_len, const uint8_t *sgn,
 		const uint32_t sgn_len, bool *result);
 
+/**
+ * @brief   A public signature key prepared for the selected crypto backend, 
+ *          see verify_key_init(). With MBEDTLS an ES256 key is imported 
+ *          into PSA once. The compact25519 API takes EdDSA keys only in 
+ *          encoded form, such keys are referenced as they are.
+ */
+struct verify_key {
+	bool initialized;
+	enum sign_alg alg;
+	/*the encoded key, it must stay valid while the key is in use*/
+	const uint8_t *pk;
+	uint32_t pk_len;
+#ifdef MBEDTLS
+	/*id of a volatile PSA key or PSA_KEY_HANDLE_INIT*/
+	psa_key_id_t key_id;
+#endif
+};
+
+/**
+ * @brief   Prepares a public key for multiple verify_prepared() calls
+ * @param   k the prepared key
+ * @param   alg signature algorithm the key is used with
+ * @param   pk public key, ES256 keys are uncompressed
+ * @param   pk_len length of pk
+ * @retval  an err code
+ */
+enum err verify_key_init(struct verify_key *k, enum sign_alg alg,
+			 const uint8_t *pk, const uint32_t pk_len);
+
+/**
+ * @brief   Releases all backend resources held by a prepared public key. 
+ *          Calling it on a key which is not initialized has no effect.
+ * @param   k the prepared key
+ * @retval  an err code
+ */
+enum err verify_key_destroy(struct verify_key *k);
+
+/**
+ * @brief   Verifies an asymmetric signature with a prepared public key, 
+ *          see verify()
+ * @param   k the prepared key
+ * @param   msg the signed message
+ * @param   msg_len length of msg
+ * @param   sgn signature
+ * @param   sgn_len length of sgn
+ * @param   result true if the signature verification is successfully
+ * @retval  an err code
+ */
+enum err verify_prepared(const struct verify_key *k, const uint8_t *msg,
+			 const uint32_t msg_len, const uint8_t *sgn,
+			 const uint32_t sgn_len, bool *result);
+
+/**
+ * @brief   A private signature key prepared for the selected crypto 
+ *          backend, see sign_key_init(). With MBEDTLS an ES256 key is 
+ *          imported into PSA once. With EDHOC_ECC_RESTARTABLE the P-256 
+ *          group, the scalar and the fixed-base comb table of the group 
+ *          generator are kept, so that each signature runs only the comb 
+ *          multiplication. The compact25519 API takes EdDSA keys only in 
+ *          encoded form, such keys are referenced as they are. The key is 
+ *          not synchronized, threads sharing it must serialize its use.
+ */
+struct sign_key {
+	bool initialized;
+	enum sign_alg alg;
+	/*the encoded keys, they must stay valid while the key is in use*/
+	const uint8_t *sk;
+	uint32_t sk_len;
+	const uint8_t *pk;
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	mbedtls_ecp_group grp;
+	mbedtls_mpi d;
+#elif defined(MBEDTLS)
+	/*id of a volatile PSA key or PSA_KEY_HANDLE_INIT*/
+	psa_key_id_t key_id;
+#endif
+};
+
+/**
+ * @brief   Prepares a private key for multiple sign_prepared() calls
+ * @param   k the prepared key
+ * @param   alg signature algorithm the key is used with
+ * @param   sk secret key
+ * @param   sk_len length of sk
+ * @param   pk public key, used by EdDSA
+ * @retval  an err code
+ */
+enum err sign_key_init(struct sign_key *k, enum sign_alg alg,
+		       const uint8_t *sk, const uint32_t sk_len,
+		       const uint8_t *pk);
+
+/**
+ * @brief   Releases all backend resources held by a prepared private key. 
+ *          Calling it on a key which is not initialized has no effect.
+ * @param   k the prepared key
+ * @retval  an err code
+ */
+enum err sign_key_destroy(struct sign_key *k);
+
+/**
+ * @brief   Computes an asymmetric signature with a prepared private key, 
+ *          see sign()
+ * @param   k the prepared key
+ * @param   msg the message to be signed
+ * @param   msg_len length of msg
+ * @param   out signature
+ * @retval  an err code
+ */
+enum err sign_prepared(struct sign_key *k, const uint8_t *msg,
+		       const uint32_t msg_len, uint8_t *out);
+
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+/*maximal number of P-256 operations of one EDHOC message, e.g., the ECDH 
+of G_XY, the ECDH of G_RX and the signature of message 3*/
+#define ECC_RESTART_OPS 3
+/*size of a result, an ES256 signature is longer than a P-256 ECDH secret*/
+#define ECC_RESTART_RESULT_SIZE 64
+
+/**
+ * @brief   State of the P-256 operations of one message which are computed 
+ *          in slices, see ecc_restartable_config(). The operations are 
+ *          numbered in the order in which they are started. When the 
+ *          message is processed again after ecc_operation_in_progress, 
+ *          the finished operations return their kept results and the 
+ *          unfinished operation continues with its kept operands and 
+ *          mbedtls restart context.
+ */
+struct ecc_restart {
+	/*number of the next operation of the current pass*/
+	uint8_t next;
+	/*number of finished operations*/
+	uint8_t done;
+	/*results of the finished operations*/
+	uint8_t results[ECC_RESTART_OPS][ECC_RESTART_RESULT_SIZE];
+	/*operands of the unfinished operation, mbedtls requires the same 
+	group object in every slice*/
+	bool loaded;
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_point q;
+	mbedtls_ecp_point p;
+	mbedtls_mpi d;
+	mbedtls_mpi r;
+	mbedtls_mpi s;
+	mbedtls_ecp_restart_ctx ecp;
+	mbedtls_ecdsa_restart_ctx ecdsa;
+};
+
+/**
+ * @brief   Sets the maximal number of basic operations of one slice of 
+ *          the *_restartable() functions, see mbedtls_ecp_set_max_ops(). 
+ *          The setting is global.
+ * @param   max_ops maximal number of basic operations per slice, 0 for 
+ *          unlimited
+ */
+void ecc_restartable_config(uint32_t max_ops);
+
+/**
+ * @brief   Initializes the state of the P-256 operations of a message
+ * @param   rs the state
+ */
+void ecc_restart_init(struct ecc_restart *rs);
+
+/**
+ * @brief   Starts a new pass over the operations of a message, i.e., the 
+ *          next operation is the first one again
+ * @param   rs the state
+ */
+void ecc_restart_rewind(struct ecc_restart *rs);
+
+/**
+ * @brief   Releases and zeroizes the state of the operations of a message. 
+ *          It is initialized afterwards and can be used for the next 
+ *          message.
+ * @param   rs the state
+ */
+void ecc_restart_free(struct ecc_restart *rs);
+#endif
+
+/**
+ * @brief   Computes a signature, with sign_prepared() if k is prepared for 
+ *          alg and with sign() otherwise. With EDHOC_ECC_RESTARTABLE and 
+ *          rs not NULL an ES256 signature is computed in slices.
+ * @param   rs state of the sliced operations or NULL for a computation in 
+ *          one go
+ * @param   k a prepared key or NULL
+ * @retval  ecc_operation_in_progress if the operations of the pass have 
+ *          to be called again with the same parameters after 
+ *          ecc_restart_rewind(), otherwise an err code
+ */
+enum err sign_restartable(struct ecc_restart *rs, struct sign_key *k,
+			  enum sign_alg alg, const uint8_t *sk,
+			  const uint32_t sk_len, const uint8_t *pk,
+			  const uint8_t *msg, const uint32_t msg_len,
+			  uint8_t *out);
+
+/**
+ * @brief   Verifies a signature, with verify_prepared() if k is prepared 
+ *          for alg and with verify() otherwise. With EDHOC_ECC_RESTARTABLE 
+ *          and rs not NULL an ES256 signature is verified in slices.
+ * @param   rs state of the sliced operations or NULL for a computation in 
+ *          one go
+ * @param   k a prepared key or NULL
+ * @retval  ecc_operation_in_progress if the operations of the pass have 
+ *          to be called again with the same parameters after 
+ *          ecc_restart_rewind(), otherwise an err code
+ */
+enum err verify_restartable(struct ecc_restart *rs,
+			    const struct verify_key *k, enum sign_alg alg,
+			    const uint8_t *pk, uint32_t pk_len,
+			    const uint8_t *msg, const uint32_t msg_len,
+			    const uint8_t *sgn, const uint32_t sgn_len,
+			    bool *result);
+
+/**
+ * @brief   Derives an ECDH shared secret, see shared_secret_derive(). With 
+ *          EDHOC_ECC_RESTARTABLE and rs not NULL a P-256 secret is 
+ *          computed in slices.
+ * @param   rs state of the sliced operations or NULL for a computation in 
+ *          one go
+ * @retval  ecc_operation_in_progress if the operations of the pass have 
+ *          to be called again with the same parameters after 
+ *          ecc_restart_rewind(), otherwise an err code
+ */
+enum err shared_secret_derive_restartable(struct ecc_restart *rs,
+					  enum ecdh_alg alg, const uint8_t *sk,
+					  const uint32_t sk_len,
+					  const uint8_t *pk,
+					  const uint32_t pk_len,
+					  uint8_t *shared_secret);
+
 /**
  * @brief   HKDF funcion used for the derivation of the Common IV, 
  *          Recipient/Sender keys.
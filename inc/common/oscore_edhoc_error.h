@@ -46,7 +46,17 @@ enum err {
 	no_such_ca = 117,
 
 	cbor_encoding_error = 119,
+	cbor_decoding_error = 120,
 	suites_i_list_to_long = 121,
+	session_table_full = 122,
+	session_not_found = 123,
+	state_token_invalid = 124,
+	ephemeral_key_pool_full = 125,
+	ephemeral_key_pool_empty = 126,
+	certificate_expired = 127,
+	message_retransmitted = 128,
+	state_token_expired = 129,
+	ecc_operation_in_progress = 130,
 
 	/*OSCORE specific errors*/
 	oscore_unknown_hkdf = 202,
@@ -62,6 +72,10 @@ enum err {
 	len_extra_byte_error = 216,
 	not_valid_input_packet = 218,
 	replayed_packed_received = 219,
+	oscore_context_table_full = 220,
+	oscore_context_table_duplicate = 221,
+	oscore_request_table_full = 222,
+	oscore_request_not_found = 223,
 
 };
 
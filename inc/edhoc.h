@@ -42,8 +42,6 @@
 #define ID_CRED_DEFAULT_SIZE 20
 #define PRK_3AE_DEFAULT_SIZE 100
 #define CERT_DEFAUT_SIZE 128
-#define CONTEXT_MAC_DEFAULT_SIZE 200
-#define INFO_DEFAULT_SIZE 250
 #define SIGNATURE_STRUCT_DEFAULT_SIZE 300
 #endif
 
@@ -62,8 +60,6 @@
 #define ID_CRED_DEFAULT_SIZE 255
 #define PLAINTEXT_DEFAULT_SIZE 255
 #define CERT_DEFAUT_SIZE 255
-#define CONTEXT_MAC_DEFAULT_SIZE 200
-#define INFO_DEFAULT_SIZE 250
 #define SIGNATURE_STRUCT_DEFAULT_SIZE 300
 #endif
 
@@ -82,8 +78,6 @@
 #define SGN_OR_MAC_DEFAULT_SIZE 128
 #define ID_CRED_DEFAULT_SIZE 600
 #define CERT_DEFAUT_SIZE 600
-#define CONTEXT_MAC_DEFAULT_SIZE 1200
-#define INFO_DEFAULT_SIZE 1200
 #define SIGNATURE_STRUCT_DEFAULT_SIZE 1200
 #endif
 
@@ -100,9 +94,6 @@
 #define G_I_DEFAULT_SIZE P_256_PUB_KEY_UNCOMPRESSED_SIZE
 #define DATA_2_DEFAULT_SIZE                                                    \
 	(C_I_DEFAULT_SIZE + G_Y_DEFAULT_SIZE + C_R_DEFAULT_SIZE)
-#define TH2_INPUT_DEFAULT_SIZE (MSG_1_DEFAULT_SIZE + DATA_2_DEFAULT_SIZE)
-#define TH3_INPUT_DEFAULT_SIZE (SHA_DEFAULT_SIZE + CIPHERTEXT3_DEFAULT_SIZE)
-#define TH4_INPUT_DEFAULT_SIZE (SHA_DEFAULT_SIZE + CIPHERTEXT4_DEFAULT_SIZE)
 #define ECDH_SECRET_DEFAULT_SIZE 32
 #define DERIVED_SECRET_DEFAULT_SIZE 32
 #define AD_DEFAULT_SIZE 256
@@ -119,6 +110,35 @@
 
 
 
+/*an ephemeral DH key pair*/
+struct edhoc_ephemeral_key {
+	uint8_t pk[G_X_DEFAULT_SIZE];
+	uint32_t pk_len;
+	uint8_t sk[P_256_PRIV_KEY_DEFAULT_SIZE];
+	uint32_t sk_len;
+};
+
+/*number of random bytes needed for one ephemeral key pair, see 
+edhoc_ephemeral_key_pool_add()*/
+#define EPHEMERAL_RANDOM_SIZE 32
+
+/*ephemeral DH key pairs generated in advance, see 
+edhoc_ephemeral_key_pool_add(). The keys are stored in a ring buffer 
+provided by the caller.*/
+struct edhoc_ephemeral_key_pool {
+	enum ecdh_alg alg;
+	struct edhoc_ephemeral_key *keys;
+	uint32_t keys_cnt;
+	/*index of the oldest key*/
+	uint32_t head;
+	/*number of keys ready for use*/
+	uint32_t count;
+	bool lock;
+};
+
+struct verify_key;
+struct sign_key;
+
 struct other_party_cred {
 	struct byte_array id_cred; /*ID_CRED_x of the other party*/
 	struct byte_array cred; /*CBOR encoded credentials*/
@@ -127,6 +147,69 @@ struct other_party_cred {
 	struct byte_array ca; /*use only when authentication with certificates*/
 	struct byte_array
 		ca_pk; /*use only when authentication with certificates*/
+	/*pk imported into the crypto backend or NULL, see 
+	edhoc_cred_pk_prepare()*/
+	struct verify_key *pk_key;
+};
+
+/*hash indexes over an array of other_party_cred, see 
+edhoc_cred_store_init(). The credentials and the index slots are provided by 
+the caller, the store only references them.*/
+struct edhoc_cred_store {
+	struct other_party_cred *creds;
+	uint32_t creds_cnt;
+	/*slot tables of index_size entries each, an entry holds the position 
+	of a credential in creds plus one, zero marks a free slot*/
+	uint32_t *id_cred_index;
+	uint32_t *issuer_index;
+	uint32_t *subject_key_index;
+	/*power of two, larger than creds_cnt*/
+	uint32_t index_size;
+};
+
+struct edhoc_cert_cache_entry {
+	uint8_t cert_hash[32]; /*SHA-256 of the certificate*/
+	uint8_t pk[PK_DEFAULT_SIZE]; /*public key of the certificate*/
+	uint32_t pk_len;
+	uint64_t not_after; /*end of the validity, 0 if not known*/
+	uint32_t last_used;
+	bool used;
+};
+
+/*certificates of other parties which have been verified before, see 
+edhoc_cert_cache_init(). The least recently used entry is replaced when the 
+cache is full.*/
+struct edhoc_cert_cache {
+	struct edhoc_cert_cache_entry *entries;
+	uint32_t entries_cnt;
+	uint32_t tick;
+	/*if not NULL returns the current time in seconds since the epoch, 
+	expired certificates are then rejected*/
+	uint64_t (*now)(void);
+	bool lock;
+};
+
+struct edhoc_reply_cache_entry {
+	uint8_t msg_hash[32]; /*SHA-256 of the received message*/
+	/*C_R of the handshake, a byte string is kept in c_r_buf*/
+	struct c_x c_r;
+	uint8_t c_r_buf[C_I_DEFAULT_SIZE];
+	/*message 2 or message 4, which is never larger than message 2*/
+	uint8_t reply[MSG_2_DEFAULT_SIZE];
+	uint32_t reply_len;
+	uint32_t last_used;
+	bool used;
+};
+
+/*the replies of a responder to the messages received last, so that a 
+retransmitted message 1 or message 3 is answered without recomputation, 
+see edhoc_reply_cache_init(). The hash of a message selects two entries, 
+a new reply replaces the older one of them.*/
+struct edhoc_reply_cache {
+	struct edhoc_reply_cache_entry *entries;
+	uint32_t entries_cnt;
+	uint32_t tick;
+	bool lock;
 };
 
 struct edhoc_responder_context {
@@ -144,6 +227,21 @@ struct edhoc_responder_context {
 	struct byte_array cred_r;
 	struct byte_array sk_r; /*sign key -use with method 0 and 2*/
 	struct byte_array pk_r; /*coresp. pk to sk_r -use with method 0 and 2*/
+	/*if not NULL every handshake takes a fresh ephemeral key pair from 
+	the pool and g_y and y are not used*/
+	struct edhoc_ephemeral_key_pool *ephemeral_keys;
+	/*if not NULL the credentials of the other party are looked up in 
+	the store and cred_i_array is ignored*/
+	const struct edhoc_cred_store *cred_store;
+	/*if not NULL certificates of the other party are verified only 
+	once, later handshakes take the public key from the cache*/
+	struct edhoc_cert_cache *cert_cache;
+	/*if not NULL signatures are computed with this prepared key, see 
+	sign_key_init(), instead of sk and pk*/
+	struct sign_key *sign_key;
+	/*if not NULL retransmitted messages are answered from the cache, see 
+	edhoc_responder_step()*/
+	struct edhoc_reply_cache *reply_cache;
 	void *sock; /*pointer used as handler for sockets by tx/rx */
 };
 
@@ -163,6 +261,18 @@ struct edhoc_initiator_context {
 	struct byte_array i; /* static DH sk -> use only with method 2 or 3*/
 	struct byte_array sk_i; /*sign key use with method 0 and 2*/
 	struct byte_array pk_i; /*coresp. pk to sk_r -use with method 0 and 2*/
+	/*if not NULL every handshake takes a fresh ephemeral key pair from 
+	the pool and g_x and x are not used*/
+	struct edhoc_ephemeral_key_pool *ephemeral_keys;
+	/*if not NULL the credentials of the other party are looked up in 
+	the store and cred_r_array is ignored*/
+	const struct edhoc_cred_store *cred_store;
+	/*if not NULL certificates of the other party are verified only 
+	once, later handshakes take the public key from the cache*/
+	struct edhoc_cert_cache *cert_cache;
+	/*if not NULL signatures are computed with this prepared key, see 
+	sign_key_init(), instead of sk and pk*/
+	struct sign_key *sign_key;
 	void *sock; /*pointer used as handler for sockets by tx/rx */
 };
 
@@ -184,6 +294,159 @@ ephemeral_dh_key_gen(
 	enum ecdh_alg alg, uint32_t seed, uint8_t *sk,
 	uint8_t *pk, uint32_t *pk_size);
 
+/**
+ * @brief   Initializes a pool of ephemeral DH key pairs
+ * @param   p the pool
+ * @param   alg the DH curve of the keys
+ * @param   keys caller provided storage for the keys
+ * @param   keys_cnt number of elements in keys
+ * @retval  an err code
+ */
+enum err edhoc_ephemeral_key_pool_init(struct edhoc_ephemeral_key_pool *p,
+				       enum ecdh_alg alg,
+				       struct edhoc_ephemeral_key *keys,
+				       uint32_t keys_cnt);
+
+/**
+ * @brief   Generates one key pair and adds it to the pool. Intended to be 
+ *          called in idle time or from a worker thread until it returns 
+ *          ephemeral_key_pool_full, so that the key generation is not part 
+ *          of the handshake latency. X25519 keys are derived from the 
+ *          random bytes, P-256 keys are generated by the crypto library.
+ *
+ *          IMPORTANT!!! PROVIDE FRESH RANDOM BYTES FROM A CRYPTOGRAPHIC 
+ *          RANDOM GENERATOR FOR EVERY CALL! 
+ *
+ * @param   p the pool
+ * @param   random EPHEMERAL_RANDOM_SIZE random bytes
+ * @param   random_len length of random
+ * @retval  an err code, ephemeral_key_pool_full if the pool is full
+ */
+enum err edhoc_ephemeral_key_pool_add(struct edhoc_ephemeral_key_pool *p,
+				      const uint8_t *random,
+				      uint32_t random_len);
+
+/**
+ * @brief   Removes the oldest key pair from the pool. Its copy in the pool 
+ *          is zeroized, the caller must zeroize k after use.
+ * @param   p the pool
+ * @param   k the key pair (output)
+ * @retval  an err code, ephemeral_key_pool_empty if the pool is empty
+ */
+enum err edhoc_ephemeral_key_pool_take(struct edhoc_ephemeral_key_pool *p,
+				       struct edhoc_ephemeral_key *k);
+
+/**
+ * @brief   Builds the hash indexes of a credential store. Credentials are 
+ *          indexed by ID_CRED_x, by the name of their CA (ca) and by their 
+ *          public key (pk, or g if there is no pk). If several credentials 
+ *          share a key the first one in creds is returned by the lookups.
+ * @param   s the store
+ * @param   creds the credentials, they must stay unchanged while the store 
+ *          is in use
+ * @param   creds_cnt number of elements in creds
+ * @param   index slot buffer with 3 * index_size elements
+ * @param   index_size number of slots per index, a power of two larger 
+ *          than creds_cnt, twice creds_cnt or more keeps the lookups short
+ * @retval  an err code
+ */
+enum err edhoc_cred_store_init(struct edhoc_cred_store *s,
+			       struct other_party_cred *creds,
+			       uint32_t creds_cnt, uint32_t *index,
+			       uint32_t index_size);
+
+/**
+ * @brief   Looks up a credential by its ID_CRED_x
+ * @param   s the store
+ * @param   id_cred ID_CRED_x
+ * @param   id_cred_len length of id_cred
+ * @param   cred reference to the credential in the store (output)
+ * @retval  an err code, credential_not_found if there is no such credential
+ */
+enum err edhoc_cred_store_id_cred_get(const struct edhoc_cred_store *s,
+				      const uint8_t *id_cred,
+				      uint32_t id_cred_len,
+				      const struct other_party_cred **cred);
+
+/**
+ * @brief   Looks up a credential whose CA has the given name
+ * @param   s the store
+ * @param   issuer name of the CA
+ * @param   issuer_len length of issuer
+ * @param   cred reference to the credential in the store (output), its 
+ *          ca_pk is the public key of the CA
+ * @retval  an err code, no_such_ca if the CA is not known
+ */
+enum err edhoc_cred_store_issuer_get(const struct edhoc_cred_store *s,
+				     const uint8_t *issuer, uint32_t issuer_len,
+				     const struct other_party_cred **cred);
+
+/**
+ * @brief   Looks up a credential by its public signature key or its static 
+ *          DH public key
+ * @param   s the store
+ * @param   key the public key
+ * @param   key_len length of key
+ * @param   cred reference to the credential in the store (output)
+ * @retval  an err code, credential_not_found if there is no such credential
+ */
+enum err edhoc_cred_store_subject_key_get(const struct edhoc_cred_store *s,
+					  const uint8_t *key, uint32_t key_len,
+					  const struct other_party_cred **cred);
+
+/**
+ * @brief   Imports the public signature key of a credential into the crypto 
+ *          backend once, so that the handshakes verify the signatures of the 
+ *          other party with the prepared key.
+ * @param   cred the credential, cred->pk_key is set to k
+ * @param   alg signature algorithm of the key
+ * @param   k storage for the prepared key, see verify_key_init() in 
+ *          common/crypto_wrapper.h
+ * @retval  an err code
+ */
+enum err edhoc_cred_pk_prepare(struct other_party_cred *cred,
+			       enum sign_alg alg, struct verify_key *k);
+
+/**
+ * @brief   Releases the prepared key of a credential
+ * @param   cred the credential, cred->pk_key is set to NULL
+ * @retval  an err code
+ */
+enum err edhoc_cred_pk_release(struct other_party_cred *cred);
+
+/**
+ * @brief   Initializes an empty certificate cache
+ * @param   c the cache
+ * @param   entries storage for the cache entries
+ * @param   entries_cnt number of elements in entries
+ * @param   now returns the current time in seconds since the epoch, may be 
+ *          NULL if the device has no clock
+ * @retval  an err code
+ */
+enum err edhoc_cert_cache_init(struct edhoc_cert_cache *c,
+			       struct edhoc_cert_cache_entry *entries,
+			       uint32_t entries_cnt, uint64_t (*now)(void));
+
+/**
+ * @brief   Removes all certificates from the cache. Must be called when a 
+ *          CA is removed from the trusted credentials.
+ * @param   c the cache
+ */
+void edhoc_cert_cache_flush(struct edhoc_cert_cache *c);
+
+/**
+ * @brief   Initializes an empty reply cache. Since the entries of a 
+ *          message are selected by its hash, entries_cnt should be a few 
+ *          times the number of handshakes in progress.
+ * @param   c the cache
+ * @param   entries storage for the cache entries
+ * @param   entries_cnt number of elements in entries
+ * @retval  an err code
+ */
+enum err edhoc_reply_cache_init(struct edhoc_reply_cache *c,
+				struct edhoc_reply_cache_entry *entries,
+				uint32_t entries_cnt);
+
 /**
  * @brief   Executes the EDHOC protocol on the initiator side
  * @param   c cointer to a structure containing initialization parameters
@@ -259,4 +522,21 @@ enum err edhoc_exporter(enum hash_alg app_hash_alg, const uint8_t *prk_4x3m,
 			uint32_t prk_4x3m_len, const uint8_t *th4,
 			uint32_t th4_len, const char *label, uint8_t *out,
 			uint32_t out_len);
+
+/**
+ * @brief   EDHOC-KeyUpdate, derives a new PRK_4x3m from the current one and 
+ *          a nonce with a single HKDF extract, PRK_4x3m = 
+ *          Extract(nonce, PRK_4x3m). Keys derived afterwards with 
+ *          edhoc_exporter() are fresh without a new handshake, but they 
+ *          offer no forward secrecy. Both parties must use the same nonce, 
+ *          which should be fresh for every update.
+ * @param   app_hash_alg hash algorithm of the selected suite
+ * @param   nonce the nonce
+ * @param   nonce_len length of nonce
+ * @param   prk_4x3m the current PRK_4x3m as input, the new one as output
+ * @param   prk_4x3m_len length of prk_4x3m, the length of a hash
+ */
+enum err edhoc_key_update(enum hash_alg app_hash_alg, const uint8_t *nonce,
+			  uint32_t nonce_len, uint8_t *prk_4x3m,
+			  uint32_t prk_4x3m_len);
 #endif
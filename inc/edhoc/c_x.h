@@ -48,4 +48,16 @@ void c_x_init(struct c_x *c, uint8_t *buf, uint32_t buf_len);
 enum err c_x_set(enum c_x_type t, const uint8_t *c_x_raw_buf,
 		 uint32_t c_x_raw_buf_len, int c_x_int, struct c_x *out);
 
+/**
+ * @brief Converts a C_x to an OSCORE Sender / Recipient ID, see RFC9528 
+ *        Appendix A.1. A byte string is used as it is, an integer is 
+ *        replaced by its CBOR encoding.
+ * 
+ * @param c the C_x
+ * @param out the OSCORE ID
+ * @param out_len in: the size of out, out: the length of the ID
+ * @return enum err 
+ */
+enum err c_x_oscore_id(const struct c_x *c, uint8_t *out, uint32_t *out_len);
+
 #endif
@@ -11,6 +11,7 @@
 #ifndef CERT_H
 #define CERT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "common/oscore_edhoc_error.h"
@@ -19,31 +20,76 @@
  * @brief   Verifies a c509 certificate
  * @param   cert a native CBOR encoded certificate
  * @param   cer_len the length of the certificate
+ * @param   store a credential store, if not NULL the CA is looked up in 
+ *          the store instead of cred_array
  * @param   cred_array an array containing credentials 
  * @param   cred_num number of elements in cred_array
  * @param   pk public key contained in the certificate
  * @param   pk_len the length pk
+ * @param   not_after end of the validity of the certificate in seconds 
+ *          since the epoch, 0 if not known
  * @param   verified true if verification successfull
  * @retval  enum err
  */
 enum err cert_c509_verify(const uint8_t *cert, uint32_t cert_len,
+			  const struct edhoc_cred_store *store,
 			  const struct other_party_cred *cred_array,
 			  uint16_t cred_num, uint8_t *pk, uint32_t *pk_len,
-			  bool *verified);
+			  uint64_t *not_after, bool *verified);
 
 /**
  * @brief   Verifies a x509 certificate
  * @param   cert a native CBOR encoded certificate
  * @param   cer_len the length of the certificate
+ * @param   store a credential store, if not NULL the CA is looked up in 
+ *          the store instead of cred_array
  * @param   cred_array an array containing credentials 
  * @param   cred_num number of elements in cred_array
  * @param   pk public key contained in the certificate
  * @param   pk_len the length pk
+ * @param   not_after end of the validity of the certificate in seconds 
+ *          since the epoch, 0 if not known
  * @param   verified true if verification successfull
  * @retval  enum err
  */
 enum err cert_x509_verify(const uint8_t *cert, uint32_t cert_len,
+			  const struct edhoc_cred_store *store,
 			  const struct other_party_cred *cred_array,
 			  uint16_t cred_num, uint8_t *pk, uint32_t *pk_len,
-			  bool *verified);
+			  uint64_t *not_after, bool *verified);
+
+/**
+ * @brief   Checks whether a certificate is expired according to the clock 
+ *          of the certificate cache
+ * @param   c the cache
+ * @param   not_after end of the validity of the certificate, 0 if not known
+ * @retval  true if the cache has a clock and the certificate is expired
+ */
+bool cert_expired(const struct edhoc_cert_cache *c, uint64_t not_after);
+
+/**
+ * @brief   Looks up a verified certificate in the cache. Expired entries 
+ *          are removed and not returned.
+ * @param   c the cache
+ * @param   cert_hash SHA-256 of the certificate
+ * @param   pk the public key of the certificate (output)
+ * @param   pk_len length of pk
+ * @param   found true if the certificate is in the cache
+ * @retval  enum err
+ */
+enum err cert_cache_get(struct edhoc_cert_cache *c, const uint8_t *cert_hash,
+			uint8_t *pk, uint32_t *pk_len, bool *found);
+
+/**
+ * @brief   Adds a verified certificate to the cache, replacing the least 
+ *          recently used entry if the cache is full
+ * @param   c the cache
+ * @param   cert_hash SHA-256 of the certificate
+ * @param   pk the public key of the certificate
+ * @param   pk_len length of pk
+ * @param   not_after end of the validity of the certificate, 0 if not known
+ * @retval  enum err
+ */
+enum err cert_cache_put(struct edhoc_cert_cache *c, const uint8_t *cert_hash,
+			const uint8_t *pk, uint32_t pk_len, uint64_t not_after);
 #endif
@@ -11,6 +11,8 @@
 
 #ifndef CIPHERTEXT_H
 #define CIPHERTEXT_H
+
+#include "common/crypto_wrapper.h"
 enum ciphertext { CIPHERTEXT2, CIPHERTEXT3, CIPHERTEXT4 };
 
 /**
@@ -24,8 +26,7 @@ enum ciphertext { CIPHERTEXT2, CIPHERTEXT3, CIPHERTEXT4 };
  * @param signature_or_mac_len lenhgt of signature_or_mac
  * @param ead additional authenticated data
  * @param ead_len lenhgt of ead
- * @param prk pseudo random key
- * @param prk_len lenhgt of prk
+ * @param prk pseudo random key prepared with hmac_key_init()
  * @param th transkript hash
  * @param th_len lenhgt of th
  * @param ciphertext the output
@@ -36,8 +37,8 @@ enum err ciphertext_gen(enum ciphertext ctxt, struct suite *suite,
 			uint8_t *id_cred, uint32_t id_cred_len,
 			uint8_t *signature_or_mac,
 			uint32_t signature_or_mac_len, uint8_t *ead,
-			uint32_t ead_len, uint8_t *prk, uint32_t prk_len,
-			uint8_t *th, uint32_t th_len, uint8_t *ciphertext,
+			uint32_t ead_len, struct hmac_key *prk, uint8_t *th,
+			uint32_t th_len, uint8_t *ciphertext,
 			uint32_t *ciphertext_len);
 
 /**
@@ -52,8 +53,7 @@ enum err ciphertext_gen(enum ciphertext ctxt, struct suite *suite,
  * @param signature_or_mac_len lenhgt of signature_or_mac
  * @param ead additional authenticated data
  * @param ead_len lenhgt of ead
- * @param prk pseudo random key
- * @param prk_len lenhgt of prk
+ * @param prk pseudo random key prepared with hmac_key_init()
  * @param th transkript hash
  * @param th_len lenhgt of th
  * @param ciphertext the input
@@ -64,9 +64,8 @@ enum err ciphertext_decrypt_split(enum ciphertext ctxt, struct suite *suite,
 				  uint8_t *id_cred, uint32_t *id_cred_len,
 				  uint8_t *signature_or_mac,
 				  uint32_t *signature_or_mac_len, uint8_t *ead,
-				  uint32_t * ead_len, uint8_t *prk,
-				  uint32_t prk_len, uint8_t *th,
-				  uint32_t th_len, uint8_t *ciphertext,
-				  uint32_t ciphertext_len);
+				  uint32_t *ead_len, struct hmac_key *prk,
+				  uint8_t *th, uint32_t th_len,
+				  uint8_t *ciphertext, uint32_t ciphertext_len);
 
 #endif
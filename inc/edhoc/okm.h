@@ -13,11 +13,16 @@
 
 #include <stdint.h>
 
-#include "hkdf_info.h"
 #include "suites.h"
 
+#include "common/byte_array.h"
+#include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
+/*maximal number of segments of the context passed to 
+okm_calc_prepared_segments(), e.g., ID_CRED, CRED and EAD for MAC_2/3*/
+#define OKM_CONTEXT_MAX_SEGMENTS 3
+
 /**
  * @brief   Derives output keying material.
  * 
@@ -37,4 +42,45 @@ enum err okm_calc(enum hash_alg hash_alg, const uint8_t *prk, uint32_t prk_len,
 		  uint8_t *context, uint32_t context_len, uint8_t *okm,
 		  uint32_t okm_len);
 
+/**
+ * @brief   Derives output keying material from a prepared PRK. Should be 
+ *          used instead of okm_calc() when more than one key is derived 
+ *          from the same PRK.
+ * 
+ * @param   prk pseudorandom key prepared with hmac_key_init()
+ * @param   th transcripthash
+ * @param   th_len length of th
+ * @param   label human readable label
+ * @param   context relevant only for MAC_2 and MAC_3
+ * @param   context_len lenhgt of context
+ * @param   okm ouput pointer
+ * @param   okm_len length of okm
+ */
+enum err okm_calc_prepared(struct hmac_key *prk, const uint8_t *th,
+			   uint32_t th_len, const char *label, uint8_t *context,
+			   uint32_t context_len, uint8_t *okm,
+			   uint32_t okm_len);
+
+/**
+ * @brief   Same as okm_calc_prepared() but with a context given as a 
+ *          sequence of segments, e.g., ID_CRED, CRED and EAD for MAC_2/3. 
+ *          The info structure is fed into the HMAC piece by piece, so that 
+ *          neither info nor the context need to be assembled in a buffer.
+ * 
+ * @param   prk pseudorandom key prepared with hmac_key_init()
+ * @param   th transcripthash
+ * @param   th_len length of th
+ * @param   label human readable label
+ * @param   context the context segments
+ * @param   context_cnt number of context segments, at most 
+ *          OKM_CONTEXT_MAX_SEGMENTS
+ * @param   okm ouput pointer
+ * @param   okm_len length of okm
+ */
+enum err okm_calc_prepared_segments(struct hmac_key *prk, const uint8_t *th,
+				    uint32_t th_len, const char *label,
+				    const struct const_byte_array *context,
+				    uint32_t context_cnt, uint8_t *okm,
+				    uint32_t okm_len);
+
 #endif
@@ -14,6 +14,7 @@
 
 #include <stdint.h>
 
+#include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
 /**
@@ -27,12 +28,14 @@
  * @param   stat_pk_len length of stat_pk
  * @param   stat_sk static secret DH key 
  * @param   stat_sk_len length of stat_sk
+ * @param   rs state of the sliced ECDH or NULL, see 
+ *          shared_secret_derive_restartable()
  * @param   prk_out pointer to the buffer for the newly created PRK
  */
 enum err prk_derive(bool static_dh_auth, struct suite suite,
 		      const uint8_t *prk_in, const uint32_t prk_in_len,
 		      const uint8_t *stat_pk, const uint32_t stat_pk_len,
 		      const uint8_t *stat_sk, const uint32_t stat_sk_len,
-		      uint8_t *prk_out);
+		      struct ecc_restart *rs, uint8_t *prk_out);
 
 #endif
@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+#ifndef REPLY_CACHE_H
+#define REPLY_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "edhoc.h"
+
+#include "common/oscore_edhoc_error.h"
+
+/**
+ * @brief   Looks up the reply to a received message
+ * @param   c the cache
+ * @param   msg_hash SHA-256 of the received message
+ * @param   c_r the C_R the message belongs to or NULL if it is not known 
+ *          yet, e.g., for message 1
+ * @param   c_r_out the C_R of the found reply (output) or NULL. A byte 
+ *          string is copied to the buffer of c_r_out.
+ * @param   reply the reply (output)
+ * @param   reply_len size of reply as input, its length as output
+ * @param   found true if the reply is in the cache
+ * @retval  enum err
+ */
+enum err reply_cache_get(struct edhoc_reply_cache *c, const uint8_t *msg_hash,
+			 const struct c_x *c_r, struct c_x *c_r_out,
+			 uint8_t *reply, uint32_t *reply_len, bool *found);
+
+/**
+ * @brief   Keeps the reply to a received message, replacing the reply 
+ *          kept in the entry of the message. Replies which do not fit in 
+ *          an entry are not kept.
+ * @param   c the cache
+ * @param   msg_hash SHA-256 of the received message
+ * @param   c_r the C_R of the handshake
+ * @param   reply the reply, message 2 or message 4
+ * @param   reply_len length of reply, 0 if no message 4 is sent
+ */
+void reply_cache_put(struct edhoc_reply_cache *c, const uint8_t *msg_hash,
+		     const struct c_x *c_r, const uint8_t *reply,
+		     uint32_t reply_len);
+#endif
@@ -16,6 +16,7 @@
 
 #include "edhoc.h"
 
+#include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
 enum id_cred_x_label {
@@ -46,21 +47,30 @@ enum id_cred_x_label {
  *          and when static DH authentication is used or public signature key 
  *          when digital signatures are used 
  * @param   static_dh_auth true if static DH authentication is used
+ * @param   store a credential store, if not NULL it is used instead of 
+ *          cred_array
+ * @param   cache cache of verified certificates, may be NULL
  * @param   cred_array an array containing credentials 
  * @param   cred_num number of elements in cred_array
  * @param   id_cred ID_CRED_x
  * @param   id_cred_len length of id_cred
  * @param   cred CRED_x
- * @param   cred_len length of cred
  * @param   pk public key
- * @param   pk_len length of pk
+ * @param   pk_key pk prepared for the crypto backend, NULL if the 
+ *          credential has none
  * @param   g static DH public key
- * @param   g_len length of g
+ *
+ *          cred, pk and g point to buffers provided by the caller. They are 
+ *          only filled when the values have to be built, e.g. from a 
+ *          certificate contained in id_cred. Credentials available locally 
+ *          are returned as references to cred_array or the store.
  */
-enum err retrieve_cred(bool static_dh_auth, struct other_party_cred *cred_array,
-		       uint16_t cred_num, uint8_t *id_cred,
-		       uint32_t id_cred_len, uint8_t *cred, uint32_t *cred_len,
-		       uint8_t *pk, uint32_t *pk_len, uint8_t *g,
-		       uint32_t *g_len);
+enum err retrieve_cred(bool static_dh_auth,
+		       const struct edhoc_cred_store *store,
+		       struct edhoc_cert_cache *cache,
+		       struct other_party_cred *cred_array, uint16_t cred_num,
+		       uint8_t *id_cred, uint32_t id_cred_len,
+		       struct byte_array *cred, struct byte_array *pk,
+		       const struct verify_key **pk_key, struct byte_array *g);
 
 #endif
@@ -15,6 +15,8 @@
 
 #include "edhoc.h"
 
+#include "common/crypto_wrapper.h"
+
 struct runtime_context {
 	uint8_t msg1[MSG_1_DEFAULT_SIZE];
 	uint32_t msg1_len;
@@ -25,13 +27,130 @@ struct runtime_context {
 	uint8_t msg4[MSG_4_DEFAULT_SIZE];
 	uint32_t msg4_len;
 	struct suite suite;
+	/*ephemeral DH key pair of this handshake, X and G_X or Y and G_Y*/
+	struct edhoc_ephemeral_key eph;
 	/*responder specific*/
 	uint8_t th3[SHA_DEFAULT_SIZE];
 	uint32_t th3_len;
 	uint8_t PRK_3e2m[PRK_DEFAULT_SIZE];
 	uint32_t PRK_3e2m_len;
+	/*C_I from message 1 as OSCORE ID, see c_x_oscore_id()*/
+	uint8_t c_i[C_I_DEFAULT_SIZE];
+	uint32_t c_i_len;
+	/*PRK_3e2m and PRK_4x3m prepared for the key derivations*/
+	struct hmac_key prk_3e2m_key;
+	struct hmac_key prk_4x3m_key;
 	bool static_dh_i;
+	/*state of the P-256 operations computed in slices or NULL, see 
+	edhoc_responder_session_init_sliced()*/
+	struct ecc_restart *ecc;
+	/*eph is the key of a message processed again after 
+	ecc_operation_in_progress and must not be replaced*/
+	bool eph_set;
+};
+
+#ifdef EDHOC_ECC_RESTARTABLE
+/*a message of a session whose P-256 operations are computed in slices, see 
+edhoc_responder_session_init_sliced()*/
+struct edhoc_sliced {
+	bool enabled;
+	/*the last step returned ecc_operation_in_progress for the message 
+	with this hash*/
+	bool in_progress;
+	uint8_t msg_hash[SHA_DEFAULT_SIZE];
+	struct ecc_restart ecc;
 };
+#endif
+
+/*states of a responder session, see edhoc_responder_step()*/
+enum edhoc_responder_state {
+	RESPONDER_WAIT_MSG1,
+	RESPONDER_WAIT_MSG3,
+	RESPONDER_DONE,
+	RESPONDER_FAILED,
+};
+
+/*a handshake of a responder which is driven by the received messages 
+instead of blocking in rx(). Only the state needed between message 2 and 
+message 3 is kept, the messages are processed in a runtime context on the 
+stack of edhoc_responder_step()*/
+struct edhoc_responder_session {
+	enum edhoc_responder_state state;
+	struct suite suite;
+	bool static_dh_i;
+	uint8_t th3[SHA_DEFAULT_SIZE];
+	uint8_t prk_3e2m[PRK_DEFAULT_SIZE];
+	/*the ephemeral secret, needed for message 3 if the initiator 
+	authenticates with static DH*/
+	uint8_t y[P_256_PRIV_KEY_DEFAULT_SIZE];
+	uint32_t y_len;
+	/*C_I as OSCORE ID, the Sender ID of the responder, see 
+	edhoc_oscore_combined_request_process(). Not kept in state tokens.*/
+	uint8_t c_i[C_I_DEFAULT_SIZE];
+	uint32_t c_i_len;
+#ifdef EDHOC_ECC_RESTARTABLE
+	struct edhoc_sliced sliced;
+	/*the ephemeral key pair of a message 2 in progress*/
+	struct edhoc_ephemeral_key eph;
+#endif
+};
+
+/*states of an initiator session, see edhoc_initiator_step()*/
+enum edhoc_initiator_state {
+	INITIATOR_START,
+	INITIATOR_WAIT_MSG2,
+	INITIATOR_WAIT_MSG4,
+	INITIATOR_DONE,
+	INITIATOR_FAILED,
+};
+
+/*a handshake of an initiator which is driven by the received messages 
+instead of blocking in rx(), see edhoc_initiator_step()*/
+struct edhoc_initiator_session {
+	enum edhoc_initiator_state state;
+	struct suite suite;
+	/*message 1 is needed for TH_2*/
+	uint8_t msg1[MSG_1_DEFAULT_SIZE];
+	uint32_t msg1_len;
+	/*the ephemeral key pair, X is needed for message 2*/
+	struct edhoc_ephemeral_key eph;
+#ifdef EDHOC_ECC_RESTARTABLE
+	struct edhoc_sliced sliced;
+#endif
+};
+
+/*pending responder sessions indexed by C_R, see edhoc_session_table_msg1() 
+and edhoc_session_table_msg3()*/
+struct edhoc_session_table {
+	struct edhoc_responder_session *sessions;
+	uint32_t sessions_cnt;
+	/*the search for a free session starts here, so that the C_R of a 
+	finished session is not reused immediately*/
+	uint32_t next;
+};
+
+/*keys protecting the session state handed out by a stateless responder, 
+see edhoc_responder_stateless_msg1(). A state token can be opened as long 
+as the key it was sealed with is the current or the previous key and its 
+lifetime has not passed.*/
+struct edhoc_state_keys {
+	struct aead_key key[2];
+	uint8_t id[2];
+	/*index of the current key in key and id*/
+	uint8_t current;
+	/*nonce of the next token, the token keys are derived with a fresh 
+	salt, so that the counter can start at 0*/
+	uint64_t counter;
+	/*lifetime of a token in the time unit of the caller*/
+	uint32_t lifetime;
+};
+
+/*key id | counter | expiry time | suite label | static DH flag | TH_3 | 
+PRK_3e2m | length of Y | Y | tag*/
+#define EDHOC_STATE_TOKEN_HEADER_SIZE (1 + 8 + 4)
+#define EDHOC_STATE_TOKEN_SIZE                                                 \
+	(EDHOC_STATE_TOKEN_HEADER_SIZE + 2 + SHA_DEFAULT_SIZE +                \
+	 PRK_DEFAULT_SIZE + 1 + P_256_PRIV_KEY_DEFAULT_SIZE + 8)
 
 
 
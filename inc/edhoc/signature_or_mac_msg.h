@@ -15,6 +15,7 @@
 
 #include "suites.h"
 
+#include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
 enum sgn_or_mac_op { VERIFY, GENERATE };
@@ -65,19 +66,29 @@ enum err signature_or_mac_msg_create(
 	const uint8_t *ad, const uint8_t ad_len, uint8_t *m, uint16_t *m_len,
 	uint8_t *mac, uint8_t *mac_len);
 
-enum err mac(const uint8_t *prk, uint32_t prk_len, const uint8_t *th,
-	     uint32_t th_len, const uint8_t *id_cred, uint32_t id_cred_len,
-	     const uint8_t *cred, uint32_t cred_len, const uint8_t *ead,
-	     uint32_t ead_len, const char *mac_label, bool static_dh,
-	     struct suite *suite, uint8_t *mac, uint32_t *mac_len);
+enum err mac(struct hmac_key *prk, const uint8_t *th, uint32_t th_len,
+	     const uint8_t *id_cred, uint32_t id_cred_len, const uint8_t *cred,
+	     uint32_t cred_len, const uint8_t *ead, uint32_t ead_len,
+	     const char *mac_label, bool static_dh, struct suite *suite,
+	     uint8_t *mac, uint32_t *mac_len);
 
+/**
+ * @brief   Generates or verifies Signature_or_MAC_2/3. For GENERATE, sk_key 
+ *          may point to sk prepared with sign_key_init(), for VERIFY, 
+ *          pk_key may point to pk prepared with verify_key_init(), 
+ *          otherwise they are NULL. With rs a signature is computed or 
+ *          verified in slices, see sign_restartable(), then 
+ *          ecc_operation_in_progress is returned until it is finished.
+ */
 enum err
 signature_or_mac(enum sgn_or_mac_op op, bool static_dh, struct suite *suite,
-		 const uint8_t *sk, uint32_t sk_len, const uint8_t *pk,
-		 uint32_t pk_len, const uint8_t *prk, uint32_t prk_len,
-		 const uint8_t *th, uint32_t th_len, const uint8_t *id_cred,
-		 uint32_t id_cred_len, const uint8_t *cred, uint32_t cred_len,
-		 const uint8_t *ead, uint32_t ead_len, const char *mac_label,
+		 const uint8_t *sk, uint32_t sk_len, struct sign_key *sk_key,
+		 const uint8_t *pk, uint32_t pk_len,
+		 const struct verify_key *pk_key, struct ecc_restart *rs,
+		 struct hmac_key *prk, const uint8_t *th,
+		 uint32_t th_len, const uint8_t *id_cred, uint32_t id_cred_len,
+		 const uint8_t *cred, uint32_t cred_len, const uint8_t *ead,
+		 uint32_t ead_len, const char *mac_label,
 		 uint8_t *signature_or_mac, uint32_t *signature_or_mac_len);
 
 #endif
@@ -0,0 +1,113 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef EDHOC_WORKER_POOL_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "edhoc.h"
+
+#include "edhoc/runtime_context.h"
+
+#include "common/oscore_edhoc_error.h"
+
+/*
+ * The expensive parts of a handshake, the ECDH, signature and signature 
+ * verification operations, are all executed while a received message is 
+ * processed by edhoc_responder_step(). A responder with an event loop can 
+ * therefore submit the processing of a message as a job to other threads 
+ * and continue to receive messages of other sessions until the job is done.
+ */
+
+/*the processing of one received message, see edhoc_responder_step()*/
+struct edhoc_responder_job {
+	struct edhoc_responder_context *c;
+	struct edhoc_responder_session *s;
+	struct other_party_cred *cred_i_array;
+	uint16_t num_cred_i;
+	const uint8_t *msg_in;
+	uint32_t msg_in_len;
+	uint8_t *msg_out;
+	/*size of msg_out as input, length of the message to be sent as 
+	output*/
+	uint32_t msg_out_len;
+	uint8_t *ead;
+	uint32_t ead_len;
+	uint8_t *prk_4x3m;
+	uint32_t prk_4x3m_len;
+	uint8_t *th4;
+	uint32_t th4_len;
+	/*the return value of edhoc_responder_step()*/
+	enum err result;
+	/*called from the thread which executed the job when it is done*/
+	void (*done)(struct edhoc_responder_job *job);
+	void *user_data;
+	/*used by the worker pool to queue the job*/
+	struct edhoc_responder_job *next;
+};
+
+/**
+ * @brief   Executes a job in the calling thread and calls its done 
+ *          callback. This is the building block for executing jobs on 
+ *          other threads, e.g., from a Zephyr work queue.
+ * @param   job the job
+ */
+void edhoc_responder_job_run(struct edhoc_responder_job *job);
+
+#ifdef EDHOC_WORKER_POOL_PTHREAD
+/*POSIX threads executing submitted jobs in the order of their submission*/
+struct edhoc_worker_pool {
+	pthread_t *threads;
+	uint32_t threads_cnt;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct edhoc_responder_job *head;
+	struct edhoc_responder_job *tail;
+	bool stop;
+};
+
+/**
+ * @brief   Starts the threads of a worker pool. Typically there is one 
+ *          thread per CPU core, e.g., sysconf(_SC_NPROCESSORS_ONLN).
+ * @param   p the pool
+ * @param   threads caller provided storage for the thread handles
+ * @param   threads_cnt number of threads to be started
+ * @retval  an err code
+ */
+enum err edhoc_worker_pool_init(struct edhoc_worker_pool *p,
+				pthread_t *threads, uint32_t threads_cnt);
+
+/**
+ * @brief   Queues a job. The job and all buffers it points to must stay 
+ *          valid until its done callback was called. Jobs of the same 
+ *          session must not be submitted concurrently.
+ * @param   p the pool
+ * @param   job the job
+ * @retval  an err code
+ */
+enum err edhoc_worker_pool_submit(struct edhoc_worker_pool *p,
+				  struct edhoc_responder_job *job);
+
+/**
+ * @brief   Executes all queued jobs and stops the threads
+ * @param   p the pool
+ * @retval  an err code
+ */
+enum err edhoc_worker_pool_deinit(struct edhoc_worker_pool *p);
+#endif
+
+#endif
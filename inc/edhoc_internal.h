@@ -33,6 +33,57 @@
  */
 void runtime_context_init(struct runtime_context *c);
 
+/**
+ * @brief Releases the prepared keys held by the EDHOC runtime context
+ * 
+ * @param c Pointer to the runtime context
+ * @retval an err code
+ */
+enum err runtime_context_deinit(struct runtime_context *c);
+
+#ifdef EDHOC_ECC_RESTARTABLE
+/**
+ * @brief Lets rc compute the P-256 operations of a session step in slices 
+ *        if they are enabled for the session. The operations finished in 
+ *        the previous calls of the step are not computed again.
+ * 
+ * @param sl the sliced operations of the session
+ * @param rc the runtime context of the step
+ * @param msg the received message
+ * @param msg_len length of msg
+ * @retval an err code, wrong_parameter if the previous step is in progress 
+ *         for another message
+ */
+enum err sliced_step_begin(struct edhoc_sliced *sl, struct runtime_context *rc,
+			   const uint8_t *msg, uint32_t msg_len);
+
+/**
+ * @brief Keeps the sliced operations of a session step which returned 
+ *        ecc_operation_in_progress and releases them otherwise
+ * 
+ * @param sl the sliced operations of the session
+ * @param r the result of the step
+ */
+void sliced_step_end(struct edhoc_sliced *sl, enum err r);
+#endif
+
+/**
+ * @brief Gets the ephemeral key pair of a handshake, a fresh one from the 
+ *        pool or a copy of the key pair in the context if there is no pool
+ * 
+ * @param p the pool or NULL
+ * @param alg the ECDH algorithm of the selected suite
+ * @param pk public key from the context
+ * @param sk secret key from the context
+ * @param k the key pair of the handshake (output)
+ * @retval an err code, wrong_parameter if the keys of the pool are of 
+ *         another algorithm
+ */
+enum err ephemeral_key_get(struct edhoc_ephemeral_key_pool *p,
+			   enum ecdh_alg alg, const struct byte_array *pk,
+			   const struct byte_array *sk,
+			   struct edhoc_ephemeral_key *k);
+
 /**
  * @brief Generates message 1. This function should by used by on the 
  *        initiator side.
@@ -133,4 +184,348 @@ enum err msg3_process(struct edhoc_responder_context *c,
 enum err msg4_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 		  uint8_t *prk_4x3m, uint32_t prk_4x3m_len, uint8_t *th4,
 		  uint32_t th4_len);
+
+/**
+ * @brief Initializes a responder session. A session must be released with 
+ *        edhoc_responder_session_deinit().
+ * 
+ * @param s the session
+ */
+void edhoc_responder_session_init(struct edhoc_responder_session *s);
+
+#ifdef EDHOC_ECC_RESTARTABLE
+/**
+ * @brief Initializes a responder session whose P-256 operations are 
+ *        computed in slices of at most the number of basic operations set 
+ *        with ecc_restartable_config(). edhoc_responder_step() then 
+ *        returns ecc_operation_in_progress after a slice and must be 
+ *        called again with the same message and buffers until it returns 
+ *        another code. In between the thread can serve other sessions or 
+ *        messages.
+ * 
+ * @param s the session
+ */
+void edhoc_responder_session_init_sliced(struct edhoc_responder_session *s);
+#endif
+
+/**
+ * @brief Releases the prepared keys held by a responder session
+ * 
+ * @param s the session
+ * @retval an err code
+ */
+enum err edhoc_responder_session_deinit(struct edhoc_responder_session *s);
+
+/**
+ * @brief Advances a responder session with a received message. Unlike 
+ *        edhoc_responder_run() this function never calls tx() or rx(), 
+ *        i.e., one thread can drive many handshakes, e.g., from an event 
+ *        loop. In the state RESPONDER_WAIT_MSG1 msg_in is message 1 and 
+ *        msg_out message 2. In the state RESPONDER_WAIT_MSG3 msg_in is 
+ *        message 3 and msg_out message 4 or empty if c->msg4 is false, 
+ *        the session is then in the state RESPONDER_DONE and prk_4x3m and 
+ *        th4 contain the results for the exporter interface. After an 
+ *        error the session is in the state RESPONDER_FAILED. If 
+ *        c->reply_cache is not NULL, the replies are kept in the cache 
+ *        and a retransmission of a message processed before, e.g., 
+ *        message 1 in the state RESPONDER_WAIT_MSG3, is answered with the 
+ *        kept message 2 or message 4 without recomputation, the session 
+ *        and prk_4x3m and th4 are then not changed.
+ * 
+ * @param c responder context
+ * @param s the session
+ * @param cred_i_array Array of CRED_Is
+ * @param num_cred_i Number of elements in cred_i_array
+ * @param msg_in the received message
+ * @param msg_in_len length of msg_in
+ * @param msg_out the message to be sent (output)
+ * @param msg_out_len size of msg_out as input, length of the message as 
+ *        output
+ * @param ead EAD_1 or EAD_3 of the received message (output)
+ * @param ead_len length of ead
+ * @param prk_4x3m the derived secret (output)
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4 (output)
+ * @param th4_len length of th4
+ * @return enum err, wrong_parameter if the session is done or failed, 
+ *         message_retransmitted if msg_in was a retransmission and msg_out 
+ *         is the reply sent before, ecc_operation_in_progress if the 
+ *         session was initialized with edhoc_responder_session_init_sliced() 
+ *         and the step is not finished
+ */
+enum err edhoc_responder_step(struct edhoc_responder_context *c,
+			      struct edhoc_responder_session *s,
+			      struct other_party_cred *cred_i_array,
+			      uint16_t num_cred_i, const uint8_t *msg_in,
+			      uint32_t msg_in_len, uint8_t *msg_out,
+			      uint32_t *msg_out_len, uint8_t *ead,
+			      uint32_t *ead_len, uint8_t *prk_4x3m,
+			      uint32_t prk_4x3m_len, uint8_t *th4,
+			      uint32_t th4_len);
+
+/**
+ * @brief Initializes an initiator session. A session must be released with 
+ *        edhoc_initiator_session_deinit().
+ * 
+ * @param s the session
+ */
+void edhoc_initiator_session_init(struct edhoc_initiator_session *s);
+
+#ifdef EDHOC_ECC_RESTARTABLE
+/**
+ * @brief Initializes an initiator session whose P-256 operations are 
+ *        computed in slices, see edhoc_responder_session_init_sliced()
+ * 
+ * @param s the session
+ */
+void edhoc_initiator_session_init_sliced(struct edhoc_initiator_session *s);
+#endif
+
+/**
+ * @brief Zeroizes the ephemeral key held by an initiator session
+ * 
+ * @param s the session
+ * @retval an err code
+ */
+enum err edhoc_initiator_session_deinit(struct edhoc_initiator_session *s);
+
+/**
+ * @brief Advances an initiator session. Unlike edhoc_initiator_run() this 
+ *        function never calls tx() or rx(), i.e., one thread can drive 
+ *        many outbound handshakes. In the state INITIATOR_START msg_in is 
+ *        ignored and msg_out is message 1. In the state 
+ *        INITIATOR_WAIT_MSG2 msg_in is message 2, msg_out message 3 and 
+ *        prk_4x3m and th4 are outputs. If c->msg4 is true the session 
+ *        then waits for message 4, which is passed in the state 
+ *        INITIATOR_WAIT_MSG4 together with prk_4x3m and th4 as inputs, 
+ *        msg_out is then empty. After that the session is in the state 
+ *        INITIATOR_DONE, after an error in the state INITIATOR_FAILED.
+ * 
+ * @param c initiator context
+ * @param s the session
+ * @param cred_r_array Array of CRED_Rs
+ * @param num_cred_r Number of elements in cred_r_array
+ * @param msg_in the received message
+ * @param msg_in_len length of msg_in
+ * @param msg_out the message to be sent (output)
+ * @param msg_out_len size of msg_out as input, length of the message as 
+ *        output
+ * @param ead EAD_2 or EAD_4 of the received message (output)
+ * @param ead_len length of ead
+ * @param prk_4x3m the derived secret
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4
+ * @param th4_len length of th4
+ * @return enum err, wrong_parameter if the session is done or failed, 
+ *         ecc_operation_in_progress if the session was initialized with 
+ *         edhoc_initiator_session_init_sliced() and the step is not 
+ *         finished
+ */
+enum err edhoc_initiator_step(const struct edhoc_initiator_context *c,
+			      struct edhoc_initiator_session *s,
+			      struct other_party_cred *cred_r_array,
+			      uint16_t num_cred_r, const uint8_t *msg_in,
+			      uint32_t msg_in_len, uint8_t *msg_out,
+			      uint32_t *msg_out_len, uint8_t *ead,
+			      uint32_t *ead_len, uint8_t *prk_4x3m,
+			      uint32_t prk_4x3m_len, uint8_t *th4,
+			      uint32_t th4_len);
+
+/**
+ * @brief Initializes a table of responder sessions
+ * 
+ * @param t the table
+ * @param sessions caller provided storage for the sessions
+ * @param sessions_cnt number of elements in sessions, i.e., the maximal 
+ *        number of handshakes waiting for message 3
+ * @retval an err code
+ */
+enum err edhoc_session_table_init(struct edhoc_session_table *t,
+				  struct edhoc_responder_session *sessions,
+				  uint32_t sessions_cnt);
+
+/**
+ * @brief Starts a handshake in a free session of the table. The index of 
+ *        the session is used as C_R, i.e., c->c_r is ignored. 
+ * 
+ * @param c responder context
+ * @param t the table
+ * @param msg1 the received message 1
+ * @param msg1_len length of msg1
+ * @param msg2 message 2 (output)
+ * @param msg2_len size of msg2 as input, length of message 2 as output
+ * @param ead_1 EAD_1 from message 1 (output)
+ * @param ead_1_len length of EAD_1
+ * @param c_r the C_R of the session (output)
+ * @return enum err, session_table_full if no session is free, 
+ *         message_retransmitted if msg1 is a retransmission of the message 
+ *         1 of a session waiting for message 3 and c->reply_cache holds 
+ *         its message 2, msg2 is then this message 2
+ */
+enum err edhoc_session_table_msg1(struct edhoc_responder_context *c,
+				  struct edhoc_session_table *t,
+				  const uint8_t *msg1, uint32_t msg1_len,
+				  uint8_t *msg2, uint32_t *msg2_len,
+				  uint8_t *ead_1, uint32_t *ead_1_len,
+				  int *c_r);
+
+/**
+ * @brief Completes the handshake with the C_R of a received message 3, 
+ *        see edhoc_responder_step(). The session is free afterwards, also 
+ *        if an error occurred.
+ * 
+ * @param c responder context
+ * @param t the table
+ * @param c_r the C_R sent together with message 3
+ * @param cred_i_array Array of CRED_Is
+ * @param num_cred_i Number of elements in cred_i_array
+ * @param msg3 the received message 3
+ * @param msg3_len length of msg3
+ * @param msg4 message 4 (output), empty if c->msg4 is false
+ * @param msg4_len size of msg4 as input, length of message 4 as output
+ * @param ead_3 EAD_3 from message 3 (output)
+ * @param ead_3_len length of EAD_3
+ * @param prk_4x3m the derived secret (output)
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4 (output)
+ * @param th4_len length of th4
+ * @return enum err, session_not_found if no handshake with C_R waits for 
+ *         message 3, message_retransmitted if msg3 is a retransmission of 
+ *         the message 3 of a finished session with C_R and c->reply_cache 
+ *         holds its message 4, msg4 is then this message 4
+ */
+enum err edhoc_session_table_msg3(struct edhoc_responder_context *c,
+				  struct edhoc_session_table *t, int c_r,
+				  struct other_party_cred *cred_i_array,
+				  uint16_t num_cred_i, const uint8_t *msg3,
+				  uint32_t msg3_len, uint8_t *msg4,
+				  uint32_t *msg4_len, uint8_t *ead_3,
+				  uint32_t *ead_3_len, uint8_t *prk_4x3m,
+				  uint32_t prk_4x3m_len, uint8_t *th4,
+				  uint32_t th4_len);
+
+/**
+ * @brief Aborts a handshake waiting for message 3, e.g., after a timeout
+ * 
+ * @param t the table
+ * @param c_r the C_R of the handshake
+ * @return enum err, session_not_found if no handshake with C_R waits for 
+ *         message 3
+ */
+enum err edhoc_session_table_release(struct edhoc_session_table *t, int c_r);
+
+/**
+ * @brief Initializes the keys protecting state tokens. The token key is 
+ *        derived from key and salt with HKDF-SHA-256, so that a key kept 
+ *        across restarts is never used with the same nonce twice as long 
+ *        as every initialization uses a fresh salt.
+ * 
+ * @param k the keys
+ * @param key a random key of at most 32 bytes known only to the responder
+ * @param key_len length of key
+ * @param salt at least 16 fresh random bytes
+ * @param salt_len length of salt
+ * @param lifetime time after which a token is rejected, in the unit of the 
+ *        time passed to edhoc_responder_stateless_msg1() and 
+ *        edhoc_responder_stateless_msg3()
+ * @retval an err code
+ */
+enum err edhoc_state_keys_init(struct edhoc_state_keys *k, const uint8_t *key,
+			       uint32_t key_len, const uint8_t *salt,
+			       uint32_t salt_len, uint32_t lifetime);
+
+/**
+ * @brief Replaces the previous key with a new current key. Tokens sealed 
+ *        with the key current before the call can still be opened, older 
+ *        tokens are rejected. Must not be called concurrently with 
+ *        edhoc_responder_stateless_msg1() or 
+ *        edhoc_responder_stateless_msg3().
+ * 
+ * @param k the keys
+ * @param key a random key of at most 32 bytes
+ * @param key_len length of key
+ * @param salt at least 16 fresh random bytes
+ * @param salt_len length of salt
+ * @retval an err code
+ */
+enum err edhoc_state_keys_rotate(struct edhoc_state_keys *k,
+				 const uint8_t *key, uint32_t key_len,
+				 const uint8_t *salt, uint32_t salt_len);
+
+/**
+ * @brief Destroys the keys
+ * 
+ * @param k the keys
+ * @retval an err code
+ */
+enum err edhoc_state_keys_deinit(struct edhoc_state_keys *k);
+
+/**
+ * @brief Processes message 1 without keeping any state in the responder. 
+ *        The state needed for message 3 is returned as a token encrypted 
+ *        and authenticated under the current key of k. The transport must 
+ *        deliver the token back together with message 3, e.g., next to 
+ *        the C_R prepended to message 3.
+ * 
+ * @param c responder context
+ * @param k keys protecting the token
+ * @param now the current time of a monotonic clock of the caller, the 
+ *        token expires at now + k->lifetime
+ * @param msg1 the received message 1
+ * @param msg1_len length of msg1
+ * @param msg2 message 2 (output)
+ * @param msg2_len size of msg2 as input, length of message 2 as output
+ * @param ead_1 EAD_1 from message 1 (output)
+ * @param ead_1_len length of EAD_1
+ * @param token the state token (output)
+ * @param token_len size of token as input, at least 
+ *        EDHOC_STATE_TOKEN_SIZE, length of the token as output
+ * @retval an err code
+ */
+enum err edhoc_responder_stateless_msg1(struct edhoc_responder_context *c,
+					struct edhoc_state_keys *k, uint32_t now,
+					const uint8_t *msg1, uint32_t msg1_len,
+					uint8_t *msg2, uint32_t *msg2_len,
+					uint8_t *ead_1, uint32_t *ead_1_len,
+					uint8_t *token, uint32_t *token_len);
+
+/**
+ * @brief Processes message 3 with the state restored from a token of 
+ *        edhoc_responder_stateless_msg1(), see edhoc_responder_step().
+ *        The responder keeps no record of used tokens. Until it expires, 
+ *        a token can be replayed together with its message 3, which 
+ *        repeats the verification of message 3 and yields the same 
+ *        PRK_4x3m and TH_4 again. The lifetime bounds this window, 
+ *        applications must not treat such a repetition as a new session.
+ * 
+ * @param c responder context
+ * @param k keys protecting the token
+ * @param now the current time of the clock passed to 
+ *        edhoc_responder_stateless_msg1()
+ * @param token the state token
+ * @param token_len length of token
+ * @param cred_i_array Array of CRED_Is
+ * @param num_cred_i Number of elements in cred_i_array
+ * @param msg3 the received message 3
+ * @param msg3_len length of msg3
+ * @param msg4 message 4 (output), empty if c->msg4 is false
+ * @param msg4_len size of msg4 as input, length of message 4 as output
+ * @param ead_3 EAD_3 from message 3 (output)
+ * @param ead_3_len length of EAD_3
+ * @param prk_4x3m the derived secret (output)
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4 (output)
+ * @param th4_len length of th4
+ * @return enum err, state_token_invalid if the token was not sealed with 
+ *         the current or the previous key or was modified, 
+ *         state_token_expired if its lifetime has passed
+ */
+enum err edhoc_responder_stateless_msg3(
+	struct edhoc_responder_context *c, struct edhoc_state_keys *k,
+	uint32_t now, const uint8_t *token, uint32_t token_len,
+	struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+	const uint8_t *msg3, uint32_t msg3_len, uint8_t *msg4,
+	uint32_t *msg4_len, uint8_t *ead_3, uint32_t *ead_3_len,
+	uint8_t *prk_4x3m, uint32_t prk_4x3m_len, uint8_t *th4,
+	uint32_t th4_len);
 #endif
@@ -0,0 +1,199 @@
+/*
+   Copyright (c) 2022 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+/*
+ * EDHOC + OSCORE combined request, see draft-ietf-core-oscore-edhoc. The
+ * initiator sends EDHOC message 3 together with its first OSCORE request,
+ * which saves one round trip. The request carries the EDHOC option and its
+ * payload is message 3 followed by the OSCORE ciphertext. The KID in the
+ * OSCORE option is C_R.
+ *
+ * edhoc_oscore_context_init() installs the OSCORE context derived from a 
+ * completed handshake, see RFC9528 Appendix A.1.
+ */
+
+#ifndef EDHOC_OSCORE_H
+#define EDHOC_OSCORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "edhoc.h"
+#include "edhoc_internal.h"
+#include "oscore.h"
+
+#include "common/oscore_edhoc_error.h"
+
+/*size of the OSCORE Master Secret and Master Salt derived from EDHOC*/
+#define EDHOC_OSCORE_MASTER_SECRET_SIZE 16
+#define EDHOC_OSCORE_MASTER_SALT_SIZE 8
+
+/*the parameters of an OSCORE context derived from EDHOC. The context 
+refers to them, so they must live as long as the context.*/
+struct edhoc_oscore_material {
+	uint8_t master_secret[EDHOC_OSCORE_MASTER_SECRET_SIZE];
+	uint8_t master_salt[EDHOC_OSCORE_MASTER_SALT_SIZE];
+	uint8_t sender_id[MAX_KID_LEN];
+	uint32_t sender_id_len;
+	uint8_t recipient_id[MAX_KID_LEN];
+	uint32_t recipient_id_len;
+};
+
+/**
+ * @brief Derives the OSCORE context from a completed handshake and 
+ *        initializes it in one step. The Master Secret and the Master 
+ *        Salt are exported from PRK_4x3m with a single prepared HMAC key 
+ *        and the Sender and Recipient IDs are the connection identifiers 
+ *        chosen by the other party, i.e., the initiator sends with C_R and 
+ *        the responder with C_I. Replaces two calls of edhoc_exporter() 
+ *        and a hand filled struct oscore_init_params.
+ *
+ * @param dev_type the CoAP role of this party
+ * @param initiator true if this party was the EDHOC initiator
+ * @param suite the selected cipher suite, its application AEAD and hash 
+ *        must be AES-CCM-16-64-128 and SHA-256
+ * @param prk_4x3m PRK_4x3m of the handshake
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4 of the handshake
+ * @param th4_len length of th4
+ * @param c_i the connection identifier of the initiator
+ * @param c_r the connection identifier of the responder
+ * @param m storage for the parameters of the context, see struct 
+ *        edhoc_oscore_material
+ * @param request_table an initialized table of outstanding requests of a 
+ *        client or NULL, see struct oscore_init_params
+ * @param c the OSCORE context (output), release it with 
+ *        oscore_context_deinit()
+ * @return enum err
+ */
+enum err edhoc_oscore_context_init(enum dev_type dev_type, bool initiator,
+				   const struct suite *suite,
+				   const uint8_t *prk_4x3m,
+				   uint32_t prk_4x3m_len, const uint8_t *th4,
+				   uint32_t th4_len, const struct c_x *c_i,
+				   const struct c_x *c_r,
+				   struct edhoc_oscore_material *m,
+				   struct oscore_request_table *request_table,
+				   struct context *c);
+
+/**
+ * @brief Rekeys an OSCORE context installed with 
+ *        edhoc_oscore_context_init() without a new handshake. PRK_4x3m is 
+ *        updated with edhoc_key_update() and the context is released and 
+ *        derived again with the IDs kept in m. The Sender Sequence Number 
+ *        and the replay window start over. Both parties must update with 
+ *        the same nonce.
+ *
+ * @param dev_type the CoAP role of this party
+ * @param suite the selected cipher suite
+ * @param nonce the nonce of the update
+ * @param nonce_len length of nonce
+ * @param prk_4x3m the stored PRK_4x3m as input, the updated one as output
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4 of the handshake
+ * @param th4_len length of th4
+ * @param m the parameters of the context, see edhoc_oscore_context_init()
+ * @param request_table the table of outstanding requests of the context 
+ *        or NULL. It is emptied, since the responses of requests sent 
+ *        before the update cannot be verified with the new keys.
+ * @param c the OSCORE context which is rekeyed
+ * @return enum err
+ */
+enum err edhoc_oscore_key_update(enum dev_type dev_type,
+				 const struct suite *suite,
+				 const uint8_t *nonce, uint32_t nonce_len,
+				 uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+				 const uint8_t *th4, uint32_t th4_len,
+				 struct edhoc_oscore_material *m,
+				 struct oscore_request_table *request_table,
+				 struct context *c);
+
+/**
+ * @brief Builds a combined request from message 3 and an OSCORE request
+ *        protected with the context derived from the handshake, i.e.,
+ *        the EDHOC option is added and message 3 is put in front of the
+ *        payload.
+ *
+ * @param msg3 message 3, see msg3_gen() or edhoc_initiator_step()
+ * @param msg3_len length of msg3
+ * @param oscore_req the OSCORE request, see coap2oscore()
+ * @param oscore_req_len length of oscore_req
+ * @param out the combined request (output), must not overlap oscore_req
+ * @param out_len size of out as input, length of the request as output
+ * @return enum err
+ */
+enum err edhoc_oscore_combined_request_gen(const uint8_t *msg3,
+					   uint32_t msg3_len,
+					   uint8_t *oscore_req,
+					   uint32_t oscore_req_len,
+					   uint8_t *out, uint32_t *out_len);
+
+/**
+ * @brief Splits a received request into message 3 and the OSCORE request.
+ *        Requests without the EDHOC option are not changed.
+ *
+ * @param buf the received request
+ * @param buf_len length of buf
+ * @param combined true if the request carries the EDHOC option (output)
+ * @param msg3 points to message 3 within buf (output)
+ * @param msg3_len length of message 3 (output)
+ * @param oscore_req the OSCORE request without the EDHOC option (output)
+ * @param oscore_req_len size of oscore_req as input, length of the
+ *        request as output
+ * @return enum err
+ */
+enum err edhoc_oscore_combined_request_split(uint8_t *buf, uint32_t buf_len,
+					     bool *combined,
+					     const uint8_t **msg3,
+					     uint32_t *msg3_len,
+					     uint8_t *oscore_req,
+					     uint32_t *oscore_req_len);
+
+/**
+ * @brief Processes a combined request on the responder side in one step:
+ *        message 3 completes the handshake of the session, the OSCORE
+ *        context is derived from the handshake and the OSCORE request is
+ *        verified and decrypted. Message 4 is not sent in this mode,
+ *        c->msg4 must be false. The OSCORE response protected with
+ *        oscore_c confirms the keys to the initiator.
+ *
+ * @param c responder context
+ * @param s the session waiting for message 3, see edhoc_responder_step()
+ * @param cred_i_array Array of CRED_Is
+ * @param num_cred_i Number of elements in cred_i_array
+ * @param buf_in the received combined request
+ * @param buf_in_len length of buf_in
+ * @param m storage for the parameters of the OSCORE context, see
+ *        edhoc_oscore_context_init()
+ * @param oscore_c the OSCORE context (output), the Sender ID is C_I and
+ *        the Recipient ID is C_R
+ * @param coap_out the decrypted CoAP request (output)
+ * @param coap_out_len size of coap_out as input, length of the request as
+ *        output
+ * @param ead_3 EAD_3 from message 3 (output)
+ * @param ead_3_len length of EAD_3
+ * @param prk_4x3m the derived secret (output)
+ * @param prk_4x3m_len length of prk_4x3m
+ * @param th4 the transcript hash 4 (output)
+ * @param th4_len length of th4
+ * @return enum err, not_valid_input_packet if buf_in is not a combined
+ *         request
+ */
+enum err edhoc_oscore_combined_request_process(
+	struct edhoc_responder_context *c, struct edhoc_responder_session *s,
+	struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+	uint8_t *buf_in, uint32_t buf_in_len, struct edhoc_oscore_material *m,
+	struct context *oscore_c,
+	uint8_t *coap_out, uint32_t *coap_out_len, uint8_t *ead_3,
+	uint32_t *ead_3_len, uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+	uint8_t *th4, uint32_t th4_len);
+
+#endif
@@ -15,6 +15,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "oscore/context_table.h"
+#include "oscore/request_table.h"
 #include "oscore/security_context.h"
 #include "oscore/supported_algorithm.h"
 
@@ -54,6 +56,14 @@ struct oscore_init_params {
 	const enum AEAD_algorithm aead_alg;
 	/*kdf is optional (default HKDF-SHA-256)*/
 	const enum hkdf hkdf;
+	/*replay_window_len is optional (default REPLAY_WINDOW_LEN), width of 
+	the replay window in bits, at most 64*/
+	const uint8_t replay_window_len;
+	/*request_table is optional (default NULL), clients which send several 
+	requests before the responses arrive provide an initialized table of 
+	outstanding requests, see oscore_request_table_init(). Observe is 
+	not supported with the table.*/
+	struct oscore_request_table *request_table;
 };
 
 /**
@@ -67,6 +77,56 @@ struct oscore_init_params {
 enum err oscore_context_init(struct oscore_init_params *params,
 			     struct context *c);
 
+/**
+ * @brief 	Releases the crypto backend resources (e.g. imported keys) held 
+ * 		by a security context. Must be called before a context 
+ * 		initialized with oscore_context_init is discarded or 
+ * 		initialized again.
+ * 
+ * @param	c the context to be released
+ * @return  err
+ */
+enum err oscore_context_deinit(struct context *c);
+
+/**
+ * @brief 	Initializes an exchange object. An exchange keeps the nonce 
+ * 		and the AAD of a request until its response is protected 
+ * 		(server) or verified (client). Threads which use the same 
+ * 		context concurrently need an exchange each, see 
+ * 		coap2oscore_exchange() and oscore2coap_exchange().
+ * 
+ * @param	e the exchange
+ */
+void oscore_exchange_init(struct oscore_exchange *e);
+
+/**
+ * A packet of a batch, see coap2oscore_batch() and oscore2coap_batch().
+ */
+struct oscore_batch_packet {
+	/*the input packet*/
+	uint8_t *buf_in;
+	uint32_t buf_in_len;
+	/*the output buffer, buf_out_len is its size before and the length of 
+	the output packet after the call. buf_out may be equal to buf_in in 
+	oscore2coap_batch()*/
+	uint8_t *buf_out;
+	uint32_t buf_out_len;
+	/*set by oscore2coap_batch(), true if the input packet was OSCORE*/
+	bool oscore_pkg_flag;
+	/*the security context. oscore2coap_batch() sets it for requests 
+	found in the context table*/
+	struct context *c;
+	/*the exchange, NULL selects the exchange stored in the context. Only 
+	one packet of a batch may use the exchange of a context, further 
+	packets of the same context without own exchange fail with 
+	wrong_parameter, since a response would reuse the nonce of another 
+	request. Requests sent and responses received by a context with a 
+	table of outstanding requests may share the exchange.*/
+	struct oscore_exchange *e;
+	/*the result of the conversion of this packet*/
+	enum err result;
+};
+
 /**
  * @brief  	Checks if the packet in buf_in is a OSCORE packet.
  * 		If so it converts it to a CoAP packet and sets the oscore_pkg to
@@ -77,18 +137,109 @@ enum err oscore_context_init(struct oscore_init_params *params,
  * 		OSCORE or CoAP packet.
  * @param 	buf_in_len length of the data in the buf_in
  * @param 	buf_out when a OSCORE packet is found and decrypted the 
- * 		resulting CoAP is saved in buf_out
+ * 		resulting CoAP is saved in buf_out. It must be at least 
+ * 		buf_in_len bytes long.
  * @param 	buf_out_len length of the CoAP packet
  * @param	oscore_pkg_flag true if the received packet was OSOCRE, if the 
  * 		packet was CoAP false
- * @param 	c pointer to a security context
+ * @param 	c pointer to a security context. If the context of a client 
+ * 		has a table of outstanding requests the nonce and the AAD of 
+ * 		a response are taken from the request with the same token.
  * @param 	oscore_pkg indicates if an incoming packet is OSCORE
- * @return	err
+ * @return	err, oscore_request_not_found if a client with a table of 
+ * 		outstanding requests receives a response with an unknown 
+ * 		token
  */
 enum err oscore2coap(uint8_t *buf_in, uint32_t buf_in_len, uint8_t *buf_out,
 		     uint32_t *buf_out_len, bool *oscore_pkg_flag,
 		     struct context *c);
 
+/**
+ * @brief  	Same as oscore2coap() but the nonce and the AAD are kept in an 
+ * 		exchange object of the caller instead of the context. 
+ * 		Servers use the same exchange to protect the response with 
+ * 		coap2oscore_exchange(). Clients pass the exchange they used 
+ * 		for the request. Several threads can use one context 
+ * 		concurrently if the library is built with OSCORE_THREAD_SAFE 
+ * 		and each thread uses its own exchange.
+ * 
+ * @param 	e the exchange, see oscore_exchange_init()
+ * @return	err
+ */
+enum err oscore2coap_exchange(uint8_t *buf_in, uint32_t buf_in_len,
+			      uint8_t *buf_out, uint32_t *buf_out_len,
+			      bool *oscore_pkg_flag, struct context *c,
+			      struct oscore_exchange *e);
+
+/**
+ * @brief  	Same as oscore2coap() but the packet is decrypted and converted
+ * 		in place, i.e., no output buffer and no plaintext buffer are 
+ * 		needed. The CoAP packet is a part of buf and its payload is 
+ * 		not moved.
+ * 
+ * @param 	buf a buffer containing an incoming packet which can be 
+ * 		OSCORE or CoAP packet. The content of buf is overwritten and 
+ * 		undefined when an error is returned.
+ * @param 	buf_len length of the data in the buf
+ * @param 	coap pointer to the CoAP packet within buf
+ * @param 	coap_len length of the CoAP packet
+ * @param	oscore_pkg_flag true if the received packet was OSOCRE, if the 
+ * 		packet was CoAP false
+ * @param 	c pointer to a security context
+ * @param 	e the exchange of the request, see oscore2coap_exchange()
+ * @return	err
+ */
+enum err oscore2coap_in_place(uint8_t *buf, uint32_t buf_len, uint8_t **coap,
+			      uint32_t *coap_len, bool *oscore_pkg_flag,
+			      struct context *c, struct oscore_exchange *e);
+
+/**
+ * @brief  	Same as oscore2coap() but for servers with many clients. The 
+ * 		security context of an incoming request is found in a context 
+ * 		table by the KID context and the KID in its OSCORE option.
+ * 
+ * @param 	buf_in a buffer containing an incoming packet which can be 
+ * 		OSCORE or CoAP packet.
+ * @param 	buf_in_len length of the data in the buf_in
+ * @param 	buf_out when a OSCORE packet is found and decrypted the 
+ * 		resulting CoAP is saved in buf_out. It must be at least 
+ * 		buf_in_len bytes long.
+ * @param 	buf_out_len length of the CoAP packet
+ * @param	oscore_pkg_flag true if the received packet was OSOCRE, if the 
+ * 		packet was CoAP false
+ * @param 	t the table containing the server contexts
+ * @param 	c the context used for the request. It must be used for the 
+ * 		protection of the response. NULL for CoAP packets.
+ * @param 	e the exchange for the request, which must be used for the 
+ * 		protection of the response. NULL selects the exchange 
+ * 		stored in the context, which is not thread safe.
+ * @return	err, oscore_kid_recipent_id_mismatch if no context matches 
+ * 		and wrong_parameter if the packet is not a request
+ */
+enum err oscore2coap_table(uint8_t *buf_in, uint32_t buf_in_len,
+			   uint8_t *buf_out, uint32_t *buf_out_len,
+			   bool *oscore_pkg_flag,
+			   struct oscore_context_table *t, struct context **c,
+			   struct oscore_exchange *e);
+
+/**
+ * @brief  	Converts a batch of incoming packets, e.g. received with 
+ * 		recvmmsg(), as oscore2coap_table() or oscore2coap_exchange() 
+ * 		would. Consecutive requests with the same KID context and KID 
+ * 		are processed with a single table lookup. An error of one 
+ * 		packet does not stop the conversion of the other packets.
+ * 
+ * @param 	packets the packets, see struct oscore_batch_packet
+ * @param 	packets_cnt number of packets
+ * @param 	t the table used to find the contexts of requests or NULL. 
+ * 		Responses, and requests if t is NULL, are converted with the 
+ * 		context of the packet.
+ * @return	err, the results of the packets are in their result field
+ */
+enum err oscore2coap_batch(struct oscore_batch_packet *packets,
+			   uint32_t packets_cnt,
+			   struct oscore_context_table *t);
+
 /**
  *@brief 	Converts a CoAP packet to OSCORE packet
  *
@@ -96,11 +247,41 @@ enum err oscore2coap(uint8_t *buf_in, uint32_t buf_in_len, uint8_t *buf_out,
  *@param	buf_o_coap_len length of the CoAP buffer
  *@param	buf_oscore a buffer where the OSCORE packet will be written
  *@param	buf_oscore_len length of the OSCORE packet
- *@param	c a struct containing the OSCORE context
- *@return	err
+ *@param	c a struct containing the OSCORE context. Requests are added 
+ *		to the table of outstanding requests of the context, if any.
+ *@return	err, oscore_request_table_full if a request cannot be added 
+ *		to the table of outstanding requests
  */
 enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
 		     uint8_t *buf_oscore, uint32_t *buf_oscore_len,
 		     struct context *c);
 
+/**
+ *@brief 	Same as coap2oscore() but the nonce and the AAD of a request 
+ *		are kept in an exchange object of the caller, see 
+ *		oscore2coap_exchange(). The sender sequence number is 
+ *		reserved atomically if the library is built with 
+ *		OSCORE_THREAD_SAFE.
+ *
+ *@param	e the exchange, see oscore_exchange_init()
+ *@return	err
+ */
+enum err coap2oscore_exchange(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
+			      uint8_t *buf_oscore, uint32_t *buf_oscore_len,
+			      struct context *c, struct oscore_exchange *e);
+
+/**
+ *@brief 	Converts a batch of CoAP packets to OSCORE packets, e.g. before 
+ *		sending them with sendmmsg(), as coap2oscore_exchange() 
+ *		would. An error of one packet does not stop the conversion of 
+ *		the other packets.
+ *
+ *@param	packets the packets, see struct oscore_batch_packet. The 
+ *		context of each packet must be set.
+ *@param	packets_cnt number of packets
+ *@return	err, the results of the packets are in their result field
+ */
+enum err coap2oscore_batch(struct oscore_batch_packet *packets,
+			   uint32_t packets_cnt);
+
 #endif
@@ -19,20 +19,35 @@
 #include "common/oscore_edhoc_error.h"
 
 /**
- * @brief   Serialize given parameters into the AAD structure.
+ * @brief   Creates the beginning of the Enc_structure (see RFC8613 Section 
+ *          5.4) which is the same for all messages of a security context, 
+ *          i.e., the context "Encrypt0", the empty protected header and the 
+ *          aad_array up to the request_kid.
+ * @param   aead_alg AEAD Algorithm to use
+ * @param   kid KID parameter. This should be the Sender ID of the endpoint 
+ *          sending the requests.
+ * @param   out out-array. out->len is set to the length of the prefix.
+ * @return  err
+ */
+enum err create_aad_prefix(enum AEAD_algorithm aead_alg,
+			   struct byte_array *kid, struct byte_array *out);
+
+/**
+ * @brief   Creates the Enc_structure which is used as AAD of the AEAD 
+ *          algorithm. Only the request_piv and the Class I options are 
+ *          encoded, all other parameters are copied from a prefix.
  * @param   options CoAP Options to include in AAD (only Class 
  *          I Options will be included)
  * @param   opt_num Number of options
- * @param   aead_alg AEAD Algorithm to use
- * @param   kid KID parameter. This should be the Recipient ID.
+ * @param   prefix the prefix created with create_aad_prefix()
  * @param   piv PIV parameter. This should be the request sender 
  *          sequence number.
- * @param   out out-array. Must have the exact length as 
- *          provided by `aad_length`.
+ * @param   out out-array. out->len is set to the length of the 
+ *          Enc_structure.
  * @return err
  */
 enum err create_aad(struct o_coap_option *options, uint16_t opt_num,
-		       enum AEAD_algorithm aead_alg, struct byte_array *kid,
-		       struct byte_array *piv, struct byte_array *out);
+		    struct byte_array *prefix, struct byte_array *piv,
+		    struct byte_array *out);
 
 #endif
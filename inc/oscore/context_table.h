@@ -0,0 +1,87 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#ifndef CONTEXT_TABLE_H
+#define CONTEXT_TABLE_H
+
+#include <stdint.h>
+
+#include "security_context.h"
+
+#include "common/byte_array.h"
+#include "common/oscore_edhoc_error.h"
+
+/**
+ * @brief   A table of server security contexts indexed by 
+ *          (ID Context, Recipient ID), i.e., by the (KID context, KID) pair 
+ *          a client sends in the OSCORE option of its requests. 
+ * 
+ *          The table is a hash table with open addressing. It holds only 
+ *          pointers to the contexts; the contexts and the slot array are 
+ *          provided by the caller. The ID Context and the Recipient ID of 
+ *          a context must not change while the context is in the table.
+ */
+struct oscore_context_table {
+	struct context **slots;
+	uint32_t slots_cnt;
+	uint32_t entries_cnt;
+};
+
+/**
+ * @brief   Initializes an empty context table
+ * @param   t the table
+ * @param   slots caller provided storage for the table. At least one slot 
+ *          stays empty, i.e., the table holds up to slots_cnt - 1 contexts. 
+ *          For short lookups slots_cnt should be about twice the number of 
+ *          contexts.
+ * @param   slots_cnt number of elements in slots
+ * @retval  err
+ */
+enum err oscore_context_table_init(struct oscore_context_table *t,
+				   struct context **slots, uint32_t slots_cnt);
+
+/**
+ * @brief   Adds an initialized security context to the table
+ * @param   t the table
+ * @param   c the context
+ * @retval  oscore_context_table_full if there is no free slot, 
+ *          oscore_context_table_duplicate if a context with the same 
+ *          ID Context and Recipient ID is already in the table
+ */
+enum err oscore_context_table_insert(struct oscore_context_table *t,
+				     struct context *c);
+
+/**
+ * @brief   Removes a security context from the table. The context itself 
+ *          is not modified, i.e., oscore_context_deinit() needs to be 
+ *          called separately.
+ * @param   t the table
+ * @param   c the context
+ * @retval  oscore_kid_recipent_id_mismatch if c is not in the table
+ */
+enum err oscore_context_table_remove(struct oscore_context_table *t,
+				     struct context *c);
+
+/**
+ * @brief   Finds the security context for a received request
+ * @param   t the table
+ * @param   kid_context the KID context of the request, an empty array 
+ *          if the request contains none
+ * @param   kid the KID of the request
+ * @param   c the found context
+ * @retval  oscore_kid_recipent_id_mismatch if no context matches
+ */
+enum err oscore_context_table_lookup(struct oscore_context_table *t,
+				     const struct byte_array *kid_context,
+				     const struct byte_array *kid,
+				     struct context **c);
+
+#endif
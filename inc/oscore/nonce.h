@@ -16,13 +16,27 @@
 #include "common/oscore_edhoc_error.h"
 
 /**
- * @brief   Create the OSCORE nonce.
- * @param   id_piv "Sender ID of the endpoint that generated the Partial IV"
- * @param   partial_iv MUST be max 5 bytes long
- * @param   common_iv MUST be 13 bytes long
- * @param   out MUST be 13 bytes long
+ * @brief   Computes the part of the AEAD nonce which is the same for all 
+ *          messages of a security context, i.e., the nonce for PIV 0, see 
+ *          RFC8613 Section 5.2.
+ * @param   id_piv the ID_PIV, i.e., the Sender ID of the endpoint sending 
+ *          the requests
+ * @param   common_iv the Common IV
+ * @param   out out-array of NONCE_LEN bytes
+ * @return  err
  */
-enum err create_nonce(struct byte_array *id_piv, struct byte_array *piv,
-		      struct byte_array *common_iv, struct byte_array *nonce);
+enum err create_nonce_template(struct byte_array *id_piv,
+			       struct byte_array *common_iv, uint8_t *out);
+
+/**
+ * @brief   Computes the AEAD nonce of a message by XORing the PIV into a 
+ *          nonce template.
+ * @param   template template created with create_nonce_template()
+ * @param   piv the PIV
+ * @param   nonce out-array. Must be at least NONCE_LEN bytes long.
+ * @return  err
+ */
+enum err create_nonce(const uint8_t *template, struct byte_array *piv,
+		      struct byte_array *nonce);
 
 #endif
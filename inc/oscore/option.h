@@ -34,6 +34,8 @@ enum o_coap_option_num {
 	COAP_OPTION_URI_QUERY = 15,
 	COAP_OPTION_ACCEPT = 17,
 	COAP_OPTION_LOCATION_QUERY = 20,
+	/*marks a request carrying EDHOC message 3, see edhoc_oscore.h*/
+	COAP_OPTION_EDHOC = 21,
 	COAP_OPTION_BLOCK2 = 23,
 	COAP_OPTION_BLOCK1 = 27,
 	COAP_OPTION_SIZE2 = 28,
@@ -18,10 +18,14 @@
 #include "common/oscore_edhoc_error.h"
 
 #define MAX_PIV_LEN 5
+#define MAX_TOKEN_LEN 8
 #define MAX_KID_CONTEXT_LEN                                                    \
 	8 /*This implementation supports Context IDs up to 8 byte*/
 #define MAX_KID_LEN 7
-#define MAX_AAD_LEN 30
+/*Enc_structure with the aad_array, up to 30 bytes Class I options included*/
+#define MAX_AAD_LEN 64
+/*Enc_structure up to and including the request_kid, see create_aad_prefix()*/
+#define MAX_AAD_PREFIX_LEN (17 + MAX_KID_LEN)
 #define MAX_INFO_LEN 50
 
 /* Mask and offset for first byte in CoAP/OSCORE header*/
@@ -75,7 +79,7 @@ struct o_coap_option {
 	uint16_t delta;
 	uint8_t len;
 	uint8_t *value;
-	uint8_t option_number;
+	uint16_t option_number;
 };
 
 struct oscore_option {
@@ -83,7 +87,7 @@ struct oscore_option {
 	uint8_t len;
 	uint8_t *value;
 	uint8_t buf[OSCORE_OPT_VALUE_LEN];
-	uint8_t option_number;
+	uint16_t option_number;
 };
 
 struct o_coap_packet {
@@ -118,6 +122,22 @@ struct piv_kid_context {
  */
 enum err buf2coap(struct byte_array *in, struct o_coap_packet *out);
 
+/**
+ * @brief   Parses CoAP options. The parsing stops at the payload marker 
+ *          0xFF or at the end of the data.
+ * @param   in_data: the options, optionally followed by a payload
+ * @param   in_data_len: length of in_data
+ * @param   out_options: array of MAX_OPTION_COUNT options. The values 
+ *          point into in_data.
+ * @param   out_options_count: number of parsed options
+ * @param   options_len: length of the options, i.e., the offset of the 
+ *          payload marker or in_data_len
+ * @return  err
+ */
+enum err buf2options(uint8_t *in_data, uint32_t in_data_len,
+		     struct o_coap_option *out_options,
+		     uint8_t *out_options_count, uint32_t *options_len);
+
 /**
  * @brief   Converts a CoAP/OSCORE packet to a byte string
  * @param   in: input CoAP/OSCORE packet
@@ -13,6 +13,7 @@
 #define OSCORE_COSE_H
 
 #include "common/byte_array.h"
+#include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
 /**
@@ -20,25 +21,25 @@
  * @param in_ciphertext: input ciphertext to be decrypted
  * @param out_plaintext: output plaintext
  * @param nonce the nonce
- * @param aad the aad
- * @param recipient_key the recipient key
+ * @param aad the Enc_structure, see create_aad()
+ * @param recipient_key the prepared recipient key
  * @return err
  */
 enum err oscore_cose_decrypt(struct byte_array *in_ciphertext,
 		      struct byte_array *out_plaintext,
 		      struct byte_array *nonce, struct byte_array *aad,
-		      struct byte_array *recipient_key);
+		      struct aead_key *recipient_key);
 
 /**
  * @brief Encrypt the plaintext
  * @param in_plaintext: input plaintext to be encrypted
  * @param out_ciphertext: output ciphertext with authentication tag (8 bytes)
  * @param nonce the nonce
- * @param aad the aad
- * @param sender_key the sender key
+ * @param aad the Enc_structure, see create_aad()
+ * @param sender_key the prepared sender key
  * @return err
  */
 enum err oscore_cose_encrypt(struct byte_array *in_plaintext, uint8_t *out_ciphertext,
 		      uint32_t out_ciphertext_len, struct byte_array *nonce,
-		      struct byte_array *sender_aad, struct byte_array *key);
+		      struct byte_array *aad, struct aead_key *key);
 #endif
@@ -0,0 +1,88 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#ifndef REPLAY_PROTECTION_H
+#define REPLAY_PROTECTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "common/byte_array.h"
+#include "common/oscore_edhoc_error.h"
+
+/*default width of the replay window in bits, can be overwritten at compile 
+time or per context, see struct oscore_init_params*/
+#ifndef REPLAY_WINDOW_LEN
+#define REPLAY_WINDOW_LEN 32
+#endif
+
+/*the window is kept in a single 64 bit word*/
+#define REPLAY_WINDOW_MAX_LEN 64
+
+#if REPLAY_WINDOW_LEN > REPLAY_WINDOW_MAX_LEN
+#error "REPLAY_WINDOW_LEN must not be larger than 64"
+#endif
+
+/*largest sender sequence number which fits into a 5 byte Partial IV*/
+#define MAX_SSN ((uint64_t)0xFFFFFFFFFF)
+
+/**
+ * @brief   Sliding window replay protection, see RFC8613 Section 7.4 and 
+ *          RFC4303 Appendix A. Bit i of bitmap is set if the sender 
+ *          sequence number ssn_max - i was already received.
+ */
+struct replay_window {
+	uint64_t ssn_max;
+	uint64_t bitmap;
+	uint8_t len;
+	/*protects the window when OSCORE_THREAD_SAFE is defined*/
+	bool lock;
+};
+
+/**
+ * @brief   Initializes an empty replay window
+ * @param   w the window
+ * @param   len the width of the window in bits, 0 selects 
+ *          REPLAY_WINDOW_LEN
+ * @retval  err
+ */
+enum err replay_window_init(struct replay_window *w, uint8_t len);
+
+/**
+ * @brief   Converts a Partial IV (big endian, up to 5 bytes) to a sender 
+ *          sequence number
+ * @param   piv the Partial IV
+ * @param   ssn the sender sequence number
+ * @retval  oscore_inpkt_invalid_piv if the PIV is empty or too long
+ */
+enum err piv2ssn(const struct byte_array *piv, uint64_t *ssn);
+
+/**
+ * @brief   Checks if a sender sequence number is new, i.e., it was not 
+ *          received before and is not left of the window
+ * @param   w the window
+ * @param   ssn the received sender sequence number
+ * @retval  replayed_packed_received if ssn is not new
+ */
+enum err replay_check(struct replay_window *w, uint64_t ssn);
+
+/**
+ * @brief   Marks a sender sequence number as received. Must be called only 
+ *          after the request was verified successfully. The check is 
+ *          repeated, so that of two concurrently verified copies of a 
+ *          request only the first is accepted.
+ * @param   w the window
+ * @param   ssn the received sender sequence number
+ * @retval  replayed_packed_received if ssn is not new anymore
+ */
+enum err replay_window_update(struct replay_window *w, uint64_t ssn);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#ifndef REQUEST_TABLE_H
+#define REQUEST_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "oscore_coap.h"
+
+#include "common/byte_array.h"
+#include "common/oscore_edhoc_error.h"
+
+/*an outstanding request of a client*/
+struct oscore_request {
+	uint8_t token[MAX_TOKEN_LEN];
+	uint8_t token_len;
+	uint8_t piv[MAX_PIV_LEN];
+	uint8_t piv_len;
+	bool used;
+	/*reserved by oscore_request_table_reserve(), the PIV is not set yet*/
+	bool pending;
+};
+
+/**
+ * @brief   A bounded table of the outstanding requests of a client indexed 
+ *          by their CoAP token. The table stores the Partial IV of each 
+ *          request, which together with the KID of the context (the 
+ *          Sender ID of the client) determines the nonce and the AAD of 
+ *          the response. This allows a client to have many requests on 
+ *          the wire at the same time. The entry array is provided by the 
+ *          caller. An entry is removed when the first response with its 
+ *          token is verified and all responses are verified with the 
+ *          nonce of the request, i.e., Observe notifications, which 
+ *          carry their own Partial IV, are not supported with the table.
+ */
+struct oscore_request_table {
+	struct oscore_request *entries;
+	uint32_t entries_cnt;
+	bool lock;
+};
+
+/**
+ * @brief   Initializes an empty request table
+ * @param   t the table
+ * @param   entries caller provided storage for the table
+ * @param   entries_cnt number of elements in entries, i.e., the maximal 
+ *          number of outstanding requests
+ * @retval  err
+ */
+enum err oscore_request_table_init(struct oscore_request_table *t,
+				   struct oscore_request *entries,
+				   uint32_t entries_cnt);
+
+/**
+ * @brief   Adds a request to the table. An outstanding request with the 
+ *          same token is replaced.
+ * @param   t the table
+ * @param   token the token of the request
+ * @param   piv the Partial IV of the request
+ * @retval  oscore_request_table_full if all entries are used
+ */
+enum err oscore_request_table_insert(struct oscore_request_table *t,
+				     const struct byte_array *token,
+				     const struct byte_array *piv);
+
+/**
+ * @brief   Reserves the entry of a request before its Sender Sequence 
+ *          Number is taken, so that a full table does not cost a Partial 
+ *          IV. An outstanding request with the same token is replaced. 
+ *          The entry must be completed with oscore_request_table_commit() 
+ *          or freed with oscore_request_table_release().
+ * @param   t the table
+ * @param   token the token of the request
+ * @param   r the reserved entry (output)
+ * @retval  oscore_request_table_full if all entries are used
+ */
+enum err oscore_request_table_reserve(struct oscore_request_table *t,
+				      const struct byte_array *token,
+				      struct oscore_request **r);
+
+/**
+ * @brief   Sets the Partial IV of a reserved entry, after that responses 
+ *          with its token are matched
+ * @param   t the table
+ * @param   r the entry returned by oscore_request_table_reserve()
+ * @param   piv the Partial IV of the request
+ * @retval  err
+ */
+enum err oscore_request_table_commit(struct oscore_request_table *t,
+				     struct oscore_request *r,
+				     const struct byte_array *piv);
+
+/**
+ * @brief   Frees a reserved entry of a request which was not sent
+ * @param   t the table
+ * @param   r the entry returned by oscore_request_table_reserve()
+ */
+void oscore_request_table_release(struct oscore_request_table *t,
+				  struct oscore_request *r);
+
+/**
+ * @brief   Finds the request matching a response
+ * @param   t the table
+ * @param   token the token of the response
+ * @param   piv output for the Partial IV of the request, at least 
+ *          MAX_PIV_LEN bytes
+ * @retval  oscore_request_not_found if there is no request with this token
+ */
+enum err oscore_request_table_lookup(struct oscore_request_table *t,
+				     const struct byte_array *token,
+				     struct byte_array *piv);
+
+/**
+ * @brief   Removes a request from the table, e.g., after its response was 
+ *          verified or when the application gives up waiting for it
+ * @param   t the table
+ * @param   token the token of the request
+ * @retval  oscore_request_not_found if there is no request with this token
+ */
+enum err oscore_request_table_remove(struct oscore_request_table *t,
+				     const struct byte_array *token);
+
+#endif
@@ -14,12 +14,13 @@
 
 #include "supported_algorithm.h"
 #include "oscore_coap.h"
+#include "replay_protection.h"
+#include "request_table.h"
 
 #include "common/byte_array.h"
+#include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
-#define REPLAY_WINDOW_LEN 32
-
 enum dev_type {
 	SERVER,
 	CLIENT,
@@ -42,6 +43,11 @@ struct common_context {
 	struct byte_array id_context; /*optional*/
 	struct byte_array common_iv;
 	uint8_t common_iv_buf[COMMON_IV_LEN];
+	/*precomputed parts of the nonce and the AAD which are the same for 
+	all messages, see create_nonce_template() and create_aad_prefix()*/
+	uint8_t nonce_template[NONCE_LEN];
+	struct byte_array aad_prefix;
+	uint8_t aad_prefix_buf[MAX_AAD_PREFIX_LEN];
 };
 
 /* Sender Context used for encrypting outbound messages */
@@ -50,6 +56,8 @@ struct sender_context {
 	uint8_t sender_id_buf[7];
 	struct byte_array sender_key;
 	uint8_t sender_key_buf[SENDER_KEY_LEN_];
+	/*sender_key imported into the crypto backend*/
+	struct aead_key sender_aead_key;
 	uint64_t sender_seq_num;
 };
 
@@ -58,13 +66,16 @@ struct recipient_context {
 	struct byte_array recipient_id;
 	struct byte_array recipient_key;
 	uint8_t recipient_key_buf[RECIPIENT_KEY_LEN_];
-	uint64_t replay_window[REPLAY_WINDOW_LEN];
-	uint8_t replay_window_len;
+	/*recipient_key imported into the crypto backend*/
+	struct aead_key recipient_aead_key;
+	struct replay_window replay_window;
 };
 
-/*request-response context contains parameters that need to persists between
- * requests and responses*/
-struct req_resp_context {
+/*the parameters of a request which need to persist until its response is 
+protected or verified. An exchange is owned by the caller, which allows 
+several threads to process messages with the same context concurrently, 
+see coap2oscore_exchange() and oscore2coap_exchange()*/
+struct oscore_exchange {
 	struct byte_array nonce;
 	uint8_t nonce_buf[NONCE_LEN];
 
@@ -73,12 +84,23 @@ struct req_resp_context {
 
 	struct byte_array piv;
 	uint8_t piv_buf[MAX_PIV_LEN];
+};
+
+/*request-response context contains parameters that need to persists between
+ * requests and responses*/
+struct req_resp_context {
+	/*the exchange used by coap2oscore() and oscore2coap()*/
+	struct oscore_exchange exchange;
 
 	struct byte_array kid_context;
 	uint8_t kid_context_buf[MAX_KID_CONTEXT_LEN];
 
 	struct byte_array kid;
 	uint8_t kid_buf[MAX_KID_LEN];
+
+	/*the outstanding requests of a client, NULL if the responses are 
+	verified with the exchange of the request*/
+	struct oscore_request_table *requests;
 };
 
 /* Context struct containing all contexts*/
@@ -98,16 +120,20 @@ struct context {
 enum err sender_seq_num2piv(uint64_t ssn, struct byte_array *piv);
 
 /**
- * @brief   Updates runtime parameter of the context
+ * @brief   Computes the nonce and the AAD of a request and updates the 
+ *          context if a server receives a new KID context. The update of 
+ *          the keys is not thread safe.
  * @param   type of the device SERVER/CLIENT
  * @param   options pointer to an array of options
  * @param   opt_num number of options
- * @param   new_piv new PIV
+ * @param   new_piv new PIV, only used by servers. Clients set e->piv before.
  * @param   new_kid_context 
  * @param   c oscore context
+ * @param   e the exchange of the request
  */
 enum err context_update(enum dev_type dev, struct o_coap_option *options,
 			uint16_t opt_num, struct byte_array *new_piv,
-			struct byte_array *new_kid_context, struct context *c);
+			struct byte_array *new_kid_context, struct context *c,
+			struct oscore_exchange *e);
 
 #endif
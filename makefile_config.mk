@@ -14,6 +14,15 @@ OPT = -O3
 # Uncomment this to print intermediery results at runtime
 #DEBUG_PRINT += -DDEBUG_PRINT
 
+# Uncomment this to allow several threads to protect and verify messages 
+# with the same OSCORE security context concurrently
+#THREAD_SAFE += -DOSCORE_THREAD_SAFE
+
+# Uncomment this to build the POSIX thread pool which processes received 
+# EDHOC messages on other threads (see edhoc/worker_pool.h). It requires 
+# OSCORE_THREAD_SAFE above and the application must link with -lpthread.
+#EDHOC_WORKER_POOL += -DEDHOC_WORKER_POOL_PTHREAD
+
 
 # CBOR engine
 # currently only ZCBOR is supported
@@ -76,4 +85,11 @@ CBOR_ENGINE += -DZCBOR
 
 #CRYPTO_ENGINE += -DTINYCRYPT
 CRYPTO_ENGINE += -DCOMPACT25519
-CRYPTO_ENGINE += -DMBEDTLS
\ No newline at end of file
+CRYPTO_ENGINE += -DMBEDTLS
+
+# Uncomment this to compute the P-256 operations (ES256 sign/verify, ECDH) 
+# of sliced EDHOC sessions with MBEDTLS in bounded slices, see 
+# edhoc_responder_session_init_sliced() and ecc_restartable_config(). 
+# MBEDTLS_ECP_RESTARTABLE and MBEDTLS_ECDSA_DETERMINISTIC must be enabled in 
+# the mbedtls configuration.
+#CRYPTO_ENGINE += -DEDHOC_ECC_RESTARTABLE
\ No newline at end of file
@@ -186,6 +186,10 @@ int main()
 	c_i.pk_i.len = test_vectors[vec_num_i].pk_i_raw_len;
 	c_i.pk_i.ptr = (uint8_t *)test_vectors[vec_num_i].pk_i_raw;
 	c_i.sock = &sockfd;
+	c_i.ephemeral_keys = NULL;
+	c_i.cred_store = NULL;
+	c_i.cert_cache = NULL;
+	c_i.sign_key = NULL;
 
 	cred_r.id_cred.len = test_vectors[vec_num_i].id_cred_r_len;
 	cred_r.id_cred.ptr = (uint8_t *)test_vectors[vec_num_i].id_cred_r;
@@ -199,6 +203,7 @@ int main()
 	cred_r.ca.ptr = (uint8_t *)test_vectors[vec_num_i].ca;
 	cred_r.ca_pk.len = test_vectors[vec_num_i].ca_pk_len;
 	cred_r.ca_pk.ptr = (uint8_t *)test_vectors[vec_num_i].ca_pk;
+	cred_r.pk_key = NULL;
 
 #ifdef USE_RANDOM_EPHEMERAL_DH_KEY
 	uint32_t seed;
@@ -205,6 +205,7 @@ int main()
 	cred_i.ca.ptr = (uint8_t *)test_vectors[vec_num_i].ca;
 	cred_i.ca_pk.len = test_vectors[vec_num_i].ca_pk_len;
 	cred_i.ca_pk.ptr = (uint8_t *)test_vectors[vec_num_i].ca_pk;
+	cred_i.pk_key = NULL;
 
 	if (test_vectors[vec_num_i].c_r_raw != NULL) {
 		c_r.c_r.type = BSTR;
@@ -239,6 +240,11 @@ int main()
 	c_r.pk_r.len = test_vectors[vec_num_i].pk_r_raw_len;
 	c_r.pk_r.ptr = (uint8_t *)test_vectors[vec_num_i].pk_r_raw;
 	c_r.sock = &sockfd;
+	c_r.ephemeral_keys = NULL;
+	c_r.cred_store = NULL;
+	c_r.cert_cache = NULL;
+	c_r.reply_cache = NULL;
+	c_r.sign_key = NULL;
 
 	while (1) {
 #ifdef USE_RANDOM_EPHEMERAL_DH_KEY
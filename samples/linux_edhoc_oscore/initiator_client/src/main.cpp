@@ -196,6 +196,10 @@ int main()
 	c_i.pk_i.len = test_vectors[vec_num_i].pk_i_raw_len;
 	c_i.pk_i.ptr = (uint8_t *)test_vectors[vec_num_i].pk_i_raw;
 	c_i.sock = &sockfd;
+	c_i.ephemeral_keys = NULL;
+	c_i.cred_store = NULL;
+	c_i.cert_cache = NULL;
+	c_i.sign_key = NULL;
 
 	cred_r.id_cred.len = test_vectors[vec_num_i].id_cred_r_len;
 	cred_r.id_cred.ptr = (uint8_t *)test_vectors[vec_num_i].id_cred_r;
@@ -209,6 +213,7 @@ int main()
 	cred_r.ca.ptr = (uint8_t *)test_vectors[vec_num_i].ca;
 	cred_r.ca_pk.len = test_vectors[vec_num_i].ca_pk_len;
 	cred_r.ca_pk.ptr = (uint8_t *)test_vectors[vec_num_i].ca_pk;
+	cred_r.pk_key = NULL;
 
 	TRY(edhoc_initiator_run(&c_i, &cred_r, cred_num, err_msg, &err_msg_len,
 				ad_2, &ad_2_len, ad_4, &ad_4_len, PRK_4x3m,
@@ -303,6 +308,7 @@ int main()
 			if (n < 0) {
 				printf("no response received\n");
 			} else {
+				coap_rx_buf_len = sizeof(coap_rx_buf);
 				TRY(oscore2coap((uint8_t *)buffer, n,
 						coap_rx_buf, &coap_rx_buf_len,
 						&oscore_flag, &c_client));
@@ -220,6 +220,7 @@ int main()
 	cred_i.ca.ptr = (uint8_t *)test_vectors[vec_num_i].ca;
 	cred_i.ca_pk.len = test_vectors[vec_num_i].ca_pk_len;
 	cred_i.ca_pk.ptr = (uint8_t *)test_vectors[vec_num_i].ca_pk;
+	cred_i.pk_key = NULL;
 
 	if (test_vectors[vec_num_i].c_r_raw != NULL) {
 		c_r.c_r.type = BSTR;
@@ -254,6 +255,11 @@ int main()
 	c_r.pk_r.len = test_vectors[vec_num_i].pk_r_raw_len;
 	c_r.pk_r.ptr = (uint8_t *)test_vectors[vec_num_i].pk_r_raw;
 	c_r.sock = &sockfd;
+	c_r.ephemeral_keys = NULL;
+	c_r.cred_store = NULL;
+	c_r.cert_cache = NULL;
+	c_r.reply_cache = NULL;
+	c_r.sign_key = NULL;
 
 	TRY(edhoc_responder_run(&c_r, &cred_i, cred_num, err_msg, &err_msg_len,
 				(uint8_t *)&ad_1, &ad_1_len, (uint8_t *)&ad_3,
@@ -318,6 +324,7 @@ int main()
 			return n;
 		}
 
+		coap_rx_buf_len = sizeof(coap_rx_buf);
 		TRY(oscore2coap((uint8_t *)buffer, n, coap_rx_buf,
 				&coap_rx_buf_len, &oscore_flag, &c_server));
 
@@ -117,6 +117,7 @@ int main()
 		if (n < 0)
 			return n;
 
+		coap_rx_buf_len = sizeof(coap_rx_buf);
 		r = oscore2coap((uint8_t *)buffer, n, coap_rx_buf,
 				&coap_rx_buf_len, &oscore_flag, &c_server);
 		if (r != ok) {
@@ -157,6 +157,7 @@ void edhoc_initiator_init(void)
 	cred_r.ca.ptr = (uint8_t *)test_vectors[vec_num].ca;
 	cred_r.ca_pk.len = test_vectors[vec_num].ca_pk_len;
 	cred_r.ca_pk.ptr = (uint8_t *)test_vectors[vec_num].ca_pk;
+	cred_r.pk_key = NULL;
 
 	if (test_vectors[vec_num].c_i_raw != NULL) {
 		c_i.c_i.type = BSTR;
@@ -191,6 +192,10 @@ void edhoc_initiator_init(void)
 	c_i.sk_i.ptr = (uint8_t *)test_vectors[vec_num].sk_i_raw;
 	c_i.pk_i.len = test_vectors[vec_num].pk_i_raw_len;
 	c_i.pk_i.ptr = (uint8_t *)test_vectors[vec_num].pk_i_raw;
+	c_i.ephemeral_keys = NULL;
+	c_i.cred_store = NULL;
+	c_i.cert_cache = NULL;
+	c_i.sign_key = NULL;
 
 	err = edhoc_initiator_run(&c_i, &cred_r, cred_num, err_msg,
 				  &err_msg_len, ad_2, &ad_2_len, ad_4,
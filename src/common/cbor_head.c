@@ -0,0 +1,130 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+
+#include "common/cbor_head.h"
+#include "common/memcpy_s.h"
+#include "common/oscore_edhoc_error.h"
+
+enum err cbor_head_encode(uint8_t major_type, uint32_t argument, uint8_t *out,
+			  uint32_t *out_len)
+{
+	uint8_t mt = (uint8_t)(major_type << 5);
+	uint32_t len;
+
+	if (argument < 24) {
+		len = 1;
+	} else if (argument <= 0xff) {
+		len = 2;
+	} else if (argument <= 0xffff) {
+		len = 3;
+	} else {
+		len = 5;
+	}
+	TRY(check_buffer_size(*out_len, len));
+
+	switch (len) {
+	case 1:
+		out[0] = mt | (uint8_t)argument;
+		break;
+	case 2:
+		out[0] = mt | 24;
+		out[1] = (uint8_t)argument;
+		break;
+	case 3:
+		out[0] = mt | 25;
+		out[1] = (uint8_t)(argument >> 8);
+		out[2] = (uint8_t)argument;
+		break;
+	default:
+		out[0] = mt | 26;
+		out[1] = (uint8_t)(argument >> 24);
+		out[2] = (uint8_t)(argument >> 16);
+		out[3] = (uint8_t)(argument >> 8);
+		out[4] = (uint8_t)argument;
+		break;
+	}
+	*out_len = len;
+	return ok;
+}
+
+enum err cbor_head_decode(const uint8_t *in, uint32_t in_len,
+			  uint8_t *major_type, uint32_t *argument,
+			  uint32_t *head_len)
+{
+	if (in_len == 0) {
+		return cbor_decoding_error;
+	}
+	uint8_t ai = in[0] & 0x1f;
+	uint32_t len;
+
+	if (ai < 24) {
+		len = 1;
+	} else if (ai == 24) {
+		len = 2;
+	} else if (ai == 25) {
+		len = 3;
+	} else if (ai == 26) {
+		len = 5;
+	} else {
+		return cbor_decoding_error;
+	}
+	if (in_len < len) {
+		return cbor_decoding_error;
+	}
+
+	if (len == 1) {
+		*argument = ai;
+	} else {
+		*argument = 0;
+		for (uint32_t i = 1; i < len; i++) {
+			*argument = (*argument << 8) | in[i];
+		}
+	}
+	*major_type = (uint8_t)(in[0] >> 5);
+	*head_len = len;
+	return ok;
+}
+
+enum err cbor_int_encode(int32_t value, uint8_t *out, uint32_t *out_len)
+{
+	if (value >= 0) {
+		return cbor_head_encode(CBOR_UINT, (uint32_t)value, out,
+					out_len);
+	} else {
+		/*-1 - value, without overflowing for INT32_MIN*/
+		return cbor_head_encode(CBOR_NINT, ~(uint32_t)value, out,
+					out_len);
+	}
+}
+
+enum err cbor_head_append(uint8_t major_type, uint32_t argument, uint8_t *out,
+			  uint32_t out_size, uint32_t *offset)
+{
+	TRY(check_buffer_size(out_size, *offset));
+	uint32_t head_len = out_size - *offset;
+
+	TRY(cbor_head_encode(major_type, argument, out + *offset, &head_len));
+	*offset += head_len;
+	return ok;
+}
+
+enum err cbor_bytes_append(const uint8_t *in, uint32_t in_len, uint8_t *out,
+			   uint32_t out_size, uint32_t *offset)
+{
+	if (in_len != 0) {
+		TRY(check_buffer_size(out_size, *offset));
+		TRY(_memcpy_s(out + *offset, out_size - *offset, in, in_len));
+		*offset += in_len;
+	}
+	return ok;
+}
@@ -8,6 +8,12 @@
    option. This file may not be copied, modified, or distributed
    except according to those terms.
 */
+#ifdef MBEDTLS
+/*must precede the first mbedtls header, also the one included by 
+crypto_wrapper.h*/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#endif
+
 #include <string.h>
 
 #include "edhoc.h"
@@ -30,8 +36,6 @@ make sure MBEDTLS_PSA_CRYPTO_CONFIG is defined in include/mbedtls/mbedtls_config
 
 modify setting in include/psa/crypto_config.h 
 */
-#define MBEDTLS_ALLOW_PRIVATE_ACCESS
-
 #include <psa/crypto.h>
 
 #include "mbedtls/ecp.h"
@@ -43,6 +47,13 @@ modify setting in include/psa/crypto_config.h
 #include "mbedtls/rsa.h"
 #include "mbedtls/x509.h"
 
+#ifdef EDHOC_ECC_RESTARTABLE
+#include "mbedtls/psa_util.h"
+#if !defined(MBEDTLS_ECP_RESTARTABLE) || !defined(MBEDTLS_ECDSA_DETERMINISTIC)
+#error "EDHOC_ECC_RESTARTABLE requires MBEDTLS_ECP_RESTARTABLE and MBEDTLS_ECDSA_DETERMINISTIC in the mbedtls configuration"
+#endif
+#endif
+
 #endif
 
 #ifdef COMPACT25519
@@ -169,19 +180,350 @@ cleanup:
 	return (ret);
 }
 
+#ifdef EDHOC_ECC_RESTARTABLE
+void ecc_restartable_config(uint32_t max_ops)
+{
+	mbedtls_ecp_set_max_ops((unsigned)max_ops);
+}
+
+/**
+ * @brief   Initializes the operands and the restart contexts of the 
+ *          unfinished operation
+ */
+static void ecc_restart_op_init(struct ecc_restart *rs)
+{
+	rs->loaded = false;
+	mbedtls_ecp_group_init(&rs->grp);
+	mbedtls_ecp_point_init(&rs->q);
+	mbedtls_ecp_point_init(&rs->p);
+	mbedtls_mpi_init(&rs->d);
+	mbedtls_mpi_init(&rs->r);
+	mbedtls_mpi_init(&rs->s);
+	mbedtls_ecp_restart_init(&rs->ecp);
+	mbedtls_ecdsa_restart_init(&rs->ecdsa);
+}
+
+/**
+ * @brief   Releases the operands and the restart contexts of the 
+ *          unfinished operation, so that the next operation can start
+ */
+static void ecc_restart_op_free(struct ecc_restart *rs)
+{
+	mbedtls_ecdsa_restart_free(&rs->ecdsa);
+	mbedtls_ecp_restart_free(&rs->ecp);
+	mbedtls_mpi_free(&rs->s);
+	mbedtls_mpi_free(&rs->r);
+	mbedtls_mpi_free(&rs->d);
+	mbedtls_ecp_point_free(&rs->p);
+	mbedtls_ecp_point_free(&rs->q);
+	mbedtls_ecp_group_free(&rs->grp);
+	ecc_restart_op_init(rs);
+}
+
+void ecc_restart_init(struct ecc_restart *rs)
+{
+	rs->next = 0;
+	rs->done = 0;
+	ecc_restart_op_init(rs);
+}
+
+void ecc_restart_rewind(struct ecc_restart *rs)
+{
+	rs->next = 0;
+}
+
+void ecc_restart_free(struct ecc_restart *rs)
+{
+	ecc_restart_op_free(rs);
+	memset(rs->results, 0, sizeof(rs->results));
+	rs->next = 0;
+	rs->done = 0;
+}
+
+/**
+ * @brief   Takes the next operation of a pass, see struct ecc_restart
+ * @param   rs the state
+ * @param   result the slot of the result of the operation
+ * @param   finished true if the operation was finished in an earlier 
+ *          pass, i.e., result holds its result
+ * @retval  an err code
+ */
+static enum err ecc_restart_next(struct ecc_restart *rs, uint8_t **result,
+				 bool *finished)
+{
+	if (rs->next >= ECC_RESTART_OPS) {
+		return wrong_parameter;
+	}
+	*result = rs->results[rs->next];
+	*finished = rs->next < rs->done;
+	rs->next++;
+	return ok;
+}
+
+/**
+ * @brief   Reads a P-256 public key, compressed keys are decompressed
+ */
+static int p256_point_read(const mbedtls_ecp_group *grp,
+			   mbedtls_ecp_point *q, const uint8_t *pk,
+			   uint32_t pk_len)
+{
+	if (pk_len == P_256_PUB_KEY_UNCOMPRESSED_SIZE) {
+		return mbedtls_ecp_point_read_binary(grp, q, pk, pk_len);
+	}
+	int ret;
+	size_t pk_decompressed_len;
+	uint8_t pk_decompressed[P_256_PUB_KEY_UNCOMPRESSED_SIZE];
+	ret = mbedtls_ecp_decompress(grp, pk, pk_len, pk_decompressed,
+				     &pk_decompressed_len,
+				     sizeof(pk_decompressed));
+	if (ret != 0) {
+		return ret;
+	}
+	return mbedtls_ecp_point_read_binary(grp, q, pk_decompressed,
+					     pk_decompressed_len);
+}
+
+/**
+ * @brief   Deterministic ES256 signature (RFC 6979) of a SHA-256 hash. 
+ *          With a restart context it returns MBEDTLS_ERR_ECP_IN_PROGRESS 
+ *          after a slice, see ecc_restartable_config().
+ */
+static int es256_sign_det(mbedtls_ecp_group *grp, const mbedtls_mpi *d,
+			  const uint8_t *h, mbedtls_mpi *r, mbedtls_mpi *s,
+			  mbedtls_ecdsa_restart_ctx *rs_ctx, uint8_t *out)
+{
+	int ret;
+	MBEDTLS_MPI_CHK(mbedtls_ecdsa_sign_det_restartable(
+		grp, r, s, d, h, SHA_DEFAULT_SIZE, MBEDTLS_MD_SHA256,
+		mbedtls_psa_get_random, MBEDTLS_PSA_RANDOM_STATE, rs_ctx));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(r, out,
+						 SIGNATURE_DEFAULT_SIZE / 2));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(
+		s, out + SIGNATURE_DEFAULT_SIZE / 2,
+		SIGNATURE_DEFAULT_SIZE / 2));
+cleanup:
+	return ret;
+}
+
+/**
+ * @brief   Computes a slice of an ES256 signature, see sign_restartable()
+ */
+static enum err es256_sign_slice(struct ecc_restart *rs, struct sign_key *k,
+				 const uint8_t *sk, uint32_t sk_len,
+				 const uint8_t *msg, uint32_t msg_len,
+				 uint8_t *out)
+{
+	uint8_t *result;
+	bool finished;
+	TRY(ecc_restart_next(rs, &result, &finished));
+	if (finished) {
+		memcpy(out, result, SIGNATURE_DEFAULT_SIZE);
+		return ok;
+	}
+
+	uint8_t h[SHA_DEFAULT_SIZE];
+	TRY(hash(SHA_256, msg, msg_len, h));
+
+	int ret = 0;
+	mbedtls_ecp_group *grp = &rs->grp;
+	const mbedtls_mpi *d = &rs->d;
+	if (k != NULL) {
+		/*a prepared key brings the comb table of the generator*/
+		grp = &k->grp;
+		d = &k->d;
+	} else if (!rs->loaded) {
+		TRY_EXPECT(psa_crypto_init(), PSA_SUCCESS);
+		MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(
+			&rs->grp, MBEDTLS_ECP_DP_SECP256R1));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&rs->d, sk, sk_len));
+	}
+	rs->loaded = true;
+	ret = es256_sign_det(grp, d, h, &rs->r, &rs->s, &rs->ecdsa, result);
+	if (ret == MBEDTLS_ERR_ECP_IN_PROGRESS) {
+		return ecc_operation_in_progress;
+	}
+
+cleanup:
+	ecc_restart_op_free(rs);
+	if (ret != 0) {
+		return sign_failed;
+	}
+	rs->done++;
+	memcpy(out, result, SIGNATURE_DEFAULT_SIZE);
+	return ok;
+}
+
+/**
+ * @brief   Computes a slice of an ES256 signature verification, see 
+ *          verify_restartable()
+ */
+static enum err es256_verify_slice(struct ecc_restart *rs, const uint8_t *pk,
+				   uint32_t pk_len, const uint8_t *msg,
+				   uint32_t msg_len, const uint8_t *sgn,
+				   uint32_t sgn_len, bool *result)
+{
+	uint8_t *verified;
+	bool finished;
+	TRY(ecc_restart_next(rs, &verified, &finished));
+	if (finished) {
+		*result = verified[0];
+		return ok;
+	}
+
+	int ret = 0;
+	*result = false;
+	if (sgn_len == SIGNATURE_DEFAULT_SIZE) {
+		uint8_t h[SHA_DEFAULT_SIZE];
+		TRY(hash(SHA_256, msg, msg_len, h));
+
+		if (!rs->loaded) {
+			MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(
+				&rs->grp, MBEDTLS_ECP_DP_SECP256R1));
+			MBEDTLS_MPI_CHK(
+				p256_point_read(&rs->grp, &rs->q, pk, pk_len));
+			MBEDTLS_MPI_CHK(mbedtls_ecp_check_pubkey(&rs->grp, &rs->q));
+			MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(
+				&rs->r, sgn, SIGNATURE_DEFAULT_SIZE / 2));
+			MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(
+				&rs->s, sgn + SIGNATURE_DEFAULT_SIZE / 2,
+				SIGNATURE_DEFAULT_SIZE / 2));
+			rs->loaded = true;
+		}
+		/*the key is valid, from here on only the signature can be 
+		wrong*/
+		int verify_ret = mbedtls_ecdsa_verify_restartable(
+			&rs->grp, h, sizeof(h), &rs->q, &rs->r, &rs->s,
+			&rs->ecdsa);
+		if (verify_ret == MBEDTLS_ERR_ECP_IN_PROGRESS) {
+			return ecc_operation_in_progress;
+		}
+		*result = (verify_ret == 0);
+	}
+
+cleanup:
+	ecc_restart_op_free(rs);
+	if (ret != 0) {
+		return unexpected_result_from_ext_lib;
+	}
+	verified[0] = *result;
+	rs->done++;
+	return ok;
+}
+
+/**
+ * @brief   Computes a slice of a P-256 ECDH, see 
+ *          shared_secret_derive_restartable()
+ */
+static enum err p256_ecdh_slice(struct ecc_restart *rs, const uint8_t *sk,
+				uint32_t sk_len, const uint8_t *pk,
+				uint32_t pk_len, uint8_t *shared_secret)
+{
+	uint8_t *result;
+	bool finished;
+	TRY(ecc_restart_next(rs, &result, &finished));
+	if (finished) {
+		memcpy(shared_secret, result, ECDH_SECRET_DEFAULT_SIZE);
+		return ok;
+	}
+
+	int ret;
+	if (!rs->loaded) {
+		TRY_EXPECT(psa_crypto_init(), PSA_SUCCESS);
+		MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(
+			&rs->grp, MBEDTLS_ECP_DP_SECP256R1));
+		MBEDTLS_MPI_CHK(p256_point_read(&rs->grp, &rs->q, pk, pk_len));
+		MBEDTLS_MPI_CHK(mbedtls_ecp_check_pubkey(&rs->grp, &rs->q));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&rs->d, sk, sk_len));
+		rs->loaded = true;
+	}
+	ret = mbedtls_ecp_mul_restartable(&rs->grp, &rs->p, &rs->d, &rs->q,
+					  mbedtls_psa_get_random,
+					  MBEDTLS_PSA_RANDOM_STATE, &rs->ecp);
+	if (ret == MBEDTLS_ERR_ECP_IN_PROGRESS) {
+		return ecc_operation_in_progress;
+	}
+	/*the shared secret is the x-coordinate*/
+	MBEDTLS_MPI_CHK(ret);
+	MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(&rs->p.X, result,
+						 ECDH_SECRET_DEFAULT_SIZE));
+
+cleanup:
+	ecc_restart_op_free(rs);
+	if (ret != 0) {
+		return unexpected_result_from_ext_lib;
+	}
+	rs->done++;
+	memcpy(shared_secret, result, ECDH_SECRET_DEFAULT_SIZE);
+	return ok;
+}
+#endif
+
 #endif
 
 enum err __attribute__((weak))
-aead(enum aes_operation op, const uint8_t *in, const uint32_t in_len,
-     const uint8_t *key, const uint32_t key_len, uint8_t *nonce,
-     const uint32_t nonce_len, const uint8_t *aad, const uint32_t aad_len,
-     uint8_t *out, const uint32_t out_len, uint8_t *tag, const uint32_t tag_len)
+aead_key_init(struct aead_key *k, const uint8_t *key, const uint32_t key_len,
+	      const uint32_t tag_len)
 {
+	k->initialized = false;
+	k->tag_len = tag_len;
+#ifdef TINYCRYPT
+	if (key_len != TC_AES_KEY_SIZE) {
+		return wrong_parameter;
+	}
+	TRY_EXPECT(tc_aes128_set_encrypt_key(&k->sched, key), 1);
+#endif
+#ifdef MBEDTLS
+	psa_key_id_t key_id = PSA_KEY_HANDLE_INIT;
+
+	TRY_EXPECT_PSA(psa_crypto_init(), PSA_SUCCESS, key_id,
+		       unexpected_result_from_ext_lib);
+
+	psa_algorithm_t alg =
+		PSA_ALG_AEAD_WITH_SHORTENED_TAG(PSA_ALG_CCM, (uint32_t)tag_len);
+
+	psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
+	psa_set_key_usage_flags(&attr,
+				PSA_KEY_USAGE_DECRYPT | PSA_KEY_USAGE_ENCRYPT);
+	psa_set_key_algorithm(&attr, alg);
+	psa_set_key_type(&attr, PSA_KEY_TYPE_AES);
+	psa_set_key_bits(&attr, ((size_t)key_len << 3));
+	psa_set_key_lifetime(&attr, PSA_KEY_LIFETIME_VOLATILE);
+	TRY_EXPECT_PSA(psa_import_key(&attr, key, key_len, &key_id),
+		       PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
+	k->key_id = key_id;
+#endif
+	k->initialized = true;
+	return ok;
+}
+
+enum err __attribute__((weak)) aead_key_destroy(struct aead_key *k)
+{
+	if (!k->initialized) {
+		return ok;
+	}
+	k->initialized = false;
+#ifdef TINYCRYPT
+	memset(&k->sched, 0, sizeof(k->sched));
+#endif
+#ifdef MBEDTLS
+	TRY_EXPECT(psa_destroy_key(k->key_id), PSA_SUCCESS);
+	k->key_id = PSA_KEY_HANDLE_INIT;
+#endif
+	return ok;
+}
+
+enum err __attribute__((weak))
+aead_prepared(enum aes_operation op, const uint8_t *in, const uint32_t in_len,
+	      struct aead_key *k, uint8_t *nonce, const uint32_t nonce_len,
+	      const uint8_t *aad, const uint32_t aad_len, uint8_t *out,
+	      const uint32_t out_len, uint8_t *tag, const uint32_t tag_len)
+{
+	if (!k->initialized || k->tag_len != tag_len) {
+		return wrong_parameter;
+	}
 #ifdef TINYCRYPT
 	struct tc_ccm_mode_struct c;
-	struct tc_aes_key_sched_struct sched;
-	TRY_EXPECT(tc_aes128_set_encrypt_key(&sched, key), 1);
-	TRY_EXPECT(tc_ccm_config(&c, &sched, nonce, nonce_len, tag_len), 1);
+	TRY_EXPECT(tc_ccm_config(&c, &k->sched, nonce, nonce_len, tag_len), 1);
 
 	if (op == DECRYPT) {
 		TRY_EXPECT(tc_ccm_decryption_verification(
@@ -197,45 +539,44 @@ aead(enum aes_operation op, const uint8_t *in, const uint32_t in_len,
 	}
 #endif
 #ifdef MBEDTLS
-	psa_key_id_t key_id = PSA_KEY_HANDLE_INIT;
-
-	TRY_EXPECT_PSA(psa_crypto_init(),
-				   PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
-
 	psa_algorithm_t alg =
 		PSA_ALG_AEAD_WITH_SHORTENED_TAG(PSA_ALG_CCM, (uint32_t)tag_len);
 
-	psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
-	psa_set_key_usage_flags(&attr,
-				PSA_KEY_USAGE_DECRYPT | PSA_KEY_USAGE_ENCRYPT);
-	psa_set_key_algorithm(&attr, alg);
-	psa_set_key_type(&attr, PSA_KEY_TYPE_AES);
-	psa_set_key_bits(&attr, ((size_t)key_len << 3));
-	psa_set_key_lifetime(&attr, PSA_KEY_LIFETIME_VOLATILE);
-	TRY_EXPECT_PSA(psa_import_key(&attr, key, key_len, &key_id),
-				   PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
-
 	if (op == DECRYPT) {
 		size_t out_len_re = 0;
-		TRY_EXPECT_PSA(psa_aead_decrypt(key_id, alg, nonce, nonce_len, aad,
-					    aad_len, in, in_len, out, out_len,
-					    &out_len_re),
-						PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
+		TRY_EXPECT(psa_aead_decrypt(k->key_id, alg, nonce, nonce_len,
+					    aad, aad_len, in, in_len, out,
+					    out_len, &out_len_re),
+			   PSA_SUCCESS);
 	} else {
 		size_t out_len_re;
-		TRY_EXPECT_PSA(psa_aead_encrypt(key_id, alg, nonce, nonce_len, aad,
-					    aad_len, in, in_len, out,
+		TRY_EXPECT(psa_aead_encrypt(k->key_id, alg, nonce, nonce_len,
+					    aad, aad_len, in, in_len, out,
 					    (size_t)(in_len + tag_len),
 					    &out_len_re),
-						PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
+			   PSA_SUCCESS);
 		memcpy(tag, out + out_len_re - tag_len, tag_len);
 	}
-	TRY_EXPECT(psa_destroy_key(key_id), PSA_SUCCESS);
-
 #endif
 	return ok;
 }
 
+enum err __attribute__((weak))
+aead(enum aes_operation op, const uint8_t *in, const uint32_t in_len,
+     const uint8_t *key, const uint32_t key_len, uint8_t *nonce,
+     const uint32_t nonce_len, const uint8_t *aad, const uint32_t aad_len,
+     uint8_t *out, const uint32_t out_len, uint8_t *tag, const uint32_t tag_len)
+{
+	struct aead_key k;
+	enum err r;
+
+	TRY(aead_key_init(&k, key, key_len, tag_len));
+	r = aead_prepared(op, in, in_len, &k, nonce, nonce_len, aad, aad_len,
+			  out, out_len, tag, tag_len);
+	TRY(aead_key_destroy(&k));
+	return r;
+}
+
 enum err __attribute__((weak))
 sign(enum sign_alg alg, const uint8_t *sk, const uint32_t sk_len,
      const uint8_t *pk, const uint8_t *msg, const uint32_t msg_len,
@@ -303,7 +644,7 @@ verify(enum sign_alg alg, const uint8_t *pk, const uint32_t pk_len,
 #endif
 	}
 	if (alg == ES256) {
-#ifdef MBEDTLS
+#if defined(MBEDTLS)
 		psa_status_t status;
 		psa_algorithm_t psa_alg;
 		size_t bits;
@@ -340,6 +681,255 @@ verify(enum sign_alg alg, const uint8_t *pk, const uint32_t pk_len,
 	return crypto_operation_not_implemented;
 }
 
+enum err __attribute__((weak))
+verify_key_init(struct verify_key *k, enum sign_alg alg, const uint8_t *pk,
+		const uint32_t pk_len)
+{
+	k->initialized = false;
+	k->alg = alg;
+	k->pk = pk;
+	k->pk_len = pk_len;
+#ifdef MBEDTLS
+	k->key_id = PSA_KEY_HANDLE_INIT;
+	if (alg == ES256) {
+		psa_key_id_t key_id = PSA_KEY_HANDLE_INIT;
+		psa_algorithm_t psa_alg = PSA_ALG_ECDSA(PSA_ALG_SHA_256);
+
+		TRY_EXPECT_PSA(psa_crypto_init(), PSA_SUCCESS, key_id,
+			       unexpected_result_from_ext_lib);
+
+		psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+		psa_set_key_usage_flags(&attributes,
+					PSA_KEY_USAGE_VERIFY_MESSAGE |
+						PSA_KEY_USAGE_VERIFY_HASH);
+		psa_set_key_algorithm(&attributes, psa_alg);
+		psa_set_key_type(&attributes, PSA_KEY_TYPE_ECC_PUBLIC_KEY(
+						      PSA_ECC_FAMILY_SECP_R1));
+		psa_set_key_bits(&attributes, PSA_BYTES_TO_BITS(
+						      P_256_PRIV_KEY_DEFAULT_SIZE));
+		TRY_EXPECT_PSA(psa_import_key(&attributes, pk, pk_len, &key_id),
+			       PSA_SUCCESS, key_id,
+			       unexpected_result_from_ext_lib);
+		k->key_id = key_id;
+	}
+#endif
+	k->initialized = true;
+	return ok;
+}
+
+enum err __attribute__((weak)) verify_key_destroy(struct verify_key *k)
+{
+	if (!k->initialized) {
+		return ok;
+	}
+	k->initialized = false;
+#ifdef MBEDTLS
+	if (k->key_id != PSA_KEY_HANDLE_INIT) {
+		TRY_EXPECT(psa_destroy_key(k->key_id), PSA_SUCCESS);
+		k->key_id = PSA_KEY_HANDLE_INIT;
+	}
+#endif
+	return ok;
+}
+
+enum err __attribute__((weak))
+verify_prepared(const struct verify_key *k, const uint8_t *msg,
+		const uint32_t msg_len, const uint8_t *sgn,
+		const uint32_t sgn_len, bool *result)
+{
+	if (!k->initialized) {
+		return wrong_parameter;
+	}
+#ifdef MBEDTLS
+	if (k->key_id != PSA_KEY_HANDLE_INIT) {
+		psa_status_t status = psa_verify_message(
+			k->key_id, PSA_ALG_ECDSA(PSA_ALG_SHA_256), msg, msg_len,
+			sgn, sgn_len);
+		*result = (PSA_SUCCESS == status);
+		return ok;
+	}
+#endif
+	return verify(k->alg, k->pk, k->pk_len, msg, msg_len, sgn, sgn_len,
+		      result);
+}
+
+enum err verify_restartable(struct ecc_restart *rs,
+			    const struct verify_key *k, enum sign_alg alg,
+			    const uint8_t *pk, uint32_t pk_len,
+			    const uint8_t *msg, const uint32_t msg_len,
+			    const uint8_t *sgn, const uint32_t sgn_len,
+			    bool *result)
+{
+	if (k != NULL && k->alg == alg) {
+		if (!k->initialized) {
+			return wrong_parameter;
+		}
+		pk = k->pk;
+		pk_len = k->pk_len;
+	} else {
+		k = NULL;
+	}
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	if (rs != NULL && alg == ES256) {
+		return es256_verify_slice(rs, pk, pk_len, msg, msg_len, sgn,
+					  sgn_len, result);
+	}
+#else
+	(void)rs;
+#endif
+	if (k != NULL) {
+		return verify_prepared(k, msg, msg_len, sgn, sgn_len, result);
+	}
+	return verify(alg, pk, pk_len, msg, msg_len, sgn, sgn_len, result);
+}
+
+enum err __attribute__((weak))
+sign_key_init(struct sign_key *k, enum sign_alg alg, const uint8_t *sk,
+	      const uint32_t sk_len, const uint8_t *pk)
+{
+	k->initialized = false;
+	k->alg = alg;
+	k->sk = sk;
+	k->sk_len = sk_len;
+	k->pk = pk;
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	mbedtls_ecp_group_init(&k->grp);
+	mbedtls_mpi_init(&k->d);
+	if (alg == ES256) {
+		TRY_EXPECT(psa_crypto_init(), PSA_SUCCESS);
+
+		int ret;
+		mbedtls_ecp_point p;
+		mbedtls_ecp_point_init(&p);
+		MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(
+			&k->grp, MBEDTLS_ECP_DP_SECP256R1));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&k->d, sk, sk_len));
+		/*a multiplication of the generator in one go stores the comb 
+		table in the group, later multiplications only read it*/
+		MBEDTLS_MPI_CHK(mbedtls_ecp_mul_restartable(
+			&k->grp, &p, &k->d, &k->grp.G, mbedtls_psa_get_random,
+			MBEDTLS_PSA_RANDOM_STATE, NULL));
+cleanup:
+		mbedtls_ecp_point_free(&p);
+		if (ret != 0) {
+			mbedtls_mpi_free(&k->d);
+			mbedtls_ecp_group_free(&k->grp);
+			return unexpected_result_from_ext_lib;
+		}
+	}
+#elif defined(MBEDTLS)
+	k->key_id = PSA_KEY_HANDLE_INIT;
+	if (alg == ES256) {
+		psa_key_id_t key_id = PSA_KEY_HANDLE_INIT;
+		psa_algorithm_t psa_alg = PSA_ALG_ECDSA(PSA_ALG_SHA_256);
+
+		TRY_EXPECT_PSA(psa_crypto_init(), PSA_SUCCESS, key_id,
+			       unexpected_result_from_ext_lib);
+
+		psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+		psa_set_key_usage_flags(&attributes,
+					PSA_KEY_USAGE_SIGN_MESSAGE |
+						PSA_KEY_USAGE_SIGN_HASH);
+		psa_set_key_algorithm(&attributes, psa_alg);
+		psa_set_key_type(&attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(
+						      PSA_ECC_FAMILY_SECP_R1));
+		psa_set_key_bits(&attributes,
+				 PSA_BYTES_TO_BITS((size_t)sk_len));
+		psa_set_key_lifetime(&attributes, PSA_KEY_LIFETIME_VOLATILE);
+		TRY_EXPECT_PSA(psa_import_key(&attributes, sk, sk_len, &key_id),
+			       PSA_SUCCESS, key_id,
+			       unexpected_result_from_ext_lib);
+		k->key_id = key_id;
+	}
+#endif
+	k->initialized = true;
+	return ok;
+}
+
+enum err __attribute__((weak)) sign_key_destroy(struct sign_key *k)
+{
+	if (!k->initialized) {
+		return ok;
+	}
+	k->initialized = false;
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	mbedtls_mpi_free(&k->d);
+	mbedtls_ecp_group_free(&k->grp);
+#elif defined(MBEDTLS)
+	if (k->key_id != PSA_KEY_HANDLE_INIT) {
+		TRY_EXPECT(psa_destroy_key(k->key_id), PSA_SUCCESS);
+		k->key_id = PSA_KEY_HANDLE_INIT;
+	}
+#endif
+	return ok;
+}
+
+enum err __attribute__((weak))
+sign_prepared(struct sign_key *k, const uint8_t *msg, const uint32_t msg_len,
+	      uint8_t *out)
+{
+	if (!k->initialized) {
+		return wrong_parameter;
+	}
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	if (k->alg == ES256) {
+		uint8_t h[SHA_DEFAULT_SIZE];
+		TRY(hash(SHA_256, msg, msg_len, h));
+
+		mbedtls_mpi r, s;
+		mbedtls_mpi_init(&r);
+		mbedtls_mpi_init(&s);
+		int ret = es256_sign_det(&k->grp, &k->d, h, &r, &s, NULL, out);
+		mbedtls_mpi_free(&s);
+		mbedtls_mpi_free(&r);
+		if (ret != 0) {
+			return sign_failed;
+		}
+		return ok;
+	}
+#elif defined(MBEDTLS)
+	if (k->key_id != PSA_KEY_HANDLE_INIT) {
+		size_t signature_length;
+		TRY_EXPECT(psa_sign_message(k->key_id,
+					    PSA_ALG_ECDSA(PSA_ALG_SHA_256), msg,
+					    msg_len, out, SIGNATURE_DEFAULT_SIZE,
+					    &signature_length),
+			   PSA_SUCCESS);
+		if (signature_length != SIGNATURE_DEFAULT_SIZE) {
+			return sign_failed;
+		}
+		return ok;
+	}
+#endif
+	return sign(k->alg, k->sk, k->sk_len, k->pk, msg, msg_len, out);
+}
+
+enum err sign_restartable(struct ecc_restart *rs, struct sign_key *k,
+			  enum sign_alg alg, const uint8_t *sk,
+			  const uint32_t sk_len, const uint8_t *pk,
+			  const uint8_t *msg, const uint32_t msg_len,
+			  uint8_t *out)
+{
+	if (k != NULL && k->alg == alg) {
+		if (!k->initialized) {
+			return wrong_parameter;
+		}
+	} else {
+		k = NULL;
+	}
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	if (rs != NULL && alg == ES256) {
+		return es256_sign_slice(rs, k, sk, sk_len, msg, msg_len, out);
+	}
+#else
+	(void)rs;
+#endif
+	if (k != NULL) {
+		return sign_prepared(k, msg, msg_len, out);
+	}
+	return sign(alg, sk, sk_len, pk, msg, msg_len, out);
+}
+
 enum err __attribute__((weak))
 hkdf_extract(enum hash_alg alg, const uint8_t *salt, uint32_t salt_len,
 	     uint8_t *ikm, uint32_t ikm_len, uint8_t *out)
@@ -397,13 +987,110 @@ hkdf_extract(enum hash_alg alg, const uint8_t *salt, uint32_t salt_len,
 }
 
 enum err __attribute__((weak))
-hkdf_expand(enum hash_alg alg, const uint8_t *prk, const uint32_t prk_len,
-	    const uint8_t *info, const uint32_t info_len, uint8_t *out,
-	    uint32_t out_len)
+hmac_key_init(enum hash_alg alg, struct hmac_key *k, const uint8_t *key,
+	      const uint32_t key_len)
 {
+	/*all currently prosed suites use hmac-sha256*/
 	if (alg != SHA_256) {
 		return crypto_operation_not_implemented;
 	}
+	k->alg = alg;
+	k->initialized = false;
+
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	uint8_t k_ipad[HMAC_BLOCK_SIZE];
+	uint8_t k_opad[HMAC_BLOCK_SIZE];
+
+	memset(k_ipad, 0, sizeof(k_ipad));
+	if (key_len > HMAC_BLOCK_SIZE) {
+		TRY(hash(alg, key, key_len, k_ipad));
+	} else {
+		memcpy(k_ipad, key, key_len);
+	}
+	for (uint8_t i = 0; i < HMAC_BLOCK_SIZE; i++) {
+		k_opad[i] = k_ipad[i] ^ 0x5c;
+		k_ipad[i] ^= 0x36;
+	}
+
+	TRY(hash_init(alg, &k->inner));
+	TRY(hash_update(&k->inner, k_ipad, sizeof(k_ipad)));
+	TRY(hash_init(alg, &k->outer));
+	TRY(hash_update(&k->outer, k_opad, sizeof(k_opad)));
+
+	memset(k_ipad, 0, sizeof(k_ipad));
+	memset(k_opad, 0, sizeof(k_opad));
+#else
+	TRY(_memcpy_s(k->key, sizeof(k->key), key, key_len));
+	k->key_len = key_len;
+#endif
+	k->initialized = true;
+	return ok;
+}
+
+enum err __attribute__((weak)) hmac_key_destroy(struct hmac_key *k)
+{
+	if (!k->initialized) {
+		return ok;
+	}
+	k->initialized = false;
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	TRY(hash_abort(&k->inner));
+	TRY(hash_abort(&k->outer));
+#else
+	memset(k->key, 0, sizeof(k->key));
+#endif
+	return ok;
+}
+
+enum err __attribute__((weak))
+hmac_init(struct hmac_ctx *ctx, struct hmac_key *k)
+{
+	if (!k->initialized) {
+		return wrong_parameter;
+	}
+	ctx->key = k;
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	TRY(hash_clone(&k->inner, &ctx->inner));
+	return ok;
+#else
+	return crypto_operation_not_implemented;
+#endif
+}
+
+enum err __attribute__((weak))
+hmac_update(struct hmac_ctx *ctx, const uint8_t *in, const uint32_t in_len)
+{
+	return hash_update(&ctx->inner, in, in_len);
+}
+
+enum err __attribute__((weak)) hmac_final(struct hmac_ctx *ctx, uint8_t *out)
+{
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	uint8_t inner_hash[SHA_DEFAULT_SIZE];
+	struct hash_ctx outer;
+
+	TRY(hash_final(&ctx->inner, inner_hash));
+	TRY(hash_clone(&ctx->key->outer, &outer));
+	TRY(hash_update(&outer, inner_hash, sizeof(inner_hash)));
+	TRY(hash_final(&outer, out));
+	memset(inner_hash, 0, sizeof(inner_hash));
+	return ok;
+#else
+	(void)ctx;
+	(void)out;
+	return crypto_operation_not_implemented;
+#endif
+}
+
+enum err __attribute__((weak))
+hkdf_expand_prepared_segments(struct hmac_key *prk,
+			      const struct const_byte_array *info,
+			      uint32_t info_cnt,
+			      uint8_t *out, uint32_t out_len)
+{
+	if (!prk->initialized) {
+		return wrong_parameter;
+	}
 	/* "N = ceil(L/HashLen)" */
 	uint32_t iterations = (out_len + 31) / 32;
 	/* "L length of output keying material in octets (<= 255*HashLen)"*/
@@ -411,72 +1098,65 @@ hkdf_expand(enum hash_alg alg, const uint8_t *prk, const uint32_t prk_len,
 		return hkdf_fialed;
 	}
 
-#ifdef TINYCRYPT
-	uint8_t t[32] = { 0 };
-	struct tc_hmac_state_struct h;
-	for (uint8_t i = 1; i <= iterations; i++) {
-		memset(&h, 0x00, sizeof(h));
-		TRY_EXPECT(tc_hmac_set_key(&h, prk, prk_len), 1);
-		tc_hmac_init(&h);
+	/* T(i) = HMAC-Hash(PRK, T(i-1) | info | i), T(0) is empty */
+	struct hmac_ctx ctx;
+	uint8_t t[SHA_DEFAULT_SIZE];
+	for (uint32_t i = 1; i <= iterations; i++) {
+		uint8_t counter = (uint8_t)i;
+		TRY(hmac_init(&ctx, prk));
 		if (i > 1) {
-			TRY_EXPECT(tc_hmac_update(&h, t, 32), 1);
+			TRY(hmac_update(&ctx, t, sizeof(t)));
 		}
-		TRY_EXPECT(tc_hmac_update(&h, info, info_len), 1);
-		TRY_EXPECT(tc_hmac_update(&h, &i, 1), 1);
-		TRY_EXPECT(tc_hmac_final(t, TC_SHA256_DIGEST_SIZE, &h),
-				1);
-		if (out_len < i * 32) {
-			memcpy(&out[(i - 1) * 32], t, out_len % 32);
-		} else {
-			memcpy(&out[(i - 1) * 32], t, 32);
+		for (uint32_t j = 0; j < info_cnt; j++) {
+			TRY(hmac_update(&ctx, info[j].ptr, info[j].len));
 		}
-	}
-#endif
-#ifdef MBEDTLS
-	psa_status_t status;
-	psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
-	psa_key_id_t key_id = PSA_KEY_HANDLE_INIT;
-
-	TRY_EXPECT_PSA(psa_crypto_init(), PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
-	psa_set_key_lifetime(&attr, PSA_KEY_LIFETIME_VOLATILE);
-	psa_set_key_usage_flags(&attr, PSA_KEY_USAGE_SIGN_HASH);
-	psa_set_key_algorithm(&attr, PSA_ALG_HMAC(PSA_ALG_SHA_256));
-	psa_set_key_type(&attr, PSA_KEY_TYPE_HMAC);
-
-	TRY_EXPECT_PSA(psa_import_key(&attr, prk, prk_len, &key_id),
-					PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
-
-	size_t combo_len = (32 + (size_t)info_len + 1);
+		TRY(hmac_update(&ctx, &counter, 1));
+		TRY(hmac_final(&ctx, t));
 
-	TRY_EXPECT_PSA(check_buffer_size(INFO_DEFAULT_SIZE, (uint32_t)combo_len),
-					ok, key_id, unexpected_result_from_ext_lib);
-
-	uint8_t combo[INFO_DEFAULT_SIZE];
-	uint8_t tmp_out[32];
-	memset(tmp_out, 0, 32);
-	memcpy(combo + 32, info, info_len);
-	size_t offset = 32;
-	for (uint32_t i = 1; i <= iterations; i++) {
-		memcpy(combo, tmp_out, 32);
-		combo[combo_len - 1] = (uint8_t)i;
-		size_t tmp_out_len;
-		status = psa_mac_compute(key_id,
-						PSA_ALG_HMAC(PSA_ALG_SHA_256),
-						combo + offset,
-						combo_len - offset, tmp_out,
-						32, &tmp_out_len);
-		TRY_EXPECT_PSA(status, PSA_SUCCESS, key_id, unexpected_result_from_ext_lib);
-		offset = 0;
 		uint8_t *dest = out + ((i - 1) << 5);
 		if (out_len < (uint32_t)(i << 5)) {
-			memcpy(dest, tmp_out, out_len & 31);
+			memcpy(dest, t, out_len & 31);
 		} else {
-			memcpy(dest, tmp_out, 32);
+			memcpy(dest, t, 32);
 		}
 	}
-	TRY_EXPECT(psa_destroy_key(key_id), PSA_SUCCESS);
+	memset(t, 0, sizeof(t));
+	return ok;
+}
+
+enum err __attribute__((weak))
+hkdf_expand_prepared(struct hmac_key *prk, const uint8_t *info,
+		     const uint32_t info_len, uint8_t *out, uint32_t out_len)
+{
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	struct const_byte_array segment = { .len = info_len, .ptr = info };
+
+	return hkdf_expand_prepared_segments(prk, &segment, 1, out, out_len);
+#else
+	if (!prk->initialized) {
+		return wrong_parameter;
+	}
+	return hkdf_expand(prk->alg, prk->key, prk->key_len, info, info_len,
+			   out, out_len);
 #endif
+}
+
+enum err __attribute__((weak))
+hkdf_expand(enum hash_alg alg, const uint8_t *prk, const uint32_t prk_len,
+	    const uint8_t *info, const uint32_t info_len, uint8_t *out,
+	    uint32_t out_len)
+{
+#if defined(TINYCRYPT) || defined(MBEDTLS)
+	struct hmac_key k;
+	enum err r;
+
+	TRY(hmac_key_init(alg, &k, prk, prk_len));
+	r = hkdf_expand_prepared(&k, info, info_len, out, out_len);
+	TRY(hmac_key_destroy(&k));
+	return r;
+#else
 	return ok;
+#endif
 }
 
 enum err __attribute__((weak))
@@ -507,7 +1187,7 @@ shared_secret_derive(enum ecdh_alg alg, const uint8_t *sk,
 #endif
 	}
 	if (alg == P256) {
-#ifdef MBEDTLS
+#if defined(MBEDTLS)
 		psa_key_id_t key_id = PSA_KEY_HANDLE_INIT;
 		psa_algorithm_t psa_alg;
 		size_t bits;
@@ -534,35 +1214,45 @@ shared_secret_derive(enum ecdh_alg alg, const uint8_t *sk,
 		size_t shared_secret_len = 0;
 		PRINT_ARRAY("pk", pk, pk_len);
 
-		size_t pk_decompressed_len;
+		size_t pk_decompressed_len = pk_len;
 		uint8_t pk_decompressed[P_256_PUB_KEY_UNCOMPRESSED_SIZE];
+		const uint8_t *peer_pk = pk;
 
 		mbedtls_pk_context ctx_verify = {0};
 		mbedtls_pk_init(&ctx_verify);
-		if(PSA_SUCCESS != mbedtls_pk_setup(
-						&ctx_verify,
-						mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY))) {
-			result = unexpected_result_from_ext_lib;
-			goto cleanup;
-		}
-		if(PSA_SUCCESS != mbedtls_ecp_group_load(&mbedtls_pk_ec(ctx_verify)->grp,
-												MBEDTLS_ECP_DP_SECP256R1)){
-			result = unexpected_result_from_ext_lib;
-			goto cleanup;
-		}
-		if(PSA_SUCCESS != mbedtls_ecp_decompress(
-						&mbedtls_pk_ec(ctx_verify)->grp, pk, pk_len,
-						pk_decompressed, &pk_decompressed_len,
-						sizeof(pk_decompressed))){
-			result = unexpected_result_from_ext_lib;
-			goto cleanup;
+		/*uncompressed keys, e.g. static DH keys of credentials, are 
+		used as they are*/
+		if (pk_len != P_256_PUB_KEY_UNCOMPRESSED_SIZE) {
+			if (PSA_SUCCESS !=
+			    mbedtls_pk_setup(&ctx_verify,
+					     mbedtls_pk_info_from_type(
+						     MBEDTLS_PK_ECKEY))) {
+				result = unexpected_result_from_ext_lib;
+				goto cleanup;
+			}
+			if (PSA_SUCCESS !=
+			    mbedtls_ecp_group_load(
+				    &mbedtls_pk_ec(ctx_verify)->grp,
+				    MBEDTLS_ECP_DP_SECP256R1)) {
+				result = unexpected_result_from_ext_lib;
+				goto cleanup;
+			}
+			if (PSA_SUCCESS !=
+			    mbedtls_ecp_decompress(
+				    &mbedtls_pk_ec(ctx_verify)->grp, pk, pk_len,
+				    pk_decompressed, &pk_decompressed_len,
+				    sizeof(pk_decompressed))) {
+				result = unexpected_result_from_ext_lib;
+				goto cleanup;
+			}
+			peer_pk = pk_decompressed;
 		}
 
-		PRINT_ARRAY("pk_decompressed", pk_decompressed,
+		PRINT_ARRAY("pk_decompressed", peer_pk,
 			    (uint32_t)pk_decompressed_len);
 
 		if(PSA_SUCCESS != psa_raw_key_agreement(
-						PSA_ALG_ECDH, key_id, pk_decompressed,
+						PSA_ALG_ECDH, key_id, peer_pk,
 						pk_decompressed_len, shared_secret,
 						shared_size, &shared_secret_len)){
 			result = unexpected_result_from_ext_lib;
@@ -579,6 +1269,25 @@ cleanup:
 	return crypto_operation_not_implemented;
 }
 
+enum err shared_secret_derive_restartable(struct ecc_restart *rs,
+					  enum ecdh_alg alg, const uint8_t *sk,
+					  const uint32_t sk_len,
+					  const uint8_t *pk,
+					  const uint32_t pk_len,
+					  uint8_t *shared_secret)
+{
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	if (rs != NULL && alg == P256) {
+		return p256_ecdh_slice(rs, sk, sk_len, pk, pk_len,
+				       shared_secret);
+	}
+#else
+	(void)rs;
+#endif
+	return shared_secret_derive(alg, sk, sk_len, pk, pk_len,
+				    shared_secret);
+}
+
 enum err __attribute__((weak))
 ephemeral_dh_key_gen(enum ecdh_alg alg, uint32_t seed, uint8_t *sk,
 	uint8_t *pk, uint32_t *pk_size)
@@ -596,8 +1305,8 @@ ephemeral_dh_key_gen(enum ecdh_alg alg, uint32_t seed, uint8_t *sk,
 #ifdef MBEDTLS
 		size_t length;
 		TRY_EXPECT(psa_hash_compute(PSA_ALG_SHA_256, (uint8_t *)&seed,
-					    sizeof(seed), sk, SHA_DEFAULT_SIZE,
-					    &length),
+					    sizeof(seed), extended_seed,
+					    sizeof(extended_seed), &length),
 			   0);
 		if (length != 32) {
 			return sha_failed;
@@ -654,6 +1363,35 @@ ephemeral_dh_key_gen(enum ecdh_alg alg, uint32_t seed, uint8_t *sk,
 	return ok;
 }
 
+enum err __attribute__((weak))
+ephemeral_dh_key_gen_random(enum ecdh_alg alg, const uint8_t *random,
+			    uint32_t random_len, uint8_t *sk, uint8_t *pk,
+			    uint32_t *pk_size)
+{
+	if (random_len != EPHEMERAL_RANDOM_SIZE) {
+		return wrong_parameter;
+	}
+#ifdef COMPACT25519
+	if (alg == X25519) {
+		if (*pk_size < X25519_KEY_SIZE) {
+			return buffer_to_small;
+		}
+		uint8_t seed[EPHEMERAL_RANDOM_SIZE];
+		memcpy(seed, random, sizeof(seed));
+		compact_x25519_keygen(sk, pk, seed);
+		memset(seed, 0, sizeof(seed));
+		*pk_size = X25519_KEY_SIZE;
+		return ok;
+	}
+#endif
+	/*P-256 keys are drawn from the random generator of the crypto 
+	library, the seed only matters for an application defined 
+	ephemeral_dh_key_gen()*/
+	uint32_t seed = (uint32_t)random[0] << 24 | (uint32_t)random[1] << 16 |
+			(uint32_t)random[2] << 8 | random[3];
+	return ephemeral_dh_key_gen(alg, seed, sk, pk, pk_size);
+}
+
 enum err __attribute__((weak))
 hash(enum hash_alg alg, const uint8_t *in, const uint32_t in_len, uint8_t *out)
 {
@@ -679,3 +1417,90 @@ hash(enum hash_alg alg, const uint8_t *in, const uint32_t in_len, uint8_t *out)
 
 	return crypto_operation_not_implemented;
 }
+
+enum err __attribute__((weak))
+hash_init(enum hash_alg alg, struct hash_ctx *ctx)
+{
+	if (alg != SHA_256) {
+		return crypto_operation_not_implemented;
+	}
+	ctx->alg = alg;
+#if defined(TINYCRYPT)
+	TRY_EXPECT(tc_sha256_init(&ctx->s), 1);
+	return ok;
+#elif defined(MBEDTLS)
+	TRY_EXPECT(psa_crypto_init(), PSA_SUCCESS);
+	ctx->op = psa_hash_operation_init();
+	TRY_EXPECT(psa_hash_setup(&ctx->op, PSA_ALG_SHA_256), PSA_SUCCESS);
+	return ok;
+#else
+	return crypto_operation_not_implemented;
+#endif
+}
+
+enum err __attribute__((weak))
+hash_update(struct hash_ctx *ctx, const uint8_t *in, const uint32_t in_len)
+{
+	if (in_len == 0) {
+		return ok;
+	}
+#if defined(TINYCRYPT)
+	TRY_EXPECT(tc_sha256_update(&ctx->s, in, in_len), 1);
+	return ok;
+#elif defined(MBEDTLS)
+	TRY_EXPECT(psa_hash_update(&ctx->op, in, in_len), PSA_SUCCESS);
+	return ok;
+#else
+	(void)ctx;
+	(void)in;
+	return crypto_operation_not_implemented;
+#endif
+}
+
+enum err __attribute__((weak)) hash_final(struct hash_ctx *ctx, uint8_t *out)
+{
+#if defined(TINYCRYPT)
+	TRY_EXPECT(tc_sha256_final(out, &ctx->s), 1);
+	return ok;
+#elif defined(MBEDTLS)
+	size_t length;
+	TRY_EXPECT(psa_hash_finish(&ctx->op, out, SHA_DEFAULT_SIZE, &length),
+		   PSA_SUCCESS);
+	if (length != SHA_DEFAULT_SIZE) {
+		return sha_failed;
+	}
+	return ok;
+#else
+	(void)ctx;
+	(void)out;
+	return crypto_operation_not_implemented;
+#endif
+}
+
+enum err __attribute__((weak))
+hash_clone(struct hash_ctx *src, struct hash_ctx *dst)
+{
+	dst->alg = src->alg;
+#if defined(TINYCRYPT)
+	dst->s = src->s;
+	return ok;
+#elif defined(MBEDTLS)
+	dst->op = psa_hash_operation_init();
+	TRY_EXPECT(psa_hash_clone(&src->op, &dst->op), PSA_SUCCESS);
+	return ok;
+#else
+	return crypto_operation_not_implemented;
+#endif
+}
+
+enum err __attribute__((weak)) hash_abort(struct hash_ctx *ctx)
+{
+#if defined(TINYCRYPT)
+	memset(&ctx->s, 0, sizeof(ctx->s));
+#elif defined(MBEDTLS)
+	TRY_EXPECT(psa_hash_abort(&ctx->op), PSA_SUCCESS);
+#else
+	(void)ctx;
+#endif
+	return ok;
+}
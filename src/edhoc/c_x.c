@@ -11,6 +11,7 @@
 
 #include "edhoc/c_x.h"
 
+#include "common/cbor_head.h"
 #include "common/oscore_edhoc_error.h"
 #include "common/memcpy_s.h"
 
@@ -34,3 +35,13 @@ enum err c_x_set(enum c_x_type t, const uint8_t *c_x_raw_buf,
 	}
 }
 
+enum err c_x_oscore_id(const struct c_x *c, uint8_t *out, uint32_t *out_len)
+{
+	if (c->type == INT) {
+		return cbor_int_encode(c->mem.c_x_int, out, out_len);
+	}
+	TRY(_memcpy_s(out, *out_len, c->mem.c_x_bstr.ptr,
+		      c->mem.c_x_bstr.len));
+	*out_len = c->mem.c_x_bstr.len;
+	return ok;
+}
@@ -9,6 +9,12 @@
    except according to those terms.
 */
 
+#ifdef MBEDTLS
+/*must precede the first mbedtls header, also the one included by 
+crypto_wrapper.h*/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#endif
+
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -23,8 +29,6 @@
 #include "cbor/edhoc_decode_cert.h"
 
 #ifdef MBEDTLS
-#define MBEDTLS_ALLOW_PRIVATE_ACCESS
-
 #include <psa/crypto.h>
 #include <mbedtls/asn1.h>
 #include <mbedtls/error.h>
@@ -81,21 +85,56 @@ static int find_pk_cb(void *void_ppk, int tag, unsigned char *start, size_t len)
 
 #endif
 
+#ifdef MBEDTLS
+/**
+ * @brief converts an X.509 time (UTC) to seconds since the epoch
+ */
+static uint64_t x509_time_to_epoch(const mbedtls_x509_time *t)
+{
+	/*days since 1970-01-01 of the proleptic Gregorian calendar*/
+	int64_t y = t->year - (t->mon <= 2);
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int64_t yoe = y - era * 400;
+	int64_t doy = (153 * (t->mon + (t->mon > 2 ? -3 : 9)) + 2) / 5 +
+		      t->day - 1;
+	int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	int64_t days = era * 146097 + doe - 719468;
+	int64_t secs = days * 86400 + t->hour * 3600 + t->min * 60 + t->sec;
+
+	return secs > 0 ? (uint64_t)secs : 0;
+}
+#endif
+
 /**
- * @brief retrives the public key of the CA from CRED_ARRAY.
+ * @brief retrives the public key of the CA from the credential store or, 
+ *        if there is no store, from CRED_ARRAY.
  * 
  * 
+ * @param store credential store indexed by the name of the CA, may be NULL
  * @param cred_array contains the public key of the root CA
  * @param cred_num the number of elements in cred_array
  * @param issuer the issuer name, i.e. the name of the CA
+ * @param issuer_len the length of the issuer name
  * @param root_pk the root public key
  * @param root_pk_len the lenhgt of the root public key
  * @return enum err 
  */
-static enum err ca_pk_get(const struct other_party_cred *cred_array,
+static enum err ca_pk_get(const struct edhoc_cred_store *store,
+			  const struct other_party_cred *cred_array,
 			  uint16_t cred_num, const uint8_t *issuer,
-			  uint8_t **root_pk, uint32_t *root_pk_len)
+			  uint32_t issuer_len, uint8_t **root_pk,
+			  uint32_t *root_pk_len)
 {
+	if (store != NULL) {
+		const struct other_party_cred *cred;
+		TRY(edhoc_cred_store_issuer_get(store, issuer, issuer_len,
+						&cred));
+		*root_pk = cred->ca_pk.ptr;
+		*root_pk_len = cred->ca_pk.len;
+		PRINT_ARRAY("Root PK of the CA", *root_pk, *root_pk_len);
+		return ok;
+	}
+
 	for (uint16_t i = 0; i < cred_num; i++) {
 		PRINT_ARRAY("cred_array[i].ca.ptr", cred_array[i].ca.ptr,
 			    cred_array[i].ca.len);
@@ -114,9 +153,10 @@ static enum err ca_pk_get(const struct other_party_cred *cred_array,
 }
 
 enum err cert_c509_verify(const uint8_t *cert, uint32_t cert_len,
+			  const struct edhoc_cred_store *store,
 			  const struct other_party_cred *cred_array,
 			  uint16_t cred_num, uint8_t *pk, uint32_t *pk_len,
-			  bool *verified)
+			  uint64_t *not_after, bool *verified)
 {
 	size_t decode_len = 0;
 	struct cert c;
@@ -143,8 +183,8 @@ enum err cert_c509_verify(const uint8_t *cert, uint32_t cert_len,
 	/*get the CA's public key*/
 	uint8_t *root_pk = NULL;
 	uint32_t root_pk_len = 0;
-	TRY(ca_pk_get(cred_array, cred_num, c._cert_issuer.value, &root_pk,
-		      &root_pk_len));
+	TRY(ca_pk_get(store, cred_array, cred_num, c._cert_issuer.value,
+		      (uint32_t)c._cert_issuer.len, &root_pk, &root_pk_len));
 
 	/*verify the certificates signature*/
 	TRY(verify((enum sign_alg)c._cert_issuer_signature_algorithm, root_pk,
@@ -156,13 +196,21 @@ enum err cert_c509_verify(const uint8_t *cert, uint32_t cert_len,
 	TRY(_memcpy_s(pk, *pk_len, c._cert_pk.value, (uint32_t)c._cert_pk.len));
 	*pk_len = (uint32_t)c._cert_pk.len;
 
+	/*C509 times are seconds since the epoch*/
+	if (c._cert_validity_not_after > 0) {
+		*not_after = (uint64_t)c._cert_validity_not_after;
+	} else {
+		*not_after = 0;
+	}
+
 	return ok;
 }
 
 enum err cert_x509_verify(const uint8_t *cert, uint32_t cert_len,
+			  const struct edhoc_cred_store *store,
 			  const struct other_party_cred *cred_array,
 			  uint16_t cred_num, uint8_t *pk, uint32_t *pk_len,
-			  bool *verified)
+			  uint64_t *not_after, bool *verified)
 {
 #ifdef MBEDTLS
 
@@ -231,8 +279,8 @@ enum err cert_x509_verify(const uint8_t *cert, uint32_t cert_len,
 	/* get the public key of the CA */
 	uint8_t *root_pk;
 	uint32_t root_pk_len;
-	TRY(ca_pk_get(cred_array, cred_num, issuer_id->p, &root_pk,
-		      &root_pk_len));
+	TRY(ca_pk_get(store, cred_array, cred_num, issuer_id->p,
+		      (uint32_t)issuer_id->len, &root_pk, &root_pk_len));
 
 	/* deserialize signature from ASN.1 to raw concatenation of (R, S) */
 	{
@@ -269,6 +317,8 @@ enum err cert_x509_verify(const uint8_t *cert, uint32_t cert_len,
 		PRINT_ARRAY("pk from cert", pk, *pk_len);
 	}
 
+	*not_after = x509_time_to_epoch(&m_cert.valid_to);
+
 	/* cleanup */
 	mbedtls_x509_crt_free(&m_cert);
 
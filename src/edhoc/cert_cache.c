@@ -0,0 +1,134 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edhoc.h"
+
+#include "edhoc/cert.h"
+
+#include "common/atomic_ops.h"
+#include "common/memcpy_s.h"
+#include "common/oscore_edhoc_error.h"
+
+enum err edhoc_cert_cache_init(struct edhoc_cert_cache *c,
+			       struct edhoc_cert_cache_entry *entries,
+			       uint32_t entries_cnt, uint64_t (*now)(void))
+{
+	if (entries == NULL || entries_cnt == 0) {
+		return wrong_parameter;
+	}
+	c->entries = entries;
+	c->entries_cnt = entries_cnt;
+	c->tick = 0;
+	c->now = now;
+	c->lock = false;
+	memset(entries, 0, sizeof(*entries) * entries_cnt);
+	return ok;
+}
+
+void edhoc_cert_cache_flush(struct edhoc_cert_cache *c)
+{
+	spin_lock(&c->lock);
+	memset(c->entries, 0, sizeof(*c->entries) * c->entries_cnt);
+	spin_unlock(&c->lock);
+}
+
+/**
+ * @brief   Checks the validity of a certificate at a given time
+ * @param   has_clock false if the cache has no clock
+ * @param   now the current time
+ * @param   not_after end of the validity of the certificate, 0 if not known
+ */
+static bool expired_at(bool has_clock, uint64_t now, uint64_t not_after)
+{
+	return has_clock && not_after != 0 && now > not_after;
+}
+
+bool cert_expired(const struct edhoc_cert_cache *c, uint64_t not_after)
+{
+	return expired_at(c->now != NULL, c->now != NULL ? c->now() : 0,
+			  not_after);
+}
+
+enum err cert_cache_get(struct edhoc_cert_cache *c, const uint8_t *cert_hash,
+			uint8_t *pk, uint32_t *pk_len, bool *found)
+{
+	enum err r = ok;
+	*found = false;
+
+	/*the clock of the application is not read under the lock*/
+	uint64_t now = c->now != NULL ? c->now() : 0;
+
+	spin_lock(&c->lock);
+	for (uint32_t i = 0; i < c->entries_cnt; i++) {
+		struct edhoc_cert_cache_entry *e = &c->entries[i];
+		if (!e->used ||
+		    0 != memcmp(e->cert_hash, cert_hash, sizeof(e->cert_hash))) {
+			continue;
+		}
+		if (expired_at(c->now != NULL, now, e->not_after)) {
+			/*verify the certificate again, it will be rejected*/
+			e->used = false;
+			break;
+		}
+		r = _memcpy_s(pk, *pk_len, e->pk, e->pk_len);
+		if (r == ok) {
+			*pk_len = e->pk_len;
+			e->last_used = ++c->tick;
+			*found = true;
+		}
+		break;
+	}
+	spin_unlock(&c->lock);
+	return r;
+}
+
+enum err cert_cache_put(struct edhoc_cert_cache *c, const uint8_t *cert_hash,
+			const uint8_t *pk, uint32_t pk_len, uint64_t not_after)
+{
+	TRY(check_buffer_size(sizeof(c->entries[0].pk), pk_len));
+
+	spin_lock(&c->lock);
+	/*the entry of the same certificate, which another thread may have 
+	added meanwhile, else a free entry or else the least recently used 
+	one*/
+	struct edhoc_cert_cache_entry *e = NULL;
+	for (uint32_t i = 0; i < c->entries_cnt && e == NULL; i++) {
+		if (c->entries[i].used &&
+		    0 == memcmp(c->entries[i].cert_hash, cert_hash,
+				sizeof(c->entries[i].cert_hash))) {
+			e = &c->entries[i];
+		}
+	}
+	for (uint32_t i = 0; i < c->entries_cnt && e == NULL; i++) {
+		if (!c->entries[i].used) {
+			e = &c->entries[i];
+		}
+	}
+	if (e == NULL) {
+		e = &c->entries[0];
+		for (uint32_t i = 1; i < c->entries_cnt; i++) {
+			if (c->entries[i].last_used < e->last_used) {
+				e = &c->entries[i];
+			}
+		}
+	}
+	memcpy(e->cert_hash, cert_hash, sizeof(e->cert_hash));
+	memcpy(e->pk, pk, pk_len);
+	e->pk_len = pk_len;
+	e->not_after = not_after;
+	e->last_used = ++c->tick;
+	e->used = true;
+	spin_unlock(&c->lock);
+	return ok;
+}
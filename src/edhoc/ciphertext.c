@@ -79,9 +79,7 @@ static enum err ciphertext_encrypt_decrypt(
  *        ciphertexts 3 and 4. 
  * 
  * @param ctxt CIPHERTEXT2, CIPHERTEXT3 or CIPHERTEXT4
- * @param edhoc_hash the hash algorithm used in the current edhoc run
- * @param prk pseudoramdom key
- * @param prk_len lenhgt of prk
+ * @param prk pseudoramdom key prepared with hmac_key_init()
  * @param th thraskript hash
  * @param th_len lenhgt of th
  * @param key the generated key
@@ -90,33 +88,33 @@ static enum err ciphertext_encrypt_decrypt(
  * @param iv_len lenhgt of iv
  * @return enum err 
  */
-static enum err key_gen(enum ciphertext ctxt, enum hash_alg edhoc_hash,
-			uint8_t *prk, uint32_t prk_len, uint8_t *th,
-			uint32_t th_len, uint8_t *key, uint32_t key_len,
-			uint8_t *iv, uint32_t iv_len)
+static enum err key_gen(enum ciphertext ctxt, struct hmac_key *prk,
+			uint8_t *th, uint32_t th_len, uint8_t *key,
+			uint32_t key_len, uint8_t *iv, uint32_t iv_len)
 {
 	switch (ctxt) {
 	case CIPHERTEXT2:
-		TRY(okm_calc(edhoc_hash, prk, prk_len, th, th_len,
-			     "KEYSTREAM_2", NULL, 0, key, key_len));
+		TRY(okm_calc_prepared(prk, th, th_len, "KEYSTREAM_2", NULL, 0,
+				      key, key_len));
 		PRINT_ARRAY("KEYSTREAM_2", key, key_len);
 		break;
 
 	case CIPHERTEXT3:
-		TRY(okm_calc(edhoc_hash, prk, prk_len, th, th_len, "K_3", NULL,
-			     0, key, key_len));
+		TRY(okm_calc_prepared(prk, th, th_len, "K_3", NULL, 0, key,
+				      key_len));
 		PRINT_ARRAY("K_3", key, key_len);
-		TRY(okm_calc(edhoc_hash, prk, prk_len, th, th_len, "IV_3", NULL,
-			     0, iv, iv_len));
+		TRY(okm_calc_prepared(prk, th, th_len, "IV_3", NULL, 0, iv,
+				      iv_len));
 		PRINT_ARRAY("IV_3", iv, iv_len);
 		break;
 
 	case CIPHERTEXT4:
-		TRY(edhoc_exporter(edhoc_hash, prk, prk_len, th, th_len,
-				   "EDHOC_K_4", key, key_len));
+		/*same as edhoc_exporter() but with the prepared PRK_4x3m*/
+		TRY(okm_calc_prepared(prk, th, th_len, "EDHOC_K_4", NULL, 0,
+				      key, key_len));
 		PRINT_ARRAY("K_4", key, key_len);
-		TRY(edhoc_exporter(edhoc_hash, prk, prk_len, th, th_len,
-				   "EDHOC_IV_4", iv, iv_len));
+		TRY(okm_calc_prepared(prk, th, th_len, "EDHOC_IV_4", NULL, 0,
+				      iv, iv_len));
 		PRINT_ARRAY("IV_4", iv, iv_len);
 		break;
 	}
@@ -127,10 +125,9 @@ enum err ciphertext_decrypt_split(enum ciphertext ctxt, struct suite *suite,
 				  uint8_t *id_cred, uint32_t *id_cred_len,
 				  uint8_t *signature_or_mac,
 				  uint32_t *signature_or_mac_len, uint8_t *ead,
-				  uint32_t *ead_len, uint8_t *prk,
-				  uint32_t prk_len, uint8_t *th,
-				  uint32_t th_len, uint8_t *ciphertext,
-				  uint32_t ciphertext_len)
+				  uint32_t *ead_len, struct hmac_key *prk,
+				  uint8_t *th, uint32_t th_len,
+				  uint8_t *ciphertext, uint32_t ciphertext_len)
 {
 	/*generate key and iv (no iv in for ciphertext 2)*/
 	uint32_t key_len;
@@ -146,8 +143,7 @@ enum err ciphertext_decrypt_split(enum ciphertext ctxt, struct suite *suite,
 	TRY(check_buffer_size(AEAD_IV_DEFAULT_SIZE, iv_len));
 	uint8_t iv[AEAD_IV_DEFAULT_SIZE];
 
-	TRY(key_gen(ctxt, suite->edhoc_hash, prk, prk_len, th, th_len, key,
-		    key_len, iv, iv_len));
+	TRY(key_gen(ctxt, prk, th, th_len, key, key_len, iv, iv_len));
 
 	/*Associated data*/
 	uint8_t associated_data[ASSOCIATED_DATA_DEFAULT_SIZE];
@@ -197,8 +193,8 @@ enum err ciphertext_gen(enum ciphertext ctxt, struct suite *suite,
 			uint8_t *id_cred, uint32_t id_cred_len,
 			uint8_t *signature_or_mac,
 			uint32_t signature_or_mac_len, uint8_t *ead,
-			uint32_t ead_len, uint8_t *prk, uint32_t prk_len,
-			uint8_t *th, uint32_t th_len, uint8_t *ciphertext,
+			uint32_t ead_len, struct hmac_key *prk, uint8_t *th,
+			uint32_t th_len, uint8_t *ciphertext,
 			uint32_t *ciphertext_len)
 {
 	/*Encode plaintext*/
@@ -270,8 +266,7 @@ enum err ciphertext_gen(enum ciphertext ctxt, struct suite *suite,
 	TRY(check_buffer_size(AEAD_IV_DEFAULT_SIZE, iv_len));
 	uint8_t iv[AEAD_IV_DEFAULT_SIZE];
 
-	TRY(key_gen(ctxt, suite->edhoc_hash, prk, prk_len, th, th_len, key,
-		    key_len, iv, iv_len));
+	TRY(key_gen(ctxt, prk, th, th_len, key, key_len, iv, iv_len));
 
 	/*encrypt*/
 	uint8_t aad[ASSOCIATED_DATA_DEFAULT_SIZE];
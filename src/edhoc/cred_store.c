@@ -0,0 +1,178 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edhoc.h"
+
+#include "common/crypto_wrapper.h"
+#include "common/oscore_edhoc_error.h"
+
+/*selects the field of a credential an index is built on*/
+typedef const struct byte_array *(*cred_key_fn)(
+	const struct other_party_cred *cred);
+
+static const struct byte_array *id_cred_key(const struct other_party_cred *cred)
+{
+	return &cred->id_cred;
+}
+
+static const struct byte_array *issuer_key(const struct other_party_cred *cred)
+{
+	return &cred->ca;
+}
+
+static const struct byte_array *
+subject_key(const struct other_party_cred *cred)
+{
+	if (cred->pk.len != 0) {
+		return &cred->pk;
+	}
+	return &cred->g;
+}
+
+/**
+ * @brief   32 bit FNV-1a hash
+ */
+static uint32_t index_hash(const uint8_t *in, uint32_t in_len)
+{
+	uint32_t h = 2166136261u;
+	for (uint32_t i = 0; i < in_len; i++) {
+		h ^= in[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/**
+ * @brief   Searches an index with linear probing
+ * @param   slot the slot holding the key or the free slot where the key 
+ *          can be inserted (output)
+ * @retval  true if the key is in the index
+ */
+static bool index_find(const struct edhoc_cred_store *s, const uint32_t *index,
+		       cred_key_fn key_of, const uint8_t *key,
+		       uint32_t key_len, uint32_t *slot)
+{
+	uint32_t mask = s->index_size - 1;
+	uint32_t i = index_hash(key, key_len) & mask;
+
+	/*index_size > creds_cnt so there is always a free slot*/
+	while (index[i] != 0) {
+		const struct byte_array *k = key_of(&s->creds[index[i] - 1]);
+		if (k->len == key_len && 0 == memcmp(k->ptr, key, key_len)) {
+			*slot = i;
+			return true;
+		}
+		i = (i + 1) & mask;
+	}
+	*slot = i;
+	return false;
+}
+
+/**
+ * @brief   Adds all credentials to an index. Credentials without the key 
+ *          and duplicates of an already indexed key are skipped.
+ */
+static void index_build(struct edhoc_cred_store *s, uint32_t *index,
+			cred_key_fn key_of)
+{
+	memset(index, 0, sizeof(*index) * s->index_size);
+	for (uint32_t i = 0; i < s->creds_cnt; i++) {
+		const struct byte_array *k = key_of(&s->creds[i]);
+		uint32_t slot;
+		if (k->len != 0 &&
+		    !index_find(s, index, key_of, k->ptr, k->len, &slot)) {
+			index[slot] = i + 1;
+		}
+	}
+}
+
+enum err edhoc_cred_store_init(struct edhoc_cred_store *s,
+			       struct other_party_cred *creds,
+			       uint32_t creds_cnt, uint32_t *index,
+			       uint32_t index_size)
+{
+	if (creds == NULL || index == NULL || index_size <= creds_cnt ||
+	    (index_size & (index_size - 1)) != 0) {
+		return wrong_parameter;
+	}
+	s->creds = creds;
+	s->creds_cnt = creds_cnt;
+	s->index_size = index_size;
+	s->id_cred_index = index;
+	s->issuer_index = index + index_size;
+	s->subject_key_index = index + 2 * index_size;
+
+	index_build(s, s->id_cred_index, id_cred_key);
+	index_build(s, s->issuer_index, issuer_key);
+	index_build(s, s->subject_key_index, subject_key);
+	return ok;
+}
+
+enum err edhoc_cred_store_id_cred_get(const struct edhoc_cred_store *s,
+				      const uint8_t *id_cred,
+				      uint32_t id_cred_len,
+				      const struct other_party_cred **cred)
+{
+	uint32_t slot;
+	if (!index_find(s, s->id_cred_index, id_cred_key, id_cred, id_cred_len,
+			&slot)) {
+		return credential_not_found;
+	}
+	*cred = &s->creds[s->id_cred_index[slot] - 1];
+	return ok;
+}
+
+enum err edhoc_cred_store_issuer_get(const struct edhoc_cred_store *s,
+				     const uint8_t *issuer, uint32_t issuer_len,
+				     const struct other_party_cred **cred)
+{
+	uint32_t slot;
+	if (!index_find(s, s->issuer_index, issuer_key, issuer, issuer_len,
+			&slot)) {
+		return no_such_ca;
+	}
+	*cred = &s->creds[s->issuer_index[slot] - 1];
+	return ok;
+}
+
+enum err edhoc_cred_store_subject_key_get(const struct edhoc_cred_store *s,
+					  const uint8_t *key, uint32_t key_len,
+					  const struct other_party_cred **cred)
+{
+	uint32_t slot;
+	if (!index_find(s, s->subject_key_index, subject_key, key, key_len,
+			&slot)) {
+		return credential_not_found;
+	}
+	*cred = &s->creds[s->subject_key_index[slot] - 1];
+	return ok;
+}
+
+enum err edhoc_cred_pk_prepare(struct other_party_cred *cred,
+			       enum sign_alg alg, struct verify_key *k)
+{
+	TRY(verify_key_init(k, alg, cred->pk.ptr, cred->pk.len));
+	cred->pk_key = k;
+	return ok;
+}
+
+enum err edhoc_cred_pk_release(struct other_party_cred *cred)
+{
+	if (cred->pk_key == NULL) {
+		return ok;
+	}
+	enum err r = verify_key_destroy(cred->pk_key);
+	cred->pk_key = NULL;
+	return r;
+}
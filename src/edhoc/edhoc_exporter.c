@@ -10,10 +10,10 @@
 */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "edhoc.h"
 
-#include "edhoc/hkdf_info.h"
 #include "edhoc/okm.h"
 #include "edhoc/suites.h"
 
@@ -29,3 +29,20 @@ enum err edhoc_exporter(enum hash_alg app_hash_alg,
 	return okm_calc(app_hash_alg, prk_4x3m, prk_4x3m_len, th4, th4_len,
 			label, NULL, 0, out, out_len);
 }
+
+enum err edhoc_key_update(enum hash_alg app_hash_alg, const uint8_t *nonce,
+			  uint32_t nonce_len, uint8_t *prk_4x3m,
+			  uint32_t prk_4x3m_len)
+{
+	uint8_t prk[PRK_DEFAULT_SIZE];
+	if (prk_4x3m_len != get_hash_len(app_hash_alg) ||
+	    prk_4x3m_len > sizeof(prk)) {
+		return wrong_parameter;
+	}
+
+	TRY(hkdf_extract(app_hash_alg, nonce, nonce_len, prk_4x3m,
+			 prk_4x3m_len, prk));
+	memcpy(prk_4x3m, prk, prk_4x3m_len);
+	memset(prk, 0, sizeof(prk));
+	return ok;
+}
@@ -0,0 +1,292 @@
+/*
+   Copyright (c) 2022 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <string.h>
+
+#include "edhoc_oscore.h"
+
+#include "common/cbor_head.h"
+#include "common/crypto_wrapper.h"
+#include "common/memcpy_s.h"
+#include "common/oscore_edhoc_error.h"
+#include "common/print_util.h"
+
+#include "edhoc/okm.h"
+
+#include "oscore/oscore_coap.h"
+#include "oscore/option.h"
+
+/*the largest OSCORE request which can be verified, see oscore2coap()*/
+#define OSCORE_REQ_MAX_SIZE                                                    \
+	(HEADER_LEN + MAX_TOKEN_LEN + MAX_COAP_OPTIONS_LEN + 1 +              \
+	 MAX_CIPHERTEXT_LEN)
+
+/**
+ * @brief   Sets the deltas of options sorted by their number after an
+ *          option was added or removed
+ */
+static void options_delta_update(struct o_coap_option *options,
+				 uint8_t options_cnt)
+{
+	uint16_t prev = 0;
+	for (uint8_t i = 0; i < options_cnt; i++) {
+		options[i].delta = (uint16_t)(options[i].option_number - prev);
+		prev = options[i].option_number;
+	}
+}
+
+/**
+ * @brief   Encodes a packet without its payload and appends the payload
+ *          from two parts
+ */
+static enum err coap2buf_payload_parts(struct o_coap_packet *p,
+				       const uint8_t *part1,
+				       uint32_t part1_len,
+				       const uint8_t *part2,
+				       uint32_t part2_len, uint8_t *out,
+				       uint32_t *out_len)
+{
+	uint32_t l = *out_len;
+	TRY(check_buffer_size(l, HEADER_LEN));
+	p->payload_len = 0;
+	p->payload = NULL;
+	TRY(coap2buf(p, out, &l));
+
+	if (part1_len + part2_len != 0) {
+		TRY(check_buffer_size(*out_len, l + 1));
+		out[l++] = 0xFF;
+		TRY(cbor_bytes_append(part1, part1_len, out, *out_len, &l));
+		TRY(cbor_bytes_append(part2, part2_len, out, *out_len, &l));
+	}
+	*out_len = l;
+	return ok;
+}
+
+enum err edhoc_oscore_combined_request_gen(const uint8_t *msg3,
+					   uint32_t msg3_len,
+					   uint8_t *oscore_req,
+					   uint32_t oscore_req_len,
+					   uint8_t *out, uint32_t *out_len)
+{
+	struct o_coap_packet p;
+	struct byte_array in = { .ptr = oscore_req, .len = oscore_req_len };
+	TRY(buf2coap(&in, &p));
+
+	/*insert the EDHOC option, the options are sorted by their number*/
+	TRY(check_buffer_size(MAX_OPTION_COUNT, (uint32_t)p.options_cnt + 1));
+	uint8_t i = p.options_cnt;
+	while (i > 0 && p.options[i - 1].option_number > COAP_OPTION_EDHOC) {
+		p.options[i] = p.options[i - 1];
+		i--;
+	}
+	if (i > 0 && p.options[i - 1].option_number == COAP_OPTION_EDHOC) {
+		return wrong_parameter;
+	}
+	p.options[i].option_number = COAP_OPTION_EDHOC;
+	p.options[i].len = 0;
+	p.options[i].value = NULL;
+	p.options_cnt++;
+	options_delta_update(p.options, p.options_cnt);
+
+	return coap2buf_payload_parts(&p, msg3, msg3_len, p.payload,
+				      p.payload_len, out, out_len);
+}
+
+enum err edhoc_oscore_combined_request_split(uint8_t *buf, uint32_t buf_len,
+					     bool *combined,
+					     const uint8_t **msg3,
+					     uint32_t *msg3_len,
+					     uint8_t *oscore_req,
+					     uint32_t *oscore_req_len)
+{
+	struct o_coap_packet p;
+	struct byte_array in = { .ptr = buf, .len = buf_len };
+	TRY(buf2coap(&in, &p));
+
+	*combined = false;
+	for (uint8_t i = 0; i < p.options_cnt; i++) {
+		if (p.options[i].option_number != COAP_OPTION_EDHOC) {
+			continue;
+		}
+		memmove(&p.options[i], &p.options[i + 1],
+			(p.options_cnt - i - 1u) * sizeof(p.options[0]));
+		p.options_cnt--;
+		options_delta_update(p.options, p.options_cnt);
+		*combined = true;
+		break;
+	}
+	if (!*combined) {
+		return ok;
+	}
+
+	/*the payload starts with message 3, which is a CBOR byte string*/
+	uint8_t mt;
+	uint32_t arg, head_len;
+	TRY(cbor_head_decode(p.payload, p.payload_len, &mt, &arg, &head_len));
+	if (mt != CBOR_BSTR || arg > p.payload_len - head_len) {
+		return not_valid_input_packet;
+	}
+	*msg3 = p.payload;
+	*msg3_len = head_len + arg;
+
+	return coap2buf_payload_parts(&p, NULL, 0, p.payload + *msg3_len,
+				      p.payload_len - *msg3_len, oscore_req,
+				      oscore_req_len);
+}
+
+/**
+ * @brief   Exports the Master Secret and the Master Salt with one prepared 
+ *          PRK_4x3m and initializes the OSCORE context, the IDs must be 
+ *          set in m already
+ */
+static enum err context_init(enum dev_type dev_type, const struct suite *suite,
+			     const uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+			     const uint8_t *th4, uint32_t th4_len,
+			     struct edhoc_oscore_material *m,
+			     struct oscore_request_table *request_table,
+			     struct context *c)
+{
+	if (suite->app_aead != AES_CCM_16_64_128) {
+		return oscore_invalid_algorithm_aead;
+	}
+	if (suite->app_hash != SHA_256) {
+		return oscore_invalid_algorithm_hkdf;
+	}
+
+	/*same as edhoc_exporter() but with the prepared PRK_4x3m*/
+	struct hmac_key prk = { .initialized = false };
+	TRY(hmac_key_init(suite->app_hash, &prk, prk_4x3m, prk_4x3m_len));
+	enum err r = okm_calc_prepared(&prk, th4, th4_len,
+				       "OSCORE_Master_Secret", NULL, 0,
+				       m->master_secret,
+				       sizeof(m->master_secret));
+	if (r == ok) {
+		r = okm_calc_prepared(&prk, th4, th4_len, "OSCORE_Master_Salt",
+				      NULL, 0, m->master_salt,
+				      sizeof(m->master_salt));
+	}
+	TRY(hmac_key_destroy(&prk));
+	if (r != ok) {
+		return r;
+	}
+	PRINT_ARRAY("OSCORE Master Secret", m->master_secret,
+		    sizeof(m->master_secret));
+	PRINT_ARRAY("OSCORE Master Salt", m->master_salt,
+		    sizeof(m->master_salt));
+
+	struct oscore_init_params params = {
+		.dev_type = dev_type,
+		.master_secret = { .ptr = m->master_secret,
+				   .len = sizeof(m->master_secret) },
+		.sender_id = { .ptr = m->sender_id, .len = m->sender_id_len },
+		.recipient_id = { .ptr = m->recipient_id,
+				  .len = m->recipient_id_len },
+		.id_context = { .ptr = NULL, .len = 0 },
+		.master_salt = { .ptr = m->master_salt,
+				 .len = sizeof(m->master_salt) },
+		.aead_alg = OSCORE_AES_CCM_16_64_128,
+		.hkdf = OSCORE_SHA_256,
+		.replay_window_len = 0,
+		.request_table = request_table,
+	};
+	return oscore_context_init(&params, c);
+}
+
+enum err edhoc_oscore_context_init(enum dev_type dev_type, bool initiator,
+				   const struct suite *suite,
+				   const uint8_t *prk_4x3m,
+				   uint32_t prk_4x3m_len, const uint8_t *th4,
+				   uint32_t th4_len, const struct c_x *c_i,
+				   const struct c_x *c_r,
+				   struct edhoc_oscore_material *m,
+				   struct oscore_request_table *request_table,
+				   struct context *c)
+{
+	/*the IDs are chosen by the party which receives with them*/
+	m->sender_id_len = sizeof(m->sender_id);
+	m->recipient_id_len = sizeof(m->recipient_id);
+	TRY(c_x_oscore_id(initiator ? c_r : c_i, m->sender_id,
+			  &m->sender_id_len));
+	TRY(c_x_oscore_id(initiator ? c_i : c_r, m->recipient_id,
+			  &m->recipient_id_len));
+
+	return context_init(dev_type, suite, prk_4x3m, prk_4x3m_len, th4,
+			    th4_len, m, request_table, c);
+}
+
+enum err edhoc_oscore_key_update(enum dev_type dev_type,
+				 const struct suite *suite,
+				 const uint8_t *nonce, uint32_t nonce_len,
+				 uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+				 const uint8_t *th4, uint32_t th4_len,
+				 struct edhoc_oscore_material *m,
+				 struct oscore_request_table *request_table,
+				 struct context *c)
+{
+	TRY(edhoc_key_update(suite->app_hash, nonce, nonce_len, prk_4x3m,
+			     prk_4x3m_len));
+	TRY(oscore_context_deinit(c));
+	if (request_table != NULL) {
+		/*the responses of older requests cannot be verified anymore*/
+		TRY(oscore_request_table_init(request_table,
+					      request_table->entries,
+					      request_table->entries_cnt));
+	}
+	return context_init(dev_type, suite, prk_4x3m, prk_4x3m_len, th4,
+			    th4_len, m, request_table, c);
+}
+
+enum err edhoc_oscore_combined_request_process(
+	struct edhoc_responder_context *c, struct edhoc_responder_session *s,
+	struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+	uint8_t *buf_in, uint32_t buf_in_len, struct edhoc_oscore_material *m,
+	struct context *oscore_c,
+	uint8_t *coap_out, uint32_t *coap_out_len, uint8_t *ead_3,
+	uint32_t *ead_3_len, uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+	uint8_t *th4, uint32_t th4_len)
+{
+	if (c->msg4 || s->state != RESPONDER_WAIT_MSG3) {
+		return wrong_parameter;
+	}
+
+	bool combined;
+	const uint8_t *msg3;
+	uint32_t msg3_len;
+	uint8_t oscore_req[OSCORE_REQ_MAX_SIZE];
+	uint32_t oscore_req_len = sizeof(oscore_req);
+	TRY(edhoc_oscore_combined_request_split(buf_in, buf_in_len, &combined,
+						&msg3, &msg3_len, oscore_req,
+						&oscore_req_len));
+	if (!combined) {
+		return not_valid_input_packet;
+	}
+
+	/*the responder sends with C_I and receives with C_R*/
+	TRY(_memcpy_s(m->sender_id, sizeof(m->sender_id), s->c_i, s->c_i_len));
+	m->sender_id_len = s->c_i_len;
+	m->recipient_id_len = sizeof(m->recipient_id);
+	TRY(c_x_oscore_id(&c->c_r, m->recipient_id, &m->recipient_id_len));
+
+	uint32_t msg4_len = 0;
+	TRY(edhoc_responder_step(c, s, cred_i_array, num_cred_i, msg3,
+				 msg3_len, NULL, &msg4_len, ead_3, ead_3_len,
+				 prk_4x3m, prk_4x3m_len, th4, th4_len));
+	TRY(context_init(SERVER, &s->suite, prk_4x3m, prk_4x3m_len, th4,
+			 th4_len, m, NULL, oscore_c));
+
+	bool oscore_pkg_flag;
+	TRY(oscore2coap(oscore_req, oscore_req_len, coap_out, coap_out_len,
+			&oscore_pkg_flag, oscore_c));
+	if (!oscore_pkg_flag) {
+		return not_valid_input_packet;
+	}
+	return ok;
+}
@@ -0,0 +1,108 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edhoc.h"
+#include "edhoc_internal.h"
+
+#include "common/atomic_ops.h"
+#include "common/crypto_wrapper.h"
+#include "common/memcpy_s.h"
+#include "common/oscore_edhoc_error.h"
+
+enum err edhoc_ephemeral_key_pool_init(struct edhoc_ephemeral_key_pool *p,
+				       enum ecdh_alg alg,
+				       struct edhoc_ephemeral_key *keys,
+				       uint32_t keys_cnt)
+{
+	if (keys == NULL || keys_cnt == 0) {
+		return wrong_parameter;
+	}
+	p->alg = alg;
+	p->keys = keys;
+	p->keys_cnt = keys_cnt;
+	p->head = 0;
+	p->count = 0;
+	p->lock = false;
+	memset(keys, 0, sizeof(*keys) * keys_cnt);
+	return ok;
+}
+
+enum err edhoc_ephemeral_key_pool_add(struct edhoc_ephemeral_key_pool *p,
+				      const uint8_t *random,
+				      uint32_t random_len)
+{
+	/*do not waste a key generation if the pool is already full*/
+	spin_lock(&p->lock);
+	bool full = p->count == p->keys_cnt;
+	spin_unlock(&p->lock);
+	if (full) {
+		return ephemeral_key_pool_full;
+	}
+
+	/*the key generation is slow, the pool is not locked meanwhile*/
+	struct edhoc_ephemeral_key k;
+	k.pk_len = sizeof(k.pk);
+	k.sk_len = sizeof(k.sk);
+	enum err r = ephemeral_dh_key_gen_random(p->alg, random, random_len,
+						 k.sk, k.pk, &k.pk_len);
+
+	if (r == ok) {
+		spin_lock(&p->lock);
+		if (p->count == p->keys_cnt) {
+			r = ephemeral_key_pool_full;
+		} else {
+			p->keys[(p->head + p->count) % p->keys_cnt] = k;
+			p->count++;
+		}
+		spin_unlock(&p->lock);
+	}
+	memset(&k, 0, sizeof(k));
+	return r;
+}
+
+enum err edhoc_ephemeral_key_pool_take(struct edhoc_ephemeral_key_pool *p,
+				       struct edhoc_ephemeral_key *k)
+{
+	spin_lock(&p->lock);
+	if (p->count == 0) {
+		spin_unlock(&p->lock);
+		return ephemeral_key_pool_empty;
+	}
+	struct edhoc_ephemeral_key *oldest = &p->keys[p->head];
+	*k = *oldest;
+	memset(oldest, 0, sizeof(*oldest));
+	p->head = (p->head + 1) % p->keys_cnt;
+	p->count--;
+	spin_unlock(&p->lock);
+	return ok;
+}
+
+enum err ephemeral_key_get(struct edhoc_ephemeral_key_pool *p,
+			   enum ecdh_alg alg, const struct byte_array *pk,
+			   const struct byte_array *sk,
+			   struct edhoc_ephemeral_key *k)
+{
+	if (p != NULL) {
+		/*a key of another curve would be sent as G_X or G_Y*/
+		if (p->alg != alg) {
+			return wrong_parameter;
+		}
+		return edhoc_ephemeral_key_pool_take(p, k);
+	}
+	TRY(_memcpy_s(k->pk, sizeof(k->pk), pk->ptr, pk->len));
+	k->pk_len = pk->len;
+	TRY(_memcpy_s(k->sk, sizeof(k->sk), sk->ptr, sk->len));
+	k->sk_len = sk->len;
+	return ok;
+}
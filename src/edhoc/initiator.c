@@ -17,7 +17,6 @@
 #include "common/memcpy_s.h"
 #include "common/print_util.h"
 
-#include "edhoc/hkdf_info.h"
 #include "edhoc/messages.h"
 #include "edhoc/okm.h"
 #include "edhoc/plaintext.h"
@@ -97,9 +96,14 @@ enum err msg1_gen(const struct edhoc_initiator_context *c,
 		}
 	}
 
-	/* G_X ephemeral public key */
-	m1._message_1_G_X.value = c->g_x.ptr;
-	m1._message_1_G_X.len = c->g_x.len;
+	/* G_X ephemeral public key of the selected suite, the last of 
+	SUITES_I */
+	TRY(get_suite((enum suite_label)c->suites_i.ptr[c->suites_i.len - 1],
+		      &rc->suite));
+	TRY(ephemeral_key_get(c->ephemeral_keys, rc->suite.edhoc_ecdh, &c->g_x,
+			      &c->x, &rc->eph));
+	m1._message_1_G_X.value = rc->eph.pk;
+	m1._message_1_G_X.len = rc->eph.pk_len;
 
 	/* C_I connection id, encoded as  bstr_identifier */
 	if (c->c_i.type == INT) {
@@ -173,8 +177,9 @@ enum err msg3_gen(const struct edhoc_initiator_context *c,
 
 	/*calculate the DH shared secret*/
 	uint8_t g_xy[ECDH_SECRET_DEFAULT_SIZE];
-	TRY(shared_secret_derive(rc->suite.edhoc_ecdh, c->x.ptr, c->x.len, g_y,
-				 g_y_len, g_xy));
+	TRY(shared_secret_derive_restartable(rc->ecc, rc->suite.edhoc_ecdh,
+					     rc->eph.sk, rc->eph.sk_len, g_y,
+					     g_y_len, g_xy));
 	PRINT_ARRAY("G_XY (ECDH shared secret) ", g_xy, sizeof(g_xy));
 
 	/*calculate th2*/
@@ -187,42 +192,53 @@ enum err msg3_gen(const struct edhoc_initiator_context *c,
 	TRY(hkdf_extract(rc->suite.edhoc_hash, NULL, 0, g_xy, sizeof(g_xy),
 			 PRK_2e));
 	PRINT_ARRAY("PRK_2e", PRK_2e, sizeof(PRK_2e));
+	struct hmac_key prk_2e_key;
+	TRY(hmac_key_init(rc->suite.edhoc_hash, &prk_2e_key, PRK_2e,
+			  sizeof(PRK_2e)));
 
 	uint8_t sign_or_mac[SGN_OR_MAC_DEFAULT_SIZE];
 	uint32_t sign_or_mac_len = sizeof(sign_or_mac);
 	uint8_t id_cred_r[ID_CRED_DEFAULT_SIZE];
 	uint32_t id_cred_r_len = sizeof(id_cred_r);
-	TRY(ciphertext_decrypt_split(
+	enum err r = ciphertext_decrypt_split(
 		CIPHERTEXT2, &rc->suite, id_cred_r, &id_cred_r_len, sign_or_mac,
-		&sign_or_mac_len, ead_2, (uint32_t *)ead_2_len, PRK_2e,
-		sizeof(PRK_2e), th2, sizeof(th2), ciphertext2,
-		ciphertext2_len));
+		&sign_or_mac_len, ead_2, (uint32_t *)ead_2_len, &prk_2e_key,
+		th2, sizeof(th2), ciphertext2, ciphertext2_len);
+	TRY(hmac_key_destroy(&prk_2e_key));
+	if (r != ok) {
+		return r;
+	}
 
 	/*check the authenticity of the responder*/
-	uint8_t cred_r[CRED_DEFAULT_SIZE];
-	uint32_t cred_r_len = sizeof(cred_r);
-	uint8_t pk[PK_DEFAULT_SIZE];
-	uint32_t pk_len = sizeof(pk);
-	uint8_t g_r[G_R_DEFAULT_SIZE];
-	uint32_t g_r_len = sizeof(g_r);
-
-	TRY(retrieve_cred(static_dh_r, cred_r_array, num_cred_r, id_cred_r,
-			  id_cred_r_len, cred_r, &cred_r_len, pk, &pk_len, g_r,
-			  &g_r_len));
-	PRINT_ARRAY("CRED_R", cred_r, cred_r_len);
-	PRINT_ARRAY("pk", pk, pk_len);
-	PRINT_ARRAY("g_r", g_r, g_r_len);
+	uint8_t cred_r_buf[CRED_DEFAULT_SIZE];
+	uint8_t pk_buf[PK_DEFAULT_SIZE];
+	uint8_t g_r_buf[G_R_DEFAULT_SIZE];
+	struct byte_array cred_r = { .len = sizeof(cred_r_buf),
+				    .ptr = cred_r_buf };
+	struct byte_array pk = { .len = sizeof(pk_buf), .ptr = pk_buf };
+	struct byte_array g_r = { .len = sizeof(g_r_buf), .ptr = g_r_buf };
+	const struct verify_key *pk_key = NULL;
+
+	TRY(retrieve_cred(static_dh_r, c->cred_store, c->cert_cache,
+			  cred_r_array, num_cred_r, id_cred_r, id_cred_r_len,
+			  &cred_r, &pk, &pk_key, &g_r));
+	PRINT_ARRAY("CRED_R", cred_r.ptr, cred_r.len);
+	PRINT_ARRAY("pk", pk.ptr, pk.len);
+	PRINT_ARRAY("g_r", g_r.ptr, g_r.len);
 
 	/*derive prk_3e2m*/
 	uint8_t PRK_3e2m[PRK_DEFAULT_SIZE];
-	TRY(prk_derive(static_dh_r, rc->suite, PRK_2e, sizeof(PRK_2e), g_r,
-		       g_r_len, c->x.ptr, c->x.len, PRK_3e2m));
+	TRY(prk_derive(static_dh_r, rc->suite, PRK_2e, sizeof(PRK_2e), g_r.ptr,
+		       g_r.len, rc->eph.sk, rc->eph.sk_len, rc->ecc, PRK_3e2m));
 	PRINT_ARRAY("prk_3e2m", PRK_3e2m, sizeof(PRK_3e2m));
+	TRY(hmac_key_destroy(&rc->prk_3e2m_key));
+	TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_3e2m_key, PRK_3e2m,
+			  sizeof(PRK_3e2m)));
 	//todo why static_dh_r?
-	TRY(signature_or_mac(VERIFY, static_dh_r, &rc->suite, NULL, 0, pk,
-			     pk_len, PRK_3e2m, sizeof(PRK_3e2m), th2,
-			     sizeof(th2), id_cred_r, id_cred_r_len, cred_r,
-			     cred_r_len, ead_2, *(uint32_t *)ead_2_len, "MAC_2",
+	TRY(signature_or_mac(VERIFY, static_dh_r, &rc->suite, NULL, 0, NULL,
+			     pk.ptr, pk.len, pk_key, rc->ecc, &rc->prk_3e2m_key,
+			     th2, sizeof(th2), id_cred_r, id_cred_r_len, cred_r.ptr,
+			     cred_r.len, ead_2, *(uint32_t *)ead_2_len, "MAC_2",
 			     sign_or_mac, &sign_or_mac_len));
 
 	/********msg3 create and send**************************************/
@@ -233,27 +249,29 @@ enum err msg3_gen(const struct edhoc_initiator_context *c,
 	/*derive prk_4x3m*/
 	TRY(prk_derive(static_dh_i, rc->suite, (uint8_t *)&PRK_3e2m,
 		       sizeof(PRK_3e2m), g_y, g_y_len, c->i.ptr, c->i.len,
-		       prk_4x3m));
+		       rc->ecc, prk_4x3m));
 	PRINT_ARRAY("prk_4x3m", prk_4x3m, prk_4x3m_len);
+	TRY(hmac_key_destroy(&rc->prk_4x3m_key));
+	TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_4x3m_key, prk_4x3m,
+			  prk_4x3m_len));
 
 	/*calculate Signature_or_MAC_3*/
 	uint32_t sign_or_mac_3_len = get_signature_len(rc->suite.edhoc_sign);
 	uint8_t sign_or_mac_3[SIGNATURE_DEFAULT_SIZE];
 
 	TRY(signature_or_mac(GENERATE, static_dh_i, &rc->suite, c->sk_i.ptr,
-			     c->sk_i.len, c->pk_i.ptr, c->pk_i.len, prk_4x3m,
-			     prk_4x3m_len, th3, sizeof(th3), c->id_cred_i.ptr,
-			     c->id_cred_i.len, c->cred_i.ptr, c->cred_i.len,
-			     c->ead_3.ptr, c->ead_3.len, "MAC_3", sign_or_mac_3,
-			     &sign_or_mac_3_len));
+			     c->sk_i.len, c->sign_key, c->pk_i.ptr, c->pk_i.len,
+			     NULL, rc->ecc, &rc->prk_4x3m_key, th3, sizeof(th3),
+			     c->id_cred_i.ptr, c->id_cred_i.len, c->cred_i.ptr,
+			     c->cred_i.len, c->ead_3.ptr, c->ead_3.len, "MAC_3",
+			     sign_or_mac_3, &sign_or_mac_3_len));
 
 	uint8_t ciphertext_3[CIPHERTEXT3_DEFAULT_SIZE];
 	uint32_t ciphertext_3_len = sizeof(ciphertext_3);
 	TRY(ciphertext_gen(CIPHERTEXT3, &rc->suite, c->id_cred_i.ptr,
 			   c->id_cred_i.len, sign_or_mac_3, sign_or_mac_3_len,
-			   c->ead_3.ptr, c->ead_3.len, PRK_3e2m,
-			   sizeof(PRK_3e2m), th3, sizeof(th3), ciphertext_3,
-			   &ciphertext_3_len));
+			   c->ead_3.ptr, c->ead_3.len, &rc->prk_3e2m_key, th3,
+			   sizeof(th3), ciphertext_3, &ciphertext_3_len));
 
 	/*massage 3 create and send*/
 	TRY(check_buffer_size(CIPHERTEXT3_DEFAULT_SIZE,
@@ -280,10 +298,180 @@ enum err msg4_process(struct runtime_context *rc, uint8_t *ead_4,
 			       &ciphertext_4_len));
 	PRINT_ARRAY("ciphertext_4", ciphertext_4, ciphertext_4_len);
 
+	if (!rc->prk_4x3m_key.initialized) {
+		TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_4x3m_key,
+				  prk_4x3m, prk_4x3m_len));
+	}
+
 	TRY(ciphertext_decrypt_split(CIPHERTEXT4, &rc->suite, NULL, 0, NULL, 0,
-				     ead_4, (uint32_t *)ead_4_len, prk_4x3m,
-				     prk_4x3m_len, th4, th4_len, ciphertext_4,
-				     ciphertext_4_len));
+				     ead_4, (uint32_t *)ead_4_len,
+				     &rc->prk_4x3m_key, th4, th4_len,
+				     ciphertext_4, ciphertext_4_len));
+	return ok;
+}
+
+void edhoc_initiator_session_init(struct edhoc_initiator_session *s)
+{
+	s->state = INITIATOR_START;
+#ifdef EDHOC_ECC_RESTARTABLE
+	s->sliced.enabled = false;
+	s->sliced.in_progress = false;
+	ecc_restart_init(&s->sliced.ecc);
+#endif
+}
+
+#ifdef EDHOC_ECC_RESTARTABLE
+void edhoc_initiator_session_init_sliced(struct edhoc_initiator_session *s)
+{
+	edhoc_initiator_session_init(s);
+	s->sliced.enabled = true;
+}
+#endif
+
+enum err edhoc_initiator_session_deinit(struct edhoc_initiator_session *s)
+{
+	memset(&s->eph, 0, sizeof(s->eph));
+#ifdef EDHOC_ECC_RESTARTABLE
+	ecc_restart_free(&s->sliced.ecc);
+	s->sliced.in_progress = false;
+#endif
+	return ok;
+}
+
+/**
+ * @brief   Produces the message of the current state of a session, see 
+ *          edhoc_initiator_step()
+ * @param   rc an initialized runtime context used for the processing of 
+ *          the message
+ */
+static enum err initiator_step(const struct edhoc_initiator_context *c,
+			       struct edhoc_initiator_session *s,
+			       struct runtime_context *rc,
+			       struct other_party_cred *cred_r_array,
+			       uint16_t num_cred_r, const uint8_t *msg_in,
+			       uint32_t msg_in_len, uint8_t *msg_out,
+			       uint32_t *msg_out_len, uint8_t *ead,
+			       uint32_t *ead_len, uint8_t *prk_4x3m,
+			       uint32_t prk_4x3m_len, uint8_t *th4,
+			       uint32_t th4_len)
+{
+	switch (s->state) {
+	case INITIATOR_START:
+		TRY(msg1_gen(c, rc));
+		TRY(_memcpy_s(msg_out, *msg_out_len, rc->msg1, rc->msg1_len));
+		*msg_out_len = rc->msg1_len;
+
+		/*keep what message 2 needs*/
+		memcpy(s->msg1, rc->msg1, rc->msg1_len);
+		s->msg1_len = rc->msg1_len;
+		s->eph = rc->eph;
+		s->state = INITIATOR_WAIT_MSG2;
+		return ok;
+
+	case INITIATOR_WAIT_MSG2:
+		memcpy(rc->msg1, s->msg1, s->msg1_len);
+		rc->msg1_len = s->msg1_len;
+		rc->eph = s->eph;
+
+		TRY(_memcpy_s(rc->msg2, sizeof(rc->msg2), msg_in, msg_in_len));
+		rc->msg2_len = msg_in_len;
+		TRY(msg3_gen(c, rc, cred_r_array, num_cred_r, ead, ead_len,
+			     prk_4x3m, prk_4x3m_len, th4));
+		TRY(_memcpy_s(msg_out, *msg_out_len, rc->msg3, rc->msg3_len));
+		*msg_out_len = rc->msg3_len;
+
+		s->suite = rc->suite;
+		if (c->msg4) {
+			s->state = INITIATOR_WAIT_MSG4;
+		} else {
+			s->state = INITIATOR_DONE;
+		}
+		return ok;
+
+	case INITIATOR_WAIT_MSG4:
+		rc->suite = s->suite;
+		TRY(_memcpy_s(rc->msg4, sizeof(rc->msg4), msg_in, msg_in_len));
+		rc->msg4_len = msg_in_len;
+		TRY(msg4_process(rc, ead, ead_len, prk_4x3m, prk_4x3m_len, th4,
+				 th4_len));
+		*msg_out_len = 0;
+		s->state = INITIATOR_DONE;
+		return ok;
+
+	default:
+		return wrong_parameter;
+	}
+}
+
+enum err edhoc_initiator_step(const struct edhoc_initiator_context *c,
+			      struct edhoc_initiator_session *s,
+			      struct other_party_cred *cred_r_array,
+			      uint16_t num_cred_r, const uint8_t *msg_in,
+			      uint32_t msg_in_len, uint8_t *msg_out,
+			      uint32_t *msg_out_len, uint8_t *ead,
+			      uint32_t *ead_len, uint8_t *prk_4x3m,
+			      uint32_t prk_4x3m_len, uint8_t *th4,
+			      uint32_t th4_len)
+{
+	struct runtime_context rc;
+	runtime_context_init(&rc);
+#ifdef EDHOC_ECC_RESTARTABLE
+	TRY(sliced_step_begin(&s->sliced, &rc, msg_in, msg_in_len));
+#endif
+
+	enum err r = initiator_step(c, s, &rc, cred_r_array, num_cred_r,
+				    msg_in, msg_in_len, msg_out, msg_out_len,
+				    ead, ead_len, prk_4x3m, prk_4x3m_len, th4,
+				    th4_len);
+	enum err r_deinit = runtime_context_deinit(&rc);
+	if (r == ok) {
+		r = r_deinit;
+	}
+#ifdef EDHOC_ECC_RESTARTABLE
+	sliced_step_end(&s->sliced, r);
+	if (s->sliced.in_progress) {
+		return r;
+	}
+#endif
+
+	/*the protocol must be discontinued after an error*/
+	if (r != ok && s->state != INITIATOR_DONE) {
+		s->state = INITIATOR_FAILED;
+	}
+	if (s->state != INITIATOR_WAIT_MSG2) {
+		TRY(edhoc_initiator_session_deinit(s));
+	}
+	return r;
+}
+
+/**
+ * @brief   Runs the handshake of edhoc_initiator_run() in the runtime 
+ *          context rc
+ */
+static enum err initiator_run(
+	const struct edhoc_initiator_context *c, struct runtime_context *rc,
+	struct other_party_cred *cred_r_array, uint16_t num_cred_r,
+	uint8_t *ead_2, uint32_t *ead_2_len, uint8_t *ead_4,
+	uint32_t *ead_4_len, uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+	uint8_t *th4, uint32_t th4_len,
+	enum err (*tx)(void *sock, uint8_t *data, uint32_t data_len),
+	enum err (*rx)(void *sock, uint8_t *data, uint32_t *data_len))
+{
+	TRY(msg1_gen(c, rc));
+	TRY(tx(c->sock, rc->msg1, rc->msg1_len));
+
+	PRINT_MSG("waiting to receive message 2...\n");
+	TRY(rx(c->sock, rc->msg2, &rc->msg2_len));
+	TRY(msg3_gen(c, rc, cred_r_array, num_cred_r, ead_2, ead_2_len,
+		     prk_4x3m, prk_4x3m_len, th4));
+	TRY(tx(c->sock, rc->msg3, rc->msg3_len));
+
+	if (c->msg4) {
+		PRINT_MSG("waiting to receive message 4...\n");
+		TRY(rx(c->sock, rc->msg4, &rc->msg4_len));
+		TRY(msg4_process(rc, ead_4, ead_4_len, prk_4x3m, prk_4x3m_len,
+				 th4, th4_len));
+	}
 	return ok;
 }
 
@@ -300,20 +488,13 @@ enum err edhoc_initiator_run(
 	struct runtime_context rc = { 0 };
 	runtime_context_init(&rc);
 
-	TRY(msg1_gen(c, &rc));
-	TRY(tx(c->sock, rc.msg1, rc.msg1_len));
-
-	PRINT_MSG("waiting to receive message 2...\n");
-	TRY(rx(c->sock, rc.msg2, &rc.msg2_len));
-	TRY(msg3_gen(c, &rc, cred_r_array, num_cred_r, ead_2, ead_2_len,
-		     prk_4x3m, prk_4x3m_len, th4));
-	TRY(tx(c->sock, rc.msg3, rc.msg3_len));
-
-	if (c->msg4) {
-		PRINT_MSG("waiting to receive message 4...\n");
-		TRY(rx(c->sock, rc.msg4, &rc.msg4_len));
-		TRY(msg4_process(&rc, ead_4, ead_4_len, prk_4x3m, prk_4x3m_len,
-				 th4, th4_len));
+	/*the ephemeral key is zeroized also if the handshake fails*/
+	enum err r = initiator_run(c, &rc, cred_r_array, num_cred_r, ead_2,
+				   ead_2_len, ead_4, ead_4_len, prk_4x3m,
+				   prk_4x3m_len, th4, th4_len, tx, rx);
+	enum err r_deinit = runtime_context_deinit(&rc);
+	if (r == ok) {
+		r = r_deinit;
 	}
-	return ok;
+	return r;
 }
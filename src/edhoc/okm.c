@@ -9,28 +9,91 @@
    except according to those terms.
 */
 
+#include <string.h>
+
 #include "edhoc.h"
 
-#include "edhoc/hkdf_info.h"
 #include "edhoc/okm.h"
 
+#include "common/cbor_head.h"
 #include "common/crypto_wrapper.h"
+#include "common/memcpy_s.h"
 #include "common/oscore_edhoc_error.h"
 
-#include "common/print_util.h"
+enum err okm_calc_prepared_segments(struct hmac_key *prk, const uint8_t *th,
+				    uint32_t th_len, const char *label,
+				    const struct const_byte_array *context,
+				    uint32_t context_cnt, uint8_t *okm,
+				    uint32_t okm_len)
+{
+	/*info = (transcript_hash : bstr, label : tstr, context : bstr, 
+	length : uint), the context is the concatenation of all segments*/
+	uint8_t th_head[CBOR_HEAD_MAX_SIZE];
+	uint8_t label_head[CBOR_HEAD_MAX_SIZE];
+	uint8_t context_head[CBOR_HEAD_MAX_SIZE];
+	uint8_t length_enc[CBOR_HEAD_MAX_SIZE];
+	uint32_t label_len = (uint32_t)strlen(label);
+	uint32_t context_len = 0;
+	struct const_byte_array info[OKM_CONTEXT_MAX_SEGMENTS + 6];
+	uint32_t info_cnt = 0;
+
+	TRY(check_buffer_size(OKM_CONTEXT_MAX_SEGMENTS, context_cnt));
+	for (uint32_t i = 0; i < context_cnt; i++) {
+		context_len += context[i].len;
+	}
+
+	info[info_cnt].ptr = th_head;
+	info[info_cnt].len = sizeof(th_head);
+	TRY(cbor_head_encode(CBOR_BSTR, th_len, th_head,
+			     &info[info_cnt++].len));
+	info[info_cnt].ptr = th;
+	info[info_cnt++].len = th_len;
+
+	info[info_cnt].ptr = label_head;
+	info[info_cnt].len = sizeof(label_head);
+	TRY(cbor_head_encode(CBOR_TSTR, label_len, label_head,
+			     &info[info_cnt++].len));
+	info[info_cnt].ptr = (const uint8_t *)label;
+	info[info_cnt++].len = label_len;
+
+	info[info_cnt].ptr = context_head;
+	info[info_cnt].len = sizeof(context_head);
+	TRY(cbor_head_encode(CBOR_BSTR, context_len, context_head,
+			     &info[info_cnt++].len));
+	for (uint32_t i = 0; i < context_cnt; i++) {
+		info[info_cnt++] = context[i];
+	}
+
+	info[info_cnt].ptr = length_enc;
+	info[info_cnt].len = sizeof(length_enc);
+	TRY(cbor_head_encode(CBOR_UINT, okm_len, length_enc,
+			     &info[info_cnt++].len));
+
+	TRY(hkdf_expand_prepared_segments(prk, info, info_cnt, okm, okm_len));
+	return ok;
+}
+
+enum err okm_calc_prepared(struct hmac_key *prk, const uint8_t *th,
+			   uint32_t th_len, const char *label, uint8_t *context,
+			   uint32_t context_len, uint8_t *okm, uint32_t okm_len)
+{
+	struct const_byte_array c = { .len = context_len, .ptr = context };
+
+	return okm_calc_prepared_segments(prk, th, th_len, label, &c, 1, okm,
+					  okm_len);
+}
 
 enum err okm_calc(enum hash_alg hash_alg, const uint8_t *prk, uint32_t prk_len,
 		  const uint8_t *th, uint32_t th_len, const char *label,
 		  uint8_t *context, uint32_t context_len, uint8_t *okm,
 		  uint32_t okm_len)
 {
-	uint8_t info[INFO_DEFAULT_SIZE];
-	uint32_t info_len = sizeof(info);
-
-	TRY(create_hkdf_info(th, th_len, label, context, context_len, okm_len,
-			     (uint8_t *)&info, &info_len));
-	PRINT_ARRAY("info", info, info_len);
-	TRY(hkdf_expand(hash_alg, prk, prk_len, (uint8_t *)&info, info_len, okm,
-			okm_len));
-	return ok;
+	struct hmac_key k;
+	enum err r;
+
+	TRY(hmac_key_init(hash_alg, &k, prk, prk_len));
+	r = okm_calc_prepared(&k, th, th_len, label, context, context_len, okm,
+			      okm_len);
+	TRY(hmac_key_destroy(&k));
+	return r;
 }
@@ -24,13 +24,14 @@ enum err prk_derive(bool static_dh_auth, struct suite suite,
 		    const uint8_t *prk_in, const uint32_t prk_in_len,
 		    const uint8_t *stat_pk, const uint32_t stat_pk_len,
 		    const uint8_t *stat_sk, const uint32_t stat_sk_len,
-		    uint8_t *prk_out)
+		    struct ecc_restart *rs, uint8_t *prk_out)
 {
 	if (static_dh_auth) {
 		uint8_t dh_secret[ECDH_SECRET_DEFAULT_SIZE];
 
-		TRY(shared_secret_derive(suite.edhoc_ecdh, stat_sk, stat_sk_len,
-					 stat_pk, stat_pk_len, dh_secret));
+		TRY(shared_secret_derive_restartable(
+			rs, suite.edhoc_ecdh, stat_sk, stat_sk_len, stat_pk,
+			stat_pk_len, dh_secret));
 		PRINT_ARRAY("dh_secret", dh_secret, sizeof(dh_secret));
 		TRY(hkdf_extract(suite.edhoc_hash, prk_in, prk_in_len,
 				 dh_secret, sizeof(dh_secret), prk_out));
@@ -0,0 +1,169 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edhoc.h"
+
+#include "edhoc/reply_cache.h"
+
+#include "common/atomic_ops.h"
+#include "common/memcpy_s.h"
+#include "common/oscore_edhoc_error.h"
+
+enum err edhoc_reply_cache_init(struct edhoc_reply_cache *c,
+				struct edhoc_reply_cache_entry *entries,
+				uint32_t entries_cnt)
+{
+	if (entries == NULL || entries_cnt == 0) {
+		return wrong_parameter;
+	}
+	c->entries = entries;
+	c->entries_cnt = entries_cnt;
+	c->tick = 0;
+	c->lock = false;
+	memset(entries, 0, sizeof(*entries) * entries_cnt);
+	return ok;
+}
+
+/**
+ * @brief   Reads 4 bytes of a hash as an integer
+ */
+static uint32_t hash_word(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+/**
+ * @brief   Returns one of the two entries of a message. The hash is
+ *          uniformly distributed, so its first bytes select the entries.
+ *          The second entry differs from the first one if the cache has
+ *          more than one entry.
+ * @param   way 0 or 1
+ */
+static struct edhoc_reply_cache_entry *
+entry_get(struct edhoc_reply_cache *c, const uint8_t *msg_hash, uint32_t way)
+{
+	uint32_t i = hash_word(msg_hash) % c->entries_cnt;
+	if (way == 1 && c->entries_cnt > 1) {
+		i = (i + 1 + hash_word(msg_hash + 4) % (c->entries_cnt - 1)) %
+		    c->entries_cnt;
+	}
+	return &c->entries[i];
+}
+
+/**
+ * @brief   Compares two connection identifiers
+ */
+static bool c_x_equal(const struct c_x *a, const struct c_x *b)
+{
+	if (a->type != b->type) {
+		return false;
+	}
+	if (a->type == INT) {
+		return a->mem.c_x_int == b->mem.c_x_int;
+	}
+	return a->mem.c_x_bstr.len == b->mem.c_x_bstr.len &&
+	       0 == memcmp(a->mem.c_x_bstr.ptr, b->mem.c_x_bstr.ptr,
+			   a->mem.c_x_bstr.len);
+}
+
+enum err reply_cache_get(struct edhoc_reply_cache *c, const uint8_t *msg_hash,
+			 const struct c_x *c_r, struct c_x *c_r_out,
+			 uint8_t *reply, uint32_t *reply_len, bool *found)
+{
+	enum err r = ok;
+	*found = false;
+
+	spin_lock(&c->lock);
+	struct edhoc_reply_cache_entry *e = NULL;
+	for (uint32_t way = 0; way < 2 && e == NULL; way++) {
+		e = entry_get(c, msg_hash, way);
+		if (!e->used ||
+		    0 != memcmp(e->msg_hash, msg_hash, sizeof(e->msg_hash)) ||
+		    (c_r != NULL && !c_x_equal(&e->c_r, c_r))) {
+			e = NULL;
+		}
+	}
+	if (e != NULL) {
+		if (e->reply_len != 0) {
+			r = _memcpy_s(reply, *reply_len, e->reply,
+				      e->reply_len);
+		}
+		if (r == ok && c_r_out != NULL) {
+			c_r_out->type = e->c_r.type;
+			if (e->c_r.type == INT) {
+				c_r_out->mem.c_x_int = e->c_r.mem.c_x_int;
+			} else {
+				r = _memcpy_s(c_r_out->mem.c_x_bstr.ptr,
+					      c_r_out->mem.c_x_bstr.len,
+					      e->c_r.mem.c_x_bstr.ptr,
+					      e->c_r.mem.c_x_bstr.len);
+				if (r == ok) {
+					c_r_out->mem.c_x_bstr.len =
+						e->c_r.mem.c_x_bstr.len;
+				}
+			}
+		}
+		if (r == ok) {
+			*reply_len = e->reply_len;
+			*found = true;
+		}
+	}
+	spin_unlock(&c->lock);
+	return r;
+}
+
+void reply_cache_put(struct edhoc_reply_cache *c, const uint8_t *msg_hash,
+		     const struct c_x *c_r, const uint8_t *reply,
+		     uint32_t reply_len)
+{
+	struct edhoc_reply_cache_entry *e = &c->entries[0];
+	if (reply_len > sizeof(e->reply) ||
+	    (c_r->type == BSTR && c_r->mem.c_x_bstr.len > sizeof(e->c_r_buf))) {
+		return;
+	}
+
+	spin_lock(&c->lock);
+	/*the entry of the same message, else a free entry, else the older one*/
+	struct edhoc_reply_cache_entry *e0 = entry_get(c, msg_hash, 0);
+	struct edhoc_reply_cache_entry *e1 = entry_get(c, msg_hash, 1);
+	if (e0->used && 0 == memcmp(e0->msg_hash, msg_hash, sizeof(e0->msg_hash))) {
+		e = e0;
+	} else if (e1->used &&
+		   0 == memcmp(e1->msg_hash, msg_hash, sizeof(e1->msg_hash))) {
+		e = e1;
+	} else if (!e0->used) {
+		e = e0;
+	} else if (!e1->used) {
+		e = e1;
+	} else {
+		e = e0->last_used < e1->last_used ? e0 : e1;
+	}
+	memcpy(e->msg_hash, msg_hash, sizeof(e->msg_hash));
+	e->c_r.type = c_r->type;
+	if (c_r->type == INT) {
+		e->c_r.mem.c_x_int = c_r->mem.c_x_int;
+	} else {
+		memcpy(e->c_r_buf, c_r->mem.c_x_bstr.ptr, c_r->mem.c_x_bstr.len);
+		e->c_r.mem.c_x_bstr.ptr = e->c_r_buf;
+		e->c_r.mem.c_x_bstr.len = c_r->mem.c_x_bstr.len;
+	}
+	if (reply_len != 0) {
+		memcpy(e->reply, reply, reply_len);
+	}
+	e->reply_len = reply_len;
+	e->last_used = ++c->tick;
+	e->used = true;
+	spin_unlock(&c->lock);
+}
@@ -17,7 +17,6 @@
 #include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 
-#include "edhoc/hkdf_info.h"
 #include "edhoc/messages.h"
 #include "edhoc/okm.h"
 #include "edhoc/plaintext.h"
@@ -30,6 +29,7 @@
 #include "edhoc/ciphertext.h"
 #include "edhoc/suites.h"
 #include "edhoc/runtime_context.h"
+#include "edhoc/reply_cache.h"
 
 #include "cbor/edhoc_decode_message_1.h"
 #include "cbor/edhoc_encode_message_2.h"
@@ -97,8 +97,8 @@ static inline enum err msg1_parse(uint8_t *msg1, uint32_t msg1_len,
 		TRY(c_x_set(INT, NULL, 0, m._message_1_C_I_int, c_i));
 		PRINTF("msg1 C_I_raw (int): %d\n", c_i->mem.c_x_int);
 	} else {
-		TRY(c_x_set(BSTR, m._message_1_C_I_bstr.value, 0,
-			    m._message_1_C_I_int, c_i));
+		TRY(c_x_set(BSTR, m._message_1_C_I_bstr.value,
+			    (uint32_t)m._message_1_C_I_bstr.len, 0, c_i));
 		PRINT_ARRAY("msg1 C_I_raw (bstr)", c_i->mem.c_x_bstr.ptr,
 			    c_i->mem.c_x_bstr.len);
 	}
@@ -197,6 +197,8 @@ enum err msg2_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 
 	TRY(msg1_parse(rc->msg1, rc->msg1_len, &method, suites_i, &suites_i_len,
 		       g_x, &g_x_len, &c_i, ead_1, ead_1_len));
+	rc->c_i_len = sizeof(rc->c_i);
+	TRY(c_x_oscore_id(&c_i, rc->c_i, &rc->c_i_len));
 
 	if (!(selected_suite_is_supported(suites_i[suites_i_len - 1],
 					  &c->suites_r))) {
@@ -217,15 +219,20 @@ enum err msg2_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 	authentication_type_get(method, &rc->static_dh_i, &static_dh_r);
 
 	/******************* create and send message 2*************************/
+	if (!rc->eph_set) {
+		TRY(ephemeral_key_get(c->ephemeral_keys, rc->suite.edhoc_ecdh,
+				      &c->g_y, &c->y, &rc->eph));
+	}
 	uint8_t th2[SHA_DEFAULT_SIZE];
 	uint32_t th2_len = sizeof(th2);
 	TRY(th2_calculate(rc->suite.edhoc_hash, rc->msg1, rc->msg1_len,
-			  c->g_y.ptr, c->g_y.len, &c->c_r, th2));
+			  rc->eph.pk, rc->eph.pk_len, &c->c_r, th2));
 
 	/*calculate the DH shared secret*/
 	uint8_t g_xy[ECDH_SECRET_DEFAULT_SIZE];
-	TRY(shared_secret_derive(rc->suite.edhoc_ecdh, c->y.ptr, c->y.len, g_x,
-				 g_x_len, g_xy));
+	TRY(shared_secret_derive_restartable(rc->ecc, rc->suite.edhoc_ecdh,
+					     rc->eph.sk, rc->eph.sk_len, g_x,
+					     g_x_len, g_xy));
 
 	PRINT_ARRAY("G_XY (ECDH shared secret) ", g_xy, sizeof(g_xy));
 
@@ -236,8 +243,11 @@ enum err msg2_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 
 	/*derive prk_3e2m*/
 	TRY(prk_derive(static_dh_r, rc->suite, PRK_2e, sizeof(PRK_2e), g_x,
-		       g_x_len, c->r.ptr, c->r.len, rc->PRK_3e2m));
+		       g_x_len, c->r.ptr, c->r.len, rc->ecc, rc->PRK_3e2m));
 	PRINT_ARRAY("prk_3e2m", rc->PRK_3e2m, rc->PRK_3e2m_len);
+	TRY(hmac_key_destroy(&rc->prk_3e2m_key));
+	TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_3e2m_key,
+			  rc->PRK_3e2m, rc->PRK_3e2m_len));
 
 	/*compute signature_or_MAC_2*/
 	uint32_t sign_or_mac_2_len = get_signature_len(rc->suite.edhoc_sign);
@@ -245,22 +255,30 @@ enum err msg2_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 
 	uint8_t sign_or_mac_2[SIGNATURE_DEFAULT_SIZE];
 	TRY(signature_or_mac(GENERATE, static_dh_r, &rc->suite, c->sk_r.ptr,
-			     c->sk_r.len, c->pk_r.ptr, c->pk_r.len,
-			     rc->PRK_3e2m, rc->PRK_3e2m_len, th2, th2_len,
-			     c->id_cred_r.ptr, c->id_cred_r.len, c->cred_r.ptr,
-			     c->cred_r.len, c->ead_2.ptr, c->ead_2.len, "MAC_2",
-			     sign_or_mac_2, &sign_or_mac_2_len));
+			     c->sk_r.len, c->sign_key, c->pk_r.ptr, c->pk_r.len,
+			     NULL, rc->ecc, &rc->prk_3e2m_key, th2, th2_len, c->id_cred_r.ptr,
+			     c->id_cred_r.len, c->cred_r.ptr, c->cred_r.len,
+			     c->ead_2.ptr, c->ead_2.len, "MAC_2", sign_or_mac_2,
+			     &sign_or_mac_2_len));
 
 	/*compute ciphertext_2*/
 	uint8_t ciphertext_2[CIPHERTEXT2_DEFAULT_SIZE];
 	uint32_t ciphertext_2_len = sizeof(ciphertext_2);
-	TRY(ciphertext_gen(CIPHERTEXT2, &rc->suite, c->id_cred_r.ptr,
-			   c->id_cred_r.len, sign_or_mac_2, sign_or_mac_2_len,
-			   c->ead_2.ptr, c->ead_2.len, PRK_2e, sizeof(PRK_2e),
-			   th2, th2_len, ciphertext_2, &ciphertext_2_len));
+	struct hmac_key prk_2e_key;
+	TRY(hmac_key_init(rc->suite.edhoc_hash, &prk_2e_key, PRK_2e,
+			  sizeof(PRK_2e)));
+	enum err r = ciphertext_gen(CIPHERTEXT2, &rc->suite, c->id_cred_r.ptr,
+				    c->id_cred_r.len, sign_or_mac_2,
+				    sign_or_mac_2_len, c->ead_2.ptr,
+				    c->ead_2.len, &prk_2e_key, th2, th2_len,
+				    ciphertext_2, &ciphertext_2_len);
+	TRY(hmac_key_destroy(&prk_2e_key));
+	if (r != ok) {
+		return r;
+	}
 
 	/*message 2 create*/
-	TRY(msg2_encode(c->g_y.ptr, c->g_y.len, &c->c_r, ciphertext_2,
+	TRY(msg2_encode(rc->eph.pk, rc->eph.pk_len, &c->c_r, ciphertext_2,
 			ciphertext_2_len, rc->msg2, &rc->msg2_len));
 
 	TRY(th3_calculate(rc->suite.edhoc_hash, th2, th2_len, ciphertext_2,
@@ -297,35 +315,42 @@ enum err msg3_process(struct edhoc_responder_context *c,
 	uint32_t sign_or_mac_len = sizeof(sign_or_mac);
 	TRY(ciphertext_decrypt_split(
 		CIPHERTEXT3, &rc->suite, id_cred_i, &id_cred_i_len, sign_or_mac,
-		&sign_or_mac_len, ead_3, (uint32_t *)ead_3_len, rc->PRK_3e2m,
-		rc->PRK_3e2m_len, rc->th3, rc->th3_len, ciphertext_3,
+		&sign_or_mac_len, ead_3, (uint32_t *)ead_3_len,
+		&rc->prk_3e2m_key, rc->th3, rc->th3_len, ciphertext_3,
 		ciphertext_3_len));
 
 	/*check the authenticity of the initiator*/
-	uint8_t cred_i[CRED_DEFAULT_SIZE];
-	uint32_t cred_i_len = sizeof(cred_i);
-	uint8_t pk[PK_DEFAULT_SIZE];
-	uint32_t pk_len = sizeof(pk);
-	uint8_t g_i[G_I_DEFAULT_SIZE];
-	uint32_t g_i_len = sizeof(g_i);
-
-	TRY(retrieve_cred(rc->static_dh_i, cred_i_array, num_cred_i, id_cred_i,
-			  id_cred_i_len, cred_i, &cred_i_len, pk, &pk_len, g_i,
-			  &g_i_len));
-	PRINT_ARRAY("CRED_I", cred_i, cred_i_len);
-	PRINT_ARRAY("pk", pk, pk_len);
-	PRINT_ARRAY("g_i", g_i, g_i_len);
+	uint8_t cred_i_buf[CRED_DEFAULT_SIZE];
+	uint8_t pk_buf[PK_DEFAULT_SIZE];
+	uint8_t g_i_buf[G_I_DEFAULT_SIZE];
+	struct byte_array cred_i = { .len = sizeof(cred_i_buf),
+				    .ptr = cred_i_buf };
+	struct byte_array pk = { .len = sizeof(pk_buf), .ptr = pk_buf };
+	struct byte_array g_i = { .len = sizeof(g_i_buf), .ptr = g_i_buf };
+	const struct verify_key *pk_key = NULL;
+
+	TRY(retrieve_cred(rc->static_dh_i, c->cred_store, c->cert_cache,
+			  cred_i_array, num_cred_i, id_cred_i, id_cred_i_len,
+			  &cred_i, &pk, &pk_key, &g_i));
+	PRINT_ARRAY("CRED_I", cred_i.ptr, cred_i.len);
+	PRINT_ARRAY("pk", pk.ptr, pk.len);
+	PRINT_ARRAY("g_i", g_i.ptr, g_i.len);
 
 	/*derive prk_4x3m*/
 	TRY(prk_derive(rc->static_dh_i, rc->suite, rc->PRK_3e2m,
-		       rc->PRK_3e2m_len, g_i, g_i_len, c->y.ptr, c->y.len,
-		       prk_4x3m));
+		       rc->PRK_3e2m_len, g_i.ptr, g_i.len, rc->eph.sk,
+		       rc->eph.sk_len, rc->ecc, prk_4x3m));
 	PRINT_ARRAY("prk_4x3m", prk_4x3m, prk_4x3m_len);
-
-	TRY(signature_or_mac(VERIFY, rc->static_dh_i, &rc->suite, NULL, 0, pk,
-			     pk_len, prk_4x3m, prk_4x3m_len, rc->th3,
-			     rc->th3_len, id_cred_i, id_cred_i_len, cred_i,
-			     cred_i_len, ead_3, *(uint32_t *)ead_3_len, "MAC_3",
+	TRY(hmac_key_destroy(&rc->prk_4x3m_key));
+	TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_4x3m_key, prk_4x3m,
+			  prk_4x3m_len));
+
+	TRY(signature_or_mac(VERIFY, rc->static_dh_i, &rc->suite, NULL, 0,
+			     NULL, pk.ptr, pk.len, pk_key, rc->ecc,
+			     &rc->prk_4x3m_key,
+			     rc->th3, rc->th3_len, id_cred_i, id_cred_i_len,
+			     cred_i.ptr, cred_i.len, ead_3,
+			     *(uint32_t *)ead_3_len, "MAC_3",
 			     sign_or_mac, &sign_or_mac_len));
 
 	/*TH4*/
@@ -342,9 +367,13 @@ enum err msg4_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 	uint8_t ciphertext_4[CIPHERTEXT4_DEFAULT_SIZE];
 	uint32_t ciphertext_4_len = sizeof(ciphertext_4);
 
+	if (!rc->prk_4x3m_key.initialized) {
+		TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_4x3m_key,
+				  prk_4x3m, prk_4x3m_len));
+	}
 	TRY(ciphertext_gen(CIPHERTEXT4, &rc->suite, NULL, 0, NULL, 0,
-			   c->ead_4.ptr, c->ead_4.len, prk_4x3m, prk_4x3m_len,
-			   th4, th4_len, ciphertext_4, &ciphertext_4_len));
+			   c->ead_4.ptr, c->ead_4.len, &rc->prk_4x3m_key, th4,
+			   th4_len, ciphertext_4, &ciphertext_4_len));
 
 	TRY(encode_byte_string(ciphertext_4, ciphertext_4_len, rc->msg4,
 			       &rc->msg4_len));
@@ -353,6 +382,212 @@ enum err msg4_gen(struct edhoc_responder_context *c, struct runtime_context *rc,
 	return ok;
 }
 
+void edhoc_responder_session_init(struct edhoc_responder_session *s)
+{
+	s->state = RESPONDER_WAIT_MSG1;
+#ifdef EDHOC_ECC_RESTARTABLE
+	s->sliced.enabled = false;
+	s->sliced.in_progress = false;
+	ecc_restart_init(&s->sliced.ecc);
+#endif
+}
+
+#ifdef EDHOC_ECC_RESTARTABLE
+void edhoc_responder_session_init_sliced(struct edhoc_responder_session *s)
+{
+	edhoc_responder_session_init(s);
+	s->sliced.enabled = true;
+}
+#endif
+
+enum err edhoc_responder_session_deinit(struct edhoc_responder_session *s)
+{
+	memset(s->prk_3e2m, 0, sizeof(s->prk_3e2m));
+	memset(s->y, 0, sizeof(s->y));
+#ifdef EDHOC_ECC_RESTARTABLE
+	ecc_restart_free(&s->sliced.ecc);
+	s->sliced.in_progress = false;
+	memset(&s->eph, 0, sizeof(s->eph));
+#endif
+	return ok;
+}
+
+/**
+ * @brief   Processes the received message of the current state of a 
+ *          session, see edhoc_responder_step()
+ * @param   rc an initialized runtime context used for the processing of 
+ *          the message
+ */
+static enum err responder_step(struct edhoc_responder_context *c,
+			       struct edhoc_responder_session *s,
+			       struct runtime_context *rc,
+			       struct other_party_cred *cred_i_array,
+			       uint16_t num_cred_i, const uint8_t *msg_in,
+			       uint32_t msg_in_len, uint8_t *msg_out,
+			       uint32_t *msg_out_len, uint8_t *ead,
+			       uint32_t *ead_len, uint8_t *prk_4x3m,
+			       uint32_t prk_4x3m_len, uint8_t *th4,
+			       uint32_t th4_len)
+{
+	switch (s->state) {
+	case RESPONDER_WAIT_MSG1:
+#ifdef EDHOC_ECC_RESTARTABLE
+		if (s->sliced.in_progress) {
+			rc->eph = s->eph;
+			rc->eph_set = true;
+		}
+#endif
+		TRY(_memcpy_s(rc->msg1, sizeof(rc->msg1), msg_in, msg_in_len));
+		rc->msg1_len = msg_in_len;
+		TRY(msg2_gen(c, rc, ead, ead_len));
+		TRY(_memcpy_s(msg_out, *msg_out_len, rc->msg2, rc->msg2_len));
+		*msg_out_len = rc->msg2_len;
+
+		/*keep what message 3 needs*/
+		s->suite = rc->suite;
+		s->static_dh_i = rc->static_dh_i;
+		memcpy(s->th3, rc->th3, sizeof(s->th3));
+		memcpy(s->prk_3e2m, rc->PRK_3e2m, sizeof(s->prk_3e2m));
+		memcpy(s->y, rc->eph.sk, sizeof(s->y));
+		s->y_len = rc->eph.sk_len;
+		memcpy(s->c_i, rc->c_i, rc->c_i_len);
+		s->c_i_len = rc->c_i_len;
+		s->state = RESPONDER_WAIT_MSG3;
+		return ok;
+
+	case RESPONDER_WAIT_MSG3:
+		rc->suite = s->suite;
+		rc->static_dh_i = s->static_dh_i;
+		memcpy(rc->th3, s->th3, sizeof(s->th3));
+		memcpy(rc->PRK_3e2m, s->prk_3e2m, sizeof(s->prk_3e2m));
+		memcpy(rc->eph.sk, s->y, sizeof(s->y));
+		rc->eph.sk_len = s->y_len;
+		TRY(hmac_key_init(rc->suite.edhoc_hash, &rc->prk_3e2m_key,
+				  rc->PRK_3e2m, rc->PRK_3e2m_len));
+
+		TRY(_memcpy_s(rc->msg3, sizeof(rc->msg3), msg_in, msg_in_len));
+		rc->msg3_len = msg_in_len;
+		TRY(msg3_process(c, rc, cred_i_array, num_cred_i, ead, ead_len,
+				 prk_4x3m, prk_4x3m_len, th4));
+		if (c->msg4) {
+			TRY(msg4_gen(c, rc, prk_4x3m, prk_4x3m_len, th4,
+				     th4_len));
+			TRY(_memcpy_s(msg_out, *msg_out_len, rc->msg4,
+				      rc->msg4_len));
+			*msg_out_len = rc->msg4_len;
+		} else {
+			*msg_out_len = 0;
+		}
+		s->state = RESPONDER_DONE;
+		return ok;
+
+	default:
+		return wrong_parameter;
+	}
+}
+
+enum err edhoc_responder_step(struct edhoc_responder_context *c,
+			      struct edhoc_responder_session *s,
+			      struct other_party_cred *cred_i_array,
+			      uint16_t num_cred_i, const uint8_t *msg_in,
+			      uint32_t msg_in_len, uint8_t *msg_out,
+			      uint32_t *msg_out_len, uint8_t *ead,
+			      uint32_t *ead_len, uint8_t *prk_4x3m,
+			      uint32_t prk_4x3m_len, uint8_t *th4,
+			      uint32_t th4_len)
+{
+	/*a retransmission of a message processed before is answered with 
+	the reply kept in the cache*/
+	uint8_t received_hash[SHA_DEFAULT_SIZE];
+	if (c->reply_cache != NULL) {
+		TRY(hash(SHA_256, msg_in, msg_in_len, received_hash));
+	}
+	if (c->reply_cache != NULL && (s->state == RESPONDER_WAIT_MSG3 ||
+				       s->state == RESPONDER_DONE)) {
+		bool found;
+		uint32_t reply_len = *msg_out_len;
+		TRY(reply_cache_get(c->reply_cache, received_hash, &c->c_r,
+				    NULL, msg_out, &reply_len, &found));
+		if (found) {
+			*msg_out_len = reply_len;
+			return message_retransmitted;
+		}
+	}
+
+	struct runtime_context rc;
+	runtime_context_init(&rc);
+#ifdef EDHOC_ECC_RESTARTABLE
+	TRY(sliced_step_begin(&s->sliced, &rc, msg_in, msg_in_len));
+#endif
+
+	enum err r = responder_step(c, s, &rc, cred_i_array, num_cred_i,
+				    msg_in, msg_in_len, msg_out, msg_out_len,
+				    ead, ead_len, prk_4x3m, prk_4x3m_len, th4,
+				    th4_len);
+#ifdef EDHOC_ECC_RESTARTABLE
+	/*message 2 in progress is finished with the same ephemeral key*/
+	if (r == ecc_operation_in_progress &&
+	    s->state == RESPONDER_WAIT_MSG1) {
+		s->eph = rc.eph;
+	} else {
+		memset(&s->eph, 0, sizeof(s->eph));
+	}
+#endif
+	enum err r_deinit = runtime_context_deinit(&rc);
+	memset(rc.PRK_3e2m, 0, sizeof(rc.PRK_3e2m));
+	if (r == ok) {
+		r = r_deinit;
+	}
+#ifdef EDHOC_ECC_RESTARTABLE
+	sliced_step_end(&s->sliced, r);
+	if (s->sliced.in_progress) {
+		return r;
+	}
+#endif
+	if (r == ok && c->reply_cache != NULL) {
+		reply_cache_put(c->reply_cache, received_hash, &c->c_r, msg_out,
+				*msg_out_len);
+	}
+
+	/*the protocol must be discontinued after an error*/
+	if (r != ok && s->state != RESPONDER_DONE) {
+		s->state = RESPONDER_FAILED;
+	}
+	if (s->state != RESPONDER_WAIT_MSG3) {
+		TRY(edhoc_responder_session_deinit(s));
+	}
+	return r;
+}
+
+/**
+ * @brief   Runs the handshake of edhoc_responder_run() in the runtime 
+ *          context rc
+ */
+static enum err responder_run(
+	struct edhoc_responder_context *c, struct runtime_context *rc,
+	struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+	uint8_t *ead_1, uint32_t *ead_1_len, uint8_t *ead_3,
+	uint32_t *ead_3_len, uint8_t *prk_4x3m, uint32_t prk_4x3m_len,
+	uint8_t *th4, uint32_t th4_len,
+	enum err (*tx)(void *sock, uint8_t *data, uint32_t data_len),
+	enum err (*rx)(void *sock, uint8_t *data, uint32_t *data_len))
+{
+	PRINT_MSG("waiting to receive message 1...\n");
+	TRY(rx(c->sock, rc->msg1, &rc->msg1_len));
+	TRY(msg2_gen(c, rc, ead_1, ead_1_len));
+	TRY(tx(c->sock, rc->msg2, rc->msg2_len));
+
+	PRINT_MSG("waiting to receive message 3...\n");
+	TRY(rx(c->sock, rc->msg3, &rc->msg3_len));
+	TRY(msg3_process(c, rc, cred_i_array, num_cred_i, ead_3, ead_3_len,
+			 prk_4x3m, prk_4x3m_len, th4));
+	if (c->msg4) {
+		TRY(msg4_gen(c, rc, prk_4x3m, prk_4x3m_len, th4, th4_len));
+		TRY(tx(c->sock, rc->msg4, rc->msg4_len));
+	}
+	return ok;
+}
+
 enum err edhoc_responder_run(
 	struct edhoc_responder_context *c,
 	struct other_party_cred *cred_i_array, uint16_t num_cred_i,
@@ -366,19 +601,13 @@ enum err edhoc_responder_run(
 	struct runtime_context rc = { 0 };
 	runtime_context_init(&rc);
 
-	PRINT_MSG("waiting to receive message 1...\n");
-	TRY(rx(c->sock, rc.msg1, &rc.msg1_len));
-	TRY(msg2_gen(c, &rc, ead_1, ead_1_len));
-	TRY(tx(c->sock, rc.msg2, rc.msg2_len));
-
-	PRINT_MSG("waiting to receive message 3...\n");
-	TRY(rx(c->sock, rc.msg3, &rc.msg3_len));
-	TRY(msg3_process(c, &rc, cred_i_array, num_cred_i, ead_3, ead_3_len,
-			 prk_4x3m, prk_4x3m_len, th4));
-	if (c->msg4) {
-		TRY(msg4_gen(c, &rc, prk_4x3m, prk_4x3m_len, th4, th4_len));
-		TRY(tx(c->sock, rc.msg4, rc.msg4_len));
+	/*the ephemeral key is zeroized also if the handshake fails*/
+	enum err r = responder_run(c, &rc, cred_i_array, num_cred_i, ead_1,
+				   ead_1_len, ead_3, ead_3_len, prk_4x3m,
+				   prk_4x3m_len, th4, th4_len, tx, rx);
+	enum err r_deinit = runtime_context_deinit(&rc);
+	if (r == ok) {
+		r = r_deinit;
 	}
-
-	return ok;
+	return r;
 }
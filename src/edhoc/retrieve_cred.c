@@ -25,130 +25,149 @@
 #include "cbor/edhoc_decode_id_cred_x.h"
 
 /**
- * @brief 	This function verifies a certificate and copies it to the cred 
+ * @brief 	This function verifies a certificate and encodes it into the cred 
  * 		buffer. It also extracts the public key contained in the 
- * 		certificate. 
+ * 		certificate. Certificates found in the cache are not verified 
+ * 		again.
  * 
  * @param static_dh_auth type of the key contained in the certificate -- 
  * 			signature key or static DH key.
+ * @param store credential store, if NULL cred_array is used
+ * @param cache cache of verified certificates, may be NULL
  * @param cred_array array containing credentials
  * @param cred_num number of credentials
  * @param label map label of id_cred_x
  * @param cert the certificate
  * @param cert_len length of the certificate
  * @param cred cred buffer
- * @param cred_len length of cred
  * @param pk public key buffer
- * @param pk_len length of pk
  * @param g static DH public key buffer
- * @param g_len length of g
  * @return enum err 
  */
 static inline enum err
-verify_cert2cred(bool static_dh_auth, struct other_party_cred *cred_array,
-		 uint16_t cred_num, enum id_cred_x_label label,
-		 const uint8_t *cert, uint32_t cert_len, uint8_t *cred,
-		 uint32_t *cred_len, uint8_t *pk, uint32_t *pk_len, uint8_t *g,
-		 uint32_t *g_len)
+verify_cert2cred(bool static_dh_auth, const struct edhoc_cred_store *store,
+		 struct edhoc_cert_cache *cache,
+		 struct other_party_cred *cred_array, uint16_t cred_num,
+		 enum id_cred_x_label label, const uint8_t *cert,
+		 uint32_t cert_len, struct byte_array *cred,
+		 struct byte_array *pk, struct byte_array *g)
 {
 	PRINT_ARRAY("ID_CRED_x contains a certificate", cert, cert_len);
-	TRY(encode_byte_string(cert, cert_len, cred, cred_len));
+	TRY(encode_byte_string(cert, cert_len, cred->ptr, &cred->len));
+
+	/*the key contained in the certificate*/
+	struct byte_array *key;
+	if (static_dh_auth) {
+		pk->len = 0;
+		key = g;
+	} else {
+		g->len = 0;
+		key = pk;
+	}
+
+	uint8_t cert_hash[32];
+	if (cache != NULL) {
+		bool found = false;
+		TRY(hash(SHA_256, cert, cert_len, cert_hash));
+		TRY(cert_cache_get(cache, cert_hash, key->ptr, &key->len,
+				   &found));
+		if (found) {
+			PRINT_MSG("Certificate verified before\n");
+			return ok;
+		}
+	}
 
 	bool verified = false;
+	uint64_t not_after = 0;
 	switch (label) {
 	/* for now we transfer a single certificate, therefore bag and chain are the same */
 	case x5bag:
 	case x5chain:
-		if (static_dh_auth) {
-			*pk_len = 0;
-			TRY(cert_x509_verify(cert, cert_len, cred_array,
-					     cred_num, g, g_len, &verified));
-		} else {
-			*g_len = 0;
-			TRY(cert_x509_verify(cert, cert_len, cred_array,
-					     cred_num, pk, pk_len, &verified));
-		}
+		TRY(cert_x509_verify(cert, cert_len, store, cred_array,
+				     cred_num, key->ptr, &key->len, &not_after,
+				     &verified));
 		break;
 	case c5b:
 	case c5c:
-		if (static_dh_auth) {
-			*pk_len = 0;
-			TRY(cert_c509_verify(cert, cert_len, cred_array,
-					     cred_num, g, g_len, &verified));
-		} else {
-			*g_len = 0;
-			TRY(cert_c509_verify(cert, cert_len, cred_array,
-					     cred_num, pk, pk_len, &verified));
-		}
-		break;
+		TRY(cert_c509_verify(cert, cert_len, store, cred_array,
+				     cred_num, key->ptr, &key->len, &not_after,
+				     &verified));
 		break;
 
 	default:
 		break;
 	}
 
-	if (verified) {
-		PRINT_MSG("Certificate verification successful!\n");
-		return ok;
-	} else {
+	if (!verified) {
 		return certificate_authentication_failed;
 	}
+	PRINT_MSG("Certificate verification successful!\n");
+
+	if (cache != NULL) {
+		if (cert_expired(cache, not_after)) {
+			return certificate_expired;
+		}
+		TRY(cert_cache_put(cache, cert_hash, key->ptr, key->len,
+				   not_after));
+	}
+	return ok;
 }
 
 static enum err get_local_cred(bool static_dh_auth,
+			       const struct edhoc_cred_store *store,
 			       struct other_party_cred *cred_array,
 			       uint16_t cred_num, uint8_t *id_cred,
-			       uint32_t id_cred_len, uint8_t *cred,
-			       uint32_t *cred_len, uint8_t *pk,
-			       uint32_t *pk_len, uint8_t *g, uint32_t *g_len)
+			       uint32_t id_cred_len, struct byte_array *cred,
+			       struct byte_array *pk,
+			       const struct verify_key **pk_key,
+			       struct byte_array *g)
 {
-	for (uint16_t i = 0; i < cred_num; i++) {
-		if ((cred_array[i].id_cred.len == id_cred_len) &&
-		    (0 ==
-		     memcmp(cred_array[i].id_cred.ptr, id_cred, id_cred_len))) {
-			/*retrieve CRED_x*/
-			TRY(_memcpy_s(cred, *cred_len, cred_array[i].cred.ptr,
-				      cred_array[i].cred.len));
-			*cred_len = cred_array[i].cred.len;
-
-			/*retrieve PK*/
-			if (static_dh_auth) {
-				*pk_len = 0;
-				if (cred_array[i].g.len == 65) {
-					/*decompressed P256 DH pk*/
-					g[0] = 0x2;
-					TRY(_memcpy_s(&g[1], *g_len - 1,
-						      &cred_array[i].g.ptr[1],
-						      32));
-					*g_len = 33;
-
-				} else {
-					TRY(_memcpy_s(g, *g_len,
-						      cred_array[i].g.ptr,
-						      cred_array[i].g.len));
-					*g_len = cred_array[i].g.len;
-				}
-
-			} else {
-				*g_len = 0;
-				TRY(_memcpy_s(pk, *pk_len, cred_array[i].pk.ptr,
-					      cred_array[i].pk.len));
-				*pk_len = cred_array[i].pk.len;
+	const struct other_party_cred *e = NULL;
+
+	if (store != NULL) {
+		TRY(edhoc_cred_store_id_cred_get(store, id_cred, id_cred_len,
+						 &e));
+	} else {
+		for (uint16_t i = 0; i < cred_num; i++) {
+			if ((cred_array[i].id_cred.len == id_cred_len) &&
+			    (0 == memcmp(cred_array[i].id_cred.ptr, id_cred,
+					 id_cred_len))) {
+				e = &cred_array[i];
+				break;
 			}
-			return ok;
+		}
+		if (e == NULL) {
+			return credential_not_found;
 		}
 	}
 
-	return credential_not_found;
+	/*retrieve CRED_x*/
+	*cred = e->cred;
+
+	/*retrieve PK, uncompressed P256 keys are passed on as they are so 
+	that the ECDH needs no decompression*/
+	if (static_dh_auth) {
+		pk->len = 0;
+		*g = e->g;
+	} else {
+		g->len = 0;
+		*pk = e->pk;
+		*pk_key = e->pk_key;
+	}
+	return ok;
 }
 
-enum err retrieve_cred(bool static_dh_auth, struct other_party_cred *cred_array,
-		       uint16_t cred_num, uint8_t *id_cred,
-		       uint32_t id_cred_len, uint8_t *cred, uint32_t *cred_len,
-		       uint8_t *pk, uint32_t *pk_len, uint8_t *g,
-		       uint32_t *g_len)
+enum err retrieve_cred(bool static_dh_auth,
+		       const struct edhoc_cred_store *store,
+		       struct edhoc_cert_cache *cache,
+		       struct other_party_cred *cred_array, uint16_t cred_num,
+		       uint8_t *id_cred, uint32_t id_cred_len,
+		       struct byte_array *cred, struct byte_array *pk,
+		       const struct verify_key **pk_key, struct byte_array *g)
 {
 	size_t decode_len = 0;
+
+	*pk_key = NULL;
 	struct id_cred_x_map map;
 
 	TRY_EXPECT(cbor_decode_id_cred_x_map(id_cred, id_cred_len, &map,
@@ -161,45 +180,48 @@ enum err retrieve_cred(bool static_dh_auth, struct other_party_cred *cred_array,
 	    (map._id_cred_x_map_x5t_present != 0) ||
 	    (map._id_cred_x_map_c5u_present != 0) ||
 	    (map._id_cred_x_map_c5t_present != 0)) {
-		TRY(get_local_cred(static_dh_auth, cred_array, cred_num,
-				   id_cred, id_cred_len, cred, cred_len, pk,
-				   pk_len, g, g_len));
+		TRY(get_local_cred(static_dh_auth, store, cred_array, cred_num,
+				   id_cred, id_cred_len, cred, pk, pk_key, g));
 		return ok;
 	}
 	/*x5chain*/
 	else if (map._id_cred_x_map_x5chain_present != 0) {
 		TRY(verify_cert2cred(
-			static_dh_auth, cred_array, cred_num, x5chain,
+			static_dh_auth, store, cache, cred_array, cred_num,
+			x5chain,
 			map._id_cred_x_map_x5chain._id_cred_x_map_x5chain.value,
 			(uint32_t) map._id_cred_x_map_x5chain._id_cred_x_map_x5chain.len,
-			cred, cred_len, pk, pk_len, g, g_len));
+			cred, pk, g));
 		return ok;
 	}
 	/*x5bag*/
 	else if (map._id_cred_x_map_x5bag_present != 0) {
 		TRY(verify_cert2cred(
-			static_dh_auth, cred_array, cred_num, x5bag,
+			static_dh_auth, store, cache, cred_array, cred_num,
+			x5bag,
 			map._id_cred_x_map_x5bag._id_cred_x_map_x5bag.value,
-			(uint32_t) map._id_cred_x_map_x5bag._id_cred_x_map_x5bag.len, cred,
-			cred_len, pk, pk_len, g, g_len));
+			(uint32_t) map._id_cred_x_map_x5bag._id_cred_x_map_x5bag.len,
+			cred, pk, g));
 		return ok;
 	}
 	/*c5c*/
 	else if (map._id_cred_x_map_c5c_present != 0) {
 		TRY(verify_cert2cred(
-			static_dh_auth, cred_array, cred_num, c5c,
+			static_dh_auth, store, cache, cred_array, cred_num,
+			c5c,
 			map._id_cred_x_map_c5c._id_cred_x_map_c5c.value,
-			(uint32_t) map._id_cred_x_map_c5c._id_cred_x_map_c5c.len, cred,
-			cred_len, pk, pk_len, g, g_len));
+			(uint32_t) map._id_cred_x_map_c5c._id_cred_x_map_c5c.len,
+			cred, pk, g));
 		return ok;
 	}
 	/*c5b*/
 	else if (map._id_cred_x_map_c5b_present != 0) {
 		TRY(verify_cert2cred(
-			static_dh_auth, cred_array, cred_num, c5b,
+			static_dh_auth, store, cache, cred_array, cred_num,
+			c5b,
 			map._id_cred_x_map_c5b._id_cred_x_map_c5b.value,
-			(uint32_t) map._id_cred_x_map_c5b._id_cred_x_map_c5b.len, cred,
-			cred_len, pk, pk_len, g, g_len));
+			(uint32_t) map._id_cred_x_map_c5b._id_cred_x_map_c5b.len,
+			cred, pk, g));
 		return ok;
 	}
 
@@ -23,4 +23,46 @@ void runtime_context_init(struct runtime_context *c)
 	c->msg4_len = sizeof(c->msg4);
 	c->th3_len = sizeof(c->th3);
 	c->PRK_3e2m_len = sizeof(c->PRK_3e2m);
+	c->prk_3e2m_key.initialized = false;
+	c->prk_4x3m_key.initialized = false;
+	c->ecc = NULL;
+	c->eph_set = false;
 }
+
+enum err runtime_context_deinit(struct runtime_context *c)
+{
+	memset(&c->eph, 0, sizeof(c->eph));
+	TRY(hmac_key_destroy(&c->prk_3e2m_key));
+	return hmac_key_destroy(&c->prk_4x3m_key);
+}
+
+#ifdef EDHOC_ECC_RESTARTABLE
+enum err sliced_step_begin(struct edhoc_sliced *sl, struct runtime_context *rc,
+			   const uint8_t *msg, uint32_t msg_len)
+{
+	if (!sl->enabled) {
+		return ok;
+	}
+
+	/*the operations in progress belong to one message*/
+	uint8_t msg_hash[SHA_DEFAULT_SIZE];
+	TRY(hash(SHA_256, msg, msg_len, msg_hash));
+	if (sl->in_progress &&
+	    0 != memcmp(sl->msg_hash, msg_hash, sizeof(msg_hash))) {
+		return wrong_parameter;
+	}
+	memcpy(sl->msg_hash, msg_hash, sizeof(msg_hash));
+
+	ecc_restart_rewind(&sl->ecc);
+	rc->ecc = &sl->ecc;
+	return ok;
+}
+
+void sliced_step_end(struct edhoc_sliced *sl, enum err r)
+{
+	sl->in_progress = (r == ecc_operation_in_progress);
+	if (!sl->in_progress) {
+		ecc_restart_free(&sl->ecc);
+	}
+}
+#endif
@@ -0,0 +1,161 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edhoc.h"
+#include "edhoc_internal.h"
+
+#include "edhoc/c_x.h"
+#include "edhoc/reply_cache.h"
+#include "edhoc/runtime_context.h"
+
+#include "common/oscore_edhoc_error.h"
+
+enum err edhoc_session_table_init(struct edhoc_session_table *t,
+				  struct edhoc_responder_session *sessions,
+				  uint32_t sessions_cnt)
+{
+	if (sessions == NULL || sessions_cnt == 0 ||
+	    sessions_cnt > (uint32_t)INT32_MAX) {
+		return wrong_parameter;
+	}
+	t->sessions = sessions;
+	t->sessions_cnt = sessions_cnt;
+	t->next = 0;
+	for (uint32_t i = 0; i < sessions_cnt; i++) {
+		edhoc_responder_session_init(&sessions[i]);
+	}
+	return ok;
+}
+
+/**
+ * @brief   Returns the session waiting for message 3 with a given C_R
+ * @retval  the session or NULL
+ */
+static struct edhoc_responder_session *
+pending_session(struct edhoc_session_table *t, int c_r)
+{
+	if (c_r < 0 || (uint32_t)c_r >= t->sessions_cnt) {
+		return NULL;
+	}
+	struct edhoc_responder_session *s = &t->sessions[c_r];
+	if (s->state != RESPONDER_WAIT_MSG3) {
+		return NULL;
+	}
+	return s;
+}
+
+enum err edhoc_session_table_msg1(struct edhoc_responder_context *c,
+				  struct edhoc_session_table *t,
+				  const uint8_t *msg1, uint32_t msg1_len,
+				  uint8_t *msg2, uint32_t *msg2_len,
+				  uint8_t *ead_1, uint32_t *ead_1_len,
+				  int *c_r)
+{
+	/*a retransmitted message 1 is answered from the reply cache as long 
+	as its session waits for message 3*/
+	if (c->reply_cache != NULL) {
+		uint8_t msg1_hash[SHA_DEFAULT_SIZE];
+		TRY(hash(SHA_256, msg1, msg1_len, msg1_hash));
+		struct c_x c_r_found;
+		uint8_t c_r_found_buf[C_I_DEFAULT_SIZE];
+		bool found;
+		uint32_t len = *msg2_len;
+		c_x_init(&c_r_found, c_r_found_buf, sizeof(c_r_found_buf));
+		TRY(reply_cache_get(c->reply_cache, msg1_hash, NULL, &c_r_found,
+				    msg2, &len, &found));
+		if (found && c_r_found.type == INT &&
+		    pending_session(t, c_r_found.mem.c_x_int) != NULL) {
+			*msg2_len = len;
+			*c_r = c_r_found.mem.c_x_int;
+			return message_retransmitted;
+		}
+	}
+
+	/*find a free session, round robin*/
+	uint32_t i;
+	uint32_t n;
+	for (n = 0; n < t->sessions_cnt; n++) {
+		i = (t->next + n) % t->sessions_cnt;
+		if (t->sessions[i].state != RESPONDER_WAIT_MSG3) {
+			break;
+		}
+	}
+	if (n == t->sessions_cnt) {
+		return session_table_full;
+	}
+	t->next = (i + 1) % t->sessions_cnt;
+
+	/*the responder context is shared by all sessions, only the copy 
+	used for this session gets the C_R*/
+	struct edhoc_responder_context session_c = *c;
+	TRY(c_x_set(INT, NULL, 0, (int)i, &session_c.c_r));
+
+	struct edhoc_responder_session *s = &t->sessions[i];
+	edhoc_responder_session_init(s);
+	TRY(edhoc_responder_step(&session_c, s, NULL, 0, msg1, msg1_len, msg2,
+				 msg2_len, ead_1, ead_1_len, NULL, 0, NULL, 0));
+	*c_r = (int)i;
+	return ok;
+}
+
+enum err edhoc_session_table_msg3(struct edhoc_responder_context *c,
+				  struct edhoc_session_table *t, int c_r,
+				  struct other_party_cred *cred_i_array,
+				  uint16_t num_cred_i, const uint8_t *msg3,
+				  uint32_t msg3_len, uint8_t *msg4,
+				  uint32_t *msg4_len, uint8_t *ead_3,
+				  uint32_t *ead_3_len, uint8_t *prk_4x3m,
+				  uint32_t prk_4x3m_len, uint8_t *th4,
+				  uint32_t th4_len)
+{
+	struct edhoc_responder_context session_c = *c;
+	TRY(c_x_set(INT, NULL, 0, c_r, &session_c.c_r));
+
+	struct edhoc_responder_session *s = pending_session(t, c_r);
+	if (s == NULL) {
+		/*a retransmitted message 3 is answered from the reply cache, 
+		also after the session was reused*/
+		if (c->reply_cache != NULL) {
+			uint8_t msg3_hash[SHA_DEFAULT_SIZE];
+			TRY(hash(SHA_256, msg3, msg3_len, msg3_hash));
+			bool found;
+			uint32_t len = *msg4_len;
+			TRY(reply_cache_get(c->reply_cache, msg3_hash,
+					    &session_c.c_r, NULL, msg4, &len,
+					    &found));
+			if (found) {
+				*msg4_len = len;
+				return message_retransmitted;
+			}
+		}
+		return session_not_found;
+	}
+
+	/*the session is in the state RESPONDER_DONE or RESPONDER_FAILED 
+	afterwards, i.e., it is free*/
+	return edhoc_responder_step(&session_c, s, cred_i_array, num_cred_i,
+				    msg3, msg3_len, msg4, msg4_len, ead_3,
+				    ead_3_len, prk_4x3m, prk_4x3m_len, th4,
+				    th4_len);
+}
+
+enum err edhoc_session_table_release(struct edhoc_session_table *t, int c_r)
+{
+	struct edhoc_responder_session *s = pending_session(t, c_r);
+	if (s == NULL) {
+		return session_not_found;
+	}
+	s->state = RESPONDER_FAILED;
+	return edhoc_responder_session_deinit(s);
+}
@@ -10,21 +10,20 @@
 */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "edhoc.h"
 #include "edhoc/edhoc_cose.h"
-#include "edhoc/hkdf_info.h"
 #include "edhoc/okm.h"
 #include "edhoc/suites.h"
 #include "edhoc/signature_or_mac_msg.h"
 
+#include "common/cbor_head.h"
 #include "common/print_util.h"
 #include "common/crypto_wrapper.h"
 #include "common/oscore_edhoc_error.h"
 #include "common/memcpy_s.h"
 
-#include "cbor/edhoc_encode_enc_structure.h"
-#include "cbor/edhoc_encode_sig_structure.h"
 #include "cbor/edhoc_encode_bstr_type.h"
 #include "cbor/edhoc_decode_bstr_type.h"
 
@@ -57,25 +56,23 @@ enum err decode_byte_string(const uint8_t *in, const uint32_t in_len,
 	return ok;
 }
 
-enum err mac(const uint8_t *prk, uint32_t prk_len, const uint8_t *th,
-	     uint32_t th_len, const uint8_t *id_cred, uint32_t id_cred_len,
-	     const uint8_t *cred, uint32_t cred_len, const uint8_t *ead,
-	     uint32_t ead_len, const char *mac_label, bool static_dh,
-	     struct suite *suite, uint8_t *mac, uint32_t *mac_len)
+enum err mac(struct hmac_key *prk, const uint8_t *th, uint32_t th_len,
+	     const uint8_t *id_cred, uint32_t id_cred_len, const uint8_t *cred,
+	     uint32_t cred_len, const uint8_t *ead, uint32_t ead_len,
+	     const char *mac_label, bool static_dh, struct suite *suite,
+	     uint8_t *mac, uint32_t *mac_len)
 {
-	uint32_t context_mac_len = id_cred_len + cred_len + ead_len;
-	TRY(check_buffer_size(CONTEXT_MAC_DEFAULT_SIZE, context_mac_len));
-	uint8_t context_mac[CONTEXT_MAC_DEFAULT_SIZE];
-	TRY(_memcpy_s(context_mac, context_mac_len, id_cred, id_cred_len));
-
-	TRY(_memcpy_s((context_mac + id_cred_len),
-		      (context_mac_len - id_cred_len), cred, cred_len));
-
-	TRY(_memcpy_s((context_mac + id_cred_len + cred_len),
-		      (context_mac_len - id_cred_len - cred_len), ead,
-		      ead_len));
-
-	PRINT_ARRAY("MAC context", context_mac, context_mac_len);
+	/*context_mac = ID_CRED || CRED || EAD, it is fed into the HMAC 
+	segment by segment*/
+	struct const_byte_array context_mac[] = {
+		{ .len = id_cred_len, .ptr = id_cred },
+		{ .len = cred_len, .ptr = cred },
+		{ .len = ead_len, .ptr = ead },
+	};
+
+	PRINT_ARRAY("MAC context: ID_CRED", id_cred, id_cred_len);
+	PRINT_ARRAY("MAC context: CRED", cred, cred_len);
+	PRINT_ARRAY("MAC context: EAD", ead, ead_len);
 
 	if (static_dh) {
 		*mac_len = suite->edhoc_mac_len_static_dh;
@@ -84,13 +81,19 @@ enum err mac(const uint8_t *prk, uint32_t prk_len, const uint8_t *th,
 		*mac_len = get_hash_len(suite->edhoc_hash);
 	}
 
-	TRY(okm_calc(suite->edhoc_hash, prk, prk_len, th, th_len, mac_label,
-		     context_mac, context_mac_len, mac, *mac_len));
+	TRY(okm_calc_prepared_segments(
+		prk, th, th_len, mac_label, context_mac,
+		sizeof(context_mac) / sizeof(context_mac[0]), mac, *mac_len));
 
 	PRINT_ARRAY("MAC 2/3", mac, *mac_len);
 	return ok;
 }
 
+/**
+ * @brief   Encodes the COSE Sig_structure 
+ *          ["Signature1", ID_CRED, << TH, CRED, ? EAD >>, MAC] directly into 
+ *          out, without assembling external_aad in an intermediate buffer
+ */
 static enum err signature_struct_gen(const uint8_t *th, uint32_t th_len,
 				     const uint8_t *id_cred,
 				     uint32_t id_cred_len, const uint8_t *cred,
@@ -99,45 +102,50 @@ static enum err signature_struct_gen(const uint8_t *th, uint32_t th_len,
 				     uint32_t mac_len, uint8_t *out,
 				     uint32_t *out_len)
 {
-	uint8_t th_enc[SHA_DEFAULT_SIZE + 2];
-	uint32_t th_enc_len = sizeof(th_enc);
-
-	TRY(encode_byte_string(th, th_len, th_enc, &th_enc_len));
-
-	uint32_t tmp_len = th_enc_len + cred_len + ead_len;
-
-	TRY(check_buffer_size(CRED_DEFAULT_SIZE + SHA_DEFAULT_SIZE +
-				      AD_DEFAULT_SIZE,
-			      tmp_len));
-	uint8_t tmp[CRED_DEFAULT_SIZE + SHA_DEFAULT_SIZE + AD_DEFAULT_SIZE];
-
-	memcpy(tmp, th_enc, th_enc_len);
-	memcpy(tmp + th_enc_len, cred, cred_len);
-	if (ead_len != 0) {
-		memcpy(tmp + th_enc_len + cred_len, ead, ead_len);
-	}
-
-	uint8_t context_str[] = { "Signature1" };
-	TRY(cose_sig_structure_encode(
-		context_str, (uint32_t)strlen((char *)context_str), id_cred,
-		id_cred_len, tmp, tmp_len, mac, mac_len, out, out_len));
+	const char *context_str = "Signature1";
+	uint32_t context_str_len = (uint32_t)strlen(context_str);
+	uint8_t th_head[CBOR_HEAD_MAX_SIZE];
+	uint32_t th_head_len = sizeof(th_head);
+	uint32_t out_size = *out_len;
+	uint32_t l = 0;
+
+	TRY(cbor_head_encode(CBOR_BSTR, th_len, th_head, &th_head_len));
+	uint32_t external_aad_len = th_head_len + th_len + cred_len + ead_len;
+
+	TRY(cbor_head_append(CBOR_ARRAY, 4, out, out_size, &l));
+	TRY(cbor_head_append(CBOR_TSTR, context_str_len, out, out_size, &l));
+	TRY(cbor_bytes_append((const uint8_t *)context_str, context_str_len,
+			      out, out_size, &l));
+	TRY(cbor_head_append(CBOR_BSTR, id_cred_len, out, out_size, &l));
+	TRY(cbor_bytes_append(id_cred, id_cred_len, out, out_size, &l));
+	TRY(cbor_head_append(CBOR_BSTR, external_aad_len, out, out_size, &l));
+	TRY(cbor_bytes_append(th_head, th_head_len, out, out_size, &l));
+	TRY(cbor_bytes_append(th, th_len, out, out_size, &l));
+	TRY(cbor_bytes_append(cred, cred_len, out, out_size, &l));
+	TRY(cbor_bytes_append(ead, ead_len, out, out_size, &l));
+	TRY(cbor_head_append(CBOR_BSTR, mac_len, out, out_size, &l));
+	TRY(cbor_bytes_append(mac, mac_len, out, out_size, &l));
+
+	*out_len = l;
 	PRINT_ARRAY("COSE_Sign1 object to be signed", out, *out_len);
 	return ok;
 }
 
 enum err
 signature_or_mac(enum sgn_or_mac_op op, bool static_dh, struct suite *suite,
-		 const uint8_t *sk, uint32_t sk_len, const uint8_t *pk,
-		 uint32_t pk_len, const uint8_t *prk, uint32_t prk_len,
-		 const uint8_t *th, uint32_t th_len, const uint8_t *id_cred,
-		 uint32_t id_cred_len, const uint8_t *cred, uint32_t cred_len,
-		 const uint8_t *ead, uint32_t ead_len, const char *mac_label,
+		 const uint8_t *sk, uint32_t sk_len, struct sign_key *sk_key,
+		 const uint8_t *pk, uint32_t pk_len,
+		 const struct verify_key *pk_key, struct ecc_restart *rs,
+		 struct hmac_key *prk, const uint8_t *th,
+		 uint32_t th_len, const uint8_t *id_cred, uint32_t id_cred_len,
+		 const uint8_t *cred, uint32_t cred_len, const uint8_t *ead,
+		 uint32_t ead_len, const char *mac_label,
 		 uint8_t *signature_or_mac, uint32_t *signature_or_mac_len)
 {
 	if (op == GENERATE) {
 		/*we always calculate the mac*/
-		TRY(mac(prk, prk_len, th, th_len, id_cred, id_cred_len, cred,
-			cred_len, ead, ead_len, mac_label, static_dh, suite,
+		TRY(mac(prk, th, th_len, id_cred, id_cred_len, cred, cred_len,
+			ead, ead_len, mac_label, static_dh, suite,
 			signature_or_mac, signature_or_mac_len));
 
 		if (static_dh) {
@@ -156,9 +164,10 @@ signature_or_mac(enum sgn_or_mac_op op, bool static_dh, struct suite *suite,
 			*signature_or_mac_len =
 				get_signature_len(suite->edhoc_sign);
 
-			TRY(sign(suite->edhoc_sign, sk, sk_len, pk,
-				 signature_struct, signature_struct_len,
-				 signature_or_mac));
+			TRY(sign_restartable(rs, sk_key, suite->edhoc_sign, sk,
+					     sk_len, pk, signature_struct,
+					     signature_struct_len,
+					     signature_or_mac));
 			PRINT_ARRAY("signature_or_mac (is signature)",
 				    signature_or_mac, *signature_or_mac_len);
 		}
@@ -167,8 +176,8 @@ signature_or_mac(enum sgn_or_mac_op op, bool static_dh, struct suite *suite,
 		TRY(check_buffer_size(SHA_DEFAULT_SIZE, mac_buf_len));
 		uint8_t mac_buf[SHA_DEFAULT_SIZE];
 
-		TRY(mac(prk, prk_len, th, th_len, id_cred, id_cred_len, cred,
-			cred_len, ead, ead_len, mac_label, static_dh, suite,
+		TRY(mac(prk, th, th_len, id_cred, id_cred_len, cred, cred_len,
+			ead, ead_len, mac_label, static_dh, suite,
 			mac_buf, &mac_buf_len));
 
 		if (static_dh) {
@@ -189,10 +198,11 @@ signature_or_mac(enum sgn_or_mac_op op, bool static_dh, struct suite *suite,
 				signature_struct, &signature_struct_len));
 
 			bool result;
-			TRY(verify(suite->edhoc_sign, pk, pk_len,
-				   signature_struct, signature_struct_len,
-				   signature_or_mac, *signature_or_mac_len,
-				   &result));
+			TRY(verify_restartable(rs, pk_key, suite->edhoc_sign,
+					       pk, pk_len, signature_struct,
+					       signature_struct_len,
+					       signature_or_mac,
+					       *signature_or_mac_len, &result));
 			if (!result) {
 				return signature_authentication_failed;
 			}
@@ -0,0 +1,247 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "edhoc.h"
+#include "edhoc_internal.h"
+
+#include "edhoc/runtime_context.h"
+#include "edhoc/suites.h"
+
+#include "common/atomic_ops.h"
+#include "common/crypto_wrapper.h"
+#include "common/oscore_edhoc_error.h"
+
+#define STATE_TOKEN_PLAINTEXT_SIZE                                             \
+	(EDHOC_STATE_TOKEN_SIZE - EDHOC_STATE_TOKEN_HEADER_SIZE - 8)
+
+#define STATE_TOKEN_SALT_MIN_SIZE 16
+
+/**
+ * @brief   Derives a token key from the key of the responder and a fresh 
+ *          salt, see edhoc_state_keys_init()
+ */
+static enum err token_key_derive(struct aead_key *token_key,
+				 const uint8_t *key, uint32_t key_len,
+				 const uint8_t *salt, uint32_t salt_len)
+{
+	static const uint8_t info[] = "EDHOC state token";
+	uint8_t ikm[SHA_DEFAULT_SIZE];
+	uint8_t prk[SHA_DEFAULT_SIZE];
+	uint8_t okm[AEAD_KEY_DEFAULT_SIZE];
+
+	if (key_len > sizeof(ikm) || salt_len < STATE_TOKEN_SALT_MIN_SIZE) {
+		return wrong_parameter;
+	}
+
+	memcpy(ikm, key, key_len);
+	enum err r = hkdf_extract(SHA_256, salt, salt_len, ikm, key_len, prk);
+	if (r == ok) {
+		r = hkdf_expand(SHA_256, prk, sizeof(prk), info,
+				sizeof(info) - 1, okm, sizeof(okm));
+	}
+	if (r == ok) {
+		r = aead_key_init(token_key, okm, sizeof(okm), 8);
+	}
+	memset(ikm, 0, sizeof(ikm));
+	memset(prk, 0, sizeof(prk));
+	memset(okm, 0, sizeof(okm));
+	return r;
+}
+
+enum err edhoc_state_keys_init(struct edhoc_state_keys *k, const uint8_t *key,
+			       uint32_t key_len, const uint8_t *salt,
+			       uint32_t salt_len, uint32_t lifetime)
+{
+	memset(k, 0, sizeof(*k));
+	k->lifetime = lifetime;
+	return token_key_derive(&k->key[0], key, key_len, salt, salt_len);
+}
+
+enum err edhoc_state_keys_rotate(struct edhoc_state_keys *k,
+				 const uint8_t *key, uint32_t key_len,
+				 const uint8_t *salt, uint32_t salt_len)
+{
+	uint8_t next = (uint8_t)(k->current ^ 1);
+
+	TRY(aead_key_destroy(&k->key[next]));
+	TRY(token_key_derive(&k->key[next], key, key_len, salt, salt_len));
+	k->id[next] = (uint8_t)(k->id[k->current] + 1);
+	k->current = next;
+	return ok;
+}
+
+enum err edhoc_state_keys_deinit(struct edhoc_state_keys *k)
+{
+	TRY(aead_key_destroy(&k->key[0]));
+	TRY(aead_key_destroy(&k->key[1]));
+	memset(k, 0, sizeof(*k));
+	return ok;
+}
+
+/**
+ * @brief   Computes the nonce of a token from the counter in its header
+ */
+static void token_nonce(const uint8_t *header,
+			uint8_t nonce[AEAD_IV_DEFAULT_SIZE])
+{
+	memset(nonce, 0, AEAD_IV_DEFAULT_SIZE);
+	memcpy(nonce + AEAD_IV_DEFAULT_SIZE - 8, header + 1, 8);
+}
+
+/**
+ * @brief   Encrypts the state of a session waiting for message 3
+ */
+static enum err session_seal(struct edhoc_state_keys *k, uint32_t now,
+			     const struct edhoc_responder_session *s,
+			     uint8_t *token, uint32_t *token_len)
+{
+	if (*token_len < EDHOC_STATE_TOKEN_SIZE) {
+		return buffer_to_small;
+	}
+
+	uint8_t plaintext[STATE_TOKEN_PLAINTEXT_SIZE];
+	plaintext[0] = (uint8_t)s->suite.suite_label;
+	plaintext[1] = (uint8_t)s->static_dh_i;
+	uint8_t *p = plaintext + 2;
+	memcpy(p, s->th3, sizeof(s->th3));
+	p += sizeof(s->th3);
+	memcpy(p, s->prk_3e2m, sizeof(s->prk_3e2m));
+	p += sizeof(s->prk_3e2m);
+	*p++ = (uint8_t)s->y_len;
+	memcpy(p, s->y, sizeof(s->y));
+
+	/*every token gets its own nonce*/
+	uint64_t counter = fetch_add_u64(&k->counter, 1);
+	token[0] = k->id[k->current];
+	for (uint8_t i = 0; i < 8; i++) {
+		token[1 + i] = (uint8_t)(counter >> (56 - 8 * i));
+	}
+	/*the expiry time is authenticated as part of the header*/
+	uint32_t expiry = now + k->lifetime;
+	for (uint8_t i = 0; i < 4; i++) {
+		token[9 + i] = (uint8_t)(expiry >> (24 - 8 * i));
+	}
+	uint8_t nonce[AEAD_IV_DEFAULT_SIZE];
+	token_nonce(token, nonce);
+
+	uint8_t *ciphertext = token + EDHOC_STATE_TOKEN_HEADER_SIZE;
+	enum err r = aead_prepared(ENCRYPT, plaintext, sizeof(plaintext),
+				   &k->key[k->current], nonce, sizeof(nonce),
+				   token, EDHOC_STATE_TOKEN_HEADER_SIZE,
+				   ciphertext, sizeof(plaintext),
+				   ciphertext + sizeof(plaintext), 8);
+	memset(plaintext, 0, sizeof(plaintext));
+	TRY(r);
+	*token_len = EDHOC_STATE_TOKEN_SIZE;
+	return ok;
+}
+
+/**
+ * @brief   Restores the state of a session waiting for message 3
+ */
+static enum err session_open(struct edhoc_state_keys *k, uint32_t now,
+			     const uint8_t *token, uint32_t token_len,
+			     struct edhoc_responder_session *s)
+{
+	if (token_len != EDHOC_STATE_TOKEN_SIZE) {
+		return state_token_invalid;
+	}
+
+	struct aead_key *key = NULL;
+	for (uint8_t i = 0; i < 2; i++) {
+		if (k->key[i].initialized && k->id[i] == token[0]) {
+			key = &k->key[i];
+		}
+	}
+	if (key == NULL) {
+		return state_token_invalid;
+	}
+
+	uint8_t nonce[AEAD_IV_DEFAULT_SIZE];
+	token_nonce(token, nonce);
+	uint8_t tag[8];
+	memcpy(tag, token + token_len - sizeof(tag), sizeof(tag));
+	uint8_t plaintext[STATE_TOKEN_PLAINTEXT_SIZE];
+	if (aead_prepared(DECRYPT, token + EDHOC_STATE_TOKEN_HEADER_SIZE,
+			  token_len - EDHOC_STATE_TOKEN_HEADER_SIZE, key, nonce,
+			  sizeof(nonce), token, EDHOC_STATE_TOKEN_HEADER_SIZE,
+			  plaintext, sizeof(plaintext),
+			  tag, sizeof(tag)) != ok) {
+		return state_token_invalid;
+	}
+
+	/*wrap-around safe comparison of now with the expiry time*/
+	uint32_t expiry = (uint32_t)token[9] << 24 | (uint32_t)token[10] << 16 |
+			  (uint32_t)token[11] << 8 | token[12];
+	if ((int32_t)(now - expiry) > 0) {
+		memset(plaintext, 0, sizeof(plaintext));
+		return state_token_expired;
+	}
+
+	enum err r = get_suite((enum suite_label)plaintext[0], &s->suite);
+	if (r == ok) {
+		s->static_dh_i = plaintext[1];
+		const uint8_t *p = plaintext + 2;
+		memcpy(s->th3, p, sizeof(s->th3));
+		p += sizeof(s->th3);
+		memcpy(s->prk_3e2m, p, sizeof(s->prk_3e2m));
+		p += sizeof(s->prk_3e2m);
+		s->y_len = *p++;
+		memcpy(s->y, p, sizeof(s->y));
+		s->c_i_len = 0;
+		s->state = RESPONDER_WAIT_MSG3;
+	}
+	memset(plaintext, 0, sizeof(plaintext));
+	return r;
+}
+
+enum err edhoc_responder_stateless_msg1(struct edhoc_responder_context *c,
+					struct edhoc_state_keys *k, uint32_t now,
+					const uint8_t *msg1, uint32_t msg1_len,
+					uint8_t *msg2, uint32_t *msg2_len,
+					uint8_t *ead_1, uint32_t *ead_1_len,
+					uint8_t *token, uint32_t *token_len)
+{
+	struct edhoc_responder_session s;
+	edhoc_responder_session_init(&s);
+
+	TRY(edhoc_responder_step(c, &s, NULL, 0, msg1, msg1_len, msg2,
+				 msg2_len, ead_1, ead_1_len, NULL, 0, NULL, 0));
+	enum err r = session_seal(k, now, &s, token, token_len);
+	TRY(edhoc_responder_session_deinit(&s));
+	return r;
+}
+
+enum err edhoc_responder_stateless_msg3(
+	struct edhoc_responder_context *c, struct edhoc_state_keys *k,
+	uint32_t now, const uint8_t *token, uint32_t token_len,
+	struct other_party_cred *cred_i_array, uint16_t num_cred_i,
+	const uint8_t *msg3, uint32_t msg3_len, uint8_t *msg4,
+	uint32_t *msg4_len, uint8_t *ead_3, uint32_t *ead_3_len,
+	uint8_t *prk_4x3m, uint32_t prk_4x3m_len, uint8_t *th4,
+	uint32_t th4_len)
+{
+	struct edhoc_responder_session s;
+	edhoc_responder_session_init(&s);
+
+	enum err r = session_open(k, now, token, token_len, &s);
+	if (r != ok) {
+		TRY(edhoc_responder_session_deinit(&s));
+		return r;
+	}
+	/*deinitializes the session*/
+	return edhoc_responder_step(c, &s, cred_i_array, num_cred_i, msg3,
+				    msg3_len, msg4, msg4_len, ead_3, ead_3_len,
+				    prk_4x3m, prk_4x3m_len, th4, th4_len);
+}
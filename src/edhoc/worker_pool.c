@@ -0,0 +1,138 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+
+#include "edhoc.h"
+#include "edhoc_internal.h"
+
+#include "edhoc/worker_pool.h"
+
+#include "common/oscore_edhoc_error.h"
+
+#if defined(EDHOC_WORKER_POOL_PTHREAD) && !defined(OSCORE_THREAD_SAFE)
+/*the ephemeral key pool and the state keys are shared between the jobs*/
+#error "EDHOC_WORKER_POOL_PTHREAD requires OSCORE_THREAD_SAFE"
+#endif
+
+void edhoc_responder_job_run(struct edhoc_responder_job *job)
+{
+	job->result = edhoc_responder_step(
+		job->c, job->s, job->cred_i_array, job->num_cred_i,
+		job->msg_in, job->msg_in_len, job->msg_out, &job->msg_out_len,
+		job->ead, &job->ead_len, job->prk_4x3m, job->prk_4x3m_len,
+		job->th4, job->th4_len);
+	if (job->done != NULL) {
+		job->done(job);
+	}
+}
+
+#ifdef EDHOC_WORKER_POOL_PTHREAD
+
+/**
+ * @brief   Executes queued jobs until the pool is stopped and the queue is 
+ *          empty
+ */
+static void *worker(void *arg)
+{
+	struct edhoc_worker_pool *p = arg;
+
+	for (;;) {
+		pthread_mutex_lock(&p->mutex);
+		while (p->head == NULL && !p->stop) {
+			pthread_cond_wait(&p->cond, &p->mutex);
+		}
+		struct edhoc_responder_job *job = p->head;
+		if (job == NULL) {
+			pthread_mutex_unlock(&p->mutex);
+			return NULL;
+		}
+		p->head = job->next;
+		if (p->head == NULL) {
+			p->tail = NULL;
+		}
+		pthread_mutex_unlock(&p->mutex);
+
+		edhoc_responder_job_run(job);
+	}
+}
+
+/**
+ * @brief   Stops and joins the first threads_cnt threads of a pool
+ */
+static void workers_stop(struct edhoc_worker_pool *p, uint32_t threads_cnt)
+{
+	pthread_mutex_lock(&p->mutex);
+	p->stop = true;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+
+	for (uint32_t i = 0; i < threads_cnt; i++) {
+		pthread_join(p->threads[i], NULL);
+	}
+	pthread_cond_destroy(&p->cond);
+	pthread_mutex_destroy(&p->mutex);
+}
+
+enum err edhoc_worker_pool_init(struct edhoc_worker_pool *p,
+				pthread_t *threads, uint32_t threads_cnt)
+{
+	if (threads == NULL || threads_cnt == 0) {
+		return wrong_parameter;
+	}
+	p->threads = threads;
+	p->threads_cnt = threads_cnt;
+	p->head = NULL;
+	p->tail = NULL;
+	p->stop = false;
+	TRY_EXPECT(pthread_mutex_init(&p->mutex, NULL), 0);
+	if (pthread_cond_init(&p->cond, NULL) != 0) {
+		pthread_mutex_destroy(&p->mutex);
+		return unexpected_result_from_ext_lib;
+	}
+
+	for (uint32_t i = 0; i < threads_cnt; i++) {
+		if (pthread_create(&threads[i], NULL, worker, p) != 0) {
+			workers_stop(p, i);
+			return unexpected_result_from_ext_lib;
+		}
+	}
+	return ok;
+}
+
+enum err edhoc_worker_pool_submit(struct edhoc_worker_pool *p,
+				  struct edhoc_responder_job *job)
+{
+	job->next = NULL;
+
+	pthread_mutex_lock(&p->mutex);
+	if (p->stop) {
+		pthread_mutex_unlock(&p->mutex);
+		return wrong_parameter;
+	}
+	if (p->tail == NULL) {
+		p->head = job;
+	} else {
+		p->tail->next = job;
+	}
+	p->tail = job;
+	pthread_cond_signal(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+	return ok;
+}
+
+enum err edhoc_worker_pool_deinit(struct edhoc_worker_pool *p)
+{
+	workers_stop(p, p->threads_cnt);
+	return ok;
+}
+
+#endif
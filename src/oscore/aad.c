@@ -14,48 +14,81 @@
 #include "oscore/aad.h"
 #include "oscore/option.h"
 
+#include "common/cbor_head.h"
 #include "common/print_util.h"
 #include "common/oscore_edhoc_error.h"
 #include "common/memcpy_s.h"
 
-#include "cbor/oscore_aad_array.h"
+/*the beginning of the Enc_structure: ["Encrypt0", h'', ... */
+static const uint8_t enc_structure_context[] = {
+	0x83, 0x68, 'E', 'n', 'c', 'r', 'y', 'p', 't', '0', 0x40
+};
 
-enum err create_aad(struct o_coap_option *options, uint16_t opt_num,
-		    enum AEAD_algorithm aead_alg, struct byte_array *kid,
-		    struct byte_array *piv, struct byte_array *out)
+enum err create_aad_prefix(enum AEAD_algorithm aead_alg,
+			   struct byte_array *kid, struct byte_array *out)
 {
-	struct aad_array aad_array;
+	uint32_t l = 0;
+
+	TRY(cbor_bytes_append(enc_structure_context,
+			      sizeof(enc_structure_context), out->ptr,
+			      out->len, &l));
+
+	/*aad_array = [oscore_version: 1, algorithms: [alg_aead], request_kid,
+	the head of the external_aad which wraps the aad_array is added 
+	together with the request_piv by create_aad()*/
+	TRY(cbor_head_append(CBOR_ARRAY, 5, out->ptr, out->len, &l));
+	TRY(cbor_head_append(CBOR_UINT, 1, out->ptr, out->len, &l));
+	TRY(cbor_head_append(CBOR_ARRAY, 1, out->ptr, out->len, &l));
+	TRY(check_buffer_size(out->len, l + CBOR_HEAD_MAX_SIZE));
+	uint32_t alg_len = CBOR_HEAD_MAX_SIZE;
+	TRY(cbor_int_encode((int32_t)aead_alg, out->ptr + l, &alg_len));
+	l += alg_len;
+	TRY(cbor_head_append(CBOR_BSTR, kid->len, out->ptr, out->len, &l));
+	TRY(cbor_bytes_append(kid->ptr, kid->len, out->ptr, out->len, &l));
 
-	aad_array._aad_array_oscore_version = 1;
-	aad_array._aad_array_algorithms_alg_aead_choice =
-		_aad_array_algorithms_alg_aead_int;
-	aad_array._aad_array_algorithms_alg_aead_int = (int32_t)aead_alg;
-	aad_array._aad_array_request_kid.value = kid->ptr;
-	aad_array._aad_array_request_kid.len = kid->len;
-	aad_array._aad_array_request_piv.value = piv->ptr;
-	aad_array._aad_array_request_piv.len = piv->len;
+	out->len = l;
+	PRINT_ARRAY("AAD prefix", out->ptr, out->len);
+	return ok;
+}
+
+enum err create_aad(struct o_coap_option *options, uint16_t opt_num,
+		    struct byte_array *prefix, struct byte_array *piv,
+		    struct byte_array *out)
+{
+	const uint32_t ctx_len = sizeof(enc_structure_context);
+	TRY(check_buffer_size(prefix->len, ctx_len));
 
 	/* options */
-	uint32_t encoded_opt_i_len =
-		encoded_option_len(options, opt_num, CLASS_I);
-	TRY(check_buffer_size(MAX_I_OPTIONS, encoded_opt_i_len));
-	uint8_t encoded_opt_i_bytes[MAX_I_OPTIONS];
-	struct byte_array opts_i = {
-		.len = encoded_opt_i_len,
-		.ptr = encoded_opt_i_bytes,
-	};
-	TRY(encode_options(options, opt_num, CLASS_I, &opts_i.ptr[0],
-			   encoded_opt_i_len));
-
-	aad_array._aad_array_options.len = opts_i.len;
-	aad_array._aad_array_options.value = opts_i.ptr;
-
-	size_t payload_len_out;
-	TRY_EXPECT(cbor_encode_aad_array(out->ptr, out->len, &aad_array,
-					 &payload_len_out),
-		   true);
-
-	out->len = (uint32_t) payload_len_out;
+	uint32_t opts_i_len = encoded_option_len(options, opt_num, CLASS_I);
+	TRY(check_buffer_size(MAX_I_OPTIONS, opts_i_len));
+
+	uint8_t head[CBOR_HEAD_MAX_SIZE];
+	uint32_t piv_head_len = sizeof(head);
+	uint32_t opts_i_head_len = sizeof(head);
+	TRY(cbor_head_encode(CBOR_BSTR, piv->len, head, &piv_head_len));
+	TRY(cbor_head_encode(CBOR_BSTR, opts_i_len, head, &opts_i_head_len));
+	uint32_t aad_array_len = prefix->len - ctx_len + piv_head_len +
+				 piv->len + opts_i_head_len + opts_i_len;
+
+	/*only the request_piv, the options and the head of the external_aad 
+	are encoded per message*/
+	uint32_t l = 0;
+	TRY(cbor_bytes_append(prefix->ptr, ctx_len, out->ptr, out->len, &l));
+	TRY(cbor_head_append(CBOR_BSTR, aad_array_len, out->ptr, out->len,
+			     &l));
+	TRY(cbor_bytes_append(prefix->ptr + ctx_len, prefix->len - ctx_len,
+			      out->ptr, out->len, &l));
+	TRY(cbor_head_append(CBOR_BSTR, piv->len, out->ptr, out->len, &l));
+	TRY(cbor_bytes_append(piv->ptr, piv->len, out->ptr, out->len, &l));
+	TRY(cbor_head_append(CBOR_BSTR, opts_i_len, out->ptr, out->len, &l));
+	if (opts_i_len != 0) {
+		TRY(check_buffer_size(out->len - l, opts_i_len));
+		TRY(encode_options(options, opt_num, CLASS_I, out->ptr + l,
+				   opts_i_len));
+		l += opts_i_len;
+	}
+
+	out->len = l;
 	PRINT_ARRAY("AAD", out->ptr, out->len);
 	return ok;
 }
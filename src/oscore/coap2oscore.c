@@ -20,8 +20,10 @@
 #include "oscore/nonce.h"
 #include "oscore/option.h"
 #include "oscore/oscore_cose.h"
+#include "oscore/request_table.h"
 #include "oscore/security_context.h"
 
+#include "common/atomic_ops.h"
 #include "common/byte_array.h"
 #include "common/oscore_edhoc_error.h"
 #include "common/memcpy_s.h"
@@ -50,10 +52,10 @@ static inline enum err e_u_options_extract(struct o_coap_packet *in_o_coap,
 	/* Initialize to 0 */
 	*e_options_len = 0;
 
-	uint8_t temp_option_nr = 0;
+	uint16_t temp_option_nr = 0;
 	uint8_t temp_len = 0;
-	uint8_t temp_E_option_delta_sum = 0;
-	uint8_t temp_U_option_delta_sum = 0;
+	uint16_t temp_E_option_delta_sum = 0;
+	uint16_t temp_U_option_delta_sum = 0;
 	uint8_t delta_extra_bytes = 0;
 	uint8_t len_extra_bytes = 0;
 
@@ -62,20 +64,19 @@ static inline enum err e_u_options_extract(struct o_coap_packet *in_o_coap,
 		len_extra_bytes = 0;
 
 		temp_option_nr =
-			(uint8_t)(temp_option_nr + in_o_coap->options[i].delta);
+			(uint16_t)(temp_option_nr + in_o_coap->options[i].delta);
 		temp_len = in_o_coap->options[i].len;
 
 		/* Calculate extra byte length of option delta and option length */
-		if (in_o_coap->options[i].delta > 13 &&
-		    in_o_coap->options[i].delta < 243)
+		if (in_o_coap->options[i].delta >= 13 &&
+		    in_o_coap->options[i].delta < 269)
 			delta_extra_bytes = 1;
-		else if (in_o_coap->options[i].delta >= 243)
+		else if (in_o_coap->options[i].delta >= 269)
 			delta_extra_bytes = 2;
-		if (in_o_coap->options[i].len > 13 &&
-		    in_o_coap->options[i].len < 243)
+		/*option lengths are stored in one byte and need at most one 
+		extended byte*/
+		if (in_o_coap->options[i].len >= 13)
 			len_extra_bytes = 1;
-		else if (in_o_coap->options[i].len >= 243)
-			len_extra_bytes = 2;
 
 		/* check delta, whether current option U or E */
 		if (is_class_e(temp_option_nr) == 1) {
@@ -91,7 +92,7 @@ static inline enum err e_u_options_extract(struct o_coap_packet *in_o_coap,
 
 			/* Update delta sum of E-options */
 			temp_E_option_delta_sum =
-				(uint8_t)(temp_E_option_delta_sum +
+				(uint16_t)(temp_E_option_delta_sum +
 					  e_options[*e_options_cnt].delta);
 
 			/* Increment E-options count */
@@ -114,7 +115,7 @@ static inline enum err e_u_options_extract(struct o_coap_packet *in_o_coap,
 
 			/* Update delta sum of E-options */
 			temp_U_option_delta_sum =
-				(uint8_t)(temp_U_option_delta_sum +
+				(uint16_t)(temp_U_option_delta_sum +
 					  U_options[*U_options_cnt].delta);
 
 			/* Increment E-options count */
@@ -186,6 +187,7 @@ static inline enum err plaintext_setup(struct o_coap_packet *in_o_coap,
 /**
  * @brief   Encrypt incoming plaintext
  * @param   c OSCORE context
+ * @param   e the exchange containing the nonce and the AAD
  * @param   in_o_coap: input CoAP packet, which will be used to calculate AAD
  *          (additional authentication data)
  * @param   in_plaintext: input plaintext that will be encrypted
@@ -194,12 +196,13 @@ static inline enum err plaintext_setup(struct o_coap_packet *in_o_coap,
  *
  */
 static inline enum err plaintext_encrypt(struct context *c,
+					 struct oscore_exchange *e,
 					 struct byte_array *in_plaintext,
 					 uint8_t *out_ciphertext,
 					 uint32_t out_ciphertext_len)
 {
 	return oscore_cose_encrypt(in_plaintext, out_ciphertext, out_ciphertext_len,
-			    &c->rrc.nonce, &c->rrc.aad, &c->sc.sender_key);
+			    &e->nonce, &e->aad, &c->sc.sender_aead_key);
 }
 
 /**
@@ -355,7 +358,7 @@ static inline enum err oscore_pkg_generate(struct o_coap_packet *in_o_coap,
 	/* Update options count number to output*/
 	out_oscore->options_cnt = (uint8_t)(1 + u_options_cnt);
 
-	uint8_t temp_opt_number_sum = 0;
+	uint16_t temp_opt_number_sum = 0;
 	/* Show the position of U-options */
 	uint8_t u_opt_pos = 0;
 	for (uint8_t i = 0; i < u_options_cnt + 1; i++) {
@@ -381,7 +384,7 @@ static inline enum err oscore_pkg_generate(struct o_coap_packet *in_o_coap,
 
 			u_opt_pos++;
 		}
-		temp_opt_number_sum = (uint8_t)(temp_opt_number_sum +
+		temp_opt_number_sum = (uint16_t)(temp_opt_number_sum +
 						out_oscore->options[i].delta);
 	}
 
@@ -392,45 +395,22 @@ static inline enum err oscore_pkg_generate(struct o_coap_packet *in_o_coap,
 }
 
 /**
- *@brief 	Converts a CoAP packet to OSCORE packet
- *@note		For messaging layer packets (simple ACK with no payload, code 0.00),
- *			encryption is dismissed and raw input buffer is copied, 
- *			as specified at section 4.2 in RFC8613.
- *@param	buf_o_coap a buffer containing a CoAP packet
- *@param	buf_o_coap_len length of the CoAP buffer
+ *@brief 	Protects a parsed CoAP packet which is not a messaging layer 
+ *		packet, see coap2oscore_exchange()
+ *@param	o_coap_pkt the parsed CoAP packet
  *@param	buf_oscore a buffer where the OSCORE packet will be written
  *@param	buf_oscore_len length of the OSCORE packet
  *@param	c a struct containing the OSCORE context
+ *@param	e the exchange which keeps the nonce and the AAD of a request
  *
  *@return	err
  */
-enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
-		     uint8_t *buf_oscore, uint32_t *buf_oscore_len,
-		     struct context *c)
+static enum err packet_protect(struct o_coap_packet *o_coap_pkt,
+			       uint8_t *buf_oscore, uint32_t *buf_oscore_len,
+			       struct context *c, struct oscore_exchange *e)
 {
-	struct o_coap_packet o_coap_pkt;
-	struct byte_array buf;
 	uint32_t plaintext_len = 0;
 
-	PRINT_MSG("\n\n\ncoap2oscore***************************************\n");
-	PRINT_ARRAY("Input CoAP packet", buf_o_coap, buf_o_coap_len);
-
-	buf.len = buf_o_coap_len;
-	buf.ptr = buf_o_coap;
-
-	/*Parse the coap buf into a CoAP struct*/
-	TRY(buf2coap(&buf, &o_coap_pkt));
-
-	/* Dismiss OSCORE encryption if messaging layer detected (simple ACK, code=0.00) */
-	if ((CODE_EMPTY == o_coap_pkt.header.code) &&
-	    (TYPE_ACK == o_coap_pkt.header.type)) {
-		PRINT_MSG(
-			"Messaging Layer CoAP packet detected, encryption dismissed\n");
-		*buf_oscore_len = buf_o_coap_len;
-		return _memcpy_s(buf_oscore, buf_o_coap_len, buf_o_coap,
-				 buf_o_coap_len);
-	}
-
 	/* 1. Divide CoAP options into E-option and U-option */
 	struct o_coap_option e_options[MAX_OPTION_COUNT];
 	uint8_t e_options_cnt = 0;
@@ -439,15 +419,15 @@ enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
 	uint8_t u_options_cnt = 0;
 
 	/* Analyze CoAP options, extract E-options and U-options */
-	TRY(e_u_options_extract(&o_coap_pkt, e_options, &e_options_cnt,
+	TRY(e_u_options_extract(o_coap_pkt, e_options, &e_options_cnt,
 				&e_options_len, u_options, &u_options_cnt));
 
 	/* 2. Create plaintext (code + E-options + o_coap_payload) */
 	/* Calculate complete plaintext length: 1 byte code + E-options + 1 byte 0xFF + payload */
 	plaintext_len = (uint32_t)(1 + e_options_len);
 
-	if (o_coap_pkt.payload_len) {
-		plaintext_len = plaintext_len + 1 + o_coap_pkt.payload_len;
+	if (o_coap_pkt->payload_len) {
+		plaintext_len = plaintext_len + 1 + o_coap_pkt->payload_len;
 	}
 
 	/* Setup buffer for plaintext */
@@ -460,7 +440,7 @@ enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
 	};
 
 	/* Combine code, E-options and payload of CoAP to plaintext */
-	TRY(plaintext_setup(&o_coap_pkt, e_options, e_options_cnt, &plaintext));
+	TRY(plaintext_setup(o_coap_pkt, e_options, e_options_cnt, &plaintext));
 
 	/* Generate OSCORE option */
 	struct oscore_option oscore_option;
@@ -469,23 +449,25 @@ enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
     - Only if the packet is a request the OSCORE option has a value 
     - Only if the packet is a request the nonce and the add need to be generated
     */
-	if ((CODE_CLASS_MASK & o_coap_pkt.header.code) == 0) {
-		/*update the piv in the request response context*/
-		TRY(sender_seq_num2piv(c->sc.sender_seq_num++, &c->rrc.piv));
+	if ((CODE_CLASS_MASK & o_coap_pkt->header.code) == 0) {
+		/*reserve a sender sequence number, the increment is atomic if 
+		the context is shared between threads*/
+		uint64_t ssn = fetch_add_u64(&c->sc.sender_seq_num, 1);
+		TRY(sender_seq_num2piv(ssn, &e->piv));
 
 		TRY(context_update(CLIENT,
-				   (struct o_coap_option *)&o_coap_pkt.options,
-				   o_coap_pkt.options_cnt, NULL, NULL, c));
+				   (struct o_coap_option *)o_coap_pkt->options,
+				   o_coap_pkt->options_cnt, NULL, NULL, c, e));
 
 		/*calculate the OSCORE option value*/
 		oscore_option.len = get_oscore_opt_val_len(
-			&c->rrc.piv, &c->rrc.kid, &c->rrc.kid_context);
+			&e->piv, &c->rrc.kid, &c->rrc.kid_context);
 		if (oscore_option.len > OSCORE_OPT_VALUE_LEN) {
 			return oscore_valuelen_to_long_error;
 		}
 
 		oscore_option.value = oscore_option.buf;
-		TRY(oscore_option_generate(&c->rrc.piv, &c->rrc.kid,
+		TRY(oscore_option_generate(&e->piv, &c->rrc.kid,
 					   &c->rrc.kid_context,
 					   &oscore_option));
 
@@ -500,15 +482,155 @@ enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
 	TRY(check_buffer_size(MAX_CIPHERTEXT_LEN, ciphertext_len));
 	uint8_t ciphertext[MAX_CIPHERTEXT_LEN];
 
-	TRY(plaintext_encrypt(c, &plaintext, (uint8_t *)&ciphertext,
+	TRY(plaintext_encrypt(c, e, &plaintext, (uint8_t *)&ciphertext,
 			      ciphertext_len));
 
 	/*create an OSCORE packet*/
 	struct o_coap_packet oscore_pkt;
-	TRY(oscore_pkg_generate(&o_coap_pkt, &oscore_pkt, u_options,
+	TRY(oscore_pkg_generate(o_coap_pkt, &oscore_pkt, u_options,
 				u_options_cnt, (uint8_t *)&ciphertext,
 				ciphertext_len, &oscore_option));
 
 	/*convert the oscore pkg to byte string*/
 	return coap2buf(&oscore_pkt, buf_oscore, buf_oscore_len);
 }
+
+/**
+ *@brief 	Converts a CoAP packet to OSCORE packet
+ *@note		For messaging layer packets (simple ACK with no payload, code 0.00),
+ *			encryption is dismissed and raw input buffer is copied, 
+ *			as specified at section 4.2 in RFC8613.
+ *@param	buf_o_coap a buffer containing a CoAP packet
+ *@param	buf_o_coap_len length of the CoAP buffer
+ *@param	buf_oscore a buffer where the OSCORE packet will be written
+ *@param	buf_oscore_len length of the OSCORE packet
+ *@param	c a struct containing the OSCORE context
+ *@param	e the exchange which keeps the nonce and the AAD of a request 
+ *		until its response is verified
+ *
+ *@return	err
+ */
+enum err coap2oscore_exchange(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
+			      uint8_t *buf_oscore, uint32_t *buf_oscore_len,
+			      struct context *c, struct oscore_exchange *e)
+{
+	struct o_coap_packet o_coap_pkt;
+	struct byte_array buf;
+
+	PRINT_MSG("\n\n\ncoap2oscore***************************************\n");
+	PRINT_ARRAY("Input CoAP packet", buf_o_coap, buf_o_coap_len);
+
+	buf.len = buf_o_coap_len;
+	buf.ptr = buf_o_coap;
+
+	/*Parse the coap buf into a CoAP struct*/
+	TRY(buf2coap(&buf, &o_coap_pkt));
+
+	/* Dismiss OSCORE encryption if messaging layer detected (simple ACK, code=0.00) */
+	if ((CODE_EMPTY == o_coap_pkt.header.code) &&
+	    (TYPE_ACK == o_coap_pkt.header.type)) {
+		PRINT_MSG(
+			"Messaging Layer CoAP packet detected, encryption dismissed\n");
+		*buf_oscore_len = buf_o_coap_len;
+		return _memcpy_s(buf_oscore, buf_o_coap_len, buf_o_coap,
+				 buf_o_coap_len);
+	}
+
+	/*a request is recorded in the table of outstanding requests, the 
+	entry is reserved before the request takes a sender sequence number*/
+	struct oscore_request *request = NULL;
+	if ((CODE_CLASS_MASK & o_coap_pkt.header.code) == 0 &&
+	    c->rrc.requests != NULL) {
+		struct byte_array token = {
+			.len = o_coap_pkt.header.TKL,
+			.ptr = o_coap_pkt.token,
+		};
+		TRY(oscore_request_table_reserve(c->rrc.requests, &token,
+						 &request));
+	}
+
+	enum err r = packet_protect(&o_coap_pkt, buf_oscore, buf_oscore_len,
+				    c, e);
+	if (request == NULL) {
+		return r;
+	}
+	if (r != ok) {
+		oscore_request_table_release(c->rrc.requests, request);
+		return r;
+	}
+	/*remember the PIV of the request until its response is verified*/
+	return oscore_request_table_commit(c->rrc.requests, request, &e->piv);
+}
+
+enum err coap2oscore(uint8_t *buf_o_coap, uint32_t buf_o_coap_len,
+		     uint8_t *buf_oscore, uint32_t *buf_oscore_len,
+		     struct context *c)
+{
+	return coap2oscore_exchange(buf_o_coap, buf_o_coap_len, buf_oscore,
+				    buf_oscore_len, c, &c->rrc.exchange);
+}
+
+/**
+ * @brief Checks if a CoAP packet of a batch is a request of a context with 
+ *        a table of outstanding requests. The exchange of such a request 
+ *        is not needed after the call since its PIV is kept in the table.
+ * @param p the packet
+ * @return true if the request is recorded in a table
+ */
+static bool batch_request_recorded(struct oscore_batch_packet *p)
+{
+	return p->buf_in_len >= 2 &&
+	       (p->buf_in[1] & CODE_CLASS_MASK) == REQUEST_CLASS &&
+	       p->c->rrc.requests != NULL;
+}
+
+/**
+ * @brief Checks if an earlier packet of a batch used the exchange stored in 
+ *        the context of packet i. A response protected with it would reuse 
+ *        the nonce of the last request instead of the one it answers.
+ *        Several recorded requests may share the exchange.
+ * @param packets the packets of the batch
+ * @param i the index of the packet
+ * @return true if the exchange of the context is taken
+ */
+static bool batch_exchange_taken(struct oscore_batch_packet *packets,
+				 uint32_t i)
+{
+	for (uint32_t j = 0; j < i; j++) {
+		if (packets[j].e == NULL && packets[j].c == packets[i].c &&
+		    !(batch_request_recorded(&packets[j]) &&
+		      batch_request_recorded(&packets[i]))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+enum err coap2oscore_batch(struct oscore_batch_packet *packets,
+			   uint32_t packets_cnt)
+{
+	if (packets == NULL && packets_cnt != 0) {
+		return wrong_parameter;
+	}
+
+	for (uint32_t i = 0; i < packets_cnt; i++) {
+		struct oscore_batch_packet *p = &packets[i];
+		if (p->c == NULL) {
+			p->result = wrong_parameter;
+			continue;
+		}
+
+		struct oscore_exchange *e = p->e;
+		if (e == NULL) {
+			if (batch_exchange_taken(packets, i)) {
+				p->result = wrong_parameter;
+				continue;
+			}
+			e = &p->c->rrc.exchange;
+		}
+		p->result = coap2oscore_exchange(p->buf_in, p->buf_in_len,
+						 p->buf_out, &p->buf_out_len,
+						 p->c, e);
+	}
+	return ok;
+}
@@ -0,0 +1,153 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "oscore/context_table.h"
+#include "oscore/security_context.h"
+
+#include "common/byte_array.h"
+#include "common/oscore_edhoc_error.h"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * @brief   FNV-1a hash over a byte string
+ * @param   h the hash of the preceding data or FNV_OFFSET_BASIS
+ * @param   in the data
+ */
+static uint32_t fnv1a(uint32_t h, const struct byte_array *in)
+{
+	for (uint32_t i = 0; i < in->len; i++) {
+		h = (h ^ in->ptr[i]) * FNV_PRIME;
+	}
+	return h;
+}
+
+/**
+ * @brief   Calculates the home slot of a (KID context, KID) pair
+ */
+static uint32_t home_slot(const struct oscore_context_table *t,
+			  const struct byte_array *kid_context,
+			  const struct byte_array *kid)
+{
+	/*the length separates KID context and KID, e.g., (0x01, 0x02) and 
+	(empty, 0x0102) map to different values*/
+	uint32_t h = (FNV_OFFSET_BASIS ^ kid_context->len) * FNV_PRIME;
+	h = fnv1a(h, kid_context);
+	h = fnv1a(h, kid);
+	return h % t->slots_cnt;
+}
+
+static bool key_equals(const struct context *c,
+		       const struct byte_array *kid_context,
+		       const struct byte_array *kid)
+{
+	return array_equals(&c->cc.id_context, kid_context) &&
+	       array_equals(&c->rc.recipient_id, kid);
+}
+
+/**
+ * @brief   Finds the slot holding the context with a given key or the empty 
+ *          slot which terminates the probe sequence of that key
+ */
+static uint32_t probe(const struct oscore_context_table *t,
+		      const struct byte_array *kid_context,
+		      const struct byte_array *kid)
+{
+	uint32_t i = home_slot(t, kid_context, kid);
+
+	while (t->slots[i] != NULL &&
+	       !key_equals(t->slots[i], kid_context, kid)) {
+		i = (i + 1) % t->slots_cnt;
+	}
+	return i;
+}
+
+enum err oscore_context_table_init(struct oscore_context_table *t,
+				   struct context **slots, uint32_t slots_cnt)
+{
+	if (slots == NULL || slots_cnt < 2) {
+		return wrong_parameter;
+	}
+	for (uint32_t i = 0; i < slots_cnt; i++) {
+		slots[i] = NULL;
+	}
+	t->slots = slots;
+	t->slots_cnt = slots_cnt;
+	t->entries_cnt = 0;
+	return ok;
+}
+
+enum err oscore_context_table_insert(struct oscore_context_table *t,
+				     struct context *c)
+{
+	/*keep one slot empty so that every probe sequence terminates*/
+	if (t->entries_cnt + 1 >= t->slots_cnt) {
+		return oscore_context_table_full;
+	}
+
+	uint32_t i = probe(t, &c->cc.id_context, &c->rc.recipient_id);
+	if (t->slots[i] != NULL) {
+		return oscore_context_table_duplicate;
+	}
+	t->slots[i] = c;
+	t->entries_cnt++;
+	return ok;
+}
+
+enum err oscore_context_table_remove(struct oscore_context_table *t,
+				     struct context *c)
+{
+	uint32_t i = probe(t, &c->cc.id_context, &c->rc.recipient_id);
+	if (t->slots[i] != c) {
+		return oscore_kid_recipent_id_mismatch;
+	}
+
+	/*backward shift deletion: move up the following entries of the 
+	cluster which would not be found anymore after emptying slot i*/
+	uint32_t j = i;
+	while (true) {
+		t->slots[i] = NULL;
+		while (true) {
+			j = (j + 1) % t->slots_cnt;
+			if (t->slots[j] == NULL) {
+				t->entries_cnt--;
+				return ok;
+			}
+			uint32_t k = home_slot(t, &t->slots[j]->cc.id_context,
+					       &t->slots[j]->rc.recipient_id);
+			/*the entry in j stays if its home slot k lies 
+			cyclically in (i, j]*/
+			if ((i < j) ? (i < k && k <= j) : (i < k || k <= j)) {
+				continue;
+			}
+			break;
+		}
+		t->slots[i] = t->slots[j];
+		i = j;
+	}
+}
+
+enum err oscore_context_table_lookup(struct oscore_context_table *t,
+				     const struct byte_array *kid_context,
+				     const struct byte_array *kid,
+				     struct context **c)
+{
+	uint32_t i = probe(t, kid_context, kid);
+	if (t->slots[i] == NULL) {
+		return oscore_kid_recipent_id_mismatch;
+	}
+	*c = t->slots[i];
+	return ok;
+}
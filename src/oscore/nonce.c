@@ -18,32 +18,43 @@
 #include "common/print_util.h"
 #include "common/memcpy_s.h"
 
-enum err create_nonce(struct byte_array *id_piv, struct byte_array *piv,
-		      struct byte_array *common_iv, struct byte_array *nonce)
+enum err create_nonce_template(struct byte_array *id_piv,
+			       struct byte_array *common_iv, uint8_t *out)
 {
-	/* "1. left-padding the PIV in network byte order with zeroes to exactly 5 bytes"*/
-	uint8_t padded_piv[MAX_PIV_LEN] = { 0 };
-	TRY(_memcpy_s(&padded_piv[sizeof(padded_piv) - piv->len], piv->len,
-		      piv->ptr, piv->len));
+	const uint32_t padded_id_piv_len = NONCE_LEN - MAX_PIV_LEN - 1;
+	TRY(check_buffer_size(padded_id_piv_len, id_piv->len));
+	TRY(check_buffer_size(NONCE_LEN, common_iv->len));
 
-	/* "2. left-padding the ID_PIV in network byte order with zeroes to exactly nonce length minus 6 bytes," */
-
-	uint8_t padded_id_piv[NONCE_LEN - MAX_PIV_LEN - 1] = { 0 };
-	const uint8_t padded_id_piv_len = sizeof(padded_id_piv);
-	TRY(_memcpy_s(&padded_id_piv[sizeof(padded_id_piv) - id_piv->len],
-		      id_piv->len, id_piv->ptr, id_piv->len));
+	/* "1. left-padding the PIV in network byte order with zeroes to exactly 5 bytes"
+	the PIV is XORed into the template for every message, see create_nonce()*/
+	memset(out, 0, NONCE_LEN);
 
+	/* "2. left-padding the ID_PIV in network byte order with zeroes to exactly nonce length minus 6 bytes," */
 	/* "3. concatenating the size of the ID_PIV (a single byte S) with the padded ID_PIV and the padded PIV,"*/
-	nonce->ptr[0] = (uint8_t)id_piv->len;
-	TRY(_memcpy_s(&nonce->ptr[1], padded_id_piv_len, padded_id_piv,
-		      padded_id_piv_len));
-
-	TRY(_memcpy_s(&nonce->ptr[1 + sizeof(padded_id_piv)],
-		      sizeof(padded_piv), padded_piv, sizeof(padded_piv)));
+	out[0] = (uint8_t)id_piv->len;
+	TRY(_memcpy_s(&out[1 + padded_id_piv_len - id_piv->len], id_piv->len,
+		      id_piv->ptr, id_piv->len));
 
 	/* "4. and then XORing with the Common IV."*/
 	for (uint32_t i = 0; i < common_iv->len; i++) {
-		nonce->ptr[i] ^= common_iv->ptr[i];
+		out[i] ^= common_iv->ptr[i];
+	}
+
+	PRINT_ARRAY("nonce template", out, NONCE_LEN);
+	return ok;
+}
+
+enum err create_nonce(const uint8_t *template, struct byte_array *piv,
+		      struct byte_array *nonce)
+{
+	TRY(check_buffer_size(MAX_PIV_LEN, piv->len));
+	TRY(_memcpy_s(nonce->ptr, nonce->len, template, NONCE_LEN));
+	nonce->len = NONCE_LEN;
+
+	/*the padded PIV are the last bytes of the nonce*/
+	uint8_t *padded_piv = &nonce->ptr[NONCE_LEN - piv->len];
+	for (uint32_t i = 0; i < piv->len; i++) {
+		padded_piv[i] ^= piv->ptr[i];
 	}
 
 	PRINT_ARRAY("nonce", nonce->ptr, nonce->len);
@@ -20,7 +20,7 @@ bool is_class_e(uint16_t code)
 	// blacklist, because OSCORE dictates that unknown options SHALL be processed as class E
 	return code != COAP_OPTION_URI_HOST && code != COAP_OPTION_URI_PORT &&
 	       code != COAP_OPTION_OSCORE && code != COAP_OPTION_PROXY_URI &&
-	       code != COAP_OPTION_PROXY_SCHEME;
+	       code != COAP_OPTION_PROXY_SCHEME && code != COAP_OPTION_EDHOC;
 }
 
 
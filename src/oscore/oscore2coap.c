@@ -21,6 +21,8 @@
 #include "oscore/nonce.h"
 #include "oscore/option.h"
 #include "oscore/oscore_cose.h"
+#include "oscore/replay_protection.h"
+#include "oscore/request_table.h"
 #include "oscore/security_context.h"
 
 #include "common/byte_array.h"
@@ -40,7 +42,7 @@ oscore_option_parser(struct o_coap_packet *in,
 {
 	uint8_t temp_option_count = in->options_cnt;
 	struct o_coap_option *temp_options = in->options;
-	uint8_t temp_option_num = 0;
+	uint16_t temp_option_num = 0;
 	uint8_t *temp_current_option_value_ptr;
 	uint8_t temp_kid_len = 0;
 
@@ -134,513 +136,620 @@ oscore_option_parser(struct o_coap_packet *in,
 	return ok;
 }
 
+
 /**
- * @brief Decrypt the OSCORE payload (ciphertext)
- * @param out_plaintext: output plaintext
- * @param received_piv_kid_context: received PIV, KID and KID context, will be used to calculate AEAD nonce and AAD
- * @param oscore_packet: complete OSCORE packet which contains the ciphertext to be decrypted
- * @return void
+ * @brief Returns the length of the extended delta or length field of an 
+ *        option, see RFC7252 Section 3.1
+ * @param value the option delta or length
  */
-static inline enum err payload_decrypt(struct context *c,
-				       struct byte_array *out_plaintext,
-				       struct o_coap_packet *oscore_packet)
+static uint8_t option_ext_len(uint16_t value)
 {
-	struct byte_array oscore_ciphertext = {
-		.len = oscore_packet->payload_len,
-		.ptr = oscore_packet->payload,
-	};
-	return oscore_cose_decrypt(&oscore_ciphertext, out_plaintext, &c->rrc.nonce,
-			    &c->rrc.aad, &c->rc.recipient_key);
+	if (value < 13) {
+		return 0;
+	} else if (value < 269) {
+		return 1;
+	} else {
+		return 2;
+	}
 }
 
 /**
- * @brief Reorder E-options and other U-options, and update their delta, and combine them all to normal CoAP packet
- * @param in_oscore_packet: input OSCORE, which contains U-options
- * @param E_options: input pointer to E-options array
- * @param E_options_cnt: count number of input E-options
- * @param out: output pointer to CoAP packet, which will have all reordered options
- * @return ok or error code
+ * @brief Writes the nibble and the extended field of an option delta or 
+ *        length
+ * @param value the option delta or length
+ * @param nibble output for the 4 bit value of the first byte
+ * @param ext output for the extended field
+ * @return pointer to the byte after the extended field
  */
-static inline enum err
-options_from_oscore_reorder(struct o_coap_packet *in_oscore_packet,
-			    struct o_coap_option *E_options,
-			    uint8_t E_options_cnt, struct o_coap_packet *out)
+static uint8_t *option_ext_encode(uint16_t value, uint8_t *nibble,
+				  uint8_t *ext)
 {
-	uint16_t temp_delta_sum = 0;
-	uint8_t temp_opt_cnt =
-		(uint8_t)(in_oscore_packet->options_cnt + E_options_cnt);
-	uint8_t o_coap_opt_cnt = (uint8_t)(temp_opt_cnt - 1);
-
-	/* Get all option numbers */
-	if (o_coap_opt_cnt > 0) {
-		TRY(check_buffer_size(MAX_OPTION_COUNT, o_coap_opt_cnt));
-		uint8_t temp_opt_number[MAX_OPTION_COUNT];
-		memset(temp_opt_number, 0, o_coap_opt_cnt);
-
-		/* Get all option numbers but discard OSCORE option */
-		uint8_t j = 0;
-		for (uint8_t i = 0; i < o_coap_opt_cnt + 1; i++) {
-			if (i < in_oscore_packet->options_cnt) {
-				if (in_oscore_packet->options[i].option_number !=
-				    COAP_OPTION_OSCORE)
-					temp_opt_number[j++] =
-						in_oscore_packet->options[i]
-							.option_number;
-			} else {
-				temp_opt_number[j++] =
-					E_options[i -
-						  in_oscore_packet->options_cnt]
-						.option_number;
-			}
-		}
+	switch (option_ext_len(value)) {
+	case 0:
+		*nibble = (uint8_t)value;
+		break;
+	case 1:
+		*nibble = 13;
+		*ext++ = (uint8_t)(value - 13);
+		break;
+	default:
+		*nibble = 14;
+		*ext++ = (uint8_t)((value - 269) >> 8);
+		*ext++ = (uint8_t)(value - 269);
+		break;
+	}
+	return ext;
+}
 
-		/* Reorder the option numbers from minimum to maximum */
-		// uint8_t min_opt_number;
-		for (uint8_t i = 0; i < o_coap_opt_cnt; i++) {
-			uint8_t ipp = (uint8_t)(i + 1);
-			for (uint8_t k = ipp; k < o_coap_opt_cnt; k++) {
-				if (temp_opt_number[i] > temp_opt_number[k]) {
-					uint8_t temp;
-					temp = temp_opt_number[i];
-					temp_opt_number[i] = temp_opt_number[k];
-					temp_opt_number[k] = temp;
-				}
-			}
+/**
+ * @brief Encodes the header (first byte, extended delta and extended 
+ *        length) of an option
+ * @param delta the option delta
+ * @param len the length of the option value
+ * @param out output buffer of 1 + option_ext_len(delta) + 
+ *        option_ext_len(len) bytes
+ */
+static void option_header_encode(uint16_t delta, uint16_t len, uint8_t *out)
+{
+	uint8_t delta_nibble, len_nibble;
+	uint8_t *ext = option_ext_encode(delta, &delta_nibble, out + 1);
+
+	option_ext_encode(len, &len_nibble, ext);
+	out[0] = (uint8_t)(delta_nibble << 4 | len_nibble);
+}
+
+/**
+ * @brief Returns the index of the U-option before option i which must be 
+ *        copied into the CoAP packet, i.e., the OSCORE option is skipped
+ * @param packet the OSCORE packet
+ * @param i index of the current option
+ * @return the index or -1 if there is none
+ */
+static int16_t prev_u_option(struct o_coap_packet *packet, int16_t i)
+{
+	for (i--; i >= 0; i--) {
+		if (packet->options[i].option_number != COAP_OPTION_OSCORE) {
+			return i;
 		}
+	}
+	return -1;
+}
 
-		/* Reset output CoAP options count */
-		out->options_cnt = 0;
-
-		/* Copy all U-options and E-options in increasing number sequence*/
-		uint8_t U_opt_idx = 0;
-		uint8_t E_opt_idx = 0;
-		for (uint8_t i = 0; i < o_coap_opt_cnt; i++) {
-			if (temp_opt_number[i] ==
-			    in_oscore_packet->options[U_opt_idx].option_number) {
-				out->options[out->options_cnt].delta =
-					(uint16_t)(in_oscore_packet
-							   ->options[U_opt_idx]
-							   .option_number -
-						   temp_delta_sum);
-				out->options[out->options_cnt].len =
-					in_oscore_packet->options[U_opt_idx].len;
-				out->options[out->options_cnt].option_number =
-					in_oscore_packet->options[U_opt_idx]
-						.option_number;
-				out->options[out->options_cnt].value =
-					in_oscore_packet->options[U_opt_idx]
-						.value;
-
-				temp_delta_sum =
-					(uint16_t)(temp_delta_sum +
-						   out->options[out->options_cnt]
-							   .delta);
-				out->options_cnt++;
-				U_opt_idx++;
-				continue;
-			} else if (temp_opt_number[i] ==
-				   E_options[E_opt_idx].option_number) {
-				out->options[out->options_cnt].delta =
-					(uint16_t)(E_options[E_opt_idx]
-							   .option_number -
-						   temp_delta_sum);
-				out->options[out->options_cnt].len =
-					E_options[E_opt_idx].len;
-				out->options[out->options_cnt].option_number =
-					E_options[E_opt_idx].option_number;
-				out->options[out->options_cnt].value =
-					E_options[E_opt_idx].value;
-
-				temp_delta_sum =
-					(uint16_t)(temp_delta_sum +
-						   out->options[out->options_cnt]
-							   .delta);
-				out->options_cnt++;
-				E_opt_idx++;
-				continue;
-			}
+/**
+ * @brief Returns the end of the bytes which must not be overwritten while 
+ *        the CoAP options are written, i.e., the end of the value of the 
+ *        last U-option which is still to be copied, or the end of the 
+ *        header and token
+ * @param packet the OSCORE packet
+ * @param u index of the last U-option still to be copied or -1
+ * @param hdr_end end of the header and token
+ */
+static uint8_t *sources_end(struct o_coap_packet *packet, int16_t u,
+			    uint8_t *hdr_end)
+{
+	for (; u >= 0; u = prev_u_option(packet, u)) {
+		if (packet->options[u].len != 0) {
+			return packet->options[u].value + packet->options[u].len;
 		}
+	}
+	return hdr_end;
+}
+
+static bool is_request(struct o_coap_packet *packet)
+{
+	if ((CODE_CLASS_MASK & packet->header.code) == REQUEST_CLASS) {
+		return true;
 	} else {
-		/* No any options! */
-		out->options_cnt = 0;
+		return false;
 	}
-	return ok;
 }
 
 /**
- * @brief Parse incoming options byte string into options structure
- * @param in_data: pointer to input data in byte string format
- * @param in_data_len: length of input byte string
- * @param out_options: pointer to output options structure array
- * @param out_options_count: count number of output options
- * @return  err
+ * @brief Decrypts a parsed OSCORE packet in place and rebuilds the CoAP 
+ *        packet inside the same buffer. 
+ * 
+ *        The ciphertext is decrypted where it is. The payload of the 
+ *        plaintext stays where it is and the CoAP packet is built 
+ *        backwards in front of it: the merged U- and E-options are written 
+ *        from the last to the first and the header and token are moved in 
+ *        front of them. Only the (short) E-options are copied out of the 
+ *        buffer, because they are overwritten while the options are 
+ *        merged.
+ * 
+ * @param oscore_packet the parsed OSCORE packet
+ * @param oscore_option the parsed OSCORE option of oscore_packet
+ * @param buf the buffer containing the OSCORE packet
+ * @param coap start of the resulting CoAP packet inside buf
+ * @param coap_len length of the CoAP packet
+ * @param c the security context matching the packet
+ * @param ex the exchange of the request
+ * @return err
  */
-static inline enum err
-oscore_packet_options_parser(uint8_t *in_data, uint16_t in_data_len,
-			     struct o_coap_option *out_options,
-			     uint8_t *out_options_count)
+static enum err
+oscore_packet_decrypt(struct o_coap_packet *oscore_packet,
+		      struct compressed_oscore_option *oscore_option,
+		      uint8_t *buf, uint8_t **coap, uint32_t *coap_len,
+		      struct context *c, struct oscore_exchange *ex)
 {
-	uint8_t *temp_options_ptr = in_data;
-	uint8_t temp_options_count = 0;
-	uint8_t temp_option_header_len = 0;
-	uint8_t temp_option_delta = 0;
-	uint8_t temp_option_len = 0;
-	uint8_t temp_option_number = 0;
-
-	// Go through the in_data to find out how many options are there
-	uint16_t i = 0;
-	while (i < in_data_len) {
-		temp_option_header_len = 1;
-		// Parser first byte,lower 4 bits for option value length and higher 4 bits for option delta
-		temp_option_delta = ((*temp_options_ptr) & 0xF0) >> 4;
-		temp_option_len = (*temp_options_ptr) & 0x0F;
-
-		temp_options_ptr++;
-
-		// Special cases for extended option delta: 13 - 1 extra delta byte, 14 - 2 extra delta bytes, 15 - reserved
-		switch (temp_option_delta) {
-		case 13:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 1);
-			temp_option_delta = (uint8_t)(*temp_options_ptr - 13);
-			temp_options_ptr += 1;
-			break;
-		case 14:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 2);
-			temp_option_delta =
-				(uint8_t)(((*temp_options_ptr) << 8 |
-					   *(temp_options_ptr + 1)) -
-					  269);
-			temp_options_ptr += 2;
-			break;
-		case 15:
-			// ERROR
-			return oscore_inpkt_invalid_option_delta;
-			break;
-		default:
-			break;
-		}
+	uint64_t ssn = 0;
+
+	if (is_request(oscore_packet)) {
+		/*check is the packet is replayed*/
+		TRY(piv2ssn(&oscore_option->piv, &ssn));
+		TRY(replay_check(&c->rc.replay_window, ssn));
+
+		/*If this is a request message we need to calculate the nonce, 
+		aad and eventually update the Common IV, Sender and Recipient 
+		Keys*/
+		TRY(context_update(
+			SERVER, (struct o_coap_option *)&oscore_packet->options,
+			oscore_packet->options_cnt, &oscore_option->piv,
+			&oscore_option->kid_context, c, ex));
+	}
 
-		// Special cases for extended option value length: 13 - 1 extra length byte, 14 - 2 extra length bytes, 15 - reserved
-		switch (temp_option_len) {
-		case 13:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 1);
-			temp_option_len = (uint8_t)(*temp_options_ptr - 13);
-			temp_options_ptr += 1;
-			break;
-		case 14:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 2);
-			temp_option_len = (uint8_t)(((*temp_options_ptr) << 8 |
-						     *(temp_options_ptr + 1)) -
-						    269);
-			temp_options_ptr += 2;
-			break;
-		case 15:
-			// ERROR
-			return oscore_inpkt_invalid_optionlen;
-			break;
-		default:
-			break;
-		}
+	/*The plaintext is shorter than the ciphertext because of the 
+	authentication tag. It contains at least the code.*/
+	if (oscore_packet->payload_len <= AUTH_TAG_LEN) {
+		return not_valid_input_packet;
+	}
+	struct byte_array ciphertext = {
+		.len = oscore_packet->payload_len,
+		.ptr = oscore_packet->payload,
+	};
+	struct byte_array plaintext = {
+		.len = oscore_packet->payload_len - AUTH_TAG_LEN,
+		.ptr = oscore_packet->payload,
+	};
+	TRY(oscore_cose_decrypt(&ciphertext, &plaintext, &ex->nonce,
+				&ex->aad, &c->rc.recipient_aead_key));
 
-		temp_option_number =
-			(uint8_t)(temp_option_number + temp_option_delta);
-		// Update in output options
-		out_options[temp_options_count].delta = temp_option_delta;
-		out_options[temp_options_count].len = temp_option_len;
-		out_options[temp_options_count].option_number =
-			temp_option_number;
-		if (temp_option_len == 0)
-			out_options[temp_options_count].value = NULL;
-		else
-			out_options[temp_options_count].value =
-				temp_options_ptr;
+	/*update the replay window after the decryption, this fails if a copy 
+	of the request was accepted concurrently*/
+	if (is_request(oscore_packet)) {
+		TRY(replay_window_update(&c->rc.replay_window, ssn));
+	}
+
+	/*plaintext = code | E-options | 0xFF | payload*/
+	uint8_t code = plaintext.ptr[0];
+	uint8_t *e_opt = plaintext.ptr + 1;
+	uint8_t *plaintext_end = plaintext.ptr + plaintext.len;
+	struct o_coap_option e_options[MAX_OPTION_COUNT];
+	uint8_t e_options_cnt = 0;
+	uint32_t e_opt_len = 0;
+	TRY(buf2options(e_opt, plaintext.len - 1, e_options, &e_options_cnt,
+			&e_opt_len));
+
+	uint8_t *payload = NULL;
+	uint32_t payload_len = 0;
+	if (e_opt + e_opt_len + 1 < plaintext_end) {
+		payload = e_opt + e_opt_len + 1;
+		payload_len = (uint32_t)(plaintext_end - payload);
+	}
 
-		// Update parameters
-		i = (uint16_t)(i + temp_option_header_len + temp_option_len);
-		temp_options_ptr += temp_option_len;
-		temp_options_count++;
+	/*the E-options are overwritten while the options are merged, their 
+	values are taken from a copy*/
+	uint8_t e_opt_bytes[MAX_COAP_OPTIONS_LEN];
+	if (e_opt_len > 0) {
+		TRY(_memcpy_s(e_opt_bytes, sizeof(e_opt_bytes), e_opt,
+			      e_opt_len));
+	}
+	for (uint8_t i = 0; i < e_options_cnt; i++) {
+		if (e_options[i].value != NULL) {
+			e_options[i].value =
+				e_opt_bytes + (e_options[i].value - e_opt);
+		}
 	}
 
-	// Assign options count number
-	*out_options_count = temp_options_count;
+	/*The CoAP packet ends with the payload of the plaintext, without 
+	payload the options end where the ciphertext ended*/
+	uint8_t *end;
+	if (payload_len != 0) {
+		end = payload - 1;
+	} else {
+		end = ciphertext.ptr + ciphertext.len;
+	}
+	uint32_t hdr_len = (uint32_t)HEADER_LEN + oscore_packet->header.TKL;
+	uint8_t *w = end;
+	int16_t u = prev_u_option(oscore_packet,
+				  (int16_t)oscore_packet->options_cnt);
+	int16_t e = (int16_t)(e_options_cnt - 1);
+
+	/*merge the U- and E-options from the last to the first, on equal 
+	option numbers U-options come first*/
+	while (u >= 0 || e >= 0) {
+		struct o_coap_option *o;
+		if (u >= 0 &&
+		    (e < 0 || oscore_packet->options[u].option_number >
+				      e_options[e].option_number)) {
+			o = &oscore_packet->options[u];
+			u = prev_u_option(oscore_packet, u);
+		} else {
+			o = &e_options[e];
+			e--;
+		}
+
+		uint16_t prev_number = 0;
+		if (u >= 0) {
+			prev_number = oscore_packet->options[u].option_number;
+		}
+		if (e >= 0 && e_options[e].option_number > prev_number) {
+			prev_number = e_options[e].option_number;
+		}
+		uint16_t delta = (uint16_t)(o->option_number - prev_number);
+		uint32_t o_len = (uint32_t)1 + option_ext_len(delta) +
+				 option_ext_len(o->len) + o->len;
+
+		/*never overwrite U-options which are still to be copied*/
+		uint8_t *limit = sources_end(oscore_packet, u, buf + hdr_len);
+		if (w < limit || (uint32_t)(w - limit) < o_len) {
+			return not_valid_input_packet;
+		}
+		w -= o->len;
+		if (o->len != 0) {
+			memmove(w, o->value, o->len);
+		}
+		w -= o_len - o->len;
+		option_header_encode(delta, o->len, w);
+	}
 
+	/*header and token*/
+	if (w < buf + hdr_len) {
+		return not_valid_input_packet;
+	}
+	w -= hdr_len;
+	memmove(w, buf, hdr_len);
+	w[1] = code;
+
+	*coap = w;
+	if (payload_len != 0) {
+		*end = 0xFF;
+		*coap_len = (uint32_t)(payload + payload_len - w);
+	} else {
+		*coap_len = (uint32_t)(end - w);
+	}
+	PRINT_ARRAY("Converted CoAP packet", *coap, *coap_len);
 	return ok;
 }
 
 /**
- * @brief Parse the decrypted OSCORE payload into code, E-options and original unprotected CoAP payload
- * @param in_payload: input decrypted payload
- * @param out_code: pointer to code number of the request
- * @param out_E_options: output pointer to an array of E-options
- * @param E_options_cnt: count number of E-options
- * @param out_o_coap_payload: output pointer original unprotected CoAP payload
- * @return  err
+ * @brief Decrypts a response of a client with a table of outstanding 
+ *        requests. The nonce and the AAD are computed from the PIV of the 
+ *        request with the token of the response. The request is removed 
+ *        from the table when the response was verified.
+ * @param oscore_packet the parsed response
+ * @param oscore_option the parsed OSCORE option of oscore_packet
+ * @param buf the buffer containing the response
+ * @param coap start of the resulting CoAP packet inside buf
+ * @param coap_len length of the CoAP packet
+ * @param c the security context of the client
+ * @return err, oscore_request_not_found if no request has the token
  */
-static inline enum err oscore_decrypted_payload_parser(
-	struct byte_array *in_payload, uint8_t *out_code,
-	struct o_coap_option *out_E_options, uint8_t *E_options_cnt,
-	struct byte_array *out_o_coap_payload)
+static enum err response_decrypt(struct o_coap_packet *oscore_packet,
+				 struct compressed_oscore_option *oscore_option,
+				 uint8_t *buf, uint8_t **coap,
+				 uint32_t *coap_len, struct context *c)
 {
-	uint8_t *temp_payload_ptr = in_payload->ptr;
-	uint32_t temp_payload_len = in_payload->len;
+	/*the token is moved in buf during the decryption*/
+	uint8_t token_buf[MAX_TOKEN_LEN];
+	struct byte_array token = {
+		.len = oscore_packet->header.TKL,
+		.ptr = token_buf,
+	};
+	if (token.len != 0) {
+		TRY(_memcpy_s(token_buf, sizeof(token_buf),
+			      oscore_packet->token, token.len));
+	}
 
-	/* Code */
-	*out_code = *(temp_payload_ptr++);
-	temp_payload_len--;
+	struct oscore_exchange request;
+	oscore_exchange_init(&request);
+	TRY(oscore_request_table_lookup(c->rrc.requests, &token,
+					&request.piv));
+	TRY(context_update(CLIENT, NULL, 0, NULL, NULL, c, &request));
 
-	/* Check whether E-options exists */
-	if (*temp_payload_ptr == 0xFF || temp_payload_len == 0) {
-		*E_options_cnt = 0;
-	} else {
-		uint8_t *temp_option_ptr = temp_payload_ptr;
-		/* Length of E-options byte string*/
-		uint16_t options_len = 0;
-
-		/* Move the temp_ptr to the original unprotected payload */
-		while (*temp_payload_ptr != 0xFF && temp_payload_len != 0) {
-			temp_payload_len--;
-			temp_payload_ptr++;
-			options_len++;
-		}
+	TRY(oscore_packet_decrypt(oscore_packet, oscore_option, buf, coap,
+				  coap_len, c, &request));
+	return oscore_request_table_remove(c->rrc.requests, &token);
+}
 
-		/* Parser all options */
-		if (options_len > 0) {
-			TRY(oscore_packet_options_parser(
-				temp_option_ptr, options_len, out_E_options,
-				E_options_cnt));
+/**
+ * @brief Parses an incoming packet and its OSCORE option, if any
+ * @param buf the incoming packet
+ * @param buf_len length of buf
+ * @param packet the parsed packet
+ * @param oscore_option the parsed OSCORE option
+ * @param oscore_pkg_flag true if the packet contains an OSCORE option
+ * @return err
+ */
+static enum err packet_parse(uint8_t *buf, uint32_t buf_len,
+			     struct o_coap_packet *packet,
+			     struct compressed_oscore_option *oscore_option,
+			     bool *oscore_pkg_flag)
+{
+	struct byte_array in = {
+		.len = buf_len,
+		.ptr = buf,
+	};
 
-		} else
-			*E_options_cnt = 0;
-	}
+	PRINT_ARRAY("Input OSCORE packet", buf, buf_len);
 
-	/* Unprotected CoAP payload */
-	++temp_payload_ptr;
-	if (temp_payload_len == 0) {
-		out_o_coap_payload->len = 0;
-		out_o_coap_payload->ptr = NULL;
-	} else {
-		/* Minus byte of 0xFF */
-		out_o_coap_payload->len = (uint32_t)(temp_payload_len - 1);
-		out_o_coap_payload->ptr = temp_payload_ptr;
-	}
+	/*Parse the incoming message into a CoAP struct*/
+	TRY(buf2coap(&in, packet));
 
-	return ok;
+	/* Check if the packet is OSCORE packet and if so parse the OSCORE option */
+	return oscore_option_parser(packet, oscore_option, oscore_pkg_flag);
 }
 
 /**
- * @brief Generate CoAP packet from OSCORE packet
- * @param decrypted_payload: decrypted OSCORE payload, which contains code, E-options and original unprotected CoAP payload
- * @param in_oscore_packet:  input OSCORE packet
- * @param out: pointer to output CoAP packet
- * @return
+ * @brief Copies a packet into the output buffer of the not in place API 
+ *        variants, which then work in place on that copy
  */
-static inline enum err
-o_coap_pkg_generate(struct byte_array *decrypted_payload,
-		    struct o_coap_packet *in_oscore_packet,
-		    struct o_coap_packet *out)
+static enum err packet_copy(uint8_t *buf_in, uint32_t buf_in_len,
+			    uint8_t *buf_out, uint32_t buf_out_len)
 {
-	uint8_t code = 0;
-	struct byte_array unprotected_o_coap_payload = {
-		.len = 0,
-		.ptr = NULL,
-	};
-	struct o_coap_option E_options[10];
-	uint8_t E_options_cnt = 0;
-
-	/* Parse decrypted payload: code + options + unprotected CoAP payload*/
-	TRY(oscore_decrypted_payload_parser(decrypted_payload, &code, E_options,
-					    &E_options_cnt,
-					    &unprotected_o_coap_payload));
-
-	/* Copy each items from OSCORE packet to CoAP packet */
-	/* Header */
-	out->header.ver = in_oscore_packet->header.ver;
-	out->header.type = in_oscore_packet->header.type;
-	out->header.TKL = in_oscore_packet->header.TKL;
-	out->header.code = code;
-	out->header.MID = in_oscore_packet->header.MID;
-
-	/* Token */
-	if (in_oscore_packet->header.TKL == 0)
-		out->token = NULL;
-	else
-		out->token = in_oscore_packet->token;
-
-	/* Payload */
-	out->payload_len = unprotected_o_coap_payload.len;
-	if (unprotected_o_coap_payload.len == 0)
-		out->payload = NULL;
-	else
-		out->payload = unprotected_o_coap_payload.ptr;
-
-	/* reorder all options, and copy it to output coap packet */
-	TRY(options_from_oscore_reorder(in_oscore_packet, E_options,
-					E_options_cnt, out));
+	if (buf_in != buf_out) {
+		TRY(_memcpy_s(buf_out, buf_out_len, buf_in, buf_in_len));
+	}
 	return ok;
 }
 
-static bool is_request(struct o_coap_packet *packet)
+/**
+ * @brief Decrypts a parsed OSCORE packet with a given context, see 
+ *        oscore2coap_in_place()
+ */
+static enum err packet_decrypt(struct o_coap_packet *oscore_packet,
+			       struct compressed_oscore_option *oscore_option,
+			       uint8_t *buf, uint8_t **coap, uint32_t *coap_len,
+			       struct context *c, struct oscore_exchange *e)
 {
-	if ((CODE_CLASS_MASK & packet->header.code) == REQUEST_CLASS) {
-		return true;
-	} else {
-		return false;
+	/*In requests the OSCORE packet contains at least a KID = sender ID 
+	and eventually sender sequence number*/
+	if (is_request(oscore_packet)) {
+		/*Check that the recipient context c->rc has a  Recipient ID that
+		 matches the received with the oscore option KID (Sender ID).
+		 If this is not true return an error which indicates the caller
+		 application to tray another context. This is useful when the caller
+		 app doesn't know in advance to which context an incoming packet 
+		 belongs. Servers with many contexts should use 
+		 oscore2coap_table() instead.*/
+		if (!array_equals(&c->rc.recipient_id, &oscore_option->kid)) {
+			return oscore_kid_recipent_id_mismatch;
+		}
+	} else if (c->rrc.requests != NULL) {
+		return response_decrypt(oscore_packet, oscore_option, buf, coap,
+					coap_len, c);
 	}
+
+	return oscore_packet_decrypt(oscore_packet, oscore_option, buf, coap,
+				     coap_len, c, e);
 }
 
-static inline enum err replay_check(uint64_t sender_sequence_number,
-				    uint64_t *replay_window,
-				    uint8_t replay_window_len)
+enum err oscore2coap_in_place(uint8_t *buf, uint32_t buf_len, uint8_t **coap,
+			      uint32_t *coap_len, bool *oscore_pkg_flag,
+			      struct context *c, struct oscore_exchange *e)
 {
-	bool first_run = true;
+	struct o_coap_packet oscore_packet;
+	struct compressed_oscore_option oscore_option;
 
-	if (first_run) {
-		first_run = false;
+	PRINT_MSG("\n\n\noscore2coap***************************************\n");
+
+	*coap = buf;
+	*coap_len = buf_len;
+	TRY(packet_parse(buf, buf_len, &oscore_packet, &oscore_option,
+			 oscore_pkg_flag));
+
+	/* If the incoming packet is OSCORE packet -- analyze and and decrypt it. */
+	if (!*oscore_pkg_flag) {
 		return ok;
+	}
+
+	return packet_decrypt(&oscore_packet, &oscore_option, buf, coap,
+			      coap_len, c, e);
+}
+
+enum err oscore2coap_exchange(uint8_t *buf_in, uint32_t buf_in_len,
+			      uint8_t *buf_out, uint32_t *buf_out_len,
+			      bool *oscore_pkg_flag, struct context *c,
+			      struct oscore_exchange *e)
+{
+	uint8_t *coap;
+	uint32_t coap_len;
+
+	TRY(packet_copy(buf_in, buf_in_len, buf_out, *buf_out_len));
+	TRY(oscore2coap_in_place(buf_out, buf_in_len, &coap, &coap_len,
+				 oscore_pkg_flag, c, e));
+	if (*oscore_pkg_flag) {
+		memmove(buf_out, coap, coap_len);
+		*buf_out_len = coap_len;
 	} else {
-		/*if the sender sequence number is bigger than the 
-		right most element -> all good */
-		if (sender_sequence_number >
-		    replay_window[replay_window_len - 1]) {
-			return ok;
-		}
+		*buf_out_len = buf_in_len;
+	}
+	return ok;
+}
 
-		/*if the sender sequence number is smaller than the 
-		left most element -> a replay is detected*/
-		if (sender_sequence_number < replay_window[0]) {
-			return replayed_packed_received;
-		}
+enum err oscore2coap(uint8_t *buf_in, uint32_t buf_in_len, uint8_t *buf_out,
+		     uint32_t *buf_out_len, bool *oscore_pkg_flag,
+		     struct context *c)
+{
+	return oscore2coap_exchange(buf_in, buf_in_len, buf_out, buf_out_len,
+				    oscore_pkg_flag, c, &c->rrc.exchange);
+}
 
-		/*if the sender sequence number is in the replay window
-		-> a replay is detected*/
-		for (uint8_t i = 0; i < replay_window_len; i++) {
-			if (sender_sequence_number == replay_window[i]) {
-				return replayed_packed_received;
-			}
-		}
+enum err oscore2coap_table(uint8_t *buf_in, uint32_t buf_in_len,
+			   uint8_t *buf_out, uint32_t *buf_out_len,
+			   bool *oscore_pkg_flag,
+			   struct oscore_context_table *t, struct context **c,
+			   struct oscore_exchange *e)
+{
+	struct o_coap_packet oscore_packet;
+	struct compressed_oscore_option oscore_option;
+	uint8_t *coap;
+	uint32_t coap_len;
+
+	PRINT_MSG("\n\n\noscore2coap_table*********************************\n");
+
+	*c = NULL;
+	TRY(packet_copy(buf_in, buf_in_len, buf_out, *buf_out_len));
+
+	/*the packet and the OSCORE option are parsed only once, the context 
+	is then found with a single table lookup*/
+	TRY(packet_parse(buf_out, buf_in_len, &oscore_packet, &oscore_option,
+			 oscore_pkg_flag));
+
+	if (!*oscore_pkg_flag) {
+		*buf_out_len = buf_in_len;
+		return ok;
 	}
 
+	/*only requests carry the KID, responses need to be processed with 
+	the context of the corresponding request, see oscore2coap()*/
+	if (!is_request(&oscore_packet)) {
+		return wrong_parameter;
+	}
+
+	TRY(oscore_context_table_lookup(t, &oscore_option.kid_context,
+					&oscore_option.kid, c));
+	if (e == NULL) {
+		e = &(*c)->rrc.exchange;
+	}
+
+	TRY(oscore_packet_decrypt(&oscore_packet, &oscore_option, buf_out,
+				  &coap, &coap_len, *c, e));
+	memmove(buf_out, coap, coap_len);
+	*buf_out_len = coap_len;
 	return ok;
 }
 
-static void insert_sender_seq_number(uint64_t sender_seq_number,
-				     uint64_t *replay_window, uint8_t position)
+/**
+ * @brief Finds the context of a request in a context table. Batches 
+ *        often contain several requests of the same client, therefore the 
+ *        context found for the previous request is checked first.
+ * @param t the table
+ * @param oscore_option the OSCORE option of the request
+ * @param last the context of the previous request or NULL
+ * @param c the found context
+ * @return err
+ */
+static enum err
+batch_context_lookup(struct oscore_context_table *t,
+		     struct compressed_oscore_option *oscore_option,
+		     struct context **last, struct context **c)
 {
-	/*shift all old values to the left*/
-	for (uint8_t j = 0; j < position; j++) {
-		replay_window[j] = replay_window[j + 1];
+	if (*last != NULL &&
+	    array_equals(&(*last)->cc.id_context,
+			 &oscore_option->kid_context) &&
+	    array_equals(&(*last)->rc.recipient_id, &oscore_option->kid)) {
+		*c = *last;
+		return ok;
 	}
-	/*insert the new sender sequence number at a given position*/
-	replay_window[position] = sender_seq_number;
+	TRY(oscore_context_table_lookup(t, &oscore_option->kid_context,
+					&oscore_option->kid, c));
+	*last = *c;
+	return ok;
 }
 
-static void update_replay_window(uint64_t sender_seq_number,
-				 uint64_t *replay_window,
-				 uint8_t replay_window_len)
+/**
+ * @brief Checks if an OSCORE packet of a batch is converted with the 
+ *        exchange stored in its context. Responses received by a context 
+ *        with a table of outstanding requests are verified with the table.
+ *        The code class in buf_out is the same before and after the 
+ *        decryption.
+ * @param p the packet
+ * @return true if the exchange of the context is used
+ */
+static bool batch_uses_context_exchange(struct oscore_batch_packet *p)
 {
-	for (uint8_t i = 0; i < replay_window_len - 1; i++) {
-		if ((replay_window[i] < sender_seq_number) &&
-		    (sender_seq_number < replay_window[i + 1])) {
-			insert_sender_seq_number(sender_seq_number,
-						 replay_window, i);
-			PRINT_ARRAY("Replay window:", (uint8_t *)replay_window,
-				    (uint32_t)(replay_window_len *
-					       sizeof(replay_window[0])));
-			return;
+	if (!p->oscore_pkg_flag || p->e != NULL || p->c == NULL) {
+		return false;
+	}
+	return (p->buf_out[1] & CODE_CLASS_MASK) == REQUEST_CLASS ||
+	       p->c->rrc.requests == NULL;
+}
+
+/**
+ * @brief Checks if an earlier packet of a batch used the exchange stored in 
+ *        the context of packet i. A second request would overwrite the 
+ *        nonce of the first one, which the response to the first request 
+ *        would then reuse.
+ * @param packets the packets of the batch
+ * @param i the index of the packet
+ * @return true if the exchange of the context is taken
+ */
+static bool batch_exchange_taken(struct oscore_batch_packet *packets,
+				 uint32_t i)
+{
+	for (uint32_t j = 0; j < i; j++) {
+		if (packets[j].c == packets[i].c &&
+		    batch_uses_context_exchange(&packets[j])) {
+			return true;
 		}
 	}
-	insert_sender_seq_number(sender_seq_number, replay_window,
-				 (uint8_t)(replay_window_len - 1));
-	PRINT_ARRAY("Replay window:", (uint8_t *)replay_window,
-		    (uint32_t)(replay_window_len * sizeof(replay_window[0])));
+	return false;
 }
 
-enum err oscore2coap(uint8_t *buf_in, uint32_t buf_in_len, uint8_t *buf_out,
-		     uint32_t *buf_out_len, bool *oscore_pkg_flag,
-		     struct context *c)
+/**
+ * @brief Converts one packet of a batch, see oscore2coap_batch()
+ * @param packets the packets of the batch
+ * @param i the index of the packet to be converted
+ * @param t the context table or NULL
+ * @param last the context of the previous request of the batch or NULL
+ * @return err
+ */
+static enum err batch_packet_decrypt(struct oscore_batch_packet *packets,
+				     uint32_t i,
+				     struct oscore_context_table *t,
+				     struct context **last)
 {
-	enum err r = ok;
+	struct oscore_batch_packet *p = &packets[i];
 	struct o_coap_packet oscore_packet;
 	struct compressed_oscore_option oscore_option;
-	struct byte_array buf;
+	uint8_t *coap;
+	uint32_t coap_len;
 
-	PRINT_MSG("\n\n\noscore2coap***************************************\n");
-	PRINT_ARRAY("Input OSCORE packet", buf_in, buf_in_len);
+	p->oscore_pkg_flag = false;
+	TRY(packet_copy(p->buf_in, p->buf_in_len, p->buf_out, p->buf_out_len));
+	TRY(packet_parse(p->buf_out, p->buf_in_len, &oscore_packet,
+			 &oscore_option, &p->oscore_pkg_flag));
 
-	buf.ptr = buf_in;
-	buf.len = buf_in_len;
+	if (!p->oscore_pkg_flag) {
+		p->buf_out_len = p->buf_in_len;
+		return ok;
+	}
 
-	/*Parse the incoming message (buf_in) into a CoAP struct*/
-	TRY(buf2coap(&buf, &oscore_packet));
+	if (t != NULL && is_request(&oscore_packet)) {
+		TRY(batch_context_lookup(t, &oscore_option, last, &p->c));
+	} else if (p->c == NULL) {
+		return wrong_parameter;
+	}
 
-	/* Check if the packet is OSCORE packet and if so parse the OSCORE option */
-	TRY(oscore_option_parser(&oscore_packet, &oscore_option,
-				 oscore_pkg_flag));
+	struct oscore_exchange *e = p->e;
+	if (e == NULL) {
+		if (batch_uses_context_exchange(p) &&
+		    batch_exchange_taken(packets, i)) {
+			return wrong_parameter;
+		}
+		e = &p->c->rrc.exchange;
+	}
 
-	/* If the incoming packet is OSCORE packet -- analyze and and decrypt it. */
-	if (*oscore_pkg_flag) {
-		/*In requests the OSCORE packet contains at least a KID = sender ID 
-        and eventually sender sequence number*/
-		if (is_request(&oscore_packet)) {
-			/*Check that the recipient context c->rc has a  Recipient ID that
-			 matches the received with the oscore option KID (Sender ID).
-			 If this is not true return an error which indicates the caller
-			 application to tray another context. This is useful when the caller
-			 app doesn't know in advance to which context an incoming packet 
-             belongs.*/
-			if (!array_equals(&c->rc.recipient_id,
-					  &oscore_option.kid)) {
-				return oscore_kid_recipent_id_mismatch;
-			}
+	TRY(packet_decrypt(&oscore_packet, &oscore_option, p->buf_out, &coap,
+			   &coap_len, p->c, e));
+	memmove(p->buf_out, coap, coap_len);
+	p->buf_out_len = coap_len;
+	return ok;
+}
 
-			/*check is the packet is replayed*/
-			TRY(replay_check(*oscore_option.piv.ptr,
-					 c->rc.replay_window,
-					 c->rc.replay_window_len));
-
-			/*If this is a request message we need to calculate the nonce, aad 
-            and eventually update the Common IV, Sender and Recipient Keys*/
-			TRY(context_update(
-				SERVER,
-				(struct o_coap_option *)&oscore_packet.options,
-				oscore_packet.options_cnt, &oscore_option.piv,
-				&oscore_option.kid_context, c));
-		}
+enum err oscore2coap_batch(struct oscore_batch_packet *packets,
+			   uint32_t packets_cnt, struct oscore_context_table *t)
+{
+	struct context *last = NULL;
 
-		/* Setup buffer for the plaintext. The plaintext is shorter than the ciphertext because of the authentication tag*/
-		uint32_t plaintext_bytes_len =
-			oscore_packet.payload_len - AUTH_TAG_LEN;
-		TRY(check_buffer_size(MAX_PLAINTEXT_LEN, plaintext_bytes_len));
-		uint8_t plaintext_bytes[MAX_PLAINTEXT_LEN];
-		struct byte_array plaintext = {
-			.len = plaintext_bytes_len,
-			.ptr = plaintext_bytes,
-		};
-
-		/* Decrypt payload */
-		r = payload_decrypt(c, &plaintext, &oscore_packet);
-		if (r == ok) {
-			/*update the replay window after the decryption*/
-			if (is_request(&oscore_packet)) {
-				update_replay_window(*oscore_option.piv.ptr,
-						     c->rc.replay_window,
-						     c->rc.replay_window_len);
-			}
-		} else {
-			return r;
-		}
+	PRINT_MSG("\n\n\noscore2coap_batch*********************************\n");
 
-		/* Generate corresponding CoAP packet */
-		struct o_coap_packet o_coap_packet;
-		TRY(o_coap_pkg_generate(&plaintext, &oscore_packet,
-					&o_coap_packet));
+	if (packets == NULL && packets_cnt != 0) {
+		return wrong_parameter;
+	}
 
-		/*Convert to byte string*/
-		r = coap2buf(&o_coap_packet, buf_out, buf_out_len);
+	for (uint32_t i = 0; i < packets_cnt; i++) {
+		packets[i].result = batch_packet_decrypt(packets, i, t, &last);
 	}
-	return r;
+	return ok;
 }
@@ -38,20 +38,23 @@ enum err options_into_byte_string(struct o_coap_option *options,
 		delta_extra_byte = 0;
 		len_extra_byte = 0;
 
-		/* Special cases for delta and length*/
+		/* the header has at most 5 bytes */
+		uint32_t used = (uint32_t)(temp_ptr - out_byte_string->ptr);
+		TRY(check_buffer_size(out_byte_string_capacity - used, 5));
+
+		/* Special cases for delta and length, see RFC7252 Section 3.1 */
 		if (options[i].delta < 13 && options[i].len < 13)
 			*(temp_ptr) = (uint8_t)(options[i].delta << 4) |
 				      (uint8_t)(options[i].len);
 		else {
-			if (options[i].delta >= 13 && options[i].delta < 243)
+			if (options[i].delta >= 13 && options[i].delta < 269)
 				delta_extra_byte = 1;
-			else if (options[i].delta >= 243)
+			else if (options[i].delta >= 269)
 				delta_extra_byte = 2;
 
-			if (options[i].len >= 13 && options[i].len < 243)
+			/* the length of an option is stored in one byte */
+			if (options[i].len >= 13)
 				len_extra_byte = 1;
-			else if (options[i].len >= 243)
-				len_extra_byte = 2;
 
 			switch (delta_extra_byte) {
 			case 0:
@@ -60,12 +63,12 @@ enum err options_into_byte_string(struct o_coap_option *options,
 			case 1:
 				*(temp_ptr) = (uint8_t)(13 << 4);
 				*(temp_ptr + 1) =
-					(uint8_t)(options[i].delta + 13);
+					(uint8_t)(options[i].delta - 13);
 				break;
 			case 2:
 				*(temp_ptr) = (uint8_t)(14 << 4);
 				uint16_t temp_delta =
-					(uint16_t)(options[i].delta + 269);
+					(uint16_t)(options[i].delta - 269);
 				*(temp_ptr + 1) =
 					(uint8_t)((temp_delta & 0xFF00) >> 8);
 				*(temp_ptr + 2) =
@@ -82,16 +85,7 @@ enum err options_into_byte_string(struct o_coap_option *options,
 			case 1:
 				*(temp_ptr) |= 13;
 				*(temp_ptr + delta_extra_byte + 1) =
-					(uint8_t)(options[i].len + 13);
-				break;
-			case 2:
-				*(temp_ptr) |= 14;
-				uint16_t temp_len =
-					(uint16_t)(options[i].len + 269);
-				*(temp_ptr + delta_extra_byte + 1) =
-					(uint8_t)((temp_len & 0xFF00) >> 8);
-				*(temp_ptr + delta_extra_byte + 2) =
-					(uint8_t)((temp_len & 0x00FF) >> 0);
+					(uint8_t)(options[i].len - 13);
 				break;
 			default:
 				return len_extra_byte_error;
@@ -118,104 +112,89 @@ enum err options_into_byte_string(struct o_coap_option *options,
 }
 
 /**
- * @brief Parse incoming options byte string into options structure
- * @param in_data: pointer to input data in byte string format
- * @param in_data_len: length of input byte string
- * @param out_options: pointer to output options structure array
- * @param out_options_count: count number of output options
- * @return  err
+ * @brief Decodes the extended option delta or option length field, see 
+ *        RFC7252 Section 3.1
+ * @param value in: the 4 bit value, out: the decoded value
+ * @param p in: the position of the extended field, out: the position after 
+ *        the field
+ * @param end end of the options
+ * @param reserved_err the error returned for the reserved value 15
+ * @return err
  */
-static inline enum err buf2options(uint8_t *in_data, uint16_t in_data_len,
-				   struct o_coap_option *out_options,
-				   uint8_t *out_options_count)
+static enum err option_ext_decode(uint32_t *value, uint8_t **p,
+				  const uint8_t *end, enum err reserved_err)
 {
-	uint8_t *temp_options_ptr = in_data;
-	uint8_t temp_options_count = 0;
-	uint8_t temp_option_header_len = 0;
-	uint8_t temp_option_delta = 0;
-	uint8_t temp_option_len = 0;
-	uint8_t temp_option_number = 0;
-
-	/* Go through the in_data to find out how many options are there */
-	uint16_t i = 0;
-	while (i < in_data_len) {
-		temp_option_header_len = 1;
-		/* Parser first byte,lower 4 bits for option value length and higher 4 bits for option delta*/
-		temp_option_delta = ((*temp_options_ptr) & 0xF0) >> 4;
-		temp_option_len = (*temp_options_ptr) & 0x0F;
-
-		temp_options_ptr++;
-
-		/* Special cases for extended option delta: 13 - 1 extra delta byte, 14 - 2 extra delta bytes, 15 - reserved */
-		switch (temp_option_delta) {
-		case 13:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 1);
-			temp_option_delta = (uint8_t)(*temp_options_ptr - 13);
-			temp_options_ptr += 1;
-			break;
-		case 14:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 2);
-			temp_option_delta =
-				(uint8_t)(((*temp_options_ptr) << 8) |
-					  (*(temp_options_ptr + 1) - 269));
-			temp_options_ptr += 2;
-			break;
-		case 15:
-			// ERROR
-			return oscore_inpkt_invalid_option_delta;
-			break;
-		default:
-			break;
+	switch (*value) {
+	case 13:
+		if (end - *p < 1) {
+			return not_valid_input_packet;
 		}
+		*value = (uint32_t)(*p)[0] + 13;
+		*p += 1;
+		break;
+	case 14:
+		if (end - *p < 2) {
+			return not_valid_input_packet;
+		}
+		*value = ((uint32_t)(*p)[0] << 8 | (*p)[1]) + 269;
+		*p += 2;
+		break;
+	case 15:
+		return reserved_err;
+	default:
+		break;
+	}
+	return ok;
+}
 
-		/* Special cases for extended option value length: 13 - 1 extra length byte, 14 - 2 extra length bytes, 15 - reserved */
-		switch (temp_option_len) {
-		case 13:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 1);
-			temp_option_len = (uint8_t)(*temp_options_ptr + 13);
-			temp_options_ptr += 1;
-			break;
-		case 14:
-			temp_option_header_len =
-				(uint8_t)(temp_option_header_len + 2);
-			temp_option_len =
-				(uint8_t)(((*temp_options_ptr) << 8) |
-					  (*(temp_options_ptr + 1) + 269));
-			temp_options_ptr += 2;
-			break;
-		case 15:
-			/* ERROR */
-			return oscore_inpkt_invalid_optionlen;
-			break;
-		default:
-			break;
+enum err buf2options(uint8_t *in_data, uint32_t in_data_len,
+		     struct o_coap_option *out_options,
+		     uint8_t *out_options_count, uint32_t *options_len)
+{
+	uint8_t *p = in_data;
+	const uint8_t *end = in_data + in_data_len;
+	uint32_t option_number = 0;
+	uint8_t cnt = 0;
+
+	/*the options end with the payload marker or with the data. The 
+	marker cannot be confused with an option header, since delta 15 is 
+	reserved, but it can appear inside option values.*/
+	while (p < end && *p != 0xFF) {
+		uint32_t delta = (*p & 0xF0) >> 4;
+		uint32_t len = *p & 0x0F;
+		p++;
+
+		TRY(option_ext_decode(&delta, &p, end,
+				      oscore_inpkt_invalid_option_delta));
+		TRY(option_ext_decode(&len, &p, end,
+				      oscore_inpkt_invalid_optionlen));
+		if (len > (uint32_t)(end - p)) {
+			return not_valid_input_packet;
 		}
 
-		temp_option_number =
-			(uint8_t)(temp_option_number + temp_option_delta);
-		/* Update in output options */
-		out_options[temp_options_count].delta = temp_option_delta;
-		out_options[temp_options_count].len = temp_option_len;
-		out_options[temp_options_count].option_number =
-			temp_option_number;
-		if (temp_option_len == 0)
-			out_options[temp_options_count].value = NULL;
-		else
-			out_options[temp_options_count].value =
-				temp_options_ptr;
-
-		/* Update parameters*/
-		i = (uint16_t)(i + temp_option_header_len + temp_option_len);
-		temp_options_ptr += temp_option_len;
-		temp_options_count++;
-	}
+		/*option numbers are stored in two bytes, lengths in one*/
+		option_number += delta;
+		if (option_number > UINT16_MAX || len > UINT8_MAX) {
+			return not_valid_input_packet;
+		}
+		if (cnt >= MAX_OPTION_COUNT) {
+			return buffer_to_small;
+		}
 
-	// Assign options count number
-	*out_options_count = temp_options_count;
+		out_options[cnt].delta = (uint16_t)delta;
+		out_options[cnt].len = (uint8_t)len;
+		out_options[cnt].option_number = (uint16_t)option_number;
+		if (len == 0) {
+			out_options[cnt].value = NULL;
+		} else {
+			out_options[cnt].value = p;
+		}
+		p += len;
+		cnt++;
+	}
 
+	*out_options_count = cnt;
+	*options_len = (uint32_t)(p - in_data);
 	return ok;
 }
 
@@ -241,64 +220,38 @@ enum err buf2coap(struct byte_array *in, struct o_coap_packet *out)
 	tmp_p += 4;
 	payload_len -= 4;
 
-	if (payload_len != 0) {
-		/*Read the token, if it exists*/
-		if (out->header.TKL == 0) {
-			out->token = NULL;
-		} else if (out->header.TKL <= 8) {
-			out->token = tmp_p;
-		} else {
-			/* ERROR: CoAP token length maximal 8 bytes */
-			return oscore_inpkt_invalid_tkl;
-		}
-		/* Update pointer and length */
-		tmp_p += out->header.TKL;
-		payload_len -= out->header.TKL;
+	/*Read the token, if it exists*/
+	if (out->header.TKL > MAX_TOKEN_LEN) {
+		/* ERROR: CoAP token length maximal 8 bytes */
+		return oscore_inpkt_invalid_tkl;
+	}
+	if (out->header.TKL > payload_len) {
+		return not_valid_input_packet;
+	}
+	if (out->header.TKL == 0) {
+		out->token = NULL;
+	} else {
+		out->token = tmp_p;
 	}
+	/* Update pointer and length */
+	tmp_p += out->header.TKL;
+	payload_len -= out->header.TKL;
 
 	/* Options, if any */
-	if (payload_len != 0) {
-		/* Check if there any options exist*/
-		if (*tmp_p == 0xFF) {
-			/* No options*/
-			out->options_cnt = 0;
-		} else {
-			/* Length of options byte string */
-			uint16_t options_len = 0;
-			uint8_t *temp_option_ptr = tmp_p;
-
-			/* Move tmp_p to the payload to get the length of options byte string*/
-
-			if (payload_len != 0) {
-				while (*tmp_p != 0xFF) {
-					payload_len--;
-					tmp_p++;
-					options_len++;
-					if (payload_len == 0) {
-						break;
-					}
-				}
-			}
-
-			/* Parser all options */
-			if (options_len > 0) {
-				TRY(buf2options(temp_option_ptr, options_len,
-						out->options,
-						&(out->options_cnt)));
-
-			} else {
-				out->options_cnt = 0;
-			}
-		}
-	}
-	/* Payload, if any */
-	++tmp_p;
+	uint32_t options_len;
+	TRY(buf2options(tmp_p, payload_len, out->options, &out->options_cnt,
+			&options_len));
+	tmp_p += options_len;
+	payload_len -= options_len;
+
+	/* Payload, if any. If there are bytes left tmp_p points to the payload 
+	marker */
 	if (payload_len == 0) {
 		out->payload_len = 0;
 		out->payload = NULL;
 	} else {
 		out->payload_len = --payload_len;
-		out->payload = tmp_p;
+		out->payload = ++tmp_p;
 	}
 
 	return ok;
@@ -0,0 +1,104 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdint.h>
+
+#include "oscore/oscore_coap.h"
+#include "oscore/replay_protection.h"
+
+#include "common/atomic_ops.h"
+#include "common/byte_array.h"
+#include "common/oscore_edhoc_error.h"
+#include "common/print_util.h"
+
+enum err replay_window_init(struct replay_window *w, uint8_t len)
+{
+	if (len == 0) {
+		len = REPLAY_WINDOW_LEN;
+	}
+	if (len > REPLAY_WINDOW_MAX_LEN) {
+		return wrong_parameter;
+	}
+	/*with an empty bitmap ssn_max = 0 is not marked as received, i.e., 
+	the first request may start with any sender sequence number*/
+	w->ssn_max = 0;
+	w->bitmap = 0;
+	w->len = len;
+	w->lock = false;
+	return ok;
+}
+
+enum err piv2ssn(const struct byte_array *piv, uint64_t *ssn)
+{
+	if (piv->len == 0 || piv->len > MAX_PIV_LEN) {
+		return oscore_inpkt_invalid_piv;
+	}
+	*ssn = 0;
+	for (uint32_t i = 0; i < piv->len; i++) {
+		*ssn = (*ssn << 8) | piv->ptr[i];
+	}
+	return ok;
+}
+
+/**
+ * @brief   Same as replay_check() but the caller holds the lock
+ */
+static enum err replay_check_locked(const struct replay_window *w,
+				    uint64_t ssn)
+{
+	if (ssn > w->ssn_max) {
+		return ok;
+	}
+
+	uint64_t diff = w->ssn_max - ssn;
+	if (diff >= w->len || (w->bitmap & ((uint64_t)1 << diff))) {
+		PRINTF("Replayed or too old sender sequence number %llu\n",
+		       (unsigned long long)ssn);
+		return replayed_packed_received;
+	}
+	return ok;
+}
+
+enum err replay_check(struct replay_window *w, uint64_t ssn)
+{
+	spin_lock(&w->lock);
+	enum err r = replay_check_locked(w, ssn);
+	spin_unlock(&w->lock);
+	return r;
+}
+
+enum err replay_window_update(struct replay_window *w, uint64_t ssn)
+{
+	spin_lock(&w->lock);
+	enum err r = replay_check_locked(w, ssn);
+	if (r != ok) {
+		spin_unlock(&w->lock);
+		return r;
+	}
+
+	if (ssn > w->ssn_max) {
+		uint64_t shift = ssn - w->ssn_max;
+		if (shift >= REPLAY_WINDOW_MAX_LEN) {
+			w->bitmap = 0;
+		} else {
+			w->bitmap <<= shift;
+		}
+		w->ssn_max = ssn;
+		w->bitmap |= 1;
+	} else {
+		w->bitmap |= (uint64_t)1 << (w->ssn_max - ssn);
+	}
+	if (w->len < REPLAY_WINDOW_MAX_LEN) {
+		w->bitmap &= ((uint64_t)1 << w->len) - 1;
+	}
+	spin_unlock(&w->lock);
+	return ok;
+}
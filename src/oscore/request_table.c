@@ -0,0 +1,156 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "oscore/request_table.h"
+
+#include "common/atomic_ops.h"
+#include "common/byte_array.h"
+#include "common/oscore_edhoc_error.h"
+
+/**
+ * @brief   Finds the used entry with a given token. The caller holds the 
+ *          lock.
+ * @retval  the entry or NULL
+ */
+static struct oscore_request *find(struct oscore_request_table *t,
+				   const struct byte_array *token)
+{
+	for (uint32_t i = 0; i < t->entries_cnt; i++) {
+		struct oscore_request *r = &t->entries[i];
+		if (r->used && r->token_len == token->len &&
+		    (token->len == 0 ||
+		     memcmp(r->token, token->ptr, token->len) == 0)) {
+			return r;
+		}
+	}
+	return NULL;
+}
+
+enum err oscore_request_table_init(struct oscore_request_table *t,
+				   struct oscore_request *entries,
+				   uint32_t entries_cnt)
+{
+	if (entries == NULL || entries_cnt == 0) {
+		return wrong_parameter;
+	}
+	for (uint32_t i = 0; i < entries_cnt; i++) {
+		entries[i].used = false;
+		entries[i].pending = false;
+	}
+	t->entries = entries;
+	t->entries_cnt = entries_cnt;
+	t->lock = false;
+	return ok;
+}
+
+enum err oscore_request_table_reserve(struct oscore_request_table *t,
+				      const struct byte_array *token,
+				      struct oscore_request **r)
+{
+	if (token->len > MAX_TOKEN_LEN) {
+		return wrong_parameter;
+	}
+
+	spin_lock(&t->lock);
+	struct oscore_request *e = find(t, token);
+	for (uint32_t i = 0; e == NULL && i < t->entries_cnt; i++) {
+		if (!t->entries[i].used) {
+			e = &t->entries[i];
+		}
+	}
+	if (e == NULL) {
+		spin_unlock(&t->lock);
+		return oscore_request_table_full;
+	}
+
+	if (token->len != 0) {
+		memcpy(e->token, token->ptr, token->len);
+	}
+	e->token_len = (uint8_t)token->len;
+	e->piv_len = 0;
+	e->pending = true;
+	e->used = true;
+	spin_unlock(&t->lock);
+	*r = e;
+	return ok;
+}
+
+enum err oscore_request_table_commit(struct oscore_request_table *t,
+				     struct oscore_request *r,
+				     const struct byte_array *piv)
+{
+	if (piv->len > MAX_PIV_LEN) {
+		oscore_request_table_release(t, r);
+		return wrong_parameter;
+	}
+
+	spin_lock(&t->lock);
+	memcpy(r->piv, piv->ptr, piv->len);
+	r->piv_len = (uint8_t)piv->len;
+	r->pending = false;
+	spin_unlock(&t->lock);
+	return ok;
+}
+
+void oscore_request_table_release(struct oscore_request_table *t,
+				  struct oscore_request *r)
+{
+	spin_lock(&t->lock);
+	r->used = false;
+	r->pending = false;
+	spin_unlock(&t->lock);
+}
+
+enum err oscore_request_table_insert(struct oscore_request_table *t,
+				     const struct byte_array *token,
+				     const struct byte_array *piv)
+{
+	struct oscore_request *r;
+
+	if (piv->len > MAX_PIV_LEN) {
+		return wrong_parameter;
+	}
+	TRY(oscore_request_table_reserve(t, token, &r));
+	return oscore_request_table_commit(t, r, piv);
+}
+
+enum err oscore_request_table_lookup(struct oscore_request_table *t,
+				     const struct byte_array *token,
+				     struct byte_array *piv)
+{
+	spin_lock(&t->lock);
+	struct oscore_request *r = find(t, token);
+	if (r == NULL || r->pending) {
+		spin_unlock(&t->lock);
+		return oscore_request_not_found;
+	}
+	memcpy(piv->ptr, r->piv, r->piv_len);
+	piv->len = r->piv_len;
+	spin_unlock(&t->lock);
+	return ok;
+}
+
+enum err oscore_request_table_remove(struct oscore_request_table *t,
+				     const struct byte_array *token)
+{
+	spin_lock(&t->lock);
+	struct oscore_request *r = find(t, token);
+	if (r != NULL) {
+		r->used = false;
+	}
+	spin_unlock(&t->lock);
+	return (r != NULL) ? ok : oscore_request_not_found;
+}
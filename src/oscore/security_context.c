@@ -19,6 +19,7 @@
 #include "oscore/nonce.h"
 #include "oscore/oscore_coap.h"
 #include "oscore/oscore_hkdf_info.h"
+#include "oscore/replay_protection.h"
 #include "oscore/security_context.h"
 
 #include "common/crypto_wrapper.h"
@@ -26,17 +27,23 @@
 #include "common/memcpy_s.h"
 #include "common/print_util.h"
 
+/*length of the PRK extracted with HKDF-SHA-256*/
+#define OSCORE_PRK_LEN 32
+
 /**
  * @brief       Common derive procedure used to derive the Common IV and 
  *              Sender / Recipient Keys
+ * @param prk   the PRK extracted from the Master Secret and Master Salt, 
+ *              prepared with hmac_key_init()
  * @param cc    pointer to the common context
  * @param id    empty array for Common IV, sender / recipient ID for keys
  * @param type  IV for Common IV, KEY for Sender / Recipient Keys
  * @param out   out-array. Must be initialized
  * @return      err
  */
-static enum err derive(struct common_context *cc, struct byte_array *id,
-		       enum derive_type type, struct byte_array *out)
+static enum err derive(struct hmac_key *prk, struct common_context *cc,
+		       struct byte_array *id, enum derive_type type,
+		       struct byte_array *out)
 {
 	uint8_t info_bytes[MAX_INFO_LEN];
 	struct byte_array info = {
@@ -48,72 +55,73 @@ static enum err derive(struct common_context *cc, struct byte_array *id,
 				    &info));
 
 	PRINT_ARRAY("info struct", info.ptr, info.len);
-
-	switch (cc->kdf) {
-	case OSCORE_SHA_256:
-		TRY(hkdf_sha_256(&cc->master_secret, &cc->master_salt, &info,
-				 out));
-		break;
-	default:
-		return oscore_unknown_hkdf;
-		break;
-	}
-	return ok;
+	return hkdf_expand_prepared(prk, info.ptr, info.len, out->ptr,
+				    out->len);
 }
 
 /**
- * @brief    Derives the Common IV 
- * @param    cc    pointer to the common context
- * @return   err
- */
-static enum err derive_common_iv(struct common_context *cc)
-{
-	TRY(derive(cc, &EMPTY_ARRAY, IV, &cc->common_iv));
-	PRINT_ARRAY("Common IV", cc->common_iv.ptr, cc->common_iv.len);
-	return ok;
-}
-
-/**
- * @brief    Derives the Sender Key 
+ * @brief    Derives the Common IV, the Sender Key and the Recipient Key. 
+ *           The Master Secret and the Master Salt are extracted once and 
+ *           the three expansions share the prepared PRK.
  * @param    cc    pointer to the common context
  * @param    sc    pointer to the sender context
+ * @param    rc    pointer to the recipient context
  * @return   err
  */
-static enum err derive_sender_key(struct common_context *cc,
-				  struct sender_context *sc)
-{
-	TRY(derive(cc, &sc->sender_id, KEY, &sc->sender_key));
-	PRINT_ARRAY("Sender Key", sc->sender_key.ptr, sc->sender_key.len);
-	return ok;
-}
-
-/**
- * @brief    Derives the Recipient Key 
- * @param    cc    pointer to the common context
- * @param    sc    pointer to the recipient context
- * @return   err
- */
-static enum err derive_recipient_key(struct common_context *cc,
-				     struct recipient_context *rc)
+static enum err derive_keys(struct common_context *cc,
+			    struct sender_context *sc,
+			    struct recipient_context *rc)
 {
-	TRY(derive(cc, &rc->recipient_id, KEY, &rc->recipient_key));
+	if (cc->kdf != OSCORE_SHA_256) {
+		return oscore_unknown_hkdf;
+	}
 
+	uint8_t prk_buf[OSCORE_PRK_LEN];
+	struct hmac_key prk = { .initialized = false };
+	TRY(hkdf_extract(SHA_256, cc->master_salt.ptr, cc->master_salt.len,
+			 cc->master_secret.ptr, cc->master_secret.len,
+			 prk_buf));
+	enum err r = hmac_key_init(SHA_256, &prk, prk_buf, sizeof(prk_buf));
+	memset(prk_buf, 0, sizeof(prk_buf));
+	if (r == ok) {
+		r = derive(&prk, cc, &EMPTY_ARRAY, IV, &cc->common_iv);
+	}
+	if (r == ok) {
+		r = derive(&prk, cc, &sc->sender_id, KEY, &sc->sender_key);
+	}
+	if (r == ok) {
+		r = derive(&prk, cc, &rc->recipient_id, KEY,
+			   &rc->recipient_key);
+	}
+	TRY(hmac_key_destroy(&prk));
+	if (r != ok) {
+		return r;
+	}
+	PRINT_ARRAY("Common IV", cc->common_iv.ptr, cc->common_iv.len);
+	PRINT_ARRAY("Sender Key", sc->sender_key.ptr, sc->sender_key.len);
 	PRINT_ARRAY("Recipient Key", rc->recipient_key.ptr,
 		    rc->recipient_key.len);
-	return ok;
+
+	TRY(aead_key_destroy(&sc->sender_aead_key));
+	TRY(aead_key_init(&sc->sender_aead_key, sc->sender_key.ptr,
+			  sc->sender_key.len, AUTH_TAG_LEN));
+	TRY(aead_key_destroy(&rc->recipient_aead_key));
+	return aead_key_init(&rc->recipient_aead_key, rc->recipient_key.ptr,
+			     rc->recipient_key.len, AUTH_TAG_LEN);
 }
 
 enum err context_update(enum dev_type dev, struct o_coap_option *options,
 			uint16_t opt_num, struct byte_array *new_piv,
-			struct byte_array *new_kid_context, struct context *c)
+			struct byte_array *new_kid_context, struct context *c,
+			struct oscore_exchange *e)
 {
 	if (dev == SERVER) {
 		/**************************************************************/
 		/*update PIV*/
-		TRY(_memcpy_s(c->rrc.piv.ptr, MAX_PIV_LEN, new_piv->ptr,
+		TRY(_memcpy_s(e->piv.ptr, MAX_PIV_LEN, new_piv->ptr,
 			      new_piv->len));
 
-		c->rrc.piv.len = new_piv->len;
+		e->piv.len = new_piv->len;
 
 		/**************************************************************/
 		/*update Sender Key, Recipient Key and Common IV if KID context 
@@ -137,20 +145,33 @@ enum err context_update(enum dev_type dev, struct o_coap_option *options,
 			c->cc.id_context.len = new_kid_context->len;
 
 			PRINT_MSG("Common Context Updated*****************\n");
-			TRY(derive_common_iv(&c->cc));
-			TRY(derive_sender_key(&c->cc, &c->sc));
-			TRY(derive_recipient_key(&c->cc, &c->rc));
+			TRY(derive_keys(&c->cc, &c->sc, &c->rc));
+			TRY(create_nonce_template(&c->rrc.kid,
+						  &c->cc.common_iv,
+						  c->cc.nonce_template));
 		}
 	}
 	/**********************************************************************/
 	/*calculate nonce*/
-	TRY(create_nonce(&c->rrc.kid, &c->rrc.piv, &c->cc.common_iv,
-			 &c->rrc.nonce));
+	TRY(create_nonce(c->cc.nonce_template, &e->piv, &e->nonce));
 
 	/**********************************************************************/
 	/*calculate AAD*/
-	return create_aad(options, opt_num, c->cc.aead_alg, &c->rrc.kid,
-			  &c->rrc.piv, &c->rrc.aad);
+	e->aad.len = sizeof(e->aad_buf);
+	return create_aad(options, opt_num, &c->cc.aad_prefix, &e->piv,
+			  &e->aad);
+}
+
+void oscore_exchange_init(struct oscore_exchange *e)
+{
+	e->nonce.len = sizeof(e->nonce_buf);
+	e->nonce.ptr = e->nonce_buf;
+
+	e->aad.len = sizeof(e->aad_buf);
+	e->aad.ptr = e->aad_buf;
+
+	e->piv.len = sizeof(e->piv_buf);
+	e->piv.ptr = e->piv_buf;
 }
 
 enum err oscore_context_init(struct oscore_init_params *params,
@@ -184,33 +205,27 @@ enum err oscore_context_init(struct oscore_init_params *params,
 	c->cc.id_context = params->id_context;
 	c->cc.common_iv.len = sizeof(c->cc.common_iv_buf);
 	c->cc.common_iv.ptr = c->cc.common_iv_buf;
-	TRY(derive_common_iv(&c->cc));
 
-	/*derive Recipient Context*********************************************/
-	c->rc.replay_window_len = REPLAY_WINDOW_LEN;
-	memset(c->rc.replay_window, 0,
-	       sizeof(c->rc.replay_window[0]) * c->rc.replay_window_len);
+	/*Recipient Context****************************************************/
+	TRY(replay_window_init(&c->rc.replay_window,
+			       params->replay_window_len));
 	c->rc.recipient_id = params->recipient_id;
 	c->rc.recipient_key.len = sizeof(c->rc.recipient_key_buf);
 	c->rc.recipient_key.ptr = c->rc.recipient_key_buf;
-	TRY(derive_recipient_key(&c->cc, &c->rc));
+	c->rc.recipient_aead_key.initialized = false;
 
-	/*derive Sender Context************************************************/
+	/*Sender Context*******************************************************/
 	c->sc.sender_id = params->sender_id;
 	c->sc.sender_key.len = sizeof(c->sc.sender_key_buf);
 	c->sc.sender_key.ptr = c->sc.sender_key_buf;
-	TRY(derive_sender_key(&c->cc, &c->sc));
+	c->sc.sender_aead_key.initialized = false;
 	c->sc.sender_seq_num = 0;
 
-	/*set up the request response context**********************************/
-	c->rrc.nonce.len = sizeof(c->rrc.nonce_buf);
-	c->rrc.nonce.ptr = c->rrc.nonce_buf;
-
-	c->rrc.aad.len = sizeof(c->rrc.aad_buf);
-	c->rrc.aad.ptr = c->rrc.aad_buf;
+	/*derive Common IV, Recipient Key and Sender Key***********************/
+	TRY(derive_keys(&c->cc, &c->sc, &c->rc));
 
-	c->rrc.piv.len = sizeof(c->rrc.piv_buf);
-	c->rrc.piv.ptr = c->rrc.piv_buf;
+	/*set up the request response context**********************************/
+	oscore_exchange_init(&c->rrc.exchange);
 
 	c->rrc.kid_context.len = sizeof(c->rrc.kid_context_buf);
 	c->rrc.kid_context.ptr = c->rrc.kid_context_buf;
@@ -228,33 +243,49 @@ enum err oscore_context_init(struct oscore_init_params *params,
 
 		PRINT_ARRAY("KID context", c->rrc.kid_context.ptr,
 			    c->rrc.kid_context.len);
+
+		c->rrc.requests = params->request_table;
 	} else {
+		c->rrc.requests = NULL;
 		TRY(_memcpy_s(c->rrc.kid.ptr, c->rrc.kid.len,
 			      params->recipient_id.ptr,
 			      params->recipient_id.len));
 		c->rrc.kid.len = params->recipient_id.len;
 	}
 	PRINT_ARRAY("KID", c->rrc.kid.ptr, c->rrc.kid.len);
-	return ok;
+
+	/*the request KID is the ID_PIV of all nonces and part of all AADs of 
+	this context*/
+	TRY(create_nonce_template(&c->rrc.kid, &c->cc.common_iv,
+				  c->cc.nonce_template));
+	c->cc.aad_prefix.len = sizeof(c->cc.aad_prefix_buf);
+	c->cc.aad_prefix.ptr = c->cc.aad_prefix_buf;
+	return create_aad_prefix(c->cc.aead_alg, &c->rrc.kid,
+				 &c->cc.aad_prefix);
+}
+
+enum err oscore_context_deinit(struct context *c)
+{
+	TRY(aead_key_destroy(&c->sc.sender_aead_key));
+	return aead_key_destroy(&c->rc.recipient_aead_key);
 }
 
-//todo: how big is piv? 5 byte= 40 bit -> in that case the sender sequence number needs to loop at the value of 2^40 -1 !!! -> uint8_t is sufficient for the sender sequence number.
 enum err sender_seq_num2piv(uint64_t ssn, struct byte_array *piv)
 {
-	uint8_t *p = (uint8_t *)&ssn;
-
-	//todo here we can start at 4?
-	for (int8_t i = 7; i >= 0; i--) {
-		if (*(p + i) > 0) {
-			TRY(_memcpy_s(piv->ptr, MAX_PIV_LEN, p,
-				      (uint32_t)(i + 1)));
-			piv->len = (uint32_t)(i + 1);
-			return ok;
-		}
+	if (ssn > MAX_SSN) {
+		return wrong_parameter;
 	}
 
-	/*if the sender seq number is 0 piv has value 0 and length 1*/
-	*piv->ptr = 0;
-	piv->len = 1;
+	/*the PIV is the sender sequence number in network byte order without 
+	leading zero bytes, if the sender seq number is 0 piv has value 0 and 
+	length 1*/
+	uint32_t len = 1;
+	while (len < MAX_PIV_LEN && (ssn >> (8 * len)) != 0) {
+		len++;
+	}
+	for (uint32_t i = 0; i < len; i++) {
+		piv->ptr[i] = (uint8_t)(ssn >> (8 * (len - 1 - i)));
+	}
+	piv->len = len;
 	return ok;
 }
@@ -0,0 +1,1888 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <edhoc.h>
+#include "edhoc_internal.h"
+#include "edhoc_oscore.h"
+#include "edhoc/cert.h"
+#include "edhoc/worker_pool.h"
+
+#include "common/cbor_head.h"
+#include "common/crypto_wrapper.h"
+
+#include "edhoc_tests.h"
+
+/*the test vector used by the API tests*/
+#define API_TEST_VEC 2
+/*a test vector with signature authentication on both sides*/
+#define SIGN_TEST_VEC 4
+
+#ifdef MBEDTLS
+/*P-256 key and deterministic ES256 signature of "sample", RFC6979 A.2.5*/
+static const uint8_t rfc6979_sk[] = {
+	0xc9, 0xaf, 0xa9, 0xd8, 0x45, 0xba, 0x75, 0x16, 0x6b, 0x5c, 0x21,
+	0x57, 0x67, 0xb1, 0xd6, 0x93, 0x4e, 0x50, 0xc3, 0xdb, 0x36, 0xe8,
+	0x9b, 0x12, 0x7b, 0x8a, 0x62, 0x2b, 0x12, 0x0f, 0x67, 0x21
+};
+static const uint8_t rfc6979_pk[] = {
+	0x04, 0x60, 0xfe, 0xd4, 0xba, 0x25, 0x5a, 0x9d, 0x31, 0xc9, 0x61,
+	0xeb, 0x74, 0xc6, 0x35, 0x6d, 0x68, 0xc0, 0x49, 0xb8, 0x92, 0x3b,
+	0x61, 0xfa, 0x6c, 0xe6, 0x69, 0x62, 0x2e, 0x60, 0xf2, 0x9f, 0xb6,
+	0x79, 0x03, 0xfe, 0x10, 0x08, 0xb8, 0xbc, 0x99, 0xa4, 0x1a, 0xe9,
+	0xe9, 0x56, 0x28, 0xbc, 0x64, 0xf2, 0xf1, 0xb2, 0x0c, 0x2d, 0x7e,
+	0x9f, 0x51, 0x77, 0xa3, 0xc2, 0x94, 0xd4, 0x46, 0x22, 0x99
+};
+static const uint8_t rfc6979_sgn[] = {
+	0xef, 0xd4, 0x8b, 0x2a, 0xac, 0xb6, 0xa8, 0xfd, 0x11, 0x40, 0xdd,
+	0x9c, 0xd4, 0x5e, 0x81, 0xd6, 0x9d, 0x2c, 0x87, 0x7b, 0x56, 0xaa,
+	0xf9, 0x91, 0xc3, 0x4d, 0x0e, 0xa8, 0x4e, 0xaf, 0x37, 0x16, 0xf7,
+	0xcb, 0x1c, 0x94, 0x2d, 0x65, 0x7c, 0x41, 0xd4, 0x36, 0xc7, 0xa1,
+	0xb6, 0xe2, 0x9f, 0x65, 0xf3, 0xe9, 0x00, 0xdb, 0xb9, 0xaf, 0xf4,
+	0x06, 0x4d, 0xc4, 0xab, 0x2f, 0x84, 0x3a, 0xcd, 0xa8
+};
+#endif
+
+/**
+ * @brief       Seals the state after message 1 of the test vector in a
+ *              state token and restores it with message 3. A token
+ *              expires after the lifetime of the keys and cannot be
+ *              opened after the keys were initialized with another salt.
+ */
+void edhoc_api_test_state_token(void)
+{
+	enum err r;
+	struct edhoc_responder_context c;
+	struct other_party_cred cred_i;
+	struct edhoc_state_keys k;
+	struct messages msgs;
+	const uint8_t *prk_4x3m_expected, *th4_expected;
+	const uint8_t key[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	const uint8_t salt_1[16] = { 1 };
+	const uint8_t salt_2[16] = { 2 };
+	uint8_t token[2][EDHOC_STATE_TOKEN_SIZE];
+	uint32_t token_len[2];
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	test_vector_responder_init(API_TEST_VEC, &c, &cred_i);
+	test_vector_messages(API_TEST_VEC, &msgs);
+	test_vector_results(API_TEST_VEC, &prk_4x3m_expected, &th4_expected);
+
+	/*the same key after a restart yields tokens under another key*/
+	for (uint8_t i = 0; i < 2; i++) {
+		r = edhoc_state_keys_init(&k, key, sizeof(key),
+					  i == 0 ? salt_1 : salt_2,
+					  sizeof(salt_1), 10);
+		zassert_equal(r, ok, "edhoc_state_keys_init failed");
+		msg_len = sizeof(msg);
+		ead_len = sizeof(ead);
+		token_len[i] = sizeof(token[i]);
+		r = edhoc_responder_stateless_msg1(&c, &k, 100, msgs.m1,
+						   msgs.m1_len, msg, &msg_len,
+						   ead, &ead_len, token[i],
+						   &token_len[i]);
+		zassert_equal(r, ok, "edhoc_responder_stateless_msg1 failed");
+		zassert_equal(msg_len, msgs.m2_len, "wrong message 2 length");
+		zassert_mem_equal__(msg, msgs.m2, msgs.m2_len,
+				    "wrong message 2");
+		if (i == 0) {
+			r = edhoc_state_keys_deinit(&k);
+			zassert_equal(r, ok, "edhoc_state_keys_deinit failed");
+		}
+	}
+	zassert_mem_equal__(token[0], token[1], EDHOC_STATE_TOKEN_HEADER_SIZE,
+			    "the counter did not restart");
+	zassert_true(memcmp(token[0], token[1], token_len[0]) != 0,
+		     "the token key was reused");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_stateless_msg3(
+		&c, &k, 110, token[0], token_len[0], &cred_i, 1, msgs.m3,
+		msgs.m3_len, msg, &msg_len, ead, &ead_len, prk_4x3m,
+		sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, state_token_invalid, "token of another salt opened");
+
+	/*a tampered expiry time is detected*/
+	token[1][EDHOC_STATE_TOKEN_HEADER_SIZE - 1] ^= 1;
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_stateless_msg3(
+		&c, &k, 110, token[1], token_len[1], &cred_i, 1, msgs.m3,
+		msgs.m3_len, msg, &msg_len, ead, &ead_len, prk_4x3m,
+		sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, state_token_invalid, "tampered token opened");
+	token[1][EDHOC_STATE_TOKEN_HEADER_SIZE - 1] ^= 1;
+
+	/*after the lifetime the token is rejected*/
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_stateless_msg3(
+		&c, &k, 111, token[1], token_len[1], &cred_i, 1, msgs.m3,
+		msgs.m3_len, msg, &msg_len, ead, &ead_len, prk_4x3m,
+		sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, state_token_expired, "expired token opened");
+
+	/*at the end of its lifetime the token is accepted*/
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_stateless_msg3(
+		&c, &k, 110, token[1], token_len[1], &cred_i, 1, msgs.m3,
+		msgs.m3_len, msg, &msg_len, ead, &ead_len, prk_4x3m,
+		sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_responder_stateless_msg3 failed");
+	zassert_equal(msg_len, msgs.m4_len, "wrong message 4 length");
+	zassert_mem_equal__(msg, msgs.m4, msgs.m4_len, "wrong message 4");
+	zassert_mem_equal__(prk_4x3m, prk_4x3m_expected, sizeof(prk_4x3m),
+			    "wrong PRK_4x3m");
+	zassert_mem_equal__(th4, th4_expected, sizeof(th4), "wrong TH4");
+
+	r = edhoc_state_keys_deinit(&k);
+	zassert_equal(r, ok, "edhoc_state_keys_deinit failed");
+}
+
+/**
+ * @brief       Drives a responder session with the messages of the test
+ *              vector. A session which failed or finished takes no further
+ *              messages.
+ */
+void edhoc_api_test_responder_step(void)
+{
+	enum err r;
+	struct edhoc_responder_context c;
+	struct other_party_cred cred_i;
+	struct edhoc_responder_session s;
+	struct messages msgs;
+	const uint8_t *prk_4x3m_expected, *th4_expected;
+	uint8_t msg3[MSG_2_DEFAULT_SIZE];
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	test_vector_responder_init(API_TEST_VEC, &c, &cred_i);
+	test_vector_messages(API_TEST_VEC, &msgs);
+	test_vector_results(API_TEST_VEC, &prk_4x3m_expected, &th4_expected);
+
+	edhoc_responder_session_init(&s);
+	zassert_equal(s.state, RESPONDER_WAIT_MSG1, "wrong state");
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1, msgs.m1_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_responder_step failed");
+	zassert_equal(s.state, RESPONDER_WAIT_MSG3, "wrong state");
+	zassert_equal(msg_len, msgs.m2_len, "wrong message 2 length");
+	zassert_mem_equal__(msg, msgs.m2, msgs.m2_len, "wrong message 2");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m3, msgs.m3_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_responder_step failed");
+	zassert_equal(s.state, RESPONDER_DONE, "wrong state");
+	zassert_equal(msg_len, msgs.m4_len, "wrong message 4 length");
+	zassert_mem_equal__(msg, msgs.m4, msgs.m4_len, "wrong message 4");
+	zassert_mem_equal__(prk_4x3m, prk_4x3m_expected, sizeof(prk_4x3m),
+			    "wrong PRK_4x3m");
+	zassert_mem_equal__(th4, th4_expected, sizeof(th4), "wrong TH4");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m3, msgs.m3_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, wrong_parameter, "finished session stepped");
+
+	/*a modified message 3 discontinues the protocol*/
+	memcpy(msg3, msgs.m3, msgs.m3_len);
+	msg3[msgs.m3_len - 1] ^= 1;
+	edhoc_responder_session_init(&s);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1, msgs.m1_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_responder_step failed");
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msg3, msgs.m3_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_not_equal(r, ok, "modified message 3 accepted");
+	zassert_equal(s.state, RESPONDER_FAILED, "wrong state");
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m3, msgs.m3_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, wrong_parameter, "failed session stepped");
+
+	/*message 2 does not fit into the output buffer*/
+	edhoc_responder_session_init(&s);
+	msg_len = msgs.m2_len - 1;
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1, msgs.m1_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_not_equal(r, ok, "message 2 written past the buffer");
+	zassert_equal(s.state, RESPONDER_FAILED, "wrong state");
+}
+
+/**
+ * @brief       Runs two handshakes of initiators of the test vector through
+ *              a table of two responder sessions. Message 3 arrives in the
+ *              opposite order and finds its session by C_R.
+ */
+void edhoc_api_test_session_table(void)
+{
+	enum err r;
+	struct edhoc_responder_context c_r;
+	struct edhoc_initiator_context c_i;
+	struct other_party_cred cred_i, cred_r;
+	struct edhoc_responder_session sessions[2];
+	struct edhoc_session_table t;
+	struct edhoc_initiator_session s_i[2];
+	int session_c_r[2], c_r_full;
+	uint8_t msg1[MSG_1_DEFAULT_SIZE];
+	uint32_t msg1_len;
+	uint8_t msg2[MSG_2_DEFAULT_SIZE];
+	uint32_t msg2_len;
+	uint8_t msg3[2][MSG_2_DEFAULT_SIZE];
+	uint32_t msg3_len[2];
+	uint8_t msg4[MSG_4_DEFAULT_SIZE];
+	uint32_t msg4_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m_i[2][PRK_DEFAULT_SIZE], prk_4x3m_r[PRK_DEFAULT_SIZE];
+	uint8_t th4_i[2][SHA_DEFAULT_SIZE], th4_r[SHA_DEFAULT_SIZE];
+
+	test_vector_responder_init(API_TEST_VEC, &c_r, &cred_i);
+	test_vector_initiator_init(API_TEST_VEC, &c_i, &cred_r);
+	r = edhoc_session_table_init(&t, sessions, 2);
+	zassert_equal(r, ok, "edhoc_session_table_init failed");
+
+	/*both initiators of the test vector send the same message 1*/
+	for (uint8_t i = 0; i < 2; i++) {
+		edhoc_initiator_session_init(&s_i[i]);
+		msg1_len = sizeof(msg1);
+		ead_len = sizeof(ead);
+		r = edhoc_initiator_step(&c_i, &s_i[i], &cred_r, 1, NULL, 0,
+					 msg1, &msg1_len, ead, &ead_len,
+					 prk_4x3m_i[i], PRK_DEFAULT_SIZE,
+					 th4_i[i], SHA_DEFAULT_SIZE);
+		zassert_equal(r, ok, "edhoc_initiator_step failed");
+
+		msg2_len = sizeof(msg2);
+		ead_len = sizeof(ead);
+		r = edhoc_session_table_msg1(&c_r, &t, msg1, msg1_len, msg2,
+					     &msg2_len, ead, &ead_len,
+					     &session_c_r[i]);
+		zassert_equal(r, ok, "edhoc_session_table_msg1 failed");
+
+		msg3_len[i] = sizeof(msg3[i]);
+		ead_len = sizeof(ead);
+		r = edhoc_initiator_step(&c_i, &s_i[i], &cred_r, 1, msg2,
+					 msg2_len, msg3[i], &msg3_len[i], ead,
+					 &ead_len, prk_4x3m_i[i],
+					 PRK_DEFAULT_SIZE, th4_i[i],
+					 SHA_DEFAULT_SIZE);
+		zassert_equal(r, ok, "edhoc_initiator_step failed");
+	}
+	zassert_not_equal(session_c_r[0], session_c_r[1], "C_R used twice");
+
+	/*no session is free for a third handshake*/
+	msg2_len = sizeof(msg2);
+	ead_len = sizeof(ead);
+	r = edhoc_session_table_msg1(&c_r, &t, msg1, msg1_len, msg2, &msg2_len,
+				     ead, &ead_len, &c_r_full);
+	zassert_equal(r, session_table_full, "third session started");
+
+	/*a message 3 sent with the C_R of the other handshake fails and 
+	releases the session*/
+	msg4_len = sizeof(msg4);
+	ead_len = sizeof(ead);
+	r = edhoc_session_table_msg3(&c_r, &t, session_c_r[1], &cred_i, 1,
+				     msg3[0], msg3_len[0], msg4, &msg4_len,
+				     ead, &ead_len, prk_4x3m_r,
+				     sizeof(prk_4x3m_r), th4_r, sizeof(th4_r));
+	zassert_not_equal(r, ok, "message 3 of another handshake accepted");
+	r = edhoc_session_table_release(&t, session_c_r[1]);
+	zassert_equal(r, session_not_found, "failed session still pending");
+
+	msg4_len = sizeof(msg4);
+	ead_len = sizeof(ead);
+	r = edhoc_session_table_msg3(&c_r, &t, session_c_r[0], &cred_i, 1,
+				     msg3[0], msg3_len[0], msg4, &msg4_len,
+				     ead, &ead_len, prk_4x3m_r,
+				     sizeof(prk_4x3m_r), th4_r, sizeof(th4_r));
+	zassert_equal(r, ok, "edhoc_session_table_msg3 failed");
+	zassert_mem_equal__(prk_4x3m_r, prk_4x3m_i[0], sizeof(prk_4x3m_r),
+			    "PRK_4x3m of initiator and responder differ");
+	zassert_mem_equal__(th4_r, th4_i[0], sizeof(th4_r),
+			    "TH4 of initiator and responder differ");
+
+	/*the finished session is free again*/
+	msg4_len = sizeof(msg4);
+	ead_len = sizeof(ead);
+	r = edhoc_session_table_msg3(&c_r, &t, session_c_r[0], &cred_i, 1,
+				     msg3[0], msg3_len[0], msg4, &msg4_len,
+				     ead, &ead_len, prk_4x3m_r,
+				     sizeof(prk_4x3m_r), th4_r, sizeof(th4_r));
+	zassert_equal(r, session_not_found, "finished session still pending");
+	r = edhoc_session_table_release(&t, 2);
+	zassert_equal(r, session_not_found, "C_R outside of the table");
+
+	msg2_len = sizeof(msg2);
+	ead_len = sizeof(ead);
+	r = edhoc_session_table_msg1(&c_r, &t, msg1, msg1_len, msg2, &msg2_len,
+				     ead, &ead_len, &c_r_full);
+	zassert_equal(r, ok, "edhoc_session_table_msg1 failed");
+	r = edhoc_session_table_release(&t, c_r_full);
+	zassert_equal(r, ok, "edhoc_session_table_release failed");
+}
+
+/**
+ * @brief       Marks a job as done, the flag is passed as user data
+ */
+static void job_done(struct edhoc_responder_job *job)
+{
+	*(bool *)job->user_data = true;
+}
+
+/**
+ * @brief       Processes message 1 of the test vector as responder jobs,
+ *              in the calling thread and, with EDHOC_WORKER_POOL_PTHREAD,
+ *              on the threads of a worker pool
+ */
+void edhoc_api_test_responder_jobs(void)
+{
+	struct edhoc_responder_context c;
+	struct other_party_cred cred_i;
+	struct edhoc_responder_session s[2];
+	struct edhoc_responder_job jobs[2];
+	struct messages msgs;
+	uint8_t msg[2][MSG_2_DEFAULT_SIZE];
+	uint8_t ead[2][AD_DEFAULT_SIZE];
+	bool done[2] = { false, false };
+
+	test_vector_responder_init(API_TEST_VEC, &c, &cred_i);
+	test_vector_messages(API_TEST_VEC, &msgs);
+
+	for (uint8_t i = 0; i < 2; i++) {
+		edhoc_responder_session_init(&s[i]);
+		jobs[i] = (struct edhoc_responder_job){
+			.c = &c,
+			.s = &s[i],
+			.cred_i_array = &cred_i,
+			.num_cred_i = 1,
+			.msg_in = msgs.m1,
+			.msg_in_len = msgs.m1_len,
+			.msg_out = msg[i],
+			.msg_out_len = sizeof(msg[i]),
+			.ead = ead[i],
+			.ead_len = sizeof(ead[i]),
+			.result = wrong_parameter,
+			.done = job_done,
+			.user_data = &done[i],
+		};
+	}
+
+	edhoc_responder_job_run(&jobs[0]);
+	zassert_true(done[0], "done callback not called");
+	zassert_equal(jobs[0].result, ok, "job failed");
+	zassert_equal(jobs[0].msg_out_len, msgs.m2_len,
+		      "wrong message 2 length");
+	zassert_mem_equal__(msg[0], msgs.m2, msgs.m2_len, "wrong message 2");
+	zassert_equal(s[0].state, RESPONDER_WAIT_MSG3, "wrong state");
+
+#ifdef EDHOC_WORKER_POOL_PTHREAD
+	enum err r;
+	struct edhoc_worker_pool p;
+	pthread_t threads[2];
+
+	/*the second session on the pool, the first one is done already*/
+	r = edhoc_worker_pool_init(&p, threads, 2);
+	zassert_equal(r, ok, "edhoc_worker_pool_init failed");
+	r = edhoc_worker_pool_submit(&p, &jobs[1]);
+	zassert_equal(r, ok, "edhoc_worker_pool_submit failed");
+	r = edhoc_worker_pool_deinit(&p);
+	zassert_equal(r, ok, "edhoc_worker_pool_deinit failed");
+	zassert_true(done[1], "queued job not executed");
+	zassert_equal(jobs[1].result, ok, "job failed");
+	zassert_equal(jobs[1].msg_out_len, msgs.m2_len,
+		      "wrong message 2 length");
+	zassert_mem_equal__(msg[1], msgs.m2, msgs.m2_len, "wrong message 2");
+	zassert_equal(s[1].state, RESPONDER_WAIT_MSG3, "wrong state");
+#endif
+}
+
+/**
+ * @brief       Finds credentials by ID_CRED_x, CA name and public key and
+ *              completes the handshake of the test vector with a responder
+ *              which looks up the initiator in the store
+ */
+void edhoc_api_test_cred_store(void)
+{
+	enum err r;
+	struct edhoc_responder_context c;
+	struct other_party_cred creds[4];
+	struct edhoc_cred_store store;
+	uint32_t index[3 * 8];
+	const struct other_party_cred *found;
+	struct edhoc_responder_session s;
+	struct messages msgs;
+	uint8_t id_creds[3][4];
+	uint8_t pks[3][4];
+	uint8_t ca[] = { 'C', 'A' };
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	/*the credential of the test vector and three others, the last two
+	share a public key and a CA*/
+	memset(creds, 0, sizeof(creds));
+	test_vector_responder_init(API_TEST_VEC, &c, &creds[0]);
+	test_vector_messages(API_TEST_VEC, &msgs);
+	for (uint8_t i = 0; i < 3; i++) {
+		const uint8_t id_cred[] = { 0xa1, 0x04, 0x41, i };
+		const uint8_t pk[] = { 0x04, i < 2 ? i : 1, 0x02, 0x03 };
+		memcpy(id_creds[i], id_cred, sizeof(id_cred));
+		memcpy(pks[i], pk, sizeof(pk));
+		creds[i + 1].id_cred.ptr = id_creds[i];
+		creds[i + 1].id_cred.len = sizeof(id_cred);
+		creds[i + 1].pk.ptr = pks[i];
+		creds[i + 1].pk.len = sizeof(pk);
+		if (i > 0) {
+			creds[i + 1].ca.ptr = ca;
+			creds[i + 1].ca.len = sizeof(ca);
+		}
+	}
+
+	r = edhoc_cred_store_init(&store, creds, 4, index, 6);
+	zassert_equal(r, wrong_parameter, "index size not a power of two");
+	r = edhoc_cred_store_init(&store, creds, 4, index, 4);
+	zassert_equal(r, wrong_parameter, "no free slot");
+	r = edhoc_cred_store_init(&store, creds, 4, index, 8);
+	zassert_equal(r, ok, "edhoc_cred_store_init failed");
+
+	for (uint8_t i = 0; i < 4; i++) {
+		r = edhoc_cred_store_id_cred_get(&store, creds[i].id_cred.ptr,
+						 creds[i].id_cred.len, &found);
+		zassert_equal(r, ok, "edhoc_cred_store_id_cred_get failed");
+		zassert_equal_ptr(found, &creds[i], "wrong credential");
+	}
+	r = edhoc_cred_store_subject_key_get(&store, pks[2], sizeof(pks[2]),
+					     &found);
+	zassert_equal(r, ok, "edhoc_cred_store_subject_key_get failed");
+	zassert_equal_ptr(found, &creds[2], "not the first credential");
+	r = edhoc_cred_store_issuer_get(&store, ca, sizeof(ca), &found);
+	zassert_equal(r, ok, "edhoc_cred_store_issuer_get failed");
+	zassert_equal_ptr(found, &creds[2], "not the first credential");
+
+	id_creds[0][3] = 0x07;
+	r = edhoc_cred_store_id_cred_get(&store, id_creds[0],
+					 sizeof(id_creds[0]), &found);
+	zassert_equal(r, credential_not_found, "unknown ID_CRED_x found");
+	r = edhoc_cred_store_issuer_get(&store, ca, 1, &found);
+	zassert_equal(r, no_such_ca, "unknown CA found");
+
+	/*the responder ignores cred_i_array*/
+	c.cred_store = &store;
+	edhoc_responder_session_init(&s);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, NULL, 0, msgs.m1, msgs.m1_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_responder_step failed");
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, NULL, 0, msgs.m3, msgs.m3_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "initiator not found in the store");
+	zassert_equal(s.state, RESPONDER_DONE, "wrong state");
+}
+
+static uint64_t cert_cache_test_time;
+static const struct edhoc_cert_cache *cert_cache_test_cache;
+static bool cert_cache_test_locked;
+
+static uint64_t cert_cache_test_now(void)
+{
+	/*the clock must not be read while the cache is locked*/
+	if (cert_cache_test_cache->lock) {
+		cert_cache_test_locked = true;
+	}
+	return cert_cache_test_time;
+}
+
+/**
+ * @brief       Adds certificates to a cache of two entries and checks that 
+ *              the least recently used one is replaced, that expired 
+ *              certificates are not returned and that flushing empties the 
+ *              cache
+ */
+void edhoc_api_test_cert_cache(void)
+{
+	enum err r;
+	struct edhoc_cert_cache c;
+	struct edhoc_cert_cache_entry entries[2];
+	uint8_t hashes[3][32];
+	uint8_t pks[3][PK_DEFAULT_SIZE];
+	uint8_t pk[PK_DEFAULT_SIZE];
+	uint32_t pk_len;
+	bool found;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		memset(hashes[i], i, sizeof(hashes[i]));
+		memset(pks[i], 0x10 + i, sizeof(pks[i]));
+	}
+
+	r = edhoc_cert_cache_init(&c, entries, 0, NULL);
+	zassert_equal(r, wrong_parameter, "empty cache accepted");
+	r = edhoc_cert_cache_init(&c, entries, 2, cert_cache_test_now);
+	zassert_equal(r, ok, "edhoc_cert_cache_init failed");
+	cert_cache_test_cache = &c;
+	cert_cache_test_locked = false;
+	cert_cache_test_time = 100;
+
+	r = cert_cache_put(&c, hashes[0], pks[0], 32, 0);
+	zassert_equal(r, ok, "cert_cache_put failed");
+	r = cert_cache_put(&c, hashes[1], pks[1], 32, 200);
+	zassert_equal(r, ok, "cert_cache_put failed");
+	r = cert_cache_put(&c, hashes[2], pks[2], PK_DEFAULT_SIZE + 1, 0);
+	zassert_equal(r, buffer_to_small, "too large public key accepted");
+
+	/*certificate 0 becomes the most recently used one*/
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[0], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_true(found, "certificate 0 not found");
+	zassert_equal(pk_len, 32, "wrong public key length");
+	zassert_mem_equal__(pk, pks[0], 32, "wrong public key");
+
+	r = cert_cache_put(&c, hashes[2], pks[2], 32, 0);
+	zassert_equal(r, ok, "cert_cache_put failed");
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[1], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_false(found, "least recently used certificate not replaced");
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[2], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_true(found, "certificate 2 not found");
+	zassert_mem_equal__(pk, pks[2], 32, "wrong public key");
+
+	/*a certificate without validity never expires*/
+	r = cert_cache_put(&c, hashes[1], pks[1], 32, 200);
+	zassert_equal(r, ok, "cert_cache_put failed");
+	cert_cache_test_time = 201;
+	zassert_true(cert_expired(&c, 200), "certificate not expired");
+	zassert_false(cert_expired(&c, 0), "certificate without end expired");
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[1], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_false(found, "expired certificate returned");
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[2], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_true(found, "certificate without end not found");
+
+	/*the output buffer is too small*/
+	pk_len = 16;
+	r = cert_cache_get(&c, hashes[2], pk, &pk_len, &found);
+	zassert_equal(r, buffer_to_small, "too small buffer accepted");
+	zassert_false(found, "certificate returned");
+
+	/*a certificate which is added twice has one entry*/
+	r = cert_cache_put(&c, hashes[0], pks[0], 32, 0);
+	zassert_equal(r, ok, "cert_cache_put failed");
+	r = cert_cache_put(&c, hashes[0], pks[1], 32, 0);
+	zassert_equal(r, ok, "cert_cache_put failed");
+	zassert_true(entries[0].used && entries[1].used, "entry lost");
+	zassert_true(memcmp(entries[0].cert_hash, entries[1].cert_hash,
+			    sizeof(entries[0].cert_hash)) != 0,
+		     "duplicate entries");
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[0], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_true(found, "certificate 0 not found");
+	zassert_mem_equal__(pk, pks[1], 32, "entry not updated");
+	zassert_false(cert_cache_test_locked, "clock read under the lock");
+
+	edhoc_cert_cache_flush(&c);
+	pk_len = sizeof(pk);
+	r = cert_cache_get(&c, hashes[2], pk, &pk_len, &found);
+	zassert_equal(r, ok, "cert_cache_get failed");
+	zassert_false(found, "certificate found after the flush");
+}
+
+/**
+ * @brief       Completes the handshake of a test vector with signature 
+ *              authentication with a prepared public key of the initiator. 
+ *              A prepared key which does not match the credential makes 
+ *              the verification of message 3 fail. With MBEDTLS an ES256 
+ *              key verifies the signature of RFC6979 A.2.5 through PSA.
+ */
+void edhoc_api_test_prepared_verify_key(void)
+{
+	enum err r;
+	struct edhoc_responder_context c;
+	struct other_party_cred cred_i;
+	struct verify_key k;
+	struct edhoc_responder_session s;
+	struct messages msgs;
+	const uint8_t *prk_4x3m_expected, *th4_expected;
+	uint8_t pk[PK_DEFAULT_SIZE];
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+	bool result;
+
+	test_vector_responder_init(SIGN_TEST_VEC, &c, &cred_i);
+	test_vector_messages(SIGN_TEST_VEC, &msgs);
+	test_vector_results(SIGN_TEST_VEC, &prk_4x3m_expected, &th4_expected);
+
+	memset(&k, 0, sizeof(k));
+	r = verify_prepared(&k, msgs.m1, msgs.m1_len, msgs.m1, msgs.m1_len,
+			    &result);
+	zassert_equal(r, wrong_parameter, "key not initialized");
+
+	for (uint8_t i = 0; i < 2; i++) {
+		/*the second time the key is prepared from a wrong copy*/
+		zassert_true(cred_i.pk.len <= sizeof(pk), "key too large");
+		memcpy(pk, cred_i.pk.ptr, cred_i.pk.len);
+		pk[0] = (uint8_t)(pk[0] ^ i);
+		r = verify_key_init(&k, EdDSA, pk, cred_i.pk.len);
+		zassert_equal(r, ok, "verify_key_init failed");
+		cred_i.pk_key = &k;
+
+		edhoc_responder_session_init(&s);
+		msg_len = sizeof(msg);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1,
+					 msgs.m1_len, msg, &msg_len, ead,
+					 &ead_len, prk_4x3m, sizeof(prk_4x3m),
+					 th4, sizeof(th4));
+		zassert_equal(r, ok, "edhoc_responder_step failed");
+		msg_len = sizeof(msg);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m3,
+					 msgs.m3_len, msg, &msg_len, ead,
+					 &ead_len, prk_4x3m, sizeof(prk_4x3m),
+					 th4, sizeof(th4));
+		if (i == 0) {
+			zassert_equal(r, ok, "edhoc_responder_step failed");
+			zassert_mem_equal__(prk_4x3m, prk_4x3m_expected,
+					    sizeof(prk_4x3m), "wrong PRK_4x3m");
+			zassert_mem_equal__(th4, th4_expected, sizeof(th4),
+					    "wrong TH4");
+		} else {
+			zassert_not_equal(r, ok, "the prepared key is not used");
+		}
+		r = edhoc_cred_pk_release(&cred_i);
+		zassert_equal(r, ok, "edhoc_cred_pk_release failed");
+		zassert_is_null(cred_i.pk_key, "key not detached");
+	}
+
+	/*attached by edhoc_cred_pk_prepare()*/
+	r = edhoc_cred_pk_prepare(&cred_i, EdDSA, &k);
+	zassert_equal(r, ok, "edhoc_cred_pk_prepare failed");
+	zassert_equal_ptr(cred_i.pk_key, &k, "key not attached");
+	r = edhoc_cred_pk_release(&cred_i);
+	zassert_equal(r, ok, "edhoc_cred_pk_release failed");
+	r = edhoc_cred_pk_release(&cred_i);
+	zassert_equal(r, ok, "second release failed");
+
+#ifdef MBEDTLS
+	/*an ES256 key is imported into PSA once*/
+	const uint8_t sample[] = { 's', 'a', 'm', 'p', 'l', 'e' };
+	uint8_t sgn[sizeof(rfc6979_sgn)];
+
+	r = verify_key_init(&k, ES256, rfc6979_pk, sizeof(rfc6979_pk));
+	zassert_equal(r, ok, "verify_key_init failed");
+	zassert_not_equal(k.key_id, PSA_KEY_HANDLE_INIT, "key not imported");
+	r = verify_prepared(&k, sample, sizeof(sample), rfc6979_sgn,
+			    sizeof(rfc6979_sgn), &result);
+	zassert_equal(r, ok, "verify_prepared failed");
+	zassert_true(result, "signature not verified");
+	memcpy(sgn, rfc6979_sgn, sizeof(sgn));
+	sgn[0] ^= 1;
+	r = verify_prepared(&k, sample, sizeof(sample), sgn, sizeof(sgn),
+			    &result);
+	zassert_equal(r, ok, "verify_prepared failed");
+	zassert_false(result, "wrong signature verified");
+	r = verify_key_destroy(&k);
+	zassert_equal(r, ok, "verify_key_destroy failed");
+#endif
+}
+
+/**
+ * @brief       Signs with a prepared private key and checks that the 
+ *              signature and message 2 of the responder equal those of the 
+ *              encoded key
+ */
+void edhoc_api_test_prepared_sign_key(void)
+{
+	enum err r;
+	struct edhoc_responder_context c;
+	struct other_party_cred cred_i;
+	struct sign_key k;
+	struct edhoc_responder_session s;
+	struct messages msgs;
+	const uint8_t data[] = { 1, 2, 3, 4, 5 };
+	uint8_t sgn[2][SIGNATURE_DEFAULT_SIZE];
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	test_vector_responder_init(SIGN_TEST_VEC, &c, &cred_i);
+	test_vector_messages(SIGN_TEST_VEC, &msgs);
+
+	r = sign_key_init(&k, EdDSA, c.sk_r.ptr, c.sk_r.len, c.pk_r.ptr);
+	zassert_equal(r, ok, "sign_key_init failed");
+	r = sign(EdDSA, c.sk_r.ptr, c.sk_r.len, c.pk_r.ptr, data,
+		 sizeof(data), sgn[0]);
+	zassert_equal(r, ok, "sign failed");
+	r = sign_prepared(&k, data, sizeof(data), sgn[1]);
+	zassert_equal(r, ok, "sign_prepared failed");
+	zassert_mem_equal__(sgn[0], sgn[1], sizeof(sgn[0]),
+			    "wrong signature");
+
+	/*the encoded key is not used*/
+	c.sign_key = &k;
+	c.sk_r.ptr = NULL;
+	c.sk_r.len = 0;
+	edhoc_responder_session_init(&s);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1, msgs.m1_len,
+				 msg, &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_responder_step failed");
+	zassert_equal(msg_len, msgs.m2_len, "wrong message 2 length");
+	zassert_mem_equal__(msg, msgs.m2, msgs.m2_len, "wrong message 2");
+
+	r = sign_key_destroy(&k);
+	zassert_equal(r, ok, "sign_key_destroy failed");
+	r = sign_prepared(&k, data, sizeof(data), sgn[1]);
+	zassert_equal(r, wrong_parameter, "destroyed key used");
+	r = sign_key_destroy(&k);
+	zassert_equal(r, ok, "second sign_key_destroy failed");
+
+#ifdef MBEDTLS
+	/*an ES256 signature of a prepared key verifies with the public key*/
+	const uint8_t sample[] = { 's', 'a', 'm', 'p', 'l', 'e' };
+	bool result;
+
+	r = sign_key_init(&k, ES256, rfc6979_sk, sizeof(rfc6979_sk), NULL);
+	zassert_equal(r, ok, "sign_key_init failed");
+	r = sign_prepared(&k, sample, sizeof(sample), sgn[0]);
+	zassert_equal(r, ok, "sign_prepared failed");
+	r = verify(ES256, rfc6979_pk, sizeof(rfc6979_pk), sample,
+		   sizeof(sample), sgn[0], sizeof(rfc6979_sgn), &result);
+	zassert_equal(r, ok, "verify failed");
+	zassert_true(result, "signature not verified");
+#ifdef EDHOC_ECC_RESTARTABLE
+	/*the restartable branch signs deterministically*/
+	zassert_mem_equal__(sgn[0], rfc6979_sgn, sizeof(rfc6979_sgn),
+			    "wrong signature");
+#endif
+	r = sign_key_destroy(&k);
+	zassert_equal(r, ok, "sign_key_destroy failed");
+#endif
+}
+
+/**
+ * @brief       Drives an initiator session with the messages of the test 
+ *              vector and checks that a session fails after a corrupted 
+ *              message 2 and cannot be continued
+ */
+void edhoc_api_test_initiator_step(void)
+{
+	enum err r;
+	struct edhoc_initiator_context c;
+	struct other_party_cred cred_r;
+	struct edhoc_initiator_session s;
+	struct messages msgs;
+	const uint8_t *prk_4x3m_expected, *th4_expected;
+	const uint8_t zero[sizeof(s.eph)] = { 0 };
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t msg2[MSG_2_DEFAULT_SIZE];
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	test_vector_initiator_init(API_TEST_VEC, &c, &cred_r);
+	test_vector_messages(API_TEST_VEC, &msgs);
+	test_vector_results(API_TEST_VEC, &prk_4x3m_expected, &th4_expected);
+
+	edhoc_initiator_session_init(&s);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, NULL, 0, msg, &msg_len,
+				 ead, &ead_len, prk_4x3m, sizeof(prk_4x3m), th4,
+				 sizeof(th4));
+	zassert_equal(r, ok, "edhoc_initiator_step failed");
+	zassert_equal(s.state, INITIATOR_WAIT_MSG2, "wrong state");
+	zassert_equal(msg_len, msgs.m1_len, "wrong message 1 length");
+	zassert_mem_equal__(msg, msgs.m1, msgs.m1_len, "wrong message 1");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, msgs.m2, msgs.m2_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_initiator_step failed");
+	zassert_equal(s.state, INITIATOR_WAIT_MSG4, "wrong state");
+	zassert_equal(msg_len, msgs.m3_len, "wrong message 3 length");
+	zassert_mem_equal__(msg, msgs.m3, msgs.m3_len, "wrong message 3");
+	zassert_mem_equal__(prk_4x3m, prk_4x3m_expected, sizeof(prk_4x3m),
+			    "wrong PRK_4x3m");
+	zassert_mem_equal__(th4, th4_expected, sizeof(th4), "wrong TH4");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, msgs.m4, msgs.m4_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, ok, "edhoc_initiator_step failed");
+	zassert_equal(s.state, INITIATOR_DONE, "wrong state");
+	zassert_equal(msg_len, 0, "message after message 4");
+	zassert_mem_equal__(&s.eph, zero, sizeof(zero), "key not zeroized");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, msgs.m4, msgs.m4_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, wrong_parameter, "finished session continued");
+
+	/*a corrupted message 2*/
+	zassert_true(msgs.m2_len <= sizeof(msg2), "message 2 too large");
+	edhoc_initiator_session_init(&s);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, NULL, 0, msg, &msg_len,
+				 ead, &ead_len, prk_4x3m, sizeof(prk_4x3m), th4,
+				 sizeof(th4));
+	zassert_equal(r, ok, "edhoc_initiator_step failed");
+	memcpy(msg2, msgs.m2, msgs.m2_len);
+	msg2[msgs.m2_len - 1] ^= 1;
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, msg2, msgs.m2_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_not_equal(r, ok, "corrupted message 2 accepted");
+	zassert_equal(s.state, INITIATOR_FAILED, "wrong state");
+	zassert_mem_equal__(&s.eph, zero, sizeof(zero), "key not zeroized");
+
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&c, &s, &cred_r, 1, msgs.m2, msgs.m2_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, wrong_parameter, "failed session continued");
+}
+
+/**
+ * @brief       Fills a pool of X25519 key pairs and empties it again. The
+ *              keys are derived from the random bytes of the caller.
+ */
+void edhoc_api_test_ephemeral_key_pool(void)
+{
+	enum err r;
+	struct edhoc_ephemeral_key_pool p;
+	struct edhoc_ephemeral_key keys[2];
+	struct edhoc_ephemeral_key k[3];
+	uint8_t random[EPHEMERAL_RANDOM_SIZE] = { 0 };
+	struct edhoc_initiator_context ic;
+	struct edhoc_responder_context rc;
+	struct other_party_cred cred_i, cred_r;
+	struct edhoc_initiator_session s_i;
+	struct edhoc_responder_session s_r;
+	struct messages msgs;
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	r = edhoc_ephemeral_key_pool_init(&p, X25519, keys, 2);
+	zassert_equal(r, ok, "edhoc_ephemeral_key_pool_init failed");
+
+	r = edhoc_ephemeral_key_pool_add(&p, random, sizeof(random) - 1);
+	zassert_equal(r, wrong_parameter, "short random accepted");
+
+	for (uint8_t i = 0; i < 3; i++) {
+		random[1] = i < 2 ? 1 : 2;
+		r = edhoc_ephemeral_key_pool_add(&p, random, sizeof(random));
+		zassert_equal(r, i < 2 ? ok : ephemeral_key_pool_full,
+			      "edhoc_ephemeral_key_pool_add failed");
+	}
+	for (uint8_t i = 0; i < 2; i++) {
+		r = edhoc_ephemeral_key_pool_take(&p, &k[i]);
+		zassert_equal(r, ok, "edhoc_ephemeral_key_pool_take failed");
+		zassert_equal(k[i].pk_len, 32, "wrong public key length");
+	}
+	r = edhoc_ephemeral_key_pool_take(&p, &k[2]);
+	zassert_equal(r, ephemeral_key_pool_empty, "key taken twice");
+
+	/*the same random bytes give the same key, other bytes another key*/
+	zassert_mem_equal__(k[0].pk, k[1].pk, 32, "random bytes not used");
+	zassert_mem_equal__(k[0].sk, k[1].sk, 32, "random bytes not used");
+	random[1] = 2;
+	r = edhoc_ephemeral_key_pool_add(&p, random, sizeof(random));
+	zassert_equal(r, ok, "edhoc_ephemeral_key_pool_add failed");
+	r = edhoc_ephemeral_key_pool_take(&p, &k[2]);
+	zassert_equal(r, ok, "edhoc_ephemeral_key_pool_take failed");
+	zassert_true(memcmp(k[0].pk, k[2].pk, 32) != 0, "keys not distinct");
+
+	memset(k, 0, sizeof(k));
+
+	/*a pool of P-256 keys cannot be used with an X25519 suite*/
+	r = edhoc_ephemeral_key_pool_init(&p, P256, keys, 2);
+	zassert_equal(r, ok, "edhoc_ephemeral_key_pool_init failed");
+	test_vector_initiator_init(API_TEST_VEC, &ic, &cred_r);
+	test_vector_responder_init(API_TEST_VEC, &rc, &cred_i);
+	test_vector_messages(API_TEST_VEC, &msgs);
+	ic.ephemeral_keys = &p;
+	rc.ephemeral_keys = &p;
+
+	edhoc_initiator_session_init(&s_i);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&ic, &s_i, &cred_r, 1, NULL, 0, msg, &msg_len,
+				 ead, &ead_len, prk_4x3m, sizeof(prk_4x3m), th4,
+				 sizeof(th4));
+	zassert_equal(r, wrong_parameter, "key of another curve used");
+	edhoc_responder_session_init(&s_r);
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&rc, &s_r, &cred_i, 1, msgs.m1, msgs.m1_len,
+				 msg, &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, wrong_parameter, "key of another curve used");
+}
+
+/*a CoAP request and its response with the token aabb*/
+static const uint8_t oscore_test_req[] = { 0x42, 0x01, 0x12, 0x34, 0xaa,
+					   0xbb, 0xb4, 't',  'e',  's',
+					   't',  0xff, 'h',  'i' };
+static const uint8_t oscore_test_rsp[] = { 0x62, 0x45, 0x12, 0x34, 0xaa,
+					   0xbb, 0xff, 'o',  'k' };
+
+/**
+ * @brief       Protects a request with the client context, verifies it
+ *              with the server context and does the same for the response
+ */
+static void oscore_round_trip(struct context *c_client,
+			      struct context *c_server)
+{
+	enum err r;
+	uint8_t oscore[64], coap[64];
+	uint32_t oscore_len = sizeof(oscore), coap_len = sizeof(coap);
+	bool oscore_flag;
+
+	r = coap2oscore((uint8_t *)oscore_test_req, sizeof(oscore_test_req),
+			oscore, &oscore_len, c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+	r = oscore2coap(oscore, oscore_len, coap, &coap_len, &oscore_flag,
+			c_server);
+	zassert_equal(r, ok, "Error in oscore2coap");
+	zassert_equal(coap_len, sizeof(oscore_test_req), "wrong request");
+	zassert_mem_equal__(coap, oscore_test_req, coap_len, "wrong request");
+
+	oscore_len = sizeof(oscore);
+	coap_len = sizeof(coap);
+	r = coap2oscore((uint8_t *)oscore_test_rsp, sizeof(oscore_test_rsp),
+			oscore, &oscore_len, c_server);
+	zassert_equal(r, ok, "Error in coap2oscore");
+	r = oscore2coap(oscore, oscore_len, coap, &coap_len, &oscore_flag,
+			c_client);
+	zassert_equal(r, ok, "Error in oscore2coap");
+	zassert_equal(coap_len, sizeof(oscore_test_rsp), "wrong response");
+	zassert_mem_equal__(coap, oscore_test_rsp, coap_len, "wrong response");
+}
+
+/**
+ * @brief       Installs the OSCORE contexts of both parties from the
+ *              results of the test vector. The client keeps its
+ *              outstanding requests in a table.
+ */
+static void oscore_contexts_install(struct suite *suite,
+				    struct oscore_request_table *t,
+				    struct edhoc_oscore_material *m_client,
+				    struct context *c_client,
+				    struct edhoc_oscore_material *m_server,
+				    struct context *c_server)
+{
+	enum err r;
+	struct edhoc_initiator_context ic;
+	struct edhoc_responder_context rc;
+	struct other_party_cred cred_i, cred_r;
+	const uint8_t *prk_4x3m, *th4;
+
+	test_vector_initiator_init(API_TEST_VEC, &ic, &cred_r);
+	test_vector_responder_init(API_TEST_VEC, &rc, &cred_i);
+	test_vector_results(API_TEST_VEC, &prk_4x3m, &th4);
+	/*the selected suite is the last one of SUITES_I*/
+	r = get_suite((enum suite_label)ic.suites_i.ptr[ic.suites_i.len - 1],
+		      suite);
+	zassert_equal(r, ok, "get_suite failed");
+
+	r = edhoc_oscore_context_init(CLIENT, true, suite, prk_4x3m,
+				      PRK_DEFAULT_SIZE, th4, SHA_DEFAULT_SIZE,
+				      &ic.c_i, &rc.c_r, m_client, t, c_client);
+	zassert_equal(r, ok, "edhoc_oscore_context_init failed");
+	r = edhoc_oscore_context_init(SERVER, false, suite, prk_4x3m,
+				      PRK_DEFAULT_SIZE, th4, SHA_DEFAULT_SIZE,
+				      &ic.c_i, &rc.c_r, m_server, NULL,
+				      c_server);
+	zassert_equal(r, ok, "edhoc_oscore_context_init failed");
+}
+
+/**
+ * @brief       Installs the OSCORE contexts of a completed handshake. The
+ *              client sends with C_R and receives with C_I and uses the
+ *              given table of outstanding requests.
+ */
+void edhoc_api_test_oscore_context(void)
+{
+	enum err r;
+	struct oscore_request requests[2];
+	struct oscore_request_table t;
+	struct edhoc_oscore_material m_client, m_server;
+	struct context c_client, c_server;
+	struct suite suite;
+	uint8_t token[] = { 0xaa, 0xbb };
+	uint8_t piv_buf[MAX_PIV_LEN];
+	struct byte_array token_ba = { .len = sizeof(token), .ptr = token };
+	struct byte_array piv = { .len = sizeof(piv_buf), .ptr = piv_buf };
+
+	r = oscore_request_table_init(&t, requests, 2);
+	zassert_equal(r, ok, "oscore_request_table_init failed");
+	oscore_contexts_install(&suite, &t, &m_client, &c_client, &m_server,
+				&c_server);
+
+	zassert_equal(m_client.sender_id_len, m_server.recipient_id_len,
+		      "wrong Sender ID");
+	zassert_mem_equal__(m_client.sender_id, m_server.recipient_id,
+			    m_client.sender_id_len, "wrong Sender ID");
+	zassert_equal(m_client.recipient_id_len, m_server.sender_id_len,
+		      "wrong Recipient ID");
+	zassert_mem_equal__(m_client.recipient_id, m_server.sender_id,
+			    m_client.recipient_id_len, "wrong Recipient ID");
+	zassert_equal_ptr(c_client.rrc.requests, &t, "request table not used");
+
+	oscore_round_trip(&c_client, &c_server);
+
+	/*the request protected by the client is outstanding*/
+	uint8_t oscore[64];
+	uint32_t oscore_len = sizeof(oscore);
+	r = coap2oscore((uint8_t *)oscore_test_req, sizeof(oscore_test_req),
+			oscore, &oscore_len, &c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+	r = oscore_request_table_lookup(&t, &token_ba, &piv);
+	zassert_equal(r, ok, "request not recorded");
+
+	r = oscore_context_deinit(&c_client);
+	zassert_equal(r, ok, "oscore_context_deinit failed");
+	r = oscore_context_deinit(&c_server);
+	zassert_equal(r, ok, "oscore_context_deinit failed");
+}
+
+/**
+ * @brief       Rekeys the installed OSCORE contexts with EDHOC-KeyUpdate.
+ *              The outstanding requests of the client are dropped and a
+ *              request protected before the update is rejected.
+ */
+void edhoc_api_test_oscore_key_update(void)
+{
+	enum err r;
+	struct oscore_request requests[2];
+	struct oscore_request_table t;
+	struct edhoc_oscore_material m_client, m_server;
+	struct context c_client, c_server;
+	const uint8_t *prk_4x3m_vec, *th4;
+	uint8_t prk_client[PRK_DEFAULT_SIZE], prk_server[PRK_DEFAULT_SIZE];
+	struct suite suite;
+	const uint8_t nonce[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	uint8_t token[] = { 0xaa, 0xbb };
+	uint8_t piv_buf[MAX_PIV_LEN];
+	struct byte_array token_ba = { .len = sizeof(token), .ptr = token };
+	struct byte_array piv = { .len = sizeof(piv_buf), .ptr = piv_buf };
+	uint8_t oscore[64], coap[64];
+	uint32_t oscore_len = sizeof(oscore), coap_len = sizeof(coap);
+	bool oscore_flag;
+
+	r = oscore_request_table_init(&t, requests, 2);
+	zassert_equal(r, ok, "oscore_request_table_init failed");
+	oscore_contexts_install(&suite, &t, &m_client, &c_client, &m_server,
+				&c_server);
+	test_vector_results(API_TEST_VEC, &prk_4x3m_vec, &th4);
+	memcpy(prk_client, prk_4x3m_vec, sizeof(prk_client));
+	memcpy(prk_server, prk_4x3m_vec, sizeof(prk_server));
+
+	r = coap2oscore((uint8_t *)oscore_test_req, sizeof(oscore_test_req),
+			oscore, &oscore_len, &c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+
+	r = edhoc_oscore_key_update(CLIENT, &suite, nonce, sizeof(nonce),
+				    prk_client, sizeof(prk_client), th4,
+				    SHA_DEFAULT_SIZE, &m_client, &t, &c_client);
+	zassert_equal(r, ok, "edhoc_oscore_key_update failed");
+	r = edhoc_oscore_key_update(SERVER, &suite, nonce, sizeof(nonce),
+				    prk_server, sizeof(prk_server), th4,
+				    SHA_DEFAULT_SIZE, &m_server, NULL,
+				    &c_server);
+	zassert_equal(r, ok, "edhoc_oscore_key_update failed");
+	zassert_mem_equal__(prk_client, prk_server, sizeof(prk_client),
+			    "different PRK_4x3m");
+	zassert_true(memcmp(prk_client, prk_4x3m_vec, sizeof(prk_client)) != 0,
+		     "PRK_4x3m not updated");
+	zassert_equal_ptr(c_client.rrc.requests, &t, "request table lost");
+
+	r = oscore_request_table_lookup(&t, &token_ba, &piv);
+	zassert_equal(r, oscore_request_not_found, "old request kept");
+	r = oscore2coap(oscore, oscore_len, coap, &coap_len, &oscore_flag,
+			&c_server);
+	zassert_not_equal(r, ok, "request of the old keys accepted");
+
+	oscore_round_trip(&c_client, &c_server);
+
+	r = oscore_context_deinit(&c_client);
+	zassert_equal(r, ok, "oscore_context_deinit failed");
+	r = oscore_context_deinit(&c_server);
+	zassert_equal(r, ok, "oscore_context_deinit failed");
+}
+
+/**
+ * @brief       Completes a handshake without message 4 by sending message 3 
+ *              together with the first OSCORE request of the initiator. The 
+ *              responder derives its OSCORE context and decrypts the 
+ *              request in one step.
+ */
+void edhoc_api_test_combined_request(void)
+{
+	enum err r;
+	struct edhoc_initiator_context ic;
+	struct edhoc_responder_context rc;
+	struct other_party_cred cred_i, cred_r;
+	struct edhoc_initiator_session s_i;
+	struct edhoc_responder_session s_r;
+	struct edhoc_oscore_material m_client, m_server;
+	struct context c_client, c_server;
+	struct suite suite;
+	uint8_t msg1[MSG_1_DEFAULT_SIZE];
+	uint32_t msg1_len;
+	uint8_t msg2[MSG_2_DEFAULT_SIZE];
+	uint32_t msg2_len;
+	uint8_t msg3[MSG_3_DEFAULT_SIZE];
+	uint32_t msg3_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_i[PRK_DEFAULT_SIZE], prk_r[PRK_DEFAULT_SIZE];
+	uint8_t th4_i[SHA_DEFAULT_SIZE], th4_r[SHA_DEFAULT_SIZE];
+	uint8_t oscore[64], oscore_split[64], coap[64];
+	uint32_t oscore_len = sizeof(oscore);
+	uint32_t oscore_split_len = sizeof(oscore_split);
+	uint32_t coap_len = sizeof(coap);
+	uint8_t combined_req[MSG_3_DEFAULT_SIZE + 64];
+	uint32_t combined_req_len = sizeof(combined_req);
+	const uint8_t *msg3_split;
+	uint32_t msg3_split_len;
+	bool combined;
+
+	test_vector_initiator_init(API_TEST_VEC, &ic, &cred_r);
+	test_vector_responder_init(API_TEST_VEC, &rc, &cred_i);
+	ic.msg4 = false;
+	rc.msg4 = false;
+
+	edhoc_initiator_session_init(&s_i);
+	edhoc_responder_session_init(&s_r);
+	msg1_len = sizeof(msg1);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&ic, &s_i, &cred_r, 1, NULL, 0, msg1,
+				 &msg1_len, ead, &ead_len, prk_i, sizeof(prk_i),
+				 th4_i, sizeof(th4_i));
+	zassert_equal(r, ok, "edhoc_initiator_step failed");
+	msg2_len = sizeof(msg2);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&rc, &s_r, &cred_i, 1, msg1, msg1_len, msg2,
+				 &msg2_len, ead, &ead_len, prk_r, sizeof(prk_r),
+				 th4_r, sizeof(th4_r));
+	zassert_equal(r, ok, "edhoc_responder_step failed");
+	msg3_len = sizeof(msg3);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&ic, &s_i, &cred_r, 1, msg2, msg2_len, msg3,
+				 &msg3_len, ead, &ead_len, prk_i, sizeof(prk_i),
+				 th4_i, sizeof(th4_i));
+	zassert_equal(r, ok, "edhoc_initiator_step failed");
+	zassert_equal(s_i.state, INITIATOR_DONE, "message 4 expected");
+
+	/*the initiator protects its first request before message 3 is sent*/
+	r = get_suite((enum suite_label)ic.suites_i.ptr[ic.suites_i.len - 1],
+		      &suite);
+	zassert_equal(r, ok, "get_suite failed");
+	r = edhoc_oscore_context_init(CLIENT, true, &suite, prk_i,
+				      sizeof(prk_i), th4_i, sizeof(th4_i),
+				      &ic.c_i, &rc.c_r, &m_client, NULL,
+				      &c_client);
+	zassert_equal(r, ok, "edhoc_oscore_context_init failed");
+	r = coap2oscore((uint8_t *)oscore_test_req, sizeof(oscore_test_req),
+			oscore, &oscore_len, &c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+	r = edhoc_oscore_combined_request_gen(msg3, msg3_len, oscore,
+					      oscore_len, combined_req,
+					      &combined_req_len);
+	zassert_equal(r, ok, "edhoc_oscore_combined_request_gen failed");
+
+	r = edhoc_oscore_combined_request_split(combined_req, combined_req_len,
+						&combined, &msg3_split,
+						&msg3_split_len, oscore_split,
+						&oscore_split_len);
+	zassert_equal(r, ok, "edhoc_oscore_combined_request_split failed");
+	zassert_true(combined, "EDHOC option not found");
+	zassert_equal(msg3_split_len, msg3_len, "wrong message 3 length");
+	zassert_mem_equal__(msg3_split, msg3, msg3_len, "wrong message 3");
+	zassert_equal(oscore_split_len, oscore_len, "wrong request length");
+	zassert_mem_equal__(oscore_split, oscore, oscore_len, "wrong request");
+
+	/*a request without the EDHOC option*/
+	oscore_split_len = sizeof(oscore_split);
+	r = edhoc_oscore_combined_request_split(oscore, oscore_len, &combined,
+						&msg3_split, &msg3_split_len,
+						oscore_split,
+						&oscore_split_len);
+	zassert_equal(r, ok, "edhoc_oscore_combined_request_split failed");
+	zassert_false(combined, "EDHOC option found");
+	ead_len = sizeof(ead);
+	r = edhoc_oscore_combined_request_process(
+		&rc, &s_r, &cred_i, 1, oscore, oscore_len, &m_server,
+		&c_server, coap, &coap_len, ead, &ead_len, prk_r,
+		sizeof(prk_r), th4_r, sizeof(th4_r));
+	zassert_equal(r, not_valid_input_packet, "plain request processed");
+
+	/*message 4 cannot be sent in this mode*/
+	rc.msg4 = true;
+	ead_len = sizeof(ead);
+	r = edhoc_oscore_combined_request_process(
+		&rc, &s_r, &cred_i, 1, combined_req, combined_req_len,
+		&m_server, &c_server, coap, &coap_len, ead, &ead_len, prk_r,
+		sizeof(prk_r), th4_r, sizeof(th4_r));
+	zassert_equal(r, wrong_parameter, "message 4 expected");
+	rc.msg4 = false;
+
+	ead_len = sizeof(ead);
+	r = edhoc_oscore_combined_request_process(
+		&rc, &s_r, &cred_i, 1, combined_req, combined_req_len,
+		&m_server, &c_server, coap, &coap_len, ead, &ead_len, prk_r,
+		sizeof(prk_r), th4_r, sizeof(th4_r));
+	zassert_equal(r, ok, "edhoc_oscore_combined_request_process failed");
+	zassert_equal(s_r.state, RESPONDER_DONE, "wrong state");
+	zassert_mem_equal__(prk_r, prk_i, sizeof(prk_r), "different PRK_4x3m");
+	zassert_mem_equal__(th4_r, th4_i, sizeof(th4_r), "different TH4");
+	zassert_equal(coap_len, sizeof(oscore_test_req), "wrong request");
+	zassert_mem_equal__(coap, oscore_test_req, coap_len, "wrong request");
+
+	/*the context refers to the caller's material, which is kept for a
+	later derivation of the keys*/
+	zassert_equal_ptr(c_server.cc.master_secret.ptr, m_server.master_secret,
+			  "Master Secret not in the caller's storage");
+	zassert_equal_ptr(c_server.cc.master_salt.ptr, m_server.master_salt,
+			  "Master Salt not in the caller's storage");
+	zassert_mem_equal__(m_server.master_secret, m_client.master_secret,
+			    sizeof(m_server.master_secret),
+			    "Master Secret not kept");
+	zassert_mem_equal__(m_server.master_salt, m_client.master_salt,
+			    sizeof(m_server.master_salt),
+			    "Master Salt not kept");
+
+	oscore_round_trip(&c_client, &c_server);
+
+	r = oscore_context_deinit(&c_client);
+	zassert_equal(r, ok, "oscore_context_deinit failed");
+	r = oscore_context_deinit(&c_server);
+	zassert_equal(r, ok, "oscore_context_deinit failed");
+}
+
+/*RFC 5869 Appendix A.1, HKDF-SHA-256*/
+static const uint8_t rfc5869_salt[] = { 0x00, 0x01, 0x02, 0x03, 0x04,
+					0x05, 0x06, 0x07, 0x08, 0x09,
+					0x0a, 0x0b, 0x0c };
+static const uint8_t rfc5869_info[] = { 0xf0, 0xf1, 0xf2, 0xf3, 0xf4,
+					0xf5, 0xf6, 0xf7, 0xf8, 0xf9 };
+static const uint8_t rfc5869_prk[] = {
+	0x07, 0x77, 0x09, 0x36, 0x2c, 0x2e, 0x32, 0xdf, 0x0d, 0xdc, 0x3f,
+	0x0d, 0xc4, 0x7b, 0xba, 0x63, 0x90, 0xb6, 0xc7, 0x3b, 0xb5, 0x0f,
+	0x9c, 0x31, 0x22, 0xec, 0x84, 0x4a, 0xd7, 0xc2, 0xb3, 0xe5
+};
+static const uint8_t rfc5869_okm[] = {
+	0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a, 0x90, 0x43, 0x4f,
+	0x64, 0xd0, 0x36, 0x2f, 0x2a, 0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a,
+	0x5a, 0x4c, 0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf, 0x34,
+	0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18, 0x58, 0x65
+};
+
+/**
+ * @brief       Derives the OKM of RFC 5869 A.1 with a prepared PRK. The
+ *              prepared key can be used for several derivations and gives
+ *              the result of hkdf_expand().
+ */
+void edhoc_api_test_hmac_key(void)
+{
+	enum err r;
+	struct hmac_key k;
+	uint8_t ikm[22];
+	uint8_t prk[sizeof(rfc5869_prk)];
+	uint8_t okm[sizeof(rfc5869_okm)];
+
+	memset(ikm, 0x0b, sizeof(ikm));
+	r = hkdf_extract(SHA_256, rfc5869_salt, sizeof(rfc5869_salt), ikm,
+			 sizeof(ikm), prk);
+	zassert_equal(r, ok, "hkdf_extract failed");
+	zassert_mem_equal__(prk, rfc5869_prk, sizeof(prk), "wrong PRK");
+
+	r = hmac_key_init(SHA_256, &k, prk, sizeof(prk));
+	zassert_equal(r, ok, "hmac_key_init failed");
+	for (uint8_t i = 0; i < 2; i++) {
+		memset(okm, 0, sizeof(okm));
+		r = hkdf_expand_prepared(&k, rfc5869_info, sizeof(rfc5869_info),
+					 okm, sizeof(okm));
+		zassert_equal(r, ok, "hkdf_expand_prepared failed");
+		zassert_mem_equal__(okm, rfc5869_okm, sizeof(okm),
+				    "wrong OKM");
+	}
+
+	memset(okm, 0, sizeof(okm));
+	r = hkdf_expand(SHA_256, prk, sizeof(prk), rfc5869_info,
+			sizeof(rfc5869_info), okm, sizeof(okm));
+	zassert_equal(r, ok, "hkdf_expand failed");
+	zassert_mem_equal__(okm, rfc5869_okm, sizeof(okm), "wrong OKM");
+
+	/*a released key cannot be used, releasing it again has no effect*/
+	r = hmac_key_destroy(&k);
+	zassert_equal(r, ok, "hmac_key_destroy failed");
+	r = hmac_key_destroy(&k);
+	zassert_equal(r, ok, "hmac_key_destroy failed");
+	r = hkdf_expand_prepared(&k, rfc5869_info, sizeof(rfc5869_info), okm,
+				 sizeof(okm));
+	zassert_equal(r, wrong_parameter, "released key used");
+}
+
+/*SHA-256("abc"), FIPS 180-2 Appendix B.1*/
+static const uint8_t sha256_abc[] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+	0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+	0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+};
+/*HMAC-SHA-256 of RFC 4231 test case 2*/
+static const uint8_t rfc4231_mac[] = {
+	0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24,
+	0x26, 0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27,
+	0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+};
+
+/**
+ * @brief       Hashes and MACs messages given in pieces, derives the OKM
+ *              of RFC 5869 A.1 from info segments and encodes CBOR heads
+ *              as the transcript hashes do.
+ */
+void edhoc_api_test_incremental_hash(void)
+{
+	enum err r;
+	struct hash_ctx h, h_clone;
+	struct hmac_key k;
+	struct hmac_ctx m;
+	const uint8_t abd[] = { 'a', 'b', 'd' };
+	const uint8_t jefe[] = { 'J', 'e', 'f', 'e' };
+	const char *data = "what do ya want for nothing?";
+	uint8_t out[SHA_DEFAULT_SIZE], expected[SHA_DEFAULT_SIZE];
+	uint8_t okm[sizeof(rfc5869_okm)];
+	uint8_t head[CBOR_HEAD_MAX_SIZE];
+	uint32_t head_len;
+	uint8_t major_type;
+	uint32_t argument;
+
+	/*"abc" in pieces, an empty piece is allowed*/
+	r = hash_init(SHA_256, &h);
+	zassert_equal(r, ok, "hash_init failed");
+	r = hash_update(&h, (const uint8_t *)"a", 1);
+	zassert_equal(r, ok, "hash_update failed");
+	r = hash_update(&h, NULL, 0);
+	zassert_equal(r, ok, "hash_update failed");
+	r = hash_update(&h, (const uint8_t *)"b", 1);
+	zassert_equal(r, ok, "hash_update failed");
+
+	/*a clone continues the common prefix "ab" with another message*/
+	r = hash_clone(&h, &h_clone);
+	zassert_equal(r, ok, "hash_clone failed");
+	r = hash_update(&h, (const uint8_t *)"c", 1);
+	zassert_equal(r, ok, "hash_update failed");
+	r = hash_final(&h, out);
+	zassert_equal(r, ok, "hash_final failed");
+	zassert_mem_equal__(out, sha256_abc, sizeof(out), "wrong hash");
+
+	r = hash_update(&h_clone, &abd[2], 1);
+	zassert_equal(r, ok, "hash_update failed");
+	r = hash_final(&h_clone, out);
+	zassert_equal(r, ok, "hash_final failed");
+	r = hash(SHA_256, abd, sizeof(abd), expected);
+	zassert_equal(r, ok, "hash failed");
+	zassert_mem_equal__(out, expected, sizeof(out), "wrong cloned hash");
+
+	/*an aborted state is not finished*/
+	r = hash_init(SHA_256, &h);
+	zassert_equal(r, ok, "hash_init failed");
+	r = hash_abort(&h);
+	zassert_equal(r, ok, "hash_abort failed");
+
+	/*HMAC with a prepared key, the message in two pieces*/
+	r = hmac_key_init(SHA_256, &k, jefe, sizeof(jefe));
+	zassert_equal(r, ok, "hmac_key_init failed");
+	r = hmac_init(&m, &k);
+	zassert_equal(r, ok, "hmac_init failed");
+	r = hmac_update(&m, (const uint8_t *)data, 10);
+	zassert_equal(r, ok, "hmac_update failed");
+	r = hmac_update(&m, (const uint8_t *)data + 10,
+			(uint32_t)strlen(data) - 10);
+	zassert_equal(r, ok, "hmac_update failed");
+	r = hmac_final(&m, out);
+	zassert_equal(r, ok, "hmac_final failed");
+	zassert_mem_equal__(out, rfc4231_mac, sizeof(out), "wrong MAC");
+	r = hmac_key_destroy(&k);
+	zassert_equal(r, ok, "hmac_key_destroy failed");
+
+	/*the info of HKDF-Expand as segments*/
+	struct const_byte_array info[] = {
+		{ .len = 3, .ptr = rfc5869_info },
+		{ .len = 0, .ptr = NULL },
+		{ .len = sizeof(rfc5869_info) - 3, .ptr = rfc5869_info + 3 },
+	};
+	r = hmac_key_init(SHA_256, &k, rfc5869_prk, sizeof(rfc5869_prk));
+	zassert_equal(r, ok, "hmac_key_init failed");
+	r = hkdf_expand_prepared_segments(&k, info, 3, okm, sizeof(okm));
+	zassert_equal(r, ok, "hkdf_expand_prepared_segments failed");
+	zassert_mem_equal__(okm, rfc5869_okm, sizeof(okm), "wrong OKM");
+	r = hmac_key_destroy(&k);
+	zassert_equal(r, ok, "hmac_key_destroy failed");
+
+	/*CBOR heads in their shortest form*/
+	const uint32_t arguments[] = { 23, 24, 256, 65536 };
+	const uint32_t lengths[] = { 1, 2, 3, 5 };
+	for (uint8_t i = 0; i < 4; i++) {
+		head_len = sizeof(head);
+		r = cbor_head_encode(CBOR_BSTR, arguments[i], head, &head_len);
+		zassert_equal(r, ok, "cbor_head_encode failed");
+		zassert_equal(head_len, lengths[i], "head not shortest");
+		r = cbor_head_decode(head, head_len, &major_type, &argument,
+				     &head_len);
+		zassert_equal(r, ok, "cbor_head_decode failed");
+		zassert_equal(major_type, CBOR_BSTR, "wrong major type");
+		zassert_equal(argument, arguments[i], "wrong argument");
+		zassert_equal(head_len, lengths[i], "wrong head length");
+	}
+	head_len = 2;
+	r = cbor_head_encode(CBOR_BSTR, 256, head, &head_len);
+	zassert_equal(r, buffer_to_small, "head written past the buffer");
+	head_len = sizeof(head);
+	r = cbor_int_encode(-25, head, &head_len);
+	zassert_equal(r, ok, "cbor_int_encode failed");
+	zassert_equal(head_len, 2, "wrong integer length");
+	zassert_equal(head[0], 0x38, "wrong integer head");
+	zassert_equal(head[1], 0x18, "wrong integer argument");
+}
+
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+/*a second key, SHA-256("b"), with its compressed public key*/
+static const uint8_t ecdh_sk[] = {
+	0x3e, 0x23, 0xe8, 0x16, 0x00, 0x39, 0x59, 0x4a, 0x33, 0x89, 0x4f,
+	0x65, 0x64, 0xe1, 0xb1, 0x34, 0x8b, 0xbd, 0x7a, 0x00, 0x88, 0xd4,
+	0x2c, 0x4a, 0xcb, 0x73, 0xee, 0xae, 0xd5, 0x9c, 0x00, 0x9d
+};
+static const uint8_t ecdh_pk[] = {
+	0x02, 0x31, 0x05, 0x77, 0xe4, 0x93, 0x15, 0xba, 0x62, 0x91, 0x1a,
+	0xd1, 0x8d, 0x96, 0x2d, 0x49, 0x1f, 0xc6, 0x75, 0xf0, 0x23, 0x39,
+	0x6c, 0x74, 0xba, 0x3d, 0x46, 0xd9, 0x99, 0xa9, 0x5d, 0xca, 0x06
+};
+static const uint8_t ecdh_secret[] = {
+	0x2a, 0xb0, 0x2a, 0x3a, 0xdb, 0x05, 0x07, 0xef, 0xd6, 0xad, 0x13,
+	0xf5, 0xa3, 0xa8, 0xe1, 0x32, 0xf0, 0xa6, 0xe6, 0x83, 0x5f, 0xc2,
+	0xb4, 0xf7, 0xcc, 0xcd, 0xe3, 0xff, 0x1c, 0xd8, 0x08, 0x2f
+};
+#endif
+
+/**
+ * @brief       Computes a P-256 ECDH, an ES256 signature and its 
+ *              verification as the operations of one message in slices 
+ *              and in one go, then runs a handshake of a P-256 suite 
+ *              between two sliced sessions. The results equal those of 
+ *              RFC6979, of the ECDH of the two keys and of both parties.
+ */
+void edhoc_api_test_ecc_restartable(void)
+{
+#if defined(MBEDTLS) && defined(EDHOC_ECC_RESTARTABLE)
+	enum err r;
+	struct sign_key k;
+	struct ecc_restart rs;
+	const uint8_t msg[] = { 's', 'a', 'm', 'p', 'l', 'e' };
+	const uint32_t max_ops[] = { 0, 200 };
+	uint8_t sgn[SIGNATURE_DEFAULT_SIZE];
+	uint8_t secret[ECDH_SECRET_DEFAULT_SIZE];
+	uint32_t passes;
+	bool result;
+
+	r = sign_key_init(&k, ES256, rfc6979_sk, sizeof(rfc6979_sk), NULL);
+	zassert_equal(r, ok, "sign_key_init failed");
+	ecc_restart_init(&rs);
+
+	for (uint8_t i = 0; i < sizeof(max_ops) / sizeof(max_ops[0]); i++) {
+		ecc_restartable_config(max_ops[i]);
+
+		/*the finished operations are not computed again*/
+		passes = 0;
+		do {
+			passes++;
+			ecc_restart_rewind(&rs);
+			r = shared_secret_derive_restartable(
+				&rs, P256, rfc6979_sk, sizeof(rfc6979_sk),
+				ecdh_pk, sizeof(ecdh_pk), secret);
+			if (r == ok) {
+				r = sign_restartable(&rs, &k, ES256, NULL, 0,
+						     NULL, msg, sizeof(msg),
+						     sgn);
+			}
+			if (r == ok) {
+				r = verify_restartable(
+					&rs, NULL, ES256, rfc6979_pk,
+					sizeof(rfc6979_pk), msg, sizeof(msg),
+					sgn, sizeof(sgn), &result);
+			}
+		} while (r == ecc_operation_in_progress);
+		zassert_equal(r, ok, "sliced operations failed");
+		zassert_equal(passes > 1, max_ops[i] != 0,
+			      "wrong number of passes");
+		zassert_mem_equal__(secret, ecdh_secret, sizeof(secret),
+				    "wrong shared secret");
+		zassert_mem_equal__(sgn, rfc6979_sgn, sizeof(sgn),
+				    "wrong signature of the prepared key");
+		zassert_true(result, "signature not verified");
+		ecc_restart_free(&rs);
+
+		/*the encoded key, a wrong signature and the other side*/
+		memset(sgn, 0, sizeof(sgn));
+		memset(secret, 0, sizeof(secret));
+		do {
+			ecc_restart_rewind(&rs);
+			r = sign_restartable(&rs, NULL, ES256, rfc6979_sk,
+					     sizeof(rfc6979_sk), NULL, msg,
+					     sizeof(msg), sgn);
+		} while (r == ecc_operation_in_progress);
+		zassert_equal(r, ok, "sign_restartable failed");
+		zassert_mem_equal__(sgn, rfc6979_sgn, sizeof(sgn),
+				    "wrong signature");
+		ecc_restart_free(&rs);
+		sgn[0] ^= 1;
+		do {
+			ecc_restart_rewind(&rs);
+			r = verify_restartable(&rs, NULL, ES256, rfc6979_pk,
+					       sizeof(rfc6979_pk), msg,
+					       sizeof(msg), sgn, sizeof(sgn),
+					       &result);
+		} while (r == ecc_operation_in_progress);
+		zassert_equal(r, ok, "verify_restartable failed");
+		zassert_false(result, "wrong signature verified");
+		ecc_restart_free(&rs);
+		do {
+			ecc_restart_rewind(&rs);
+			r = shared_secret_derive_restartable(
+				&rs, P256, ecdh_sk, sizeof(ecdh_sk),
+				rfc6979_pk, sizeof(rfc6979_pk), secret);
+		} while (r == ecc_operation_in_progress);
+		zassert_equal(r, ok, "shared_secret_derive_restartable failed");
+		zassert_mem_equal__(secret, ecdh_secret, sizeof(secret),
+				    "wrong shared secret");
+		ecc_restart_free(&rs);
+	}
+
+	/*without a state everything is computed in one go*/
+	memset(sgn, 0, sizeof(sgn));
+	r = sign_restartable(NULL, &k, ES256, NULL, 0, NULL, msg, sizeof(msg),
+			     sgn);
+	zassert_equal(r, ok, "sign_restartable failed");
+	zassert_mem_equal__(sgn, rfc6979_sgn, sizeof(sgn), "wrong signature");
+	r = sign_key_destroy(&k);
+	zassert_equal(r, ok, "sign_key_destroy failed");
+
+	/*a handshake of suite 2 with the keys above, both parties sign with 
+	the RFC6979 key*/
+	struct edhoc_initiator_context ic;
+	struct edhoc_responder_context rc;
+	struct other_party_cred cred_i, cred_r;
+	struct edhoc_initiator_session s_i;
+	struct edhoc_responder_session s_r;
+	const uint8_t suites[] = { SUITE_2 };
+	uint8_t g_x[P_256_PUB_KEY_COMPRESSED_SIZE] = { 0x02 };
+	uint8_t m1[MSG_1_DEFAULT_SIZE], m2[MSG_2_DEFAULT_SIZE];
+	uint8_t m3[MSG_3_DEFAULT_SIZE], m4[MSG_4_DEFAULT_SIZE];
+	uint32_t m1_len = sizeof(m1), m2_len, m3_len, m4_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len = sizeof(ead);
+	uint8_t prk_4x3m[2][PRK_DEFAULT_SIZE];
+	uint8_t th4[2][SHA_DEFAULT_SIZE];
+
+	memcpy(g_x + 1, rfc6979_pk + 1, sizeof(g_x) - 1);
+	test_vector_initiator_init(SIGN_TEST_VEC, &ic, &cred_r);
+	test_vector_responder_init(SIGN_TEST_VEC, &rc, &cred_i);
+	ic.suites_i.ptr = (uint8_t *)suites;
+	ic.suites_i.len = sizeof(suites);
+	rc.suites_r.ptr = (uint8_t *)suites;
+	rc.suites_r.len = sizeof(suites);
+	ic.g_x.ptr = g_x;
+	ic.g_x.len = sizeof(g_x);
+	ic.x.ptr = (uint8_t *)rfc6979_sk;
+	ic.x.len = sizeof(rfc6979_sk);
+	rc.g_y.ptr = (uint8_t *)ecdh_pk;
+	rc.g_y.len = sizeof(ecdh_pk);
+	rc.y.ptr = (uint8_t *)ecdh_sk;
+	rc.y.len = sizeof(ecdh_sk);
+	ic.sk_i.ptr = (uint8_t *)rfc6979_sk;
+	ic.sk_i.len = sizeof(rfc6979_sk);
+	rc.sk_r.ptr = (uint8_t *)rfc6979_sk;
+	rc.sk_r.len = sizeof(rfc6979_sk);
+	cred_i.pk.ptr = (uint8_t *)rfc6979_pk;
+	cred_i.pk.len = sizeof(rfc6979_pk);
+	cred_r.pk.ptr = (uint8_t *)rfc6979_pk;
+	cred_r.pk.len = sizeof(rfc6979_pk);
+
+	edhoc_initiator_session_init_sliced(&s_i);
+	edhoc_responder_session_init_sliced(&s_r);
+	r = edhoc_initiator_step(&ic, &s_i, &cred_r, 1, NULL, 0, m1, &m1_len,
+				 ead, &ead_len, prk_4x3m[0], PRK_DEFAULT_SIZE,
+				 th4[0], SHA_DEFAULT_SIZE);
+	zassert_equal(r, ok, "message 1 failed");
+
+	passes = 0;
+	do {
+		passes++;
+		m2_len = sizeof(m2);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_step(&rc, &s_r, &cred_i, 1, m1, m1_len, m2,
+					 &m2_len, ead, &ead_len, prk_4x3m[1],
+					 PRK_DEFAULT_SIZE, th4[1],
+					 SHA_DEFAULT_SIZE);
+	} while (r == ecc_operation_in_progress);
+	zassert_equal(r, ok, "message 2 failed");
+	zassert_true(passes > 2, "message 2 not sliced");
+
+	/*a step in progress is continued only with its message*/
+	passes = 0;
+	do {
+		passes++;
+		m3_len = sizeof(m3);
+		ead_len = sizeof(ead);
+		r = edhoc_initiator_step(&ic, &s_i, &cred_r, 1, m2, m2_len, m3,
+					 &m3_len, ead, &ead_len, prk_4x3m[0],
+					 PRK_DEFAULT_SIZE, th4[0],
+					 SHA_DEFAULT_SIZE);
+		if (passes == 1) {
+			zassert_equal(r, ecc_operation_in_progress,
+				      "message 3 not sliced");
+			m3_len = sizeof(m3);
+			r = edhoc_initiator_step(
+				&ic, &s_i, &cred_r, 1, m1, m1_len, m3, &m3_len,
+				ead, &ead_len, prk_4x3m[0], PRK_DEFAULT_SIZE,
+				th4[0], SHA_DEFAULT_SIZE);
+			zassert_equal(r, wrong_parameter,
+				      "step continued with another message");
+			r = ecc_operation_in_progress;
+		}
+	} while (r == ecc_operation_in_progress);
+	zassert_equal(r, ok, "message 3 failed");
+	zassert_true(passes > 3, "message 3 not sliced");
+
+	do {
+		m4_len = sizeof(m4);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_step(&rc, &s_r, &cred_i, 1, m3, m3_len, m4,
+					 &m4_len, ead, &ead_len, prk_4x3m[1],
+					 PRK_DEFAULT_SIZE, th4[1],
+					 SHA_DEFAULT_SIZE);
+	} while (r == ecc_operation_in_progress);
+	zassert_equal(r, ok, "message 3 not verified");
+	m1_len = sizeof(m1);
+	ead_len = sizeof(ead);
+	r = edhoc_initiator_step(&ic, &s_i, &cred_r, 1, m4, m4_len, m1, &m1_len,
+				 ead, &ead_len, prk_4x3m[0], PRK_DEFAULT_SIZE,
+				 th4[0], SHA_DEFAULT_SIZE);
+	zassert_equal(r, ok, "message 4 failed");
+	zassert_mem_equal__(prk_4x3m[0], prk_4x3m[1], PRK_DEFAULT_SIZE,
+			    "different PRK_4x3m");
+	zassert_mem_equal__(th4[0], th4[1], SHA_DEFAULT_SIZE,
+			    "different TH4");
+	ecc_restartable_config(0);
+#else
+	ztest_test_skip();
+#endif
+}
+
+/**
+ * @brief       Answers retransmissions of message 1 and message 3 of the
+ *              test vector from a reply cache, in a session and with a
+ *              state token. Without a cache a retransmission is processed
+ *              as a new message.
+ */
+void edhoc_api_test_reply_cache(void)
+{
+	enum err r;
+	struct edhoc_responder_context c;
+	struct other_party_cred cred_i;
+	struct edhoc_responder_session s;
+	struct edhoc_reply_cache cache;
+	struct edhoc_reply_cache_entry entries[8];
+	struct edhoc_state_keys k;
+	struct messages msgs;
+	const uint8_t *prk_4x3m_expected, *th4_expected;
+	const uint8_t key[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	const uint8_t salt[16] = { 1 };
+	const uint8_t zeros[PRK_DEFAULT_SIZE] = { 0 };
+	uint8_t token[EDHOC_STATE_TOKEN_SIZE];
+	uint32_t token_len;
+	uint8_t msg[MSG_2_DEFAULT_SIZE];
+	uint32_t msg_len;
+	uint8_t ead[AD_DEFAULT_SIZE];
+	uint32_t ead_len;
+	uint8_t prk_4x3m[PRK_DEFAULT_SIZE];
+	uint8_t th4[SHA_DEFAULT_SIZE];
+
+	test_vector_responder_init(API_TEST_VEC, &c, &cred_i);
+	test_vector_messages(API_TEST_VEC, &msgs);
+	test_vector_results(API_TEST_VEC, &prk_4x3m_expected, &th4_expected);
+
+	r = edhoc_reply_cache_init(&cache, NULL, 8);
+	zassert_equal(r, wrong_parameter, "cache without entries");
+	r = edhoc_reply_cache_init(&cache, entries, 8);
+	zassert_equal(r, ok, "edhoc_reply_cache_init failed");
+	c.reply_cache = &cache;
+
+	/*message 1 and its retransmission*/
+	edhoc_responder_session_init(&s);
+	for (uint8_t i = 0; i < 2; i++) {
+		msg_len = sizeof(msg);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1,
+					 msgs.m1_len, msg, &msg_len, ead,
+					 &ead_len, prk_4x3m, sizeof(prk_4x3m),
+					 th4, sizeof(th4));
+		zassert_equal(r, i == 0 ? ok : message_retransmitted,
+			      "edhoc_responder_step failed");
+		zassert_equal(msg_len, msgs.m2_len, "wrong message 2 length");
+		zassert_mem_equal__(msg, msgs.m2, msgs.m2_len,
+				    "wrong message 2");
+		zassert_equal(s.state, RESPONDER_WAIT_MSG3, "wrong state");
+	}
+
+	/*message 3 and its retransmission, which leaves the results alone*/
+	for (uint8_t i = 0; i < 2; i++) {
+		memset(prk_4x3m, 0, sizeof(prk_4x3m));
+		msg_len = sizeof(msg);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m3,
+					 msgs.m3_len, msg, &msg_len, ead,
+					 &ead_len, prk_4x3m, sizeof(prk_4x3m),
+					 th4, sizeof(th4));
+		zassert_equal(r, i == 0 ? ok : message_retransmitted,
+			      "edhoc_responder_step failed");
+		zassert_equal(msg_len, msgs.m4_len, "wrong message 4 length");
+		zassert_mem_equal__(msg, msgs.m4, msgs.m4_len,
+				    "wrong message 4");
+		zassert_mem_equal__(prk_4x3m,
+				    i == 0 ? prk_4x3m_expected : zeros,
+				    sizeof(prk_4x3m), "wrong PRK_4x3m");
+		zassert_equal(s.state, RESPONDER_DONE, "wrong state");
+	}
+
+	/*a retransmitted message 1 is still answered after message 3*/
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m1, msgs.m1_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, message_retransmitted, "message 2 not kept");
+	zassert_mem_equal__(msg, msgs.m2, msgs.m2_len, "wrong message 2");
+
+	/*without the cache the finished session rejects message 3*/
+	c.reply_cache = NULL;
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	r = edhoc_responder_step(&c, &s, &cred_i, 1, msgs.m3, msgs.m3_len, msg,
+				 &msg_len, ead, &ead_len, prk_4x3m,
+				 sizeof(prk_4x3m), th4, sizeof(th4));
+	zassert_equal(r, wrong_parameter, "done session stepped");
+
+	/*a retransmitted message 3 of a stateless responder*/
+	r = edhoc_reply_cache_init(&cache, entries, 8);
+	zassert_equal(r, ok, "edhoc_reply_cache_init failed");
+	c.reply_cache = &cache;
+	r = edhoc_state_keys_init(&k, key, sizeof(key), salt, sizeof(salt), 10);
+	zassert_equal(r, ok, "edhoc_state_keys_init failed");
+	msg_len = sizeof(msg);
+	ead_len = sizeof(ead);
+	token_len = sizeof(token);
+	r = edhoc_responder_stateless_msg1(&c, &k, 100, msgs.m1, msgs.m1_len,
+					   msg, &msg_len, ead, &ead_len, token,
+					   &token_len);
+	zassert_equal(r, ok, "edhoc_responder_stateless_msg1 failed");
+	for (uint8_t i = 0; i < 2; i++) {
+		msg_len = sizeof(msg);
+		ead_len = sizeof(ead);
+		r = edhoc_responder_stateless_msg3(
+			&c, &k, 105, token, token_len, &cred_i, 1, msgs.m3,
+			msgs.m3_len, msg, &msg_len, ead, &ead_len, prk_4x3m,
+			sizeof(prk_4x3m), th4, sizeof(th4));
+		zassert_equal(r, i == 0 ? ok : message_retransmitted,
+			      "edhoc_responder_stateless_msg3 failed");
+		zassert_equal(msg_len, msgs.m4_len, "wrong message 4 length");
+		zassert_mem_equal__(msg, msgs.m4, msgs.m4_len,
+				    "wrong message 4");
+	}
+	r = edhoc_state_keys_deinit(&k);
+	zassert_equal(r, ok, "edhoc_state_keys_deinit failed");
+}
@@ -12,6 +12,7 @@
 #define EDHOC_TESTS_H
 
 #include <stdint.h>
+#include <edhoc.h>
 //#include "../../samples/common/test_vec_parser.h"
 
 struct messages {
@@ -37,4 +38,53 @@ enum role { INITIATOR, RESPONDER };
  */
 int test_edhoc(enum role p, uint8_t vec_num);
 
+/**
+ * @brief       Sets up an initiator context and the credential of the 
+ *              responder from a test vector
+ * @param       vec_num the test vector number
+ */
+void test_vector_initiator_init(uint8_t vec_num,
+				struct edhoc_initiator_context *c,
+				struct other_party_cred *cred_r);
+
+/**
+ * @brief       Sets up a responder context and the credential of the 
+ *              initiator from a test vector
+ * @param       vec_num the test vector number
+ */
+void test_vector_responder_init(uint8_t vec_num,
+				struct edhoc_responder_context *c,
+				struct other_party_cred *cred_i);
+
+/**
+ * @brief       Points msgs to the messages of a test vector
+ * @param       vec_num the test vector number
+ */
+void test_vector_messages(uint8_t vec_num, struct messages *msgs);
+
+/**
+ * @brief       Points prk_4x3m and th4 to the results of a test vector
+ * @param       vec_num the test vector number
+ */
+void test_vector_results(uint8_t vec_num, const uint8_t **prk_4x3m,
+			 const uint8_t **th4);
+
+void edhoc_api_test_state_token(void);
+void edhoc_api_test_responder_step(void);
+void edhoc_api_test_session_table(void);
+void edhoc_api_test_responder_jobs(void);
+void edhoc_api_test_cred_store(void);
+void edhoc_api_test_cert_cache(void);
+void edhoc_api_test_prepared_verify_key(void);
+void edhoc_api_test_prepared_sign_key(void);
+void edhoc_api_test_initiator_step(void);
+void edhoc_api_test_ephemeral_key_pool(void);
+void edhoc_api_test_hmac_key(void);
+void edhoc_api_test_incremental_hash(void);
+void edhoc_api_test_ecc_restartable(void);
+void edhoc_api_test_oscore_context(void);
+void edhoc_api_test_oscore_key_update(void);
+void edhoc_api_test_combined_request(void);
+void edhoc_api_test_reply_cache(void);
+
 #endif
\ No newline at end of file
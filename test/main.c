@@ -149,6 +149,29 @@ void test_main(void)
 	ztest_run_test_suite(initiator_tests);
 	ztest_run_test_suite(responder_tests);
 
+	/* EDHOC API tests */
+
+	ztest_test_suite(edhoc_api_tests,
+			 ztest_unit_test(edhoc_api_test_state_token),
+			 ztest_unit_test(edhoc_api_test_responder_step),
+			 ztest_unit_test(edhoc_api_test_session_table),
+			 ztest_unit_test(edhoc_api_test_responder_jobs),
+			 ztest_unit_test(edhoc_api_test_cred_store),
+			 ztest_unit_test(edhoc_api_test_cert_cache),
+			 ztest_unit_test(edhoc_api_test_prepared_verify_key),
+			 ztest_unit_test(edhoc_api_test_prepared_sign_key),
+			 ztest_unit_test(edhoc_api_test_initiator_step),
+			 ztest_unit_test(edhoc_api_test_ephemeral_key_pool),
+			 ztest_unit_test(edhoc_api_test_hmac_key),
+			 ztest_unit_test(edhoc_api_test_incremental_hash),
+			 ztest_unit_test(edhoc_api_test_ecc_restartable),
+			 ztest_unit_test(edhoc_api_test_oscore_context),
+			 ztest_unit_test(edhoc_api_test_oscore_key_update),
+			 ztest_unit_test(edhoc_api_test_combined_request),
+			 ztest_unit_test(edhoc_api_test_reply_cache));
+
+	ztest_run_test_suite(edhoc_api_tests);
+
 	/* OSCORE testvector tests */
 
 	ztest_test_suite(oscore_tests, ztest_unit_test(oscore_client_test1),
@@ -164,4 +187,18 @@ void test_main(void)
 	// 		 ztest_unit_test(oscore_server_test2));
 
 	ztest_run_test_suite(oscore_tests);
+
+	/* OSCORE API tests */
+
+	ztest_test_suite(oscore_api_tests,
+			 ztest_unit_test(oscore_api_test_option_numbers),
+			 ztest_unit_test(oscore_api_test_batch_same_context),
+			 ztest_unit_test(oscore_api_test_prepared_keys),
+			 ztest_unit_test(oscore_api_test_context_table),
+			 ztest_unit_test(oscore_api_test_replay_window),
+			 ztest_unit_test(oscore_api_test_nonce_aad_templates),
+			 ztest_unit_test(oscore_api_test_exchanges),
+			 ztest_unit_test(oscore_api_test_request_table));
+
+	ztest_run_test_suite(oscore_api_tests);
 }
@@ -0,0 +1,718 @@
+/*
+   Copyright (c) 2021 Fraunhofer AISEC. See the COPYRIGHT
+   file at the top-level directory of this distribution.
+
+   Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+   http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+   <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+   option. This file may not be copied, modified, or distributed
+   except according to those terms.
+*/
+
+#include <stdio.h>
+#include <zephyr.h>
+#include <ztest.h>
+#include "oscore.h"
+
+#include "common/crypto_wrapper.h"
+#include "oscore/aad.h"
+#include "oscore/nonce.h"
+
+#include "oscore_tests.h"
+
+/*keying material of RFC8613 Appendix C.1, the test vectors header cannot be 
+included a second time*/
+static uint8_t master_secret[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+				   0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c,
+				   0x0d, 0x0e, 0x0f, 0x10 };
+static uint8_t master_salt[] = { 0x9e, 0x7c, 0xa9, 0x22,
+				 0x23, 0x78, 0x63, 0x40 };
+static uint8_t server_id[] = { 0x01 };
+
+/**
+ * @brief   Initializes a client or a server context with the keys of
+ *          RFC8613 Appendix C.1 and the given client ID
+ */
+static void t1_context_init_id(enum dev_type dev_type, uint8_t *client_id,
+			       uint32_t client_id_len,
+			       struct oscore_request_table *requests,
+			       struct context *c)
+{
+	enum err r;
+	bool server = dev_type == SERVER;
+	struct oscore_init_params params = {
+		.dev_type = dev_type,
+		.master_secret.ptr = master_secret,
+		.master_secret.len = sizeof(master_secret),
+		.sender_id.ptr = server ? server_id : client_id,
+		.sender_id.len = server ? sizeof(server_id) : client_id_len,
+		.recipient_id.ptr = server ? client_id : server_id,
+		.recipient_id.len = server ? client_id_len : sizeof(server_id),
+		.master_salt.ptr = master_salt,
+		.master_salt.len = sizeof(master_salt),
+		.id_context.ptr = NULL,
+		.id_context.len = 0,
+		.aead_alg = OSCORE_AES_CCM_16_64_128,
+		.hkdf = OSCORE_SHA_256,
+		.request_table = requests,
+	};
+
+	r = oscore_context_init(&params, c);
+	zassert_equal(r, ok, "Error in oscore_context_init");
+}
+
+/**
+ * @brief   Initializes a client or a server context with the keys of
+ *          RFC8613 Appendix C.1, the client ID is empty
+ */
+static void t1_context_init(enum dev_type dev_type,
+			    struct oscore_request_table *requests,
+			    struct context *c)
+{
+	t1_context_init_id(dev_type, NULL, 0, requests, c);
+}
+
+/**
+ * @brief   Protects and unprotects a request carrying an option with a
+ *          number above 255 (No-Response, RFC7967) and passes a plain CoAP
+ *          packet through oscore2coap
+ */
+void oscore_api_test_option_numbers(void)
+{
+	enum err r;
+	struct context c_client, c_server;
+	/*Uri-Path "x", No-Response 2, payload "p"*/
+	const uint8_t coap[] = { 0x42, 0x02, 0x10, 0x01, 0xa0, 0x01, 0xb1,
+				 'x',  0xd1, 234,  0x02, 0xff, 'p' };
+	uint8_t buf_oscore[128], buf_coap[128];
+	uint32_t buf_oscore_len = sizeof(buf_oscore);
+	uint32_t buf_coap_len = sizeof(buf_coap);
+	bool oscore_flag;
+
+	t1_context_init(CLIENT, NULL, &c_client);
+	t1_context_init(SERVER, NULL, &c_server);
+
+	r = coap2oscore((uint8_t *)coap, sizeof(coap), buf_oscore,
+			&buf_oscore_len, &c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+
+	r = oscore2coap(buf_oscore, buf_oscore_len, buf_coap, &buf_coap_len,
+			&oscore_flag, &c_server);
+	zassert_equal(r, ok, "Error in oscore2coap");
+	zassert_true(oscore_flag, "OSCORE packet not detected");
+	zassert_equal(buf_coap_len, sizeof(coap), "wrong CoAP length");
+	zassert_mem_equal__(buf_coap, coap, sizeof(coap),
+			    "No-Response not restored");
+
+	/*a CoAP packet without OSCORE option is copied with its length*/
+	buf_coap_len = sizeof(buf_coap);
+	r = oscore2coap((uint8_t *)coap, sizeof(coap), buf_coap, &buf_coap_len,
+			&oscore_flag, &c_server);
+	zassert_equal(r, ok, "Error in oscore2coap");
+	zassert_true(!oscore_flag, "CoAP packet taken for OSCORE");
+	zassert_equal(buf_coap_len, sizeof(coap), "wrong CoAP length");
+}
+
+#define BATCH_SIZE 3
+
+/**
+ * @brief   Converts batches with several packets of the same context. 
+ *          Without own exchanges only the first packet of a server context 
+ *          may use the exchange of the context.
+ */
+void oscore_api_test_batch_same_context(void)
+{
+	enum err r;
+	struct context c_client, c_server;
+	struct oscore_request requests[BATCH_SIZE];
+	struct oscore_request_table t;
+	struct oscore_exchange e_server[BATCH_SIZE];
+	struct oscore_batch_packet p[BATCH_SIZE];
+	uint8_t coap[BATCH_SIZE][16];
+	uint8_t oscore[BATCH_SIZE][64];
+
+	r = oscore_request_table_init(&t, requests, BATCH_SIZE);
+	zassert_equal(r, ok, "Error in oscore_request_table_init");
+	t1_context_init(CLIENT, &t, &c_client);
+	t1_context_init(SERVER, NULL, &c_server);
+
+	/*requests of a client with a table of outstanding requests may 
+	share the exchange of the context*/
+	for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+		const uint8_t req[] = { 0x41, 0x01, 0x00, i, i, 0xb1, 'x' };
+		memcpy(coap[i], req, sizeof(req));
+		p[i] = (struct oscore_batch_packet){
+			.buf_in = coap[i],
+			.buf_in_len = sizeof(req),
+			.buf_out = oscore[i],
+			.buf_out_len = sizeof(oscore[i]),
+			.c = &c_client,
+		};
+	}
+	r = coap2oscore_batch(p, BATCH_SIZE);
+	zassert_equal(r, ok, "Error in coap2oscore_batch");
+	for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+		zassert_equal(p[i].result, ok, "request not protected");
+	}
+
+	/*a server without own exchanges accepts one request per context*/
+	for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+		p[i].buf_in = oscore[i];
+		p[i].buf_in_len = p[i].buf_out_len;
+		p[i].buf_out_len = sizeof(oscore[i]);
+		p[i].c = &c_server;
+	}
+	r = oscore2coap_batch(p, BATCH_SIZE, NULL);
+	zassert_equal(r, ok, "Error in oscore2coap_batch");
+	zassert_equal(p[0].result, ok, "first request rejected");
+	zassert_equal(p[1].result, wrong_parameter, "exchange shared");
+	zassert_equal(p[2].result, wrong_parameter, "exchange shared");
+
+	/*with own exchanges the remaining requests are accepted*/
+	for (uint8_t i = 1; i < BATCH_SIZE; i++) {
+		oscore_exchange_init(&e_server[i]);
+		p[i].e = &e_server[i];
+		p[i].buf_out_len = sizeof(oscore[i]);
+	}
+	r = oscore2coap_batch(&p[1], BATCH_SIZE - 1, NULL);
+	zassert_equal(r, ok, "Error in oscore2coap_batch");
+	zassert_equal(p[1].result, ok, "request not verified");
+	zassert_equal(p[2].result, ok, "request not verified");
+
+	/*the responses are protected with the nonces of their requests and 
+	verified in any order with the table of the client*/
+	for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+		const uint8_t rsp[] = { 0x61, 0x45, 0x00, i, i, 0xff, 'r', i };
+		memcpy(coap[i], rsp, sizeof(rsp));
+		p[i].buf_in = coap[i];
+		p[i].buf_in_len = sizeof(rsp);
+		p[i].buf_out_len = sizeof(oscore[i]);
+	}
+	r = coap2oscore_batch(p, BATCH_SIZE);
+	zassert_equal(r, ok, "Error in coap2oscore_batch");
+	for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+		zassert_equal(p[i].result, ok, "response not protected");
+		p[i].buf_in = oscore[i];
+		p[i].buf_in_len = p[i].buf_out_len;
+		p[i].buf_out_len = sizeof(oscore[i]);
+		p[i].c = &c_client;
+		p[i].e = NULL;
+	}
+	r = oscore2coap_batch(p, BATCH_SIZE, NULL);
+	zassert_equal(r, ok, "Error in oscore2coap_batch");
+	for (uint8_t i = 0; i < BATCH_SIZE; i++) {
+		zassert_equal(p[i].result, ok, "response not verified");
+		zassert_equal(p[i].buf_out_len, 8, "wrong response length");
+		zassert_equal(p[i].buf_out[7], i, "wrong response payload");
+	}
+
+	/*two responses of a server context without own exchanges*/
+	p[0].c = &c_server;
+	p[1].c = &c_server;
+	p[0].buf_in = coap[0];
+	p[1].buf_in = coap[1];
+	p[0].buf_in_len = 8;
+	p[1].buf_in_len = 8;
+	p[0].buf_out_len = sizeof(oscore[0]);
+	p[1].buf_out_len = sizeof(oscore[1]);
+	r = coap2oscore_batch(p, 2);
+	zassert_equal(r, ok, "Error in coap2oscore_batch");
+	zassert_equal(p[0].result, ok, "first response rejected");
+	zassert_equal(p[1].result, wrong_parameter, "exchange shared");
+}
+
+/**
+ * @brief   Encrypts with the prepared Sender Key of a context and decrypts 
+ *          with a key prepared from the same bytes. The prepared keys give 
+ *          the results of the one-shot aead() and are released by 
+ *          oscore_context_deinit().
+ */
+void oscore_api_test_prepared_keys(void)
+{
+	enum err r;
+	struct context c_client;
+	struct aead_key k;
+	uint8_t nonce[13] = { 1, 2, 3 };
+	const uint8_t aad[] = { 0x83, 0x68, 'E', 'n', 'c', 'r', 'y', 'p', 't' };
+	const uint8_t plaintext[] = { 'p', 'r', 'e', 'p', 'a', 'r', 'e', 'd' };
+	uint8_t ciphertext[2][sizeof(plaintext) + 8];
+	uint8_t decrypted[sizeof(plaintext)];
+	uint8_t tag[8];
+
+	t1_context_init(CLIENT, NULL, &c_client);
+	zassert_true(c_client.sc.sender_aead_key.initialized,
+		     "Sender Key not prepared");
+
+	/*the prepared key can be used any number of times*/
+	for (uint8_t i = 0; i < 2; i++) {
+		r = aead_prepared(ENCRYPT, plaintext, sizeof(plaintext),
+				  &c_client.sc.sender_aead_key, nonce,
+				  sizeof(nonce), aad, sizeof(aad),
+				  ciphertext[0], sizeof(plaintext),
+				  &ciphertext[0][sizeof(plaintext)], sizeof(tag));
+		zassert_equal(r, ok, "Error in aead_prepared");
+	}
+	r = aead(ENCRYPT, plaintext, sizeof(plaintext),
+		 c_client.sc.sender_key.ptr, c_client.sc.sender_key.len, nonce,
+		 sizeof(nonce), aad, sizeof(aad), ciphertext[1],
+		 sizeof(plaintext), tag, sizeof(tag));
+	zassert_equal(r, ok, "Error in aead");
+	zassert_mem_equal__(ciphertext[0], ciphertext[1], sizeof(plaintext),
+			    "prepared and one-shot ciphertexts differ");
+	zassert_mem_equal__(&ciphertext[0][sizeof(plaintext)], tag,
+			    sizeof(tag), "prepared and one-shot tags differ");
+
+	r = aead_key_init(&k, c_client.sc.sender_key.ptr,
+			  c_client.sc.sender_key.len, sizeof(tag));
+	zassert_equal(r, ok, "Error in aead_key_init");
+	r = aead_prepared(DECRYPT, ciphertext[0], sizeof(ciphertext[0]), &k,
+			  nonce, sizeof(nonce), aad, sizeof(aad), decrypted,
+			  sizeof(decrypted), tag, sizeof(tag));
+	zassert_equal(r, ok, "Error in aead_prepared");
+	zassert_mem_equal__(decrypted, plaintext, sizeof(plaintext),
+			    "wrong plaintext");
+
+	/*a modified tag and another tag length are rejected*/
+	ciphertext[0][sizeof(plaintext)] ^= 1;
+	r = aead_prepared(DECRYPT, ciphertext[0], sizeof(ciphertext[0]), &k,
+			  nonce, sizeof(nonce), aad, sizeof(aad), decrypted,
+			  sizeof(decrypted), tag, sizeof(tag));
+	zassert_not_equal(r, ok, "modified tag accepted");
+	r = aead_prepared(DECRYPT, ciphertext[0], sizeof(ciphertext[0]), &k,
+			  nonce, sizeof(nonce), aad, sizeof(aad), decrypted,
+			  sizeof(decrypted), tag, 16);
+	zassert_equal(r, wrong_parameter, "other tag length accepted");
+
+	/*released keys cannot be used, releasing them again has no effect*/
+	r = aead_key_destroy(&k);
+	zassert_equal(r, ok, "Error in aead_key_destroy");
+	r = aead_key_destroy(&k);
+	zassert_equal(r, ok, "Error in aead_key_destroy");
+	r = aead_prepared(ENCRYPT, plaintext, sizeof(plaintext), &k, nonce,
+			  sizeof(nonce), aad, sizeof(aad), ciphertext[0],
+			  sizeof(plaintext), tag, sizeof(tag));
+	zassert_equal(r, wrong_parameter, "released key used");
+
+	r = oscore_context_deinit(&c_client);
+	zassert_equal(r, ok, "Error in oscore_context_deinit");
+	zassert_true(!c_client.sc.sender_aead_key.initialized,
+		     "Sender Key not released");
+	zassert_true(!c_client.rc.recipient_aead_key.initialized,
+		     "Recipient Key not released");
+}
+
+/**
+ * @brief   Finds the server contexts of several clients in a context table 
+ *          by the KID of their requests
+ */
+void oscore_api_test_context_table(void)
+{
+	enum err r;
+	struct context c_server[4], c_client;
+	struct context *slots[4];
+	struct context *found;
+	struct oscore_context_table t;
+	uint8_t client_ids[4][1] = { { 0x0a }, { 0x0b }, { 0x0c }, { 0x0d } };
+	struct byte_array kid_context = { .len = 0, .ptr = NULL };
+	struct byte_array kid = { .len = 1 };
+	const uint8_t coap[] = { 0x42, 0x01, 0x10, 0x01, 0xa0, 0x01, 0xb1, 'x' };
+	uint8_t buf_oscore[64], buf_coap[64];
+	uint32_t buf_oscore_len = sizeof(buf_oscore);
+	uint32_t buf_coap_len = sizeof(buf_coap);
+	bool oscore_flag;
+
+	r = oscore_context_table_init(&t, slots, 4);
+	zassert_equal(r, ok, "Error in oscore_context_table_init");
+
+	/*one slot stays empty*/
+	for (uint8_t i = 0; i < 4; i++) {
+		t1_context_init_id(SERVER, client_ids[i], 1, NULL,
+				   &c_server[i]);
+		r = oscore_context_table_insert(&t, &c_server[i]);
+		zassert_equal(r, i < 3 ? ok : oscore_context_table_full,
+			      "Error in oscore_context_table_insert");
+	}
+
+	for (uint8_t i = 0; i < 4; i++) {
+		kid.ptr = client_ids[i];
+		r = oscore_context_table_lookup(&t, &kid_context, &kid, &found);
+		zassert_equal(r, i < 3 ? ok : oscore_kid_recipent_id_mismatch,
+			      "Error in oscore_context_table_lookup");
+		if (i < 3) {
+			zassert_equal_ptr(found, &c_server[i], "wrong context");
+		}
+	}
+
+	/*a request of the second client is verified with its context*/
+	t1_context_init_id(CLIENT, client_ids[1], 1, NULL, &c_client);
+	r = coap2oscore((uint8_t *)coap, sizeof(coap), buf_oscore,
+			&buf_oscore_len, &c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+	r = oscore2coap_table(buf_oscore, buf_oscore_len, buf_coap,
+			      &buf_coap_len, &oscore_flag, &t, &found, NULL);
+	zassert_equal(r, ok, "Error in oscore2coap_table");
+	zassert_true(oscore_flag, "OSCORE packet not detected");
+	zassert_equal_ptr(found, &c_server[1], "wrong context");
+	zassert_equal(buf_coap_len, sizeof(coap), "wrong CoAP length");
+	zassert_mem_equal__(buf_coap, coap, sizeof(coap), "wrong CoAP packet");
+
+	/*after the removal the other contexts are still found*/
+	r = oscore_context_table_remove(&t, &c_server[1]);
+	zassert_equal(r, ok, "Error in oscore_context_table_remove");
+	r = oscore_context_table_remove(&t, &c_server[1]);
+	zassert_equal(r, oscore_kid_recipent_id_mismatch, "removed twice");
+	for (uint8_t i = 0; i < 3; i++) {
+		kid.ptr = client_ids[i];
+		r = oscore_context_table_lookup(&t, &kid_context, &kid, &found);
+		zassert_equal(r, i == 1 ? oscore_kid_recipent_id_mismatch : ok,
+			      "Error in oscore_context_table_lookup");
+	}
+	buf_coap_len = sizeof(buf_coap);
+	r = oscore2coap_table(buf_oscore, buf_oscore_len, buf_coap,
+			      &buf_coap_len, &oscore_flag, &t, &found, NULL);
+	zassert_equal(r, oscore_kid_recipent_id_mismatch,
+		      "request of a removed context accepted");
+
+	r = oscore_context_table_insert(&t, &c_server[0]);
+	zassert_equal(r, oscore_context_table_duplicate, "context added twice");
+}
+
+/**
+ * @brief   Checks the edges of replay windows of 32 and 64 bits, jumps of 
+ *          more than the window width and the largest Partial IV
+ */
+void oscore_api_test_replay_window(void)
+{
+	enum err r;
+	struct replay_window w;
+	uint64_t ssn;
+	uint8_t piv_buf[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	struct byte_array piv = { .len = 5, .ptr = piv_buf };
+
+	r = replay_window_init(&w, REPLAY_WINDOW_MAX_LEN + 1);
+	zassert_equal(r, wrong_parameter, "too wide window accepted");
+
+	/*the default width, the first number may be 0*/
+	r = replay_window_init(&w, 0);
+	zassert_equal(r, ok, "Error in replay_window_init");
+	zassert_equal(w.len, REPLAY_WINDOW_LEN, "wrong default width");
+	r = replay_window_update(&w, 0);
+	zassert_equal(r, ok, "first number rejected");
+	r = replay_check(&w, 0);
+	zassert_equal(r, replayed_packed_received, "replay accepted");
+
+	r = replay_window_init(&w, 32);
+	zassert_equal(r, ok, "Error in replay_window_init");
+	r = replay_window_update(&w, 40);
+	zassert_equal(r, ok, "Error in replay_window_update");
+	r = replay_check(&w, 9);
+	zassert_equal(r, ok, "last number in the window rejected");
+	r = replay_check(&w, 8);
+	zassert_equal(r, replayed_packed_received, "number left of the window");
+	r = replay_window_update(&w, 40);
+	zassert_equal(r, replayed_packed_received, "marked twice");
+
+	/*the whole 64 bit word*/
+	r = replay_window_init(&w, 64);
+	zassert_equal(r, ok, "Error in replay_window_init");
+	r = replay_window_update(&w, 100);
+	zassert_equal(r, ok, "Error in replay_window_update");
+	r = replay_window_update(&w, 37);
+	zassert_equal(r, ok, "last number in the window rejected");
+	r = replay_check(&w, 36);
+	zassert_equal(r, replayed_packed_received, "number left of the window");
+	r = replay_check(&w, 37);
+	zassert_equal(r, replayed_packed_received, "replay accepted");
+
+	/*a jump of the window width clears the bitmap*/
+	r = replay_window_update(&w, 164);
+	zassert_equal(r, ok, "Error in replay_window_update");
+	r = replay_check(&w, 101);
+	zassert_equal(r, ok, "number never received rejected");
+	r = replay_check(&w, 100);
+	zassert_equal(r, replayed_packed_received, "number left of the window");
+
+	/*the largest Partial IV*/
+	r = piv2ssn(&piv, &ssn);
+	zassert_equal(r, ok, "Error in piv2ssn");
+	zassert_true(ssn == MAX_SSN, "wrong sender sequence number");
+	r = replay_window_update(&w, ssn);
+	zassert_equal(r, ok, "largest number rejected");
+	r = replay_check(&w, ssn);
+	zassert_equal(r, replayed_packed_received, "replay accepted");
+	r = replay_check(&w, ssn - 63);
+	zassert_equal(r, ok, "number in the window rejected");
+
+	piv.len = 6;
+	r = piv2ssn(&piv, &ssn);
+	zassert_equal(r, oscore_inpkt_invalid_piv, "too long PIV accepted");
+	piv.len = 0;
+	r = piv2ssn(&piv, &ssn);
+	zassert_equal(r, oscore_inpkt_invalid_piv, "empty PIV accepted");
+}
+
+/**
+ * @brief   Completes the nonces and AADs of the requests of RFC8613 
+ *          Appendix C.4 and C.5 from the templates of their contexts
+ */
+void oscore_api_test_nonce_aad_templates(void)
+{
+	enum err r;
+	struct context c_client, c_server;
+	uint8_t piv_buf[] = { 0x14 };
+	struct byte_array piv = { .len = sizeof(piv_buf), .ptr = piv_buf };
+	uint8_t nonce_buf[NONCE_LEN];
+	struct byte_array nonce = { .len = sizeof(nonce_buf), .ptr = nonce_buf };
+	uint8_t aad_buf[MAX_AAD_LEN];
+	struct byte_array aad = { .len = sizeof(aad_buf), .ptr = aad_buf };
+	const uint8_t c4_nonce[] = { 0x46, 0x22, 0xd4, 0xdd, 0x6d, 0x94, 0x41,
+				     0x68, 0xee, 0xfb, 0x54, 0x98, 0x68 };
+	const uint8_t c4_aad[] = { 0x83, 0x68, 'E',  'n',  'c',  'r',  'y',
+				   'p',  't',  '0',  0x40, 0x48, 0x85, 0x01,
+				   0x81, 0x0a, 0x40, 0x41, 0x14, 0x40 };
+	/*C.5, Sender ID 0x00 and the Common IV of C.2 without master salt*/
+	uint8_t c5_sender_id[] = { 0x00 };
+	uint8_t c5_common_iv_buf[] = { 0xbe, 0x35, 0xae, 0x29, 0x7d,
+				       0x2d, 0xac, 0xe9, 0x10, 0xc5,
+				       0x2e, 0x99, 0xf9 };
+	struct byte_array c5_id = { .len = sizeof(c5_sender_id),
+				    .ptr = c5_sender_id };
+	struct byte_array c5_common_iv = { .len = sizeof(c5_common_iv_buf),
+					   .ptr = c5_common_iv_buf };
+	const uint8_t c5_nonce[] = { 0xbf, 0x35, 0xae, 0x29, 0x7d, 0x2d, 0xac,
+				     0xe9, 0x10, 0xc5, 0x2e, 0x99, 0xed };
+	const uint8_t c5_aad[] = { 0x83, 0x68, 'E',  'n',  'c',  'r',  'y',
+				   'p',  't',  '0',  0x40, 0x49, 0x85, 0x01,
+				   0x81, 0x0a, 0x41, 0x00, 0x41, 0x14, 0x40 };
+	uint8_t template[NONCE_LEN];
+	uint8_t prefix_buf[MAX_AAD_PREFIX_LEN];
+	struct byte_array prefix = { .len = sizeof(prefix_buf),
+				     .ptr = prefix_buf };
+
+	/*the request templates of the client and the server are the same*/
+	t1_context_init(CLIENT, NULL, &c_client);
+	t1_context_init(SERVER, NULL, &c_server);
+	zassert_mem_equal__(c_client.cc.nonce_template,
+			    c_server.cc.nonce_template, NONCE_LEN,
+			    "different nonce templates");
+	zassert_equal(c_client.cc.aad_prefix.len, c_server.cc.aad_prefix.len,
+		      "different AAD prefixes");
+
+	r = create_nonce(c_client.cc.nonce_template, &piv, &nonce);
+	zassert_equal(r, ok, "Error in create_nonce");
+	zassert_equal(nonce.len, NONCE_LEN, "wrong nonce length");
+	zassert_mem_equal__(nonce.ptr, c4_nonce, NONCE_LEN, "wrong nonce");
+	r = create_aad(NULL, 0, &c_client.cc.aad_prefix, &piv, &aad);
+	zassert_equal(r, ok, "Error in create_aad");
+	zassert_equal(aad.len, sizeof(c4_aad), "wrong AAD length");
+	zassert_mem_equal__(aad.ptr, c4_aad, sizeof(c4_aad), "wrong AAD");
+
+	/*a non-empty ID_PIV*/
+	r = create_nonce_template(&c5_id, &c5_common_iv, template);
+	zassert_equal(r, ok, "Error in create_nonce_template");
+	nonce.len = sizeof(nonce_buf);
+	r = create_nonce(template, &piv, &nonce);
+	zassert_equal(r, ok, "Error in create_nonce");
+	zassert_mem_equal__(nonce.ptr, c5_nonce, NONCE_LEN, "wrong nonce");
+	r = create_aad_prefix(OSCORE_AES_CCM_16_64_128, &c5_id, &prefix);
+	zassert_equal(r, ok, "Error in create_aad_prefix");
+	aad.len = sizeof(aad_buf);
+	r = create_aad(NULL, 0, &prefix, &piv, &aad);
+	zassert_equal(r, ok, "Error in create_aad");
+	zassert_equal(aad.len, sizeof(c5_aad), "wrong AAD length");
+	zassert_mem_equal__(aad.ptr, c5_aad, sizeof(c5_aad), "wrong AAD");
+}
+
+/**
+ * @brief   Interleaves two requests of one client context with own 
+ *          exchanges. Every response is verified with the exchange of its 
+ *          request, also if the responses arrive in the opposite order.
+ */
+void oscore_api_test_exchanges(void)
+{
+	enum err r;
+	struct context c_client, c_server;
+	struct oscore_exchange e_client[2], e_server[2];
+	uint8_t coap[2][16];
+	uint8_t oscore[2][64];
+	uint32_t oscore_len[2];
+	uint8_t buf[64];
+	uint32_t buf_len;
+	uint8_t *coap_in_place;
+	uint32_t coap_in_place_len;
+	bool oscore_flag;
+
+	t1_context_init(CLIENT, NULL, &c_client);
+	t1_context_init(SERVER, NULL, &c_server);
+
+	/*each request reserves its own sender sequence number*/
+	for (uint8_t i = 0; i < 2; i++) {
+		const uint8_t req[] = { 0x41, 0x01, 0x00, i, i, 0xb1, 'x' };
+		memcpy(coap[i], req, sizeof(req));
+		oscore_exchange_init(&e_client[i]);
+		oscore_len[i] = sizeof(oscore[i]);
+		r = coap2oscore_exchange(coap[i], sizeof(req), oscore[i],
+					 &oscore_len[i], &c_client,
+					 &e_client[i]);
+		zassert_equal(r, ok, "Error in coap2oscore_exchange");
+	}
+	zassert_true(c_client.sc.sender_seq_num == 2,
+		     "sender sequence number not reserved");
+	zassert_true(memcmp(e_client[0].nonce.ptr, e_client[1].nonce.ptr,
+			    NONCE_LEN) != 0,
+		     "nonce reused");
+
+	/*the server verifies the requests in the opposite order*/
+	for (int8_t i = 1; i >= 0; i--) {
+		oscore_exchange_init(&e_server[i]);
+		buf_len = sizeof(buf);
+		r = oscore2coap_exchange(oscore[i], oscore_len[i], buf,
+					 &buf_len, &oscore_flag, &c_server,
+					 &e_server[i]);
+		zassert_equal(r, ok, "Error in oscore2coap_exchange");
+		zassert_equal(buf[4], (uint8_t)i, "wrong request");
+	}
+
+	for (uint8_t i = 0; i < 2; i++) {
+		const uint8_t rsp[] = { 0x61, 0x45, 0x00, i, i, 0xff, 'r', i };
+		memcpy(coap[i], rsp, sizeof(rsp));
+		oscore_len[i] = sizeof(oscore[i]);
+		r = coap2oscore_exchange(coap[i], sizeof(rsp), oscore[i],
+					 &oscore_len[i], &c_server,
+					 &e_server[i]);
+		zassert_equal(r, ok, "Error in coap2oscore_exchange");
+	}
+
+	/*a response does not verify with the exchange of another request*/
+	buf_len = sizeof(buf);
+	r = oscore2coap_exchange(oscore[0], oscore_len[0], buf, &buf_len,
+				 &oscore_flag, &c_client, &e_client[1]);
+	zassert_not_equal(r, ok, "response of another request accepted");
+
+	/*the second response is decrypted in place*/
+	r = oscore2coap_in_place(oscore[1], oscore_len[1], &coap_in_place,
+				 &coap_in_place_len, &oscore_flag, &c_client,
+				 &e_client[1]);
+	zassert_equal(r, ok, "Error in oscore2coap_in_place");
+	zassert_true(oscore_flag, "OSCORE packet not detected");
+	zassert_equal(coap_in_place_len, 8, "wrong response length");
+	zassert_equal(coap_in_place[7], 1, "wrong response payload");
+
+	buf_len = sizeof(buf);
+	r = oscore2coap_exchange(oscore[0], oscore_len[0], buf, &buf_len,
+				 &oscore_flag, &c_client, &e_client[0]);
+	zassert_equal(r, ok, "Error in oscore2coap_exchange");
+	zassert_equal(buf_len, 8, "wrong response length");
+	zassert_equal(buf[7], 0, "wrong response payload");
+}
+
+/**
+ * @brief   Keeps the Partial IVs of outstanding requests by token. A 
+ *          response is verified once, the request is removed afterwards.
+ */
+void oscore_api_test_request_table(void)
+{
+	enum err r;
+	struct context c_client, c_server;
+	struct oscore_request requests[2];
+	struct oscore_request_table t;
+	struct oscore_request *reserved;
+	struct oscore_exchange e_server;
+	uint8_t token_buf[] = { 0xaa, 0x01 };
+	uint8_t piv_buf[] = { 0x07 };
+	uint8_t piv_out_buf[MAX_PIV_LEN];
+	struct byte_array token = { .len = sizeof(token_buf), .ptr = token_buf };
+	struct byte_array piv = { .len = sizeof(piv_buf), .ptr = piv_buf };
+	struct byte_array piv_out = { .len = sizeof(piv_out_buf),
+				      .ptr = piv_out_buf };
+	uint8_t oscore[3][64];
+	uint32_t oscore_len[3];
+	uint8_t buf[64];
+	uint32_t buf_len;
+	bool oscore_flag;
+
+	/*a request with the same token replaces the outstanding one*/
+	r = oscore_request_table_init(&t, requests, 2);
+	zassert_equal(r, ok, "Error in oscore_request_table_init");
+	r = oscore_request_table_insert(&t, &token, &piv);
+	zassert_equal(r, ok, "Error in oscore_request_table_insert");
+	piv_buf[0] = 0x08;
+	r = oscore_request_table_insert(&t, &token, &piv);
+	zassert_equal(r, ok, "Error in oscore_request_table_insert");
+	r = oscore_request_table_lookup(&t, &token, &piv_out);
+	zassert_equal(r, ok, "Error in oscore_request_table_lookup");
+	zassert_equal(piv_out.len, 1, "wrong PIV length");
+	zassert_equal(piv_out.ptr[0], 0x08, "request not replaced");
+	r = oscore_request_table_remove(&t, &token);
+	zassert_equal(r, ok, "Error in oscore_request_table_remove");
+	r = oscore_request_table_remove(&t, &token);
+	zassert_equal(r, oscore_request_not_found, "removed twice");
+	r = oscore_request_table_lookup(&t, &token, &piv_out);
+	zassert_equal(r, oscore_request_not_found, "removed request found");
+
+	/*a reserved entry is not matched before its PIV is set*/
+	r = oscore_request_table_reserve(&t, &token, &reserved);
+	zassert_equal(r, ok, "Error in oscore_request_table_reserve");
+	r = oscore_request_table_lookup(&t, &token, &piv_out);
+	zassert_equal(r, oscore_request_not_found, "pending request found");
+	oscore_request_table_release(&t, reserved);
+	r = oscore_request_table_remove(&t, &token);
+	zassert_equal(r, oscore_request_not_found, "released request found");
+
+	/*a client with two outstanding requests at most*/
+	t1_context_init(CLIENT, &t, &c_client);
+	t1_context_init(SERVER, NULL, &c_server);
+	for (uint8_t i = 0; i < 3; i++) {
+		const uint8_t req[] = { 0x41, 0x01, 0x00, i, i, 0xb1, 'x' };
+		oscore_len[i] = sizeof(oscore[i]);
+		r = coap2oscore((uint8_t *)req, sizeof(req), oscore[i],
+				&oscore_len[i], &c_client);
+		zassert_equal(r, i < 2 ? ok : oscore_request_table_full,
+			      "Error in coap2oscore");
+	}
+	/*the request which did not fit took no sender sequence number*/
+	zassert_equal(c_client.sc.sender_seq_num, 2,
+		      "sequence number of a rejected request spent");
+
+	/*the response to the second request*/
+	const uint8_t rsp[] = { 0x61, 0x45, 0x00, 1, 1, 0xff, 'r' };
+	oscore_exchange_init(&e_server);
+	buf_len = sizeof(buf);
+	r = oscore2coap_exchange(oscore[1], oscore_len[1], buf, &buf_len,
+				 &oscore_flag, &c_server, &e_server);
+	zassert_equal(r, ok, "Error in oscore2coap_exchange");
+	oscore_len[2] = sizeof(oscore[2]);
+	r = coap2oscore_exchange((uint8_t *)rsp, sizeof(rsp), oscore[2],
+				 &oscore_len[2], &c_server, &e_server);
+	zassert_equal(r, ok, "Error in coap2oscore_exchange");
+
+	for (uint8_t i = 0; i < 2; i++) {
+		memcpy(oscore[0], oscore[2], oscore_len[2]);
+		buf_len = sizeof(buf);
+		r = oscore2coap(oscore[0], oscore_len[2], buf, &buf_len,
+				&oscore_flag, &c_client);
+		zassert_equal(r, i == 0 ? ok : oscore_request_not_found,
+			      "Error in oscore2coap");
+		if (i == 0) {
+			zassert_equal(buf_len, sizeof(rsp),
+				      "wrong response length");
+			zassert_mem_equal__(buf, rsp, sizeof(rsp),
+					    "wrong response");
+		}
+	}
+
+	/*the verified response freed an entry for the third request*/
+	const uint8_t req[] = { 0x41, 0x01, 0x00, 2, 2, 0xb1, 'x' };
+	uint8_t token_2_buf[] = { 2 };
+	struct byte_array token_2 = { .len = sizeof(token_2_buf),
+				      .ptr = token_2_buf };
+	oscore_len[2] = sizeof(oscore[2]);
+	r = coap2oscore((uint8_t *)req, sizeof(req), oscore[2], &oscore_len[2],
+			&c_client);
+	zassert_equal(r, ok, "Error in coap2oscore");
+	piv_out.len = sizeof(piv_out_buf);
+	r = oscore_request_table_lookup(&t, &token_2, &piv_out);
+	zassert_equal(r, ok, "Error in oscore_request_table_lookup");
+	zassert_equal(piv_out.len, 1, "wrong PIV length");
+	zassert_equal(piv_out.ptr[0], 2, "a Partial IV was skipped");
+}
@@ -19,4 +19,13 @@ void oscore_server_test4(void);
 void oscore_server_test6(void);
 void oscore_misc_test8(void);
 
+void oscore_api_test_option_numbers(void);
+void oscore_api_test_batch_same_context(void);
+void oscore_api_test_prepared_keys(void);
+void oscore_api_test_context_table(void);
+void oscore_api_test_replay_window(void);
+void oscore_api_test_nonce_aad_templates(void);
+void oscore_api_test_exchanges(void);
+void oscore_api_test_request_table(void);
+
 #endif
\ No newline at end of file